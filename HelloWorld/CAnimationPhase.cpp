@@ -0,0 +1,208 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CAnimationPhase.h"
+#include "CSimulationClock.h"
+#include "CWorkStealingPool.h"
+#include "PreciseTimer.h"
+
+namespace irr
+{
+namespace scene
+{
+
+CAnimationPhase::CAnimationPhase(u32 threadCount)
+	: Pool(0), GrainSize(64), TimeMs(0), LastAnimateTimeMs(0), LastCommitTimeMs(0)
+{
+	#ifdef _DEBUG
+	setDebugName("CAnimationPhase");
+	#endif
+
+	setThreadCount(threadCount);
+}
+
+
+CAnimationPhase::~CAnimationPhase()
+{
+	releaseAnimators();
+	delete Pool;
+}
+
+
+void CAnimationPhase::setThreadCount(u32 threadCount)
+{
+	delete Pool;
+	Pool = new CWorkStealingPool(threadCount);
+}
+
+
+u32 CAnimationPhase::getThreadCount() const
+{
+	return Pool->getThreadCount();
+}
+
+
+bool CAnimationPhase::isParallelSafe(const ISceneNodeAnimator* animator)
+{
+	// these only read their own state and the time, and only write the
+	// relative transformation of the node; none of them grabs or drops,
+	// the reference counts are not thread safe
+	switch (animator->getType())
+	{
+	case ESNAT_FLY_CIRCLE:
+	case ESNAT_FLY_STRAIGHT:
+	case ESNAT_FOLLOW_SPLINE:
+	case ESNAT_ROTATION:
+		return true;
+	default:
+		return animator->getType() == ESNAT_INTERPOLATION;
+	}
+}
+
+
+void CAnimationPhase::adoptAnimators(ISceneNode* root)
+{
+	if (!root)
+		return;
+
+	if (Roots.linear_search(root) < 0)
+	{
+		root->grab();
+		Roots.push_back(root);
+	}
+
+	adoptNode(root);
+}
+
+
+void CAnimationPhase::adoptNode(ISceneNode* node)
+{
+	const core::list<ISceneNodeAnimator*>& animators = node->getAnimators();
+
+	bool safe = !animators.empty();
+	for (core::list<ISceneNodeAnimator*>::ConstIterator it = animators.begin(); safe && it != animators.end(); ++it)
+	{
+		// an animator of several nodes keeps state for all of them
+		safe = isParallelSafe(*it) && (*it)->getReferenceCount() == 1;
+	}
+
+	if (safe)
+	{
+		// a task per node, even if it was adopted before: two tasks of one
+		// node could run at the same time
+		STask* task = 0;
+		for (u32 i=0; i<Tasks.size() && !task; ++i)
+			if (Tasks[i].Node == node)
+				task = &Tasks[i];
+
+		if (!task)
+		{
+			Tasks.push_back(STask());
+			task = &Tasks.getLast();
+			task->Node = node;
+			node->grab();
+		}
+
+		for (core::list<ISceneNodeAnimator*>::ConstIterator it = animators.begin(); it != animators.end(); ++it)
+		{
+			(*it)->grab();
+			task->Animators.push_back(*it);
+		}
+		node->removeAnimators();
+	}
+
+	const core::list<ISceneNode*>& children = node->getChildren();
+	for (core::list<ISceneNode*>::ConstIterator it = children.begin(); it != children.end(); ++it)
+		adoptNode(*it);
+}
+
+
+void CAnimationPhase::releaseAnimators()
+{
+	for (u32 i=0; i<Tasks.size(); ++i)
+	{
+		STask& task = Tasks[i];
+		for (u32 a=0; a<task.Animators.size(); ++a)
+		{
+			task.Node->addAnimator(task.Animators[a]);
+			task.Animators[a]->drop();
+		}
+		task.Node->drop();
+	}
+	Tasks.clear();
+
+	for (u32 i=0; i<Roots.size(); ++i)
+		Roots[i]->drop();
+	Roots.clear();
+}
+
+
+void CAnimationPhase::removeOrphans()
+{
+	for (u32 i=Tasks.size(); i--; )
+	{
+		// only held by this phase: removed from the scene and forgotten
+		STask& task = Tasks[i];
+		if (task.Node->getReferenceCount() != 1)
+			continue;
+
+		for (u32 a=0; a<task.Animators.size(); ++a)
+			task.Animators[a]->drop();
+		task.Node->drop();
+
+		Tasks[i] = Tasks.getLast();
+		Tasks.erase(Tasks.size() - 1);
+	}
+}
+
+
+void CAnimationPhase::animateTasks(void* data, u32 begin, u32 end)
+{
+	CAnimationPhase* phase = (CAnimationPhase*)data;
+
+	for (u32 i=begin; i<end; ++i)
+	{
+		const STask& task = phase->Tasks[i];
+
+		// drawAll() does not animate hidden nodes or their children either
+		if (!task.Node->isTrulyVisible())
+			continue;
+
+		for (u32 a=0; a<task.Animators.size(); ++a)
+			task.Animators[a]->animateNode(task.Node, phase->TimeMs);
+	}
+}
+
+
+void CAnimationPhase::commitTransformations(ISceneNode* node)
+{
+	if (!node->isVisible())
+		return;
+
+	node->updateAbsolutePosition();
+
+	const core::list<ISceneNode*>& children = node->getChildren();
+	for (core::list<ISceneNode*>::ConstIterator it = children.begin(); it != children.end(); ++it)
+		commitTransformations(*it);
+}
+
+
+void CAnimationPhase::animate(u32 timeMs)
+{
+	removeOrphans();
+	TimeMs = timeMs;
+
+	const f64 start = getPreciseTimeMs();
+	Pool->run(animateTasks, this, Tasks.size(), GrainSize);
+	const f64 animated = getPreciseTimeMs();
+
+	for (u32 i=0; i<Roots.size(); ++i)
+		commitTransformations(Roots[i]);
+
+	LastAnimateTimeMs = animated - start;
+	LastCommitTimeMs = getPreciseTimeMs() - animated;
+}
+
+} // end namespace scene
+} // end namespace irr
@@ -0,0 +1,104 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_ANIMATION_PHASE_H_INCLUDED__
+#define __C_ANIMATION_PHASE_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+
+class CWorkStealingPool;
+
+namespace scene
+{
+
+//! Runs the animators of many nodes on several threads before drawAll().
+/** drawAll() walks the scene graph and runs the animators of one node after
+the other. adoptAnimators() takes the animators which only move their own
+node, like rotations, fly circles and splines, off the nodes of a subtree
+and animate() runs them itself, one task per node, spread over a work
+stealing pool. Since such animators only change the relative transformation
+of their node, the nodes are independent of each other, also parents of
+their children. The absolute transformations are updated afterwards in one
+walk from the top of the subtree down, so every child sees the final
+transformation of its parent.
+
+Nodes with any other animator, like the collision response and the FPS
+camera, keep all their animators, in order, and are animated by drawAll()
+as before. So do animators shared by several nodes, they keep state per
+animator. */
+class CAnimationPhase : public virtual IReferenceCounted
+{
+public:
+
+	//! \param threadCount Threads including the caller, 0 for one per hardware thread.
+	CAnimationPhase(u32 threadCount=0);
+
+	//! Gives the adopted animators back to their nodes.
+	virtual ~CAnimationPhase();
+
+	//! Changes the amount of threads.
+	void setThreadCount(u32 threadCount);
+
+	u32 getThreadCount() const;
+
+	//! Sets how many nodes a thread animates per chunk of work.
+	void setGrainSize(u32 nodes) { GrainSize = core::max_(nodes, 1u); }
+
+	//! Takes the animators which can run in parallel off the nodes below root.
+	/** Can be called again for nodes added later. */
+	void adoptAnimators(ISceneNode* root);
+
+	//! Gives all adopted animators back to their nodes.
+	void releaseAnimators();
+
+	//! Runs the adopted animators and updates the absolute transformations.
+	void animate(u32 timeMs);
+
+	//! Returns true if animator only touches its node and may run on another thread.
+	static bool isParallelSafe(const ISceneNodeAnimator* animator);
+
+	//! Amount of nodes with adopted animators.
+	u32 getNodeCount() const { return Tasks.size(); }
+
+	//! Time the animators took in the last animate().
+	f64 getLastAnimateTimeMs() const { return LastAnimateTimeMs; }
+
+	//! Time updating the absolute transformations took in the last animate().
+	f64 getLastCommitTimeMs() const { return LastCommitTimeMs; }
+
+private:
+
+	struct STask
+	{
+		//! Grabbed, so a node removed from the scene stays valid until released.
+		ISceneNode* Node;
+		core::array<ISceneNodeAnimator*> Animators;
+	};
+
+	void adoptNode(ISceneNode* node);
+
+	//! Drops the tasks of nodes which are no longer in the scene.
+	void removeOrphans();
+
+	static void animateTasks(void* data, u32 begin, u32 end);
+
+	static void commitTransformations(ISceneNode* node);
+
+	CWorkStealingPool* Pool;
+	core::array<STask> Tasks;
+	core::array<ISceneNode*> Roots;
+	u32 GrainSize;
+	u32 TimeMs;
+
+	f64 LastAnimateTimeMs;
+	f64 LastCommitTimeMs;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
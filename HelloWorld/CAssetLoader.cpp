@@ -0,0 +1,468 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CAssetLoader.h"
+#include "CFrameProfiler.h"
+#include "CThreadPool.h"
+#include "CookedMeshFormat.h"
+#include "CookedTextureFormat.h"
+#include "PreciseTimer.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+namespace irr
+{
+
+namespace
+{
+
+void logf(ILogger* logger, const c8* format, ...)
+{
+	c8 buffer[512];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	buffer[sizeof(buffer)-1] = 0;
+	logger->log(buffer, ELL_INFORMATION);
+}
+
+} // end anonymous namespace
+
+
+CAssetLoader::CAssetLoader(IrrlichtDevice* device, scene::CCookedMeshLoader* cookedMeshLoader)
+	: Device(device), CookedMeshLoader(cookedMeshLoader), LoadTimeMs(0.0), ThreadCount(0)
+{
+}
+
+
+CAssetLoader::~CAssetLoader()
+{
+	for (u32 i=0; i<Assets.size(); ++i)
+	{
+		// only set if load() was never called
+		delete [] Assets[i]->Data;
+		if (Assets[i]->File)
+			Assets[i]->File->drop();
+		if (Assets[i]->Image)
+			Assets[i]->Image->drop();
+		if (Assets[i]->Mesh)
+			Assets[i]->Mesh->drop();
+		delete Assets[i];
+	}
+}
+
+
+void CAssetLoader::addTexture(const io::path& filename, bool mipMaps)
+{
+	io::IFileSystem* fileSystem = Device->getFileSystem();
+
+	// the driver finds textures by their absolute name first
+	const io::path absolute = fileSystem->getAbsolutePath(filename);
+	if (Device->getVideoDriver()->findTexture(absolute))
+		return;
+
+	const io::path cooked = video::getCookedTextureName(absolute);
+	SAsset* asset = fileSystem->existFile(cooked) ?
+		addAsset(EAT_COOKED_TEXTURE, absolute, cooked) :
+		addAsset(EAT_TEXTURE, absolute, absolute);
+	asset->MipMaps = mipMaps;
+}
+
+
+void CAssetLoader::addMesh(const io::path& source)
+{
+	io::IFileSystem* fileSystem = Device->getFileSystem();
+	scene::IMeshCache* meshCache = Device->getSceneManager()->getMeshCache();
+
+	// the same choice getGameMesh() makes
+	const io::path cooked = scene::getCookedMeshName(fileSystem, source);
+	if (CookedMeshLoader && fileSystem->existFile(cooked))
+	{
+		if (!meshCache->isMeshLoaded(cooked))
+			addAsset(EAT_COOKED_MESH, cooked, fileSystem->getAbsolutePath(cooked));
+	}
+	else if (!meshCache->isMeshLoaded(source))
+		addAsset(EAT_MESH, source, fileSystem->getAbsolutePath(source));
+}
+
+
+CAssetLoader::SAsset* CAssetLoader::addAsset(E_ASSET_TYPE type, const io::path& name, const io::path& fileName)
+{
+	for (u32 i=0; i<Assets.size(); ++i)
+		if (Assets[i]->Name == name)
+			return Assets[i];
+
+	SAsset* asset = new SAsset();
+	asset->Type = type;
+	asset->Name = name;
+	asset->FileName = fileName;
+	asset->Loader = this;
+	asset->MipMaps = true;
+	asset->Data = 0;
+	asset->Size = 0;
+	asset->File = 0;
+	asset->ImageLoader = 0;
+	asset->Image = 0;
+	asset->Mesh = 0;
+	asset->Timing.Name = name;
+	asset->Timing.ReadMs = 0.0;
+	asset->Timing.DecodeMs = 0.0;
+	asset->Timing.MainThreadMs = 0.0;
+	asset->Timing.FileBytes = 0;
+	asset->Timing.TextureBytes = 0;
+	asset->Timing.Cooked = type == EAT_COOKED_TEXTURE || type == EAT_COOKED_MESH;
+	asset->Timing.Loaded = false;
+	Assets.push_back(asset);
+	return asset;
+}
+
+
+u32 CAssetLoader::load(u32 threadCount, ProgressCallback callback, void* userData)
+{
+	const f64 start = getPreciseTimeMs();
+	u32 failed = 0;
+	u32 loaded = 0;
+
+	{
+		CThreadPool pool(threadCount);
+		ThreadCount = pool.getThreadCount();
+
+		// the workers decode an asset while the next one is read, and the
+		// main thread uploads what is done in between
+		for (u32 i=0; i<Assets.size(); ++i)
+		{
+			read(*Assets[i]);
+			pool.addJob(loadAssetJob, Assets[i]);
+			failed += uploadFinished(false, loaded, callback, userData);
+		}
+
+		while (loaded < Assets.size())
+			failed += uploadFinished(true, loaded, callback, userData);
+	}
+
+	LoadTimeMs = getPreciseTimeMs() - start;
+	return failed;
+}
+
+
+u32 CAssetLoader::uploadFinished(bool wait, u32& loaded, ProgressCallback callback, void* userData)
+{
+	core::array<SAsset*> finished;
+	{
+		std::unique_lock<std::mutex> lock(FinishedMutex);
+		while (wait && Finished.empty())
+			FinishedAdded.wait(lock);
+		finished = Finished;
+		Finished.set_used(0);
+	}
+
+	u32 failed = 0;
+	for (u32 i=0; i<finished.size(); ++i)
+	{
+		upload(*finished[i]);
+		if (!finished[i]->Timing.Loaded)
+			++failed;
+
+		++loaded;
+		if (callback)
+			callback(loaded, Assets.size(), finished[i]->Name, userData);
+	}
+	return failed;
+}
+
+
+void CAssetLoader::loadAssetJob(void* data)
+{
+	SAsset* asset = (SAsset*)data;
+	CAssetLoader* loader = asset->Loader;
+
+	loader->decode(*asset);
+
+	{
+		std::lock_guard<std::mutex> lock(loader->FinishedMutex);
+		loader->Finished.push_back(asset);
+	}
+	loader->FinishedAdded.notify_one();
+}
+
+
+void CAssetLoader::read(SAsset& asset)
+{
+	const f64 start = getPreciseTimeMs();
+	io::IFileSystem* fileSystem = Device->getFileSystem();
+
+	io::IReadFile* file = fileSystem->createAndOpenFile(asset.FileName);
+	if (file)
+	{
+		const long size = file->getSize();
+		if (size > 0)
+		{
+			asset.Data = new c8[size];
+			asset.Size = (u32)size;
+			if (file->read(asset.Data, asset.Size) != (s32)asset.Size)
+			{
+				delete [] asset.Data;
+				asset.Data = 0;
+				asset.Size = 0;
+			}
+		}
+		file->drop();
+	}
+
+	if (asset.Data && asset.Type == EAT_TEXTURE)
+	{
+		// the memory file takes the data and the name, which selects the image loader
+		asset.File = fileSystem->createMemoryReadFile(asset.Data, asset.Size, asset.Name, true);
+		asset.Data = 0;
+
+		// like createImageFromFile(): the last loader taking the extension,
+		// else the last one recognizing the data
+		video::IVideoDriver* driver = Device->getVideoDriver();
+		for (s32 i=(s32)driver->getImageLoaderCount()-1; i>=0 && !asset.ImageLoader; --i)
+			if (driver->getImageLoader(i)->isALoadableFileExtension(asset.Name))
+				asset.ImageLoader = driver->getImageLoader(i);
+		for (s32 i=(s32)driver->getImageLoaderCount()-1; i>=0 && !asset.ImageLoader; --i)
+		{
+			asset.File->seek(0);
+			if (driver->getImageLoader(i)->isALoadableFileFormat(asset.File))
+				asset.ImageLoader = driver->getImageLoader(i);
+		}
+		asset.File->seek(0);
+	}
+
+	const f64 end = getPreciseTimeMs();
+	asset.Timing.ReadMs = end - start;
+	asset.Timing.FileBytes = asset.Size;
+
+	if (CFrameProfiler* profiler = CFrameProfiler::getActive())
+		profiler->addEvent(core::stringc("read ") + asset.Name, start, end);
+}
+
+
+void CAssetLoader::decode(SAsset& asset)
+{
+	if (!asset.Data && !asset.File)
+		return;
+	const f64 start = getPreciseTimeMs();
+
+	switch (asset.Type)
+	{
+	case EAT_TEXTURE:
+		if (asset.ImageLoader)
+		{
+			// the loader only builds an image in memory, the driver is not used
+			if (core::hasFileExtension(asset.Name, "jpg", "jpeg"))
+			{
+				std::lock_guard<std::mutex> lock(JpegMutex);
+				asset.Image = asset.ImageLoader->loadImage(asset.File);
+			}
+			else
+				asset.Image = asset.ImageLoader->loadImage(asset.File);
+		}
+		asset.File->drop();
+		asset.File = 0;
+		break;
+
+	case EAT_COOKED_TEXTURE:
+		{
+			// nothing to decode, the data is uploaded as it is
+			video::SCookedTextureHeader header;
+			if (asset.Size >= sizeof(header))
+				memcpy(&header, asset.Data, sizeof(header));
+			if (asset.Size < sizeof(header) || !video::isCookedTextureValid(header, asset.Size))
+			{
+				delete [] asset.Data;
+				asset.Data = 0;
+			}
+		}
+		break;
+
+	case EAT_COOKED_MESH:
+		asset.Mesh = CookedMeshLoader->readMesh((const u8*)asset.Data, asset.Size, asset.Textures);
+		delete [] asset.Data;
+		asset.Data = 0;
+		break;
+
+	case EAT_MESH:
+		// the mesh loaders use the driver, the main thread parses the data
+		break;
+	}
+
+	const f64 end = getPreciseTimeMs();
+	asset.Timing.DecodeMs = end - start;
+
+	if (CFrameProfiler* profiler = CFrameProfiler::getActive())
+		profiler->addEvent(core::stringc("decode ") + asset.Name, start, end);
+}
+
+
+void CAssetLoader::upload(SAsset& asset)
+{
+	const f64 start = getPreciseTimeMs();
+	video::IVideoDriver* driver = Device->getVideoDriver();
+	scene::ISceneManager* smgr = Device->getSceneManager();
+
+	const bool mipMaps = driver->getTextureCreationFlag(video::ETCF_CREATE_MIP_MAPS);
+	video::ITexture* texture = 0;
+
+	// a mesh finished earlier may have loaded the texture already
+	if (asset.Type == EAT_TEXTURE || asset.Type == EAT_COOKED_TEXTURE)
+	{
+		texture = driver->findTexture(asset.Name);
+		if (texture)
+		{
+			if (asset.Image)
+				asset.Image->drop();
+			asset.Image = 0;
+			delete [] asset.Data;
+			asset.Data = 0;
+		}
+	}
+
+	switch (asset.Type)
+	{
+	case EAT_TEXTURE:
+		if (asset.Image)
+		{
+			driver->setTextureCreationFlag(video::ETCF_CREATE_MIP_MAPS, asset.MipMaps);
+			texture = driver->addTexture(asset.Name, asset.Image);
+			asset.Image->drop();
+			asset.Image = 0;
+		}
+		break;
+
+	case EAT_COOKED_TEXTURE:
+		if (asset.Data)
+		{
+			video::SCookedTextureHeader header;
+			memcpy(&header, asset.Data, sizeof(header));
+			u8* level0 = (u8*)asset.Data + sizeof(header);
+
+			// the mip levels are only in the format of the texture if it is
+			// created with 32 bit, otherwise the driver has to build them
+			void* mipmapData = 0;
+			if (asset.MipMaps && header.LevelCount > 1 &&
+				!driver->getTextureCreationFlag(video::ETCF_ALWAYS_16_BIT))
+				mipmapData = level0 + video::getCookedTextureLevelSize(header, 0);
+
+			video::IImage* image = driver->createImageFromData(video::ECF_A8R8G8B8,
+				core::dimension2d<u32>(header.Width, header.Height), level0, true, false);
+			driver->setTextureCreationFlag(video::ETCF_CREATE_MIP_MAPS, asset.MipMaps);
+			texture = driver->addTexture(asset.Name, image, mipmapData);
+			image->drop();
+
+			delete [] asset.Data;
+			asset.Data = 0;
+		}
+		break;
+
+	case EAT_COOKED_MESH:
+		if (asset.Mesh)
+		{
+			CookedMeshLoader->loadTextures(asset.Textures);
+			smgr->getMeshCache()->addMesh(asset.Name, asset.Mesh);
+			asset.Mesh->drop();
+			asset.Mesh = 0;
+			asset.Timing.Loaded = true;
+		}
+		break;
+
+	case EAT_MESH:
+		if (asset.Data)
+		{
+			// getMesh() adds the mesh to the cache under the name of the file
+			io::IReadFile* file = Device->getFileSystem()->createMemoryReadFile(
+				asset.Data, asset.Size, asset.Name, true);
+			asset.Data = 0;
+			asset.Timing.Loaded = smgr->getMesh(file) != 0;
+			file->drop();
+		}
+		break;
+	}
+
+	driver->setTextureCreationFlag(video::ETCF_CREATE_MIP_MAPS, mipMaps);
+	if (texture)
+	{
+		asset.Timing.Loaded = true;
+		asset.Timing.TextureBytes = getTextureMemory(texture);
+	}
+
+	if (!asset.Timing.Loaded)
+		Device->getLogger()->log("Could not preload", asset.Name.c_str(), ELL_WARNING);
+
+	const f64 end = getPreciseTimeMs();
+	asset.Timing.MainThreadMs = end - start;
+
+	if (CFrameProfiler* profiler = CFrameProfiler::getActive())
+		profiler->addEvent(core::stringc("upload ") + asset.Name, start, end);
+}
+
+
+core::array<CAssetLoader::SAssetTiming> CAssetLoader::getTimings() const
+{
+	core::array<SAssetTiming> timings;
+	timings.reallocate(Assets.size());
+	for (u32 i=0; i<Assets.size(); ++i)
+		timings.push_back(Assets[i]->Timing);
+	return timings;
+}
+
+
+f64 CAssetLoader::getWorkerTimeMs() const
+{
+	f64 time = 0.0;
+	for (u32 i=0; i<Assets.size(); ++i)
+		time += Assets[i]->Timing.ReadMs + Assets[i]->Timing.DecodeMs;
+	return time;
+}
+
+
+u32 CAssetLoader::getTextureBytes() const
+{
+	u32 bytes = 0;
+	for (u32 i=0; i<Assets.size(); ++i)
+		bytes += Assets[i]->Timing.TextureBytes;
+	return bytes;
+}
+
+
+u32 CAssetLoader::getTextureMemory(const video::ITexture* texture)
+{
+	const u32 bytesPerPixel = video::IImage::getBitsPerPixelFromFormat(texture->getColorFormat()) / 8;
+	u32 width = texture->getSize().Width;
+	u32 height = texture->getSize().Height;
+	u32 bytes = width * height * bytesPerPixel;
+
+	if (texture->hasMipMaps())
+	{
+		while (width > 1 || height > 1)
+		{
+			width = core::max_(width >> 1, 1u);
+			height = core::max_(height >> 1, 1u);
+			bytes += width * height * bytesPerPixel;
+		}
+	}
+	return bytes;
+}
+
+
+void CAssetLoader::logTimings(ILogger* logger) const
+{
+	for (u32 i=0; i<Assets.size(); ++i)
+	{
+		const SAssetTiming& timing = Assets[i]->Timing;
+		logf(logger, "%s%s: read %.1f ms, decode %.1f ms, main thread %.1f ms, file %u KB, texture %u KB%s",
+			timing.Name.c_str(), timing.Cooked ? " (cooked)" : "",
+			timing.ReadMs, timing.DecodeMs, timing.MainThreadMs,
+			timing.FileBytes / 1024, timing.TextureBytes / 1024,
+			timing.Loaded ? "" : ", failed");
+	}
+
+	logf(logger, "Loaded %u assets in %.1f ms on %u threads, %.1f ms of worker time, %u KB of textures",
+		Assets.size(), LoadTimeMs, ThreadCount, getWorkerTimeMs(), getTextureBytes() / 1024);
+}
+
+} // end namespace irr
@@ -0,0 +1,173 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_ASSET_LOADER_H_INCLUDED__
+#define __C_ASSET_LOADER_H_INCLUDED__
+
+#include <irrlicht.h>
+#include "CCookedMeshLoader.h"
+#include <condition_variable>
+#include <mutex>
+
+namespace irr
+{
+
+//! Loads textures and meshes on worker threads before the scene is built.
+/** All assets are added first, then load() reads the files on the main
+thread, through the file system so archives and added folders work, and
+decodes the images and cooked meshes on a thread pool while it reads the
+next ones. The workers never call the driver: the image loader of every
+texture is picked on the main thread from those of the driver, and the
+loaders only create an image from a memory file. Everything which needs
+the driver or the scene manager is done on the main thread, as soon as an
+asset is ready: uploading the textures, loading the textures of cooked
+meshes and parsing meshes which are not cooked, from the file already read
+into memory.
+
+The results end up in the texture and mesh caches of the engine under the
+names driver->getTexture() and getGameMesh() look for, so the code building
+the scene does not change and finds everything already loaded. */
+class CAssetLoader
+{
+public:
+
+	//! Called on the main thread after every asset, also for failed ones.
+	typedef void (*ProgressCallback)(u32 loaded, u32 total, const io::path& name, void* userData);
+
+	//! Times spent on one asset.
+	struct SAssetTiming
+	{
+		io::path Name;
+		//! Reading the file, on the main thread.
+		f64 ReadMs;
+		//! Decoding the image or parsing the cooked mesh, on a worker.
+		f64 DecodeMs;
+		//! Uploading or parsing on the main thread.
+		f64 MainThreadMs;
+		//! Size of the file which was read.
+		u32 FileBytes;
+		//! Memory of a texture including its mip levels, 0 for meshes.
+		u32 TextureBytes;
+		//! Loaded from a cooked file.
+		bool Cooked;
+		bool Loaded;
+	};
+
+	//! cookedMeshLoader is the loader added by addCookedMeshLoader(), it may be 0.
+	CAssetLoader(IrrlichtDevice* device, scene::CCookedMeshLoader* cookedMeshLoader);
+
+	~CAssetLoader();
+
+	//! Adds a texture, loaded like driver->getTexture(filename).
+	/** Its cooked .ctex file is used if there is one, see TextureCooker.h.
+	\param mipMaps Value of ETCF_CREATE_MIP_MAPS the texture is created with. */
+	void addTexture(const io::path& filename, bool mipMaps=true);
+
+	//! Adds a mesh, loaded like getGameMesh(smgr, source).
+	void addMesh(const io::path& source);
+
+	u32 getAssetCount() const { return Assets.size(); }
+
+	//! Loads all added assets.
+	/** \param threadCount Amount of worker threads, 0 for one per hardware thread.
+	\return Amount of assets which could not be loaded. */
+	u32 load(u32 threadCount=0, ProgressCallback callback=0, void* userData=0);
+
+	//! Timings of all assets of the last load(), in the order they were added.
+	core::array<SAssetTiming> getTimings() const;
+
+	//! Wall clock time of the last load().
+	f64 getLoadTimeMs() const { return LoadTimeMs; }
+
+	//! Time reading and decoding took, roughly what load() took before it was parallel.
+	f64 getWorkerTimeMs() const;
+
+	//! Memory of all loaded textures including their mip levels.
+	u32 getTextureBytes() const;
+
+	//! Returns the memory of texture including its mip levels.
+	static u32 getTextureMemory(const video::ITexture* texture);
+
+	u32 getThreadCount() const { return ThreadCount; }
+
+	//! Logs the timing of every asset and the totals.
+	void logTimings(ILogger* logger) const;
+
+private:
+
+	enum E_ASSET_TYPE
+	{
+		EAT_TEXTURE = 0,
+		EAT_COOKED_TEXTURE,
+		EAT_MESH,
+		EAT_COOKED_MESH
+	};
+
+	struct SAsset
+	{
+		E_ASSET_TYPE Type;
+		//! Name in the texture or mesh cache.
+		io::path Name;
+		//! Absolute name of the file read by the worker.
+		io::path FileName;
+		CAssetLoader* Loader;
+		bool MipMaps;
+
+		//! What the main thread read, a memory file for images.
+		c8* Data;
+		u32 Size;
+		io::IReadFile* File;
+		//! Loader of the driver which decodes File, 0 if none takes it.
+		video::IImageLoader* ImageLoader;
+
+		// results of the worker
+		video::IImage* Image;
+		scene::IAnimatedMesh* Mesh;
+		core::array<scene::CCookedMeshLoader::STextureSlot> Textures;
+
+		SAssetTiming Timing;
+	};
+
+	// not copyable
+	CAssetLoader(const CAssetLoader&);
+	CAssetLoader& operator=(const CAssetLoader&);
+
+	//! Returns the new asset, or the one added before with the same name.
+	SAsset* addAsset(E_ASSET_TYPE type, const io::path& name, const io::path& fileName);
+
+	static void loadAssetJob(void* data);
+
+	//! Reads the file of asset and picks its image loader, runs on the main thread.
+	void read(SAsset& asset);
+
+	//! Decodes asset, runs on a worker.
+	void decode(SAsset& asset);
+
+	//! Hands the result of asset to the engine, runs on the main thread.
+	void upload(SAsset& asset);
+
+	//! Uploads the assets the workers are done with, waits for one first if wait is set.
+	/** eturn Amount of those which could not be loaded. */
+	u32 uploadFinished(bool wait, u32& loaded, ProgressCallback callback, void* userData);
+
+	IrrlichtDevice* Device;
+	scene::CCookedMeshLoader* CookedMeshLoader;
+	core::array<SAsset*> Assets;
+
+	//! Assets decoded by the workers and not uploaded yet.
+	core::array<SAsset*> Finished;
+	std::mutex FinishedMutex;
+	std::condition_variable FinishedAdded;
+
+	//! The jpeg loader of Irrlicht 1.8 keeps the file name in a static
+	//! member, so two jpegs must not be decoded at the same time.
+	std::mutex JpegMutex;
+
+	f64 LoadTimeMs;
+	u32 ThreadCount;
+};
+
+} // end namespace irr
+
+#endif
@@ -0,0 +1,220 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CBenchmarkRecorder.h"
+#include "CTextWriter.h"
+#include <math.h>
+#include <stdio.h>
+
+namespace irr
+{
+
+namespace
+{
+
+// upper bounds of the frame time histogram buckets in milliseconds. The
+// last bucket collects everything slower.
+const f64 HistogramBounds[] = { 1., 2., 4., 8., 16.7, 33.3, 66.7, 133.3 };
+const u32 HistogramBucketCount = sizeof(HistogramBounds) / sizeof(HistogramBounds[0]) + 1;
+
+f64 percentile(const core::array<f64>& sorted, f64 p)
+{
+	if (sorted.empty())
+		return 0.;
+	// nearest rank
+	u32 rank = (u32)(p * sorted.size() + 0.5);
+	if (rank > 0)
+		--rank;
+	return sorted[core::min_(rank, sorted.size() - 1)];
+}
+
+} // end anonymous namespace
+
+
+CBenchmarkRecorder::CBenchmarkRecorder()
+	: FrameCount(0)
+{
+	addSeries("frame_ms");
+}
+
+
+u32 CBenchmarkRecorder::addSeries(const c8* name)
+{
+	_IRR_DEBUG_BREAK_IF(FrameCount != 0);
+
+	SSeries series;
+	series.Name = name;
+	Series.push_back(series);
+	return Series.size() - 1;
+}
+
+
+void CBenchmarkRecorder::beginFrame()
+{
+	for (u32 i=0; i<Series.size(); ++i)
+		Series[i].Values.push_back(0.);
+	++FrameCount;
+}
+
+
+void CBenchmarkRecorder::setValue(u32 series, f64 value)
+{
+	if (series < Series.size() && FrameCount)
+		Series[series].Values.getLast() = value;
+}
+
+
+void CBenchmarkRecorder::addValue(u32 series, f64 value)
+{
+	if (series < Series.size() && FrameCount)
+		Series[series].Values.getLast() += value;
+}
+
+
+void CBenchmarkRecorder::setInfo(const c8* key, const core::stringc& value)
+{
+	SInfo info;
+	info.Key = key;
+	info.Value = value;
+	info.IsNumber = false;
+	Infos.push_back(info);
+}
+
+
+void CBenchmarkRecorder::setInfo(const c8* key, f64 value)
+{
+	SInfo info;
+	info.Key = key;
+	appendf(info.Value, "%.4f", value);
+	info.IsNumber = true;
+	Infos.push_back(info);
+}
+
+
+CBenchmarkRecorder::SStatistics CBenchmarkRecorder::getStatistics(const core::array<f64>& values)
+{
+	core::array<f64> sorted(values);
+	sorted.sort();
+
+	f64 sum = 0.;
+	for (u32 i=0; i<values.size(); ++i)
+		sum += values[i];
+
+	SStatistics stats;
+	stats.Min = sorted.empty() ? 0. : sorted[0];
+	stats.Avg = values.empty() ? 0. : sum / values.size();
+	stats.P50 = percentile(sorted, 0.5);
+	stats.P99 = percentile(sorted, 0.99);
+	stats.Max = sorted.empty() ? 0. : sorted.getLast();
+
+	f64 squares = 0.;
+	for (u32 i=0; i<values.size(); ++i)
+		squares += (values[i] - stats.Avg) * (values[i] - stats.Avg);
+	stats.StdDev = values.size() > 1 ? sqrt(squares / (values.size() - 1)) : 0.;
+	return stats;
+}
+
+
+bool CBenchmarkRecorder::writeReport(io::IFileSystem* fileSystem, const io::path& filename) const
+{
+	if (!fileSystem)
+		return false;
+
+	io::IWriteFile* file = fileSystem->createAndWriteFile(filename);
+	if (!file)
+		return false;
+
+	// every frame of every series is written, so the report is streamed to
+	// the file instead of built in one string
+	CTextWriter out(file);
+	out.print("{\n");
+
+	for (u32 i=0; i<Infos.size(); ++i)
+	{
+		out.print("  ");
+		out.writeQuoted(Infos[i].Key);
+		out.print(": ");
+		if (Infos[i].IsNumber)
+			out.write(Infos[i].Value);
+		else
+			out.writeQuoted(Infos[i].Value);
+		out.print(",\n");
+	}
+
+	out.print("  \"frames\": %u,\n", FrameCount);
+	out.print("  \"series\": {\n");
+
+	for (u32 s=0; s<Series.size(); ++s)
+	{
+		const core::array<f64>& values = Series[s].Values;
+		const SStatistics stats = getStatistics(values);
+
+		out.print("    ");
+		out.writeQuoted(Series[s].Name);
+		out.print(": {\n");
+		out.print("      \"min\": %.4f,\n", stats.Min);
+		out.print("      \"avg\": %.4f,\n", stats.Avg);
+		out.print("      \"p50\": %.4f,\n", stats.P50);
+		out.print("      \"p99\": %.4f,\n", stats.P99);
+		out.print("      \"max\": %.4f,\n", stats.Max);
+		out.print("      \"stddev\": %.4f,\n", stats.StdDev);
+
+		if (s == FRAME_TIME)
+		{
+			u32 buckets[HistogramBucketCount] = { 0 };
+			for (u32 i=0; i<values.size(); ++i)
+			{
+				u32 b = 0;
+				while (b < HistogramBucketCount - 1 && values[i] > HistogramBounds[b])
+					++b;
+				++buckets[b];
+			}
+
+			out.print("      \"histogram\": [");
+			for (u32 b=0; b<HistogramBucketCount; ++b)
+			{
+				if (b < HistogramBucketCount - 1)
+					out.print("{\"le_ms\": %.1f, \"count\": %u}, ", HistogramBounds[b], buckets[b]);
+				else
+					out.print("{\"le_ms\": null, \"count\": %u}", buckets[b]);
+			}
+			out.print("],\n");
+		}
+
+		out.print("      \"values\": [");
+		for (u32 i=0; i<values.size(); ++i)
+			out.print(i ? ", %.4f" : "%.4f", values[i]);
+		out.print("]\n");
+
+		out.print((s + 1 < Series.size()) ? "    },\n" : "    }\n");
+	}
+
+	out.print("  }\n}\n");
+
+	const bool written = out.flush();
+	file->drop();
+	return written;
+}
+
+
+void CBenchmarkRecorder::printSummary(const c8* title) const
+{
+	printf("%s, %u frames\n", title, FrameCount);
+	for (u32 i=0; i<Infos.size(); ++i)
+		printf("  %-40s %s\n", Infos[i].Key.c_str(), Infos[i].Value.c_str());
+
+	printf("  %-40s %12s %12s %12s %12s %12s %12s\n", "series", "min", "p50", "avg", "p99", "max", "stddev");
+	for (u32 s=0; s<Series.size(); ++s)
+	{
+		const SStatistics stats = getStatistics(Series[s].Values);
+		if (s == FRAME_TIME && stats.Max == 0.)
+			continue;
+
+		printf("  %-40s %12.4f %12.4f %12.4f %12.4f %12.4f %12.4f\n", Series[s].Name.c_str(),
+			stats.Min, stats.P50, stats.Avg, stats.P99, stats.Max, stats.StdDev);
+	}
+	printf("\n");
+}
+
+} // end namespace irr
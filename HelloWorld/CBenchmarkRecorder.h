@@ -0,0 +1,86 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_BENCHMARK_RECORDER_H_INCLUDED__
+#define __C_BENCHMARK_RECORDER_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+
+//! Collects per-frame measurements and writes them as a JSON report.
+/** Every measurement is a named series with one value per frame, for
+example the frame time or the amount of triangles drawn. The report
+contains min/avg/p50/p99/max and the standard deviation of every series,
+a histogram of the frame times and the raw per-frame values, so
+regressions can be diffed by scripts on the build farm. */
+class CBenchmarkRecorder
+{
+public:
+
+	//! Index of the frame time series, which always exists.
+	static const u32 FRAME_TIME = 0;
+
+	CBenchmarkRecorder();
+
+	//! Adds a series and returns its index. Must be called before the first frame.
+	u32 addSeries(const c8* name);
+
+	//! Returns amount of series, including the frame time.
+	u32 getSeriesCount() const { return Series.size(); }
+
+	//! Starts a new frame. All series default to 0 for it.
+	void beginFrame();
+
+	//! Sets the value of a series for the current frame.
+	void setValue(u32 series, f64 value);
+
+	//! Adds to the value of a series for the current frame.
+	void addValue(u32 series, f64 value);
+
+	//! Returns amount of recorded frames.
+	u32 getFrameCount() const { return FrameCount; }
+
+	//! Adds a key/value pair to the header of the report.
+	void setInfo(const c8* key, const core::stringc& value);
+	void setInfo(const c8* key, f64 value);
+
+	//! Writes the report. Returns false if the file could not be written.
+	bool writeReport(io::IFileSystem* fileSystem, const io::path& filename) const;
+
+	//! Prints the header and the statistics of every series to stdout, one line each.
+	/** The frame time is left out if it was never set. */
+	void printSummary(const c8* title) const;
+
+private:
+
+	struct SSeries
+	{
+		core::stringc Name;
+		core::array<f64> Values;
+	};
+
+	struct SStatistics
+	{
+		f64 Min, Avg, P50, P99, Max, StdDev;
+	};
+
+	static SStatistics getStatistics(const core::array<f64>& values);
+
+	struct SInfo
+	{
+		core::stringc Key;
+		core::stringc Value;
+		bool IsNumber;
+	};
+
+	core::array<SSeries> Series;
+	core::array<SInfo> Infos;
+	u32 FrameCount;
+};
+
+} // end namespace irr
+
+#endif
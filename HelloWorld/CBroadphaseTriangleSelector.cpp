@@ -0,0 +1,194 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CBroadphaseTriangleSelector.h"
+
+namespace irr
+{
+namespace scene
+{
+
+CBroadphaseTriangleSelector::CBroadphaseTriangleSelector()
+{
+	#ifdef _DEBUG
+	setDebugName("CBroadphaseTriangleSelector");
+	#endif
+}
+
+
+CBroadphaseTriangleSelector::~CBroadphaseTriangleSelector()
+{
+	removeAllTriangleSelectors();
+}
+
+
+void CBroadphaseTriangleSelector::addTriangleSelector(ITriangleSelector* toAdd)
+{
+	if (!toAdd)
+		return;
+
+	// all selectors created by the scene manager belong to exactly one node
+	addTriangleSelector(toAdd, toAdd->getTriangleCount() ? toAdd->getSceneNodeForTriangle(0) : 0);
+}
+
+
+void CBroadphaseTriangleSelector::addTriangleSelector(ITriangleSelector* toAdd, ISceneNode* node)
+{
+	if (!toAdd)
+		return;
+
+	SEntry entry;
+	entry.Selector = toAdd;
+	entry.Node = node;
+	Selectors.push_back(entry);
+	toAdd->grab();
+}
+
+
+bool CBroadphaseTriangleSelector::removeTriangleSelector(ITriangleSelector* toRemove)
+{
+	for (u32 i=0; i<Selectors.size(); ++i)
+	{
+		if (Selectors[i].Selector == toRemove)
+		{
+			Selectors[i].Selector->drop();
+			Selectors.erase(i);
+			LastQuery.set_used(0);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void CBroadphaseTriangleSelector::removeAllTriangleSelectors()
+{
+	for (u32 i=0; i<Selectors.size(); ++i)
+		Selectors[i].Selector->drop();
+
+	Selectors.clear();
+	LastQuery.clear();
+}
+
+
+s32 CBroadphaseTriangleSelector::getTriangleCount() const
+{
+	s32 count = 0;
+	for (u32 i=0; i<Selectors.size(); ++i)
+		count += Selectors[i].Selector->getTriangleCount();
+
+	return count;
+}
+
+
+void CBroadphaseTriangleSelector::addResultRange(u32 entry, s32& outTriangleCount, s32 count) const
+{
+	if (!count)
+		return;
+
+	outTriangleCount += count;
+
+	SResultRange range;
+	range.Entry = entry;
+	range.End = outTriangleCount;
+	LastQuery.push_back(range);
+}
+
+
+void CBroadphaseTriangleSelector::getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::matrix4* transform) const
+{
+	outTriangleCount = 0;
+	LastQuery.set_used(0);
+
+	for (u32 i=0; i<Selectors.size() && outTriangleCount < arraySize; ++i)
+	{
+		s32 count = 0;
+		Selectors[i].Selector->getTriangles(triangles + outTriangleCount,
+			arraySize - outTriangleCount, count, transform);
+		addResultRange(i, outTriangleCount, count);
+	}
+}
+
+
+void CBroadphaseTriangleSelector::getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::aabbox3d<f32>& box,
+		const core::matrix4* transform) const
+{
+	outTriangleCount = 0;
+	LastQuery.set_used(0);
+
+	for (u32 i=0; i<Selectors.size() && outTriangleCount < arraySize; ++i)
+	{
+		const SEntry& e = Selectors[i];
+
+		if (e.Node && !e.Node->getTransformedBoundingBox().intersectsWithBox(box))
+			continue;
+
+		s32 count = 0;
+		e.Selector->getTriangles(triangles + outTriangleCount,
+			arraySize - outTriangleCount, count, box, transform);
+		addResultRange(i, outTriangleCount, count);
+	}
+}
+
+
+void CBroadphaseTriangleSelector::getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::line3d<f32>& line,
+		const core::matrix4* transform) const
+{
+	outTriangleCount = 0;
+	LastQuery.set_used(0);
+
+	for (u32 i=0; i<Selectors.size() && outTriangleCount < arraySize; ++i)
+	{
+		const SEntry& e = Selectors[i];
+
+		if (e.Node && !e.Node->getTransformedBoundingBox().intersectsWithLine(line))
+			continue;
+
+		s32 count = 0;
+		e.Selector->getTriangles(triangles + outTriangleCount,
+			arraySize - outTriangleCount, count, line, transform);
+		addResultRange(i, outTriangleCount, count);
+	}
+}
+
+
+ISceneNode* CBroadphaseTriangleSelector::getSceneNodeForTriangle(u32 triangleIndex) const
+{
+	for (u32 i=0; i<LastQuery.size(); ++i)
+	{
+		if ((s32)triangleIndex < LastQuery[i].End)
+		{
+			const SEntry& e = Selectors[LastQuery[i].Entry];
+			const s32 begin = i ? LastQuery[i-1].End : 0;
+			return e.Selector->getSceneNodeForTriangle(triangleIndex - begin);
+		}
+	}
+
+	return 0;
+}
+
+
+u32 CBroadphaseTriangleSelector::getSelectorCount() const
+{
+	return Selectors.size();
+}
+
+
+ITriangleSelector* CBroadphaseTriangleSelector::getSelector(u32 index)
+{
+	return index < Selectors.size() ? Selectors[index].Selector : 0;
+}
+
+
+const ITriangleSelector* CBroadphaseTriangleSelector::getSelector(u32 index) const
+{
+	return index < Selectors.size() ? Selectors[index].Selector : 0;
+}
+
+} // end namespace scene
+} // end namespace irr
@@ -0,0 +1,93 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_BROADPHASE_TRIANGLE_SELECTOR_H_INCLUDED__
+#define __C_BROADPHASE_TRIANGLE_SELECTOR_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Meta triangle selector which skips whole selectors by their bounding box.
+/** The stock meta selector asks every child selector for triangles, and
+each child then tests all of its triangles against the query. With one
+child per cube, gate, ship and the terrain that is a lot of work for a query
+box which usually touches two or three of them. This selector remembers the
+scene node of every child and first tests the transformed bounding box of
+that node, so only the children near the camera are queried at all.
+
+It is meant to be the single world of one collision response animator:
+the animator queries it once per frame and resolves the ellipsoid once. */
+class CBroadphaseTriangleSelector : public IMetaTriangleSelector
+{
+public:
+
+	CBroadphaseTriangleSelector();
+
+	virtual ~CBroadphaseTriangleSelector();
+
+	//! Adds a selector. Its bounds are taken from the node it was created for.
+	virtual void addTriangleSelector(ITriangleSelector* toAdd);
+
+	//! Adds a selector whose triangles all lie within the bounds of node.
+	/** If node is 0, the selector is queried for every request. */
+	void addTriangleSelector(ITriangleSelector* toAdd, ISceneNode* node);
+
+	virtual bool removeTriangleSelector(ITriangleSelector* toRemove);
+
+	virtual void removeAllTriangleSelectors();
+
+	virtual s32 getTriangleCount() const;
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::matrix4* transform=0) const;
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::aabbox3d<f32>& box,
+		const core::matrix4* transform=0) const;
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::line3d<f32>& line,
+		const core::matrix4* transform=0) const;
+
+	//! Returns the node of a triangle returned by the last getTriangles() call.
+	virtual ISceneNode* getSceneNodeForTriangle(u32 triangleIndex) const;
+
+	virtual u32 getSelectorCount() const;
+
+	virtual ITriangleSelector* getSelector(u32 index);
+
+	virtual const ITriangleSelector* getSelector(u32 index) const;
+
+	//! Returns how many child selectors passed the bounds test in the last query.
+	u32 getLastCandidateCount() const { return LastQuery.size(); }
+
+private:
+
+	struct SEntry
+	{
+		ITriangleSelector* Selector;
+		ISceneNode* Node;
+	};
+
+	//! Triangles [previous End, End) of the last result came from Entry.
+	struct SResultRange
+	{
+		u32 Entry;
+		s32 End;
+	};
+
+	void addResultRange(u32 entry, s32& outTriangleCount, s32 count) const;
+
+	core::array<SEntry> Selectors;
+	mutable core::array<SResultRange> LastQuery;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
@@ -0,0 +1,485 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CBvhTree.h"
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+// amount of bins used to find the best split with the surface area heuristic
+const u32 BinCount = 12;
+
+// leaves bigger than this are always split, whatever the heuristic says
+const u32 MaxLeafSize = 16;
+
+// below this depth the heuristic is used, deeper nodes are split in the
+// middle so the depth of the tree and the traversal stacks stay bounded
+const u32 MaxSahDepth = 48;
+
+const u32 StackSize = 128;
+
+inline f32 axisValue(const core::vector3df& v, u32 axis)
+{
+	return axis == 0 ? v.X : (axis == 1 ? v.Y : v.Z);
+}
+
+inline f32 surfaceArea(const core::aabbox3df& box)
+{
+	const core::vector3df e = box.MaxEdge - box.MinEdge;
+	return 2.f * (e.X * e.Y + e.X * e.Z + e.Y * e.Z);
+}
+
+// Slab test of the segment start + t * dir, t in [0, maxT], against a box.
+inline bool segmentHitsBox(const f32* boxMin, const f32* boxMax,
+	const core::vector3df& start, const core::vector3df& invDir, f32 maxT, f32& outNear)
+{
+	f32 tNear = 0.f;
+	f32 tFar = maxT;
+
+	const f32 s[3] = { start.X, start.Y, start.Z };
+	const f32 inv[3] = { invDir.X, invDir.Y, invDir.Z };
+
+	for (u32 a=0; a<3; ++a)
+	{
+		f32 t1 = (boxMin[a] - s[a]) * inv[a];
+		f32 t2 = (boxMax[a] - s[a]) * inv[a];
+		if (t1 > t2)
+			core::swap(t1, t2);
+		tNear = core::max_(tNear, t1);
+		tFar = core::min_(tFar, t2);
+		if (tNear > tFar)
+			return false;
+	}
+
+	outNear = tNear;
+	return true;
+}
+
+inline f32 safeInverse(f32 v)
+{
+	// not infinity: 0 * 1e30 stays 0 while 0 * inf would be NaN
+	if (core::iszero(v))
+		return v < 0.f ? -1e30f : 1e30f;
+	return 1.f / v;
+}
+
+inline void transformTriangle(core::triangle3df& tri, const core::matrix4* mat)
+{
+	if (!mat)
+		return;
+	mat->transformVect(tri.pointA);
+	mat->transformVect(tri.pointB);
+	mat->transformVect(tri.pointC);
+}
+
+} // end anonymous namespace
+
+
+CBvhTree::CBvhTree(const IMesh* mesh, u32 maxLeafSize)
+{
+	#ifdef _DEBUG
+	setDebugName("CBvhTree");
+	#endif
+
+	core::array<core::triangle3df> source;
+	core::array<SBuildTriangle> tris;
+
+	if (mesh)
+	{
+		for (u32 b=0; b<mesh->getMeshBufferCount(); ++b)
+		{
+			const IMeshBuffer* mb = mesh->getMeshBuffer(b);
+			const u32 indexCount = mb->getIndexCount();
+			const u16* indices16 = mb->getIndices();
+			const u32* indices32 = (const u32*)indices16;
+			const bool is32Bit = mb->getIndexType() == video::EIT_32BIT;
+
+			for (u32 i=0; i+2<indexCount; i+=3)
+			{
+				core::triangle3df tri;
+				if (is32Bit)
+					tri.set(mb->getPosition(indices32[i]), mb->getPosition(indices32[i+1]), mb->getPosition(indices32[i+2]));
+				else
+					tri.set(mb->getPosition(indices16[i]), mb->getPosition(indices16[i+1]), mb->getPosition(indices16[i+2]));
+
+				SBuildTriangle bt;
+				bt.Box.reset(tri.pointA);
+				bt.Box.addInternalPoint(tri.pointB);
+				bt.Box.addInternalPoint(tri.pointC);
+				bt.Center = bt.Box.getCenter();
+				bt.Index = source.size();
+				tris.push_back(bt);
+				source.push_back(tri);
+			}
+		}
+	}
+
+	BoundingBox.reset(0,0,0);
+	if (tris.empty())
+		return;
+
+	// a binary tree with n leaves has 2n-1 nodes, and leaves hold about
+	// maxLeafSize/2 triangles on average
+	Nodes.reallocate(core::max_(1u, 4 * tris.size() / core::max_(1u, maxLeafSize)));
+	Triangles.reallocate(tris.size());
+
+	// build() only stores the source index in the leaves, the triangles
+	// are copied afterwards in leaf order
+	build(tris, 0, tris.size(), core::max_(1u, core::min_(maxLeafSize, MaxLeafSize)), 0);
+
+	for (u32 i=0; i<tris.size(); ++i)
+		Triangles.push_back(source[tris[i].Index]);
+
+	BoundingBox.MinEdge.set(Nodes[0].Min[0], Nodes[0].Min[1], Nodes[0].Min[2]);
+	BoundingBox.MaxEdge.set(Nodes[0].Max[0], Nodes[0].Max[1], Nodes[0].Max[2]);
+}
+
+
+void CBvhTree::setNodeBox(u32 node, const core::aabbox3df& box)
+{
+	SNode& n = Nodes[node];
+	n.Min[0] = box.MinEdge.X; n.Min[1] = box.MinEdge.Y; n.Min[2] = box.MinEdge.Z;
+	n.Max[0] = box.MaxEdge.X; n.Max[1] = box.MaxEdge.Y; n.Max[2] = box.MaxEdge.Z;
+}
+
+
+u32 CBvhTree::build(core::array<SBuildTriangle>& tris, u32 first, u32 count,
+		u32 maxLeafSize, u32 depth)
+{
+	const u32 nodeIndex = Nodes.size();
+	Nodes.push_back(SNode());
+
+	core::aabbox3df bounds(tris[first].Box);
+	core::aabbox3df centers(tris[first].Center);
+	for (u32 i=first+1; i<first+count; ++i)
+	{
+		bounds.addInternalBox(tris[i].Box);
+		centers.addInternalPoint(tris[i].Center);
+	}
+	setNodeBox(nodeIndex, bounds);
+
+	// the triangles of a leaf are the range [first, first+count) of the
+	// final order of tris
+	Nodes[nodeIndex].Offset = first;
+	Nodes[nodeIndex].Count = (u16)count;
+	Nodes[nodeIndex].Axis = 0;
+
+	if (count <= maxLeafSize)
+		return nodeIndex;
+
+	// find the best split over all three axes
+	f32 bestCost = 0.f;
+	s32 bestAxis = -1;
+	u32 bestBin = 0;
+
+	for (u32 axis=0; axis<3 && depth<MaxSahDepth; ++axis)
+	{
+		const f32 cmin = axisValue(centers.MinEdge, axis);
+		const f32 extent = axisValue(centers.MaxEdge, axis) - cmin;
+		if (extent <= 1e-6f)
+			continue;
+
+		const f32 scale = BinCount / extent;
+
+		u32 binCounts[BinCount] = { 0 };
+		core::aabbox3df binBoxes[BinCount];
+
+		for (u32 i=first; i<first+count; ++i)
+		{
+			const u32 b = core::min_((u32)((axisValue(tris[i].Center, axis) - cmin) * scale), BinCount - 1);
+			if (binCounts[b]++)
+				binBoxes[b].addInternalBox(tris[i].Box);
+			else
+				binBoxes[b] = tris[i].Box;
+		}
+
+		// sweep from the right to get the cost of every right side
+		f32 rightArea[BinCount];
+		u32 rightCount[BinCount];
+		core::aabbox3df box;
+		u32 sum = 0;
+		for (u32 b=BinCount-1; b>0; --b)
+		{
+			if (binCounts[b])
+			{
+				if (sum)
+					box.addInternalBox(binBoxes[b]);
+				else
+					box = binBoxes[b];
+			}
+			sum += binCounts[b];
+			rightCount[b] = sum;
+			rightArea[b] = sum ? surfaceArea(box) : 0.f;
+		}
+
+		// and from the left, evaluating a split after every bin
+		sum = 0;
+		for (u32 b=0; b<BinCount-1; ++b)
+		{
+			if (binCounts[b])
+			{
+				if (sum)
+					box.addInternalBox(binBoxes[b]);
+				else
+					box = binBoxes[b];
+			}
+			sum += binCounts[b];
+
+			if (!sum || !rightCount[b+1])
+				continue;
+
+			const f32 cost = sum * surfaceArea(box) + rightCount[b+1] * rightArea[b+1];
+			if (bestAxis < 0 || cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+			}
+		}
+	}
+
+	// splitting must be cheaper than testing all triangles of this node,
+	// unless the leaf would get too big
+	if (bestAxis >= 0 && count <= MaxLeafSize && bestCost >= count * surfaceArea(bounds))
+		return nodeIndex;
+
+	u32 mid = first;
+	if (bestAxis >= 0)
+	{
+		const f32 cmin = axisValue(centers.MinEdge, bestAxis);
+		const f32 scale = BinCount / (axisValue(centers.MaxEdge, bestAxis) - cmin);
+
+		u32 right = first + count;
+		while (mid < right)
+		{
+			const u32 b = core::min_((u32)((axisValue(tris[mid].Center, bestAxis) - cmin) * scale), BinCount - 1);
+			if (b <= bestBin)
+				++mid;
+			else
+				core::swap(tris[mid], tris[--right]);
+		}
+	}
+
+	// too deep or all centers in one point: split the range in half, which
+	// is a valid if not a good tree and keeps the depth logarithmic
+	if (mid == first || mid == first + count)
+		mid = first + count / 2;
+
+	Nodes[nodeIndex].Count = 0;
+	Nodes[nodeIndex].Axis = (u16)core::max_(bestAxis, 0);
+
+	build(tris, first, mid - first, maxLeafSize, depth + 1);
+	const u32 second = build(tris, mid, first + count - mid, maxLeafSize, depth + 1);
+	Nodes[nodeIndex].Offset = second;
+
+	return nodeIndex;
+}
+
+
+bool CBvhTree::intersectsBox(const SNode& node, const core::aabbox3df& box) const
+{
+	return node.Min[0] <= box.MaxEdge.X && node.Max[0] >= box.MinEdge.X &&
+		node.Min[1] <= box.MaxEdge.Y && node.Max[1] >= box.MinEdge.Y &&
+		node.Min[2] <= box.MaxEdge.Z && node.Max[2] >= box.MinEdge.Z;
+}
+
+
+bool CBvhTree::intersectsSegment(const SNode& node, const core::vector3df& start,
+		const core::vector3df& invDir, f32 maxT, f32& outNear) const
+{
+	return segmentHitsBox(node.Min, node.Max, start, invDir, maxT, outNear);
+}
+
+
+s32 CBvhTree::getTriangles(const core::aabbox3df& box, core::triangle3df* out,
+		s32 maxCount, const core::matrix4* mat) const
+{
+	if (Nodes.empty() || maxCount <= 0)
+		return 0;
+
+	s32 written = 0;
+	u32 stack[StackSize];
+	u32 top = 0;
+	stack[top++] = 0;
+
+	while (top)
+	{
+		const u32 index = stack[--top];
+		const SNode& node = Nodes[index];
+
+		if (!intersectsBox(node, box))
+			continue;
+
+		if (node.Count)
+		{
+			const u32 end = node.Offset + node.Count;
+			for (u32 t=node.Offset; t<end; ++t)
+			{
+				// same test as the stock selector, so both return the same set
+				if (Triangles[t].isTotalOutsideBox(box))
+					continue;
+
+				out[written] = Triangles[t];
+				transformTriangle(out[written], mat);
+				if (++written == maxCount)
+					return written;
+			}
+		}
+		else
+		{
+			stack[top++] = node.Offset;
+			stack[top++] = index + 1;
+		}
+	}
+
+	return written;
+}
+
+
+s32 CBvhTree::getTriangles(const core::line3df& line, core::triangle3df* out,
+		s32 maxCount, const core::matrix4* mat) const
+{
+	if (Nodes.empty() || maxCount <= 0)
+		return 0;
+
+	const core::vector3df dir = line.end - line.start;
+	const core::vector3df invDir(safeInverse(dir.X), safeInverse(dir.Y), safeInverse(dir.Z));
+
+	s32 written = 0;
+	u32 stack[StackSize];
+	u32 top = 0;
+	stack[top++] = 0;
+
+	while (top)
+	{
+		const u32 index = stack[--top];
+		const SNode& node = Nodes[index];
+
+		f32 tNear;
+		if (!intersectsSegment(node, line.start, invDir, 1.f, tNear))
+			continue;
+
+		if (node.Count)
+		{
+			const u32 end = node.Offset + node.Count;
+			for (u32 t=node.Offset; t<end; ++t)
+			{
+				const core::triangle3df& tri = Triangles[t];
+				const f32 triMin[3] = {
+					core::min_(tri.pointA.X, tri.pointB.X, tri.pointC.X),
+					core::min_(tri.pointA.Y, tri.pointB.Y, tri.pointC.Y),
+					core::min_(tri.pointA.Z, tri.pointB.Z, tri.pointC.Z) };
+				const f32 triMax[3] = {
+					core::max_(tri.pointA.X, tri.pointB.X, tri.pointC.X),
+					core::max_(tri.pointA.Y, tri.pointB.Y, tri.pointC.Y),
+					core::max_(tri.pointA.Z, tri.pointB.Z, tri.pointC.Z) };
+
+				if (!segmentHitsBox(triMin, triMax, line.start, invDir, 1.f, tNear))
+					continue;
+
+				out[written] = tri;
+				transformTriangle(out[written], mat);
+				if (++written == maxCount)
+					return written;
+			}
+		}
+		else
+		{
+			stack[top++] = node.Offset;
+			stack[top++] = index + 1;
+		}
+	}
+
+	return written;
+}
+
+
+bool CBvhTree::getFirstHit(const core::line3df& line, f32& outT, u32& outTriangle) const
+{
+	if (Nodes.empty())
+		return false;
+
+	const core::vector3df dir = line.end - line.start;
+	const core::vector3df invDir(safeInverse(dir.X), safeInverse(dir.Y), safeInverse(dir.Z));
+	const bool dirNegative[3] = { dir.X < 0.f, dir.Y < 0.f, dir.Z < 0.f };
+
+	f32 best = 1.f;
+	bool found = false;
+
+	u32 stack[StackSize];
+	u32 top = 0;
+	stack[top++] = 0;
+
+	while (top)
+	{
+		const u32 index = stack[--top];
+		const SNode& node = Nodes[index];
+
+		f32 tNear;
+		if (!intersectsSegment(node, line.start, invDir, best, tNear))
+			continue;
+
+		if (node.Count)
+		{
+			const u32 end = node.Offset + node.Count;
+			for (u32 t=node.Offset; t<end; ++t)
+			{
+				// Moeller-Trumbore, with t measured along the unnormalized segment
+				const core::triangle3df& tri = Triangles[t];
+				const core::vector3df e1 = tri.pointB - tri.pointA;
+				const core::vector3df e2 = tri.pointC - tri.pointA;
+				const core::vector3df p = dir.crossProduct(e2);
+				const f32 det = e1.dotProduct(p);
+				if (core::iszero(det, 1e-12f))
+					continue;
+
+				const f32 invDet = 1.f / det;
+				const core::vector3df s = line.start - tri.pointA;
+				const f32 u = s.dotProduct(p) * invDet;
+				if (u < 0.f || u > 1.f)
+					continue;
+
+				const core::vector3df q = s.crossProduct(e1);
+				const f32 v = dir.dotProduct(q) * invDet;
+				if (v < 0.f || u + v > 1.f)
+					continue;
+
+				const f32 hit = e2.dotProduct(q) * invDet;
+				if (hit >= 0.f && hit <= best)
+				{
+					best = hit;
+					outTriangle = t;
+					found = true;
+				}
+			}
+		}
+		else
+		{
+			// push the far child first so the near one is visited first
+			// and can shorten the segment for the other
+			if (dirNegative[node.Axis])
+			{
+				stack[top++] = index + 1;
+				stack[top++] = node.Offset;
+			}
+			else
+			{
+				stack[top++] = node.Offset;
+				stack[top++] = index + 1;
+			}
+		}
+	}
+
+	if (found)
+		outT = best;
+	return found;
+}
+
+} // end namespace scene
+} // end namespace irr
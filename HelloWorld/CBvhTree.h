@@ -0,0 +1,98 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_BVH_TREE_H_INCLUDED__
+#define __C_BVH_TREE_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Bounding volume hierarchy over the triangles of a static mesh.
+/** The tree is built once with the surface area heuristic and stored as a
+flat array of 32 byte nodes in depth first order, so a parent is always
+followed by its first child and two nodes share a cache line. The triangles
+are reordered so that every leaf references one contiguous range of them.
+
+The tree is immutable after construction and only holds the triangles in
+object space, so it can be shared by all scene nodes using the same mesh,
+for example the four gate arrays. */
+class CBvhTree : public virtual IReferenceCounted
+{
+public:
+
+	//! Builds the tree over all mesh buffers of mesh.
+	/** \param maxLeafSize Leaves with this many triangles or less are never split. */
+	CBvhTree(const IMesh* mesh, u32 maxLeafSize=4);
+
+	//! Bounding box of all triangles in object space.
+	const core::aabbox3df& getBoundingBox() const { return BoundingBox; }
+
+	u32 getTriangleCount() const { return Triangles.size(); }
+
+	u32 getNodeCount() const { return Nodes.size(); }
+
+	//! Returns a triangle in object space.
+	const core::triangle3df& getTriangle(u32 index) const { return Triangles[index]; }
+
+	//! Copies all triangles touching box into out, transformed by mat.
+	/** box is in object space. Returns the amount of triangles written, at most maxCount. */
+	s32 getTriangles(const core::aabbox3df& box, core::triangle3df* out,
+		s32 maxCount, const core::matrix4* mat) const;
+
+	//! Copies all triangles whose bounding box is hit by line into out, transformed by mat.
+	/** line is in object space. Returns the amount of triangles written, at most maxCount. */
+	s32 getTriangles(const core::line3df& line, core::triangle3df* out,
+		s32 maxCount, const core::matrix4* mat) const;
+
+	//! Finds the first triangle hit when going from line.start to line.end.
+	/** line is in object space.
+	\param outT Position of the hit on the line, 0 is start and 1 is end.
+	\param outTriangle Index of the triangle which was hit.
+	\return True if something was hit. */
+	bool getFirstHit(const core::line3df& line, f32& outT, u32& outTriangle) const;
+
+private:
+
+	struct SNode
+	{
+		f32 Min[3];
+		//! Leaf: first triangle. Inner node: index of the second child.
+		u32 Offset;
+		f32 Max[3];
+		//! Leaf: amount of triangles. Inner node: 0.
+		u16 Count;
+		//! Inner node: axis of the split, used to visit the near child first.
+		u16 Axis;
+	};
+
+	struct SBuildTriangle
+	{
+		core::aabbox3df Box;
+		core::vector3df Center;
+		u32 Index;
+	};
+
+	u32 build(core::array<SBuildTriangle>& tris, u32 first, u32 count,
+		u32 maxLeafSize, u32 depth);
+
+	void setNodeBox(u32 node, const core::aabbox3df& box);
+
+	bool intersectsBox(const SNode& node, const core::aabbox3df& box) const;
+
+	bool intersectsSegment(const SNode& node, const core::vector3df& start,
+		const core::vector3df& invDir, f32 maxT, f32& outNear) const;
+
+	core::array<SNode> Nodes;
+	core::array<core::triangle3df> Triangles;
+	core::aabbox3df BoundingBox;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
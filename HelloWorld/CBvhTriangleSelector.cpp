@@ -0,0 +1,204 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CBvhTriangleSelector.h"
+
+namespace irr
+{
+namespace scene
+{
+
+CBvhTriangleSelector::CBvhTriangleSelector(CBvhTree* tree, ISceneNode* node)
+	: Tree(tree), SceneNode(node)
+{
+	#ifdef _DEBUG
+	setDebugName("CBvhTriangleSelector");
+	#endif
+
+	if (Tree)
+		Tree->grab();
+}
+
+
+CBvhTriangleSelector::~CBvhTriangleSelector()
+{
+	if (Tree)
+		Tree->drop();
+}
+
+
+s32 CBvhTriangleSelector::getTriangleCount() const
+{
+	return Tree ? Tree->getTriangleCount() : 0;
+}
+
+
+core::matrix4 CBvhTriangleSelector::getTransformation(const core::matrix4* transform) const
+{
+	core::matrix4 mat;
+	if (transform)
+		mat = *transform;
+	if (SceneNode)
+		mat *= SceneNode->getAbsoluteTransformation();
+	return mat;
+}
+
+
+void CBvhTriangleSelector::getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::matrix4* transform) const
+{
+	outTriangleCount = 0;
+	if (!Tree)
+		return;
+
+	const core::matrix4 mat(getTransformation(transform));
+
+	const s32 count = core::min_((s32)Tree->getTriangleCount(), arraySize);
+	for (s32 i=0; i<count; ++i)
+	{
+		triangles[i] = Tree->getTriangle(i);
+		mat.transformVect(triangles[i].pointA);
+		mat.transformVect(triangles[i].pointB);
+		mat.transformVect(triangles[i].pointC);
+	}
+
+	outTriangleCount = count;
+}
+
+
+void CBvhTriangleSelector::getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::aabbox3d<f32>& box,
+		const core::matrix4* transform) const
+{
+	outTriangleCount = 0;
+	if (!Tree)
+		return;
+
+	// the box is in world space, the tree in object space
+	core::aabbox3df objectBox(box);
+	if (SceneNode)
+	{
+		core::matrix4 inverse;
+		SceneNode->getAbsoluteTransformation().getInverse(inverse);
+		inverse.transformBoxEx(objectBox);
+	}
+
+	const core::matrix4 mat(getTransformation(transform));
+	outTriangleCount = Tree->getTriangles(objectBox, triangles, arraySize, &mat);
+}
+
+
+void CBvhTriangleSelector::getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::line3d<f32>& line,
+		const core::matrix4* transform) const
+{
+	outTriangleCount = 0;
+	if (!Tree)
+		return;
+
+	core::line3df objectLine(line);
+	if (SceneNode)
+	{
+		core::matrix4 inverse;
+		SceneNode->getAbsoluteTransformation().getInverse(inverse);
+		inverse.transformVect(objectLine.start);
+		inverse.transformVect(objectLine.end);
+	}
+
+	const core::matrix4 mat(getTransformation(transform));
+	outTriangleCount = Tree->getTriangles(objectLine, triangles, arraySize, &mat);
+}
+
+
+bool CBvhTriangleSelector::getCollisionPoint(const core::line3df& ray,
+		core::vector3df& outCollisionPoint, core::triangle3df& outTriangle) const
+{
+	if (!Tree)
+		return false;
+
+	core::line3df objectRay(ray);
+	if (SceneNode)
+	{
+		core::matrix4 inverse;
+		SceneNode->getAbsoluteTransformation().getInverse(inverse);
+		inverse.transformVect(objectRay.start);
+		inverse.transformVect(objectRay.end);
+	}
+
+	f32 t;
+	u32 index;
+	if (!Tree->getFirstHit(objectRay, t, index))
+		return false;
+
+	// the position along the line does not change with an affine transform
+	outCollisionPoint = ray.start + (ray.end - ray.start) * t;
+
+	outTriangle = Tree->getTriangle(index);
+	if (SceneNode)
+	{
+		const core::matrix4& mat = SceneNode->getAbsoluteTransformation();
+		mat.transformVect(outTriangle.pointA);
+		mat.transformVect(outTriangle.pointB);
+		mat.transformVect(outTriangle.pointC);
+	}
+
+	return true;
+}
+
+
+ISceneNode* CBvhTriangleSelector::getSceneNodeForTriangle(u32 triangleIndex) const
+{
+	return SceneNode;
+}
+
+
+u32 CBvhTriangleSelector::getSelectorCount() const
+{
+	return 1;
+}
+
+
+ITriangleSelector* CBvhTriangleSelector::getSelector(u32 index)
+{
+	return index ? 0 : this;
+}
+
+
+const ITriangleSelector* CBvhTriangleSelector::getSelector(u32 index) const
+{
+	return index ? 0 : this;
+}
+
+
+ITriangleSelector* createBvhTriangleSelector(IMesh* mesh, ISceneNode* node)
+{
+	if (!mesh)
+		return 0;
+
+	CBvhTree* tree = new CBvhTree(mesh);
+	ITriangleSelector* selector = new CBvhTriangleSelector(tree, node);
+	tree->drop();
+	return selector;
+}
+
+
+ITriangleSelector* createBvhTriangleSelector(IAnimatedMeshSceneNode* node)
+{
+	if (!node || !node->getMesh())
+		return 0;
+
+	return createBvhTriangleSelector(node->getMesh()->getMesh(0), node);
+}
+
+
+ITriangleSelector* createBvhTriangleSelector(CBvhTree* tree, ISceneNode* node)
+{
+	if (!tree)
+		return 0;
+
+	return new CBvhTriangleSelector(tree, node);
+}
+
+} // end namespace scene
+} // end namespace irr
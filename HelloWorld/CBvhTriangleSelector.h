@@ -0,0 +1,88 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_BVH_TRIANGLE_SELECTOR_H_INCLUDED__
+#define __C_BVH_TRIANGLE_SELECTOR_H_INCLUDED__
+
+#include <irrlicht.h>
+#include "CBvhTree.h"
+
+namespace irr
+{
+namespace scene
+{
+
+//! Triangle selector which answers queries with a bounding volume hierarchy.
+/** The stock selector of the scene manager keeps a flat list of all
+triangles and tests every one of them for each box or line query. This one
+only visits the leaves of a CBvhTree which overlap the query, and returns the
+same triangles as the stock selector would.
+
+The tree holds the triangles in object space and is transformed by the
+absolute transformation of the node on every query, so moving the node does
+not need a rebuild and one tree can be shared by several nodes. */
+class CBvhTriangleSelector : public ITriangleSelector
+{
+public:
+
+	//! Constructs a selector for node using tree, which is grabbed.
+	CBvhTriangleSelector(CBvhTree* tree, ISceneNode* node);
+
+	virtual ~CBvhTriangleSelector();
+
+	virtual s32 getTriangleCount() const;
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::matrix4* transform=0) const;
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::aabbox3d<f32>& box,
+		const core::matrix4* transform=0) const;
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::line3d<f32>& line,
+		const core::matrix4* transform=0) const;
+
+	virtual ISceneNode* getSceneNodeForTriangle(u32 triangleIndex) const;
+
+	virtual u32 getSelectorCount() const;
+
+	virtual ITriangleSelector* getSelector(u32 index);
+
+	virtual const ITriangleSelector* getSelector(u32 index) const;
+
+	//! Finds the nearest hit of a ray in world space.
+	/** Unlike getTriangles() with a line this does not return every
+	candidate, but walks the tree front to back and stops as soon as no
+	closer hit is possible.
+	\return True if the ray hit a triangle. */
+	bool getCollisionPoint(const core::line3df& ray, core::vector3df& outCollisionPoint,
+		core::triangle3df& outTriangle) const;
+
+	CBvhTree* getTree() const { return Tree; }
+
+private:
+
+	//! Returns the transformation from object space to the caller's space.
+	core::matrix4 getTransformation(const core::matrix4* transform) const;
+
+	CBvhTree* Tree;
+	ISceneNode* SceneNode;
+};
+
+
+//! Creates a bvh selector for all triangles of mesh, placed like node.
+ITriangleSelector* createBvhTriangleSelector(IMesh* mesh, ISceneNode* node);
+
+//! Creates a bvh selector for the first frame of the mesh of node.
+/** This is the replacement for ISceneManager::createTriangleSelector(node). */
+ITriangleSelector* createBvhTriangleSelector(IAnimatedMeshSceneNode* node);
+
+//! Creates a selector for node sharing an already built tree.
+ITriangleSelector* createBvhTriangleSelector(CBvhTree* tree, ISceneNode* node);
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
@@ -0,0 +1,459 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CCookedMeshLoader.h"
+#include "CMappedFile.h"
+#include <string.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Bounds checked reader over the mapped file.
+class CCookedMeshLoader::CReader
+{
+public:
+
+	CReader(const u8* data, u32 size)
+		: Pos(data), End(data + size)
+	{
+	}
+
+	template <class T>
+	bool read(T& out)
+	{
+		const u8* data = skip(sizeof(T));
+		if (!data)
+			return false;
+		memcpy(&out, data, sizeof(T));
+		return true;
+	}
+
+	//! Returns count elements of size bytes and moves behind their padding, or 0 if the file is too short.
+	const u8* skip(u32 count, u32 size=1)
+	{
+		const u32 remaining = (u32)(End - Pos);
+		if (size && count > remaining / size)
+			return 0;
+
+		const u8* data = Pos;
+		const u32 bytes = count * size;
+		const u32 padded = (bytes + 3) & ~3u;
+		Pos += padded < remaining ? padded : remaining;
+		return data;
+	}
+
+	bool readName(core::stringc& out)
+	{
+		u32 length;
+		if (!read(length))
+			return false;
+
+		const u8* chars = skip(length);
+		if (!chars)
+			return false;
+
+		out = core::stringc((const c8*)chars, length);
+		return true;
+	}
+
+private:
+
+	const u8* Pos;
+	const u8* End;
+};
+
+
+namespace
+{
+
+core::aabbox3df getBox(const f32* boxMin, const f32* boxMax)
+{
+	return core::aabbox3df(boxMin[0], boxMin[1], boxMin[2], boxMax[0], boxMax[1], boxMax[2]);
+}
+
+void getMaterial(video::SMaterial& out, const SCookedMaterial& material)
+{
+	out.MaterialType = (video::E_MATERIAL_TYPE)material.MaterialType;
+	out.AmbientColor.color = material.AmbientColor;
+	out.DiffuseColor.color = material.DiffuseColor;
+	out.EmissiveColor.color = material.EmissiveColor;
+	out.SpecularColor.color = material.SpecularColor;
+	out.Shininess = material.Shininess;
+	out.MaterialTypeParam = material.MaterialTypeParam;
+	out.MaterialTypeParam2 = material.MaterialTypeParam2;
+	out.Thickness = material.Thickness;
+	out.ZBuffer = (u8)material.ZBuffer;
+	out.AntiAliasing = (u8)material.AntiAliasing;
+	out.ColorMask = (u8)material.ColorMask;
+
+	out.Wireframe = (material.Flags & ECMAT_WIREFRAME) != 0;
+	out.PointCloud = (material.Flags & ECMAT_POINTCLOUD) != 0;
+	out.GouraudShading = (material.Flags & ECMAT_GOURAUD_SHADING) != 0;
+	out.Lighting = (material.Flags & ECMAT_LIGHTING) != 0;
+	out.ZWriteEnable = (material.Flags & ECMAT_ZWRITE_ENABLE) != 0;
+	out.BackfaceCulling = (material.Flags & ECMAT_BACK_FACE_CULLING) != 0;
+	out.FrontfaceCulling = (material.Flags & ECMAT_FRONT_FACE_CULLING) != 0;
+	out.FogEnable = (material.Flags & ECMAT_FOG_ENABLE) != 0;
+	out.NormalizeNormals = (material.Flags & ECMAT_NORMALIZE_NORMALS) != 0;
+	out.UseMipMaps = (material.Flags & ECMAT_USE_MIP_MAPS) != 0;
+}
+
+template <class T>
+IMeshBuffer* createMeshBuffer(const u8* vertices, u32 vertexCount, const u8* indices, u32 indexCount)
+{
+	CMeshBuffer<T>* buffer = new CMeshBuffer<T>();
+	buffer->Vertices.set_used(vertexCount);
+	memcpy(buffer->Vertices.pointer(), vertices, vertexCount * sizeof(T));
+	buffer->Indices.set_used(indexCount);
+	memcpy(buffer->Indices.pointer(), indices, indexCount * sizeof(u16));
+	return buffer;
+}
+
+//! Returns false if an index points behind the vertices of its buffer.
+bool checkIndices(const u8* indices, u32 indexCount, bool indices32, u32 vertexCount)
+{
+	// the reader keeps the data 4 byte aligned
+	for (u32 i=0; i<indexCount; ++i)
+	{
+		const u32 index = indices32 ? ((const u32*)indices)[i] : ((const u16*)indices)[i];
+		if (index >= vertexCount)
+			return false;
+	}
+	return true;
+}
+
+template <class T>
+void copyVertices(core::array<T>& out, const u8* vertices, u32 vertexCount)
+{
+	out.set_used(vertexCount);
+	memcpy(out.pointer(), vertices, vertexCount * sizeof(T));
+}
+
+} // end anonymous namespace
+
+
+CCookedMeshLoader::CCookedMeshLoader(ISceneManager* smgr, video::IVideoDriver* driver, ILogger* logger)
+	: SceneManager(smgr), Driver(driver), Logger(logger)
+{
+	#ifdef _DEBUG
+	setDebugName("CCookedMeshLoader");
+	#endif
+}
+
+
+bool CCookedMeshLoader::isALoadableFileExtension(const io::path& filename) const
+{
+	return core::hasFileExtension(filename, "cmesh") != 0;
+}
+
+
+IAnimatedMesh* CCookedMeshLoader::createMesh(io::IReadFile* file)
+{
+	io::CMappedFile mapped(file);
+	if (!mapped.getData())
+		return 0;
+
+	core::array<STextureSlot> textures;
+	bool oldVersion = false;
+	IAnimatedMesh* mesh = readMesh(mapped.getData(), mapped.getSize(), textures, &oldVersion);
+
+	if (mesh)
+		loadTextures(textures);
+	else if (Logger && oldVersion)
+		Logger->log("Cooked mesh has an old version, cook it again", file->getFileName().c_str(), ELL_WARNING);
+	else if (Logger)
+		Logger->log("Cooked mesh is damaged", file->getFileName().c_str(), ELL_ERROR);
+
+	return mesh;
+}
+
+
+IAnimatedMesh* CCookedMeshLoader::readMesh(const u8* data, u32 size,
+	core::array<STextureSlot>& textures, bool* outOldVersion)
+{
+	CReader reader(data, size);
+
+	SCookedMeshHeader header;
+	if (!reader.read(header) || header.Magic != COOKED_MESH_MAGIC)
+		return 0;
+
+	if (header.Version != COOKED_MESH_VERSION)
+	{
+		if (outOldVersion)
+			*outOldVersion = true;
+		return 0;
+	}
+
+	const u32 firstTexture = textures.size();
+	IAnimatedMesh* mesh = (header.Flags & ECMF_SKINNED) ?
+		readSkinnedMesh(reader, header, textures) : readStaticMesh(reader, header, textures);
+
+	// the slots of a damaged mesh point to dropped buffers
+	if (!mesh)
+		textures.set_used(firstTexture);
+
+	return mesh;
+}
+
+
+void CCookedMeshLoader::loadTextures(const core::array<STextureSlot>& textures)
+{
+	for (u32 i=0; i<textures.size(); ++i)
+		textures[i].Buffer->getMaterial().setTexture(textures[i].Layer,
+			Driver->getTexture(textures[i].Name));
+}
+
+
+void CCookedMeshLoader::addTextureSlots(IMeshBuffer* buffer, const core::stringc* textureNames,
+	core::array<STextureSlot>& textures)
+{
+	for (u32 t=0; t<video::MATERIAL_MAX_TEXTURES; ++t)
+	{
+		if (!textureNames[t].size())
+			continue;
+
+		STextureSlot slot;
+		slot.Buffer = buffer;
+		slot.Layer = t;
+		slot.Name = textureNames[t];
+		textures.push_back(slot);
+	}
+}
+
+
+bool CCookedMeshLoader::readBuffer(CReader& reader, SCookedBuffer& cooked, video::SMaterial& material,
+	core::stringc* textureNames)
+{
+	if (!reader.read(cooked) || cooked.VertexType > video::EVT_TANGENTS ||
+		cooked.IndexType > video::EIT_32BIT)
+		return false;
+
+	getMaterial(material, cooked.Material);
+
+	for (u32 t=0; t<video::MATERIAL_MAX_TEXTURES; ++t)
+		if (!reader.readName(textureNames[t]))
+			return false;
+	return true;
+}
+
+
+IAnimatedMesh* CCookedMeshLoader::readStaticMesh(CReader& reader, const SCookedMeshHeader& header,
+	core::array<STextureSlot>& textures)
+{
+	SMesh* mesh = new SMesh();
+
+	for (u32 i=0; i<header.BufferCount; ++i)
+	{
+		SCookedBuffer cooked;
+		video::SMaterial material;
+		core::stringc textureNames[video::MATERIAL_MAX_TEXTURES];
+		if (!readBuffer(reader, cooked, material, textureNames))
+		{
+			mesh->drop();
+			return 0;
+		}
+
+		const video::E_VERTEX_TYPE vertexType = (video::E_VERTEX_TYPE)cooked.VertexType;
+		const video::E_INDEX_TYPE indexType = (video::E_INDEX_TYPE)cooked.IndexType;
+		const u32 vertexPitch = video::getVertexPitchFromType(vertexType);
+		const u32 indexSize = indexType == video::EIT_32BIT ? 4 : 2;
+
+		const u8* vertices = reader.skip(cooked.VertexCount, vertexPitch);
+		const u8* indices = vertices ? reader.skip(cooked.IndexCount, indexSize) : 0;
+		if (!indices || !checkIndices(indices, cooked.IndexCount, indexType == video::EIT_32BIT, cooked.VertexCount))
+		{
+			mesh->drop();
+			return 0;
+		}
+
+		IMeshBuffer* buffer = 0;
+		if (indexType == video::EIT_32BIT)
+		{
+			// only the dynamic buffer can hold 32 bit indices
+			CDynamicMeshBuffer* dynamic = new CDynamicMeshBuffer(vertexType, indexType);
+			dynamic->getVertexBuffer().set_used(cooked.VertexCount);
+			memcpy(dynamic->getVertexBuffer().getData(), vertices, cooked.VertexCount * vertexPitch);
+			dynamic->getIndexBuffer().set_used(cooked.IndexCount);
+			memcpy(dynamic->getIndexBuffer().getData(), indices, cooked.IndexCount * indexSize);
+			buffer = dynamic;
+		}
+		else
+		{
+			switch (vertexType)
+			{
+			case video::EVT_2TCOORDS:
+				buffer = createMeshBuffer<video::S3DVertex2TCoords>(vertices, cooked.VertexCount, indices, cooked.IndexCount);
+				break;
+			case video::EVT_TANGENTS:
+				buffer = createMeshBuffer<video::S3DVertexTangents>(vertices, cooked.VertexCount, indices, cooked.IndexCount);
+				break;
+			default:
+				buffer = createMeshBuffer<video::S3DVertex>(vertices, cooked.VertexCount, indices, cooked.IndexCount);
+				break;
+			}
+		}
+
+		buffer->getMaterial() = material;
+		buffer->setBoundingBox(getBox(cooked.BoxMin, cooked.BoxMax));
+		mesh->addMeshBuffer(buffer);
+		buffer->drop();
+		addTextureSlots(buffer, textureNames, textures);
+	}
+
+	mesh->setBoundingBox(getBox(header.BoxMin, header.BoxMax));
+
+	SAnimatedMesh* animatedMesh = new SAnimatedMesh(mesh);
+	mesh->drop();
+	animatedMesh->setBoundingBox(mesh->getBoundingBox());
+	if (header.AnimationSpeed > 0.f)
+		animatedMesh->setAnimationSpeed(header.AnimationSpeed);
+	return animatedMesh;
+}
+
+
+IAnimatedMesh* CCookedMeshLoader::readSkinnedMesh(CReader& reader, const SCookedMeshHeader& header,
+	core::array<STextureSlot>& textures)
+{
+	ISkinnedMesh* mesh = SceneManager->createSkinnedMesh();
+	// what the weights of the joints are checked against
+	core::array<u32> vertexCounts;
+	vertexCounts.reallocate(header.BufferCount);
+
+	for (u32 i=0; i<header.BufferCount; ++i)
+	{
+		SCookedBuffer cooked;
+		video::SMaterial material;
+		core::stringc textureNames[video::MATERIAL_MAX_TEXTURES];
+		// skinned mesh buffers only have 16 bit indices
+		if (!readBuffer(reader, cooked, material, textureNames) || cooked.IndexType != video::EIT_16BIT)
+		{
+			mesh->drop();
+			return 0;
+		}
+
+		const video::E_VERTEX_TYPE vertexType = (video::E_VERTEX_TYPE)cooked.VertexType;
+		const u8* vertices = reader.skip(cooked.VertexCount, video::getVertexPitchFromType(vertexType));
+		const u8* indices = vertices ? reader.skip(cooked.IndexCount, sizeof(u16)) : 0;
+		if (!indices || !checkIndices(indices, cooked.IndexCount, false, cooked.VertexCount))
+		{
+			mesh->drop();
+			return 0;
+		}
+
+		vertexCounts.push_back(cooked.VertexCount);
+		SSkinMeshBuffer* buffer = mesh->addMeshBuffer();
+		buffer->VertexType = vertexType;
+		switch (vertexType)
+		{
+		case video::EVT_2TCOORDS:
+			copyVertices(buffer->Vertices_2TCoords, vertices, cooked.VertexCount);
+			break;
+		case video::EVT_TANGENTS:
+			copyVertices(buffer->Vertices_Tangents, vertices, cooked.VertexCount);
+			break;
+		default:
+			copyVertices(buffer->Vertices_Standard, vertices, cooked.VertexCount);
+			break;
+		}
+		buffer->Indices.set_used(cooked.IndexCount);
+		memcpy(buffer->Indices.pointer(), indices, cooked.IndexCount * sizeof(u16));
+
+		buffer->Material = material;
+		buffer->BoundingBox = getBox(cooked.BoxMin, cooked.BoxMax);
+		buffer->Transformation.setM(cooked.Transformation);
+		addTextureSlots(buffer, textureNames, textures);
+	}
+
+	core::array<ISkinnedMesh::SJoint*> joints;
+	joints.reallocate(header.JointCount);
+
+	for (u32 i=0; i<header.JointCount; ++i)
+	{
+		core::stringc name;
+		SCookedJoint cooked;
+		if (!reader.readName(name) || !reader.read(cooked) || cooked.Parent >= (s32)i)
+		{
+			mesh->drop();
+			return 0;
+		}
+
+		ISkinnedMesh::SJoint* joint = mesh->addJoint(cooked.Parent >= 0 ? joints[cooked.Parent] : 0);
+		joints.push_back(joint);
+
+		joint->Name = name;
+		joint->LocalMatrix.setM(cooked.LocalMatrix);
+		joint->GlobalInversedMatrix.setM(cooked.GlobalInversedMatrix);
+
+		const u8* attached = reader.skip(cooked.AttachedMeshCount, sizeof(u32));
+		const u8* positionKeys = attached ? reader.skip(cooked.PositionKeyCount, sizeof(SCookedKey)) : 0;
+		const u8* scaleKeys = positionKeys ? reader.skip(cooked.ScaleKeyCount, sizeof(SCookedKey)) : 0;
+		const u8* rotationKeys = scaleKeys ? reader.skip(cooked.RotationKeyCount, sizeof(SCookedRotationKey)) : 0;
+		const u8* weights = rotationKeys ? reader.skip(cooked.WeightCount, sizeof(SCookedWeight)) : 0;
+		if (!weights)
+		{
+			mesh->drop();
+			return 0;
+		}
+
+		joint->AttachedMeshes.set_used(cooked.AttachedMeshCount);
+		memcpy(joint->AttachedMeshes.pointer(), attached, cooked.AttachedMeshCount * sizeof(u32));
+		if (!checkIndices(attached, cooked.AttachedMeshCount, true, header.BufferCount))
+		{
+			mesh->drop();
+			return 0;
+		}
+
+		for (u32 k=0; k<cooked.PositionKeyCount; ++k)
+		{
+			SCookedKey key;
+			memcpy(&key, positionKeys + k * sizeof(key), sizeof(key));
+			ISkinnedMesh::SPositionKey* out = mesh->addPositionKey(joint);
+			out->frame = key.Frame;
+			out->position.set(key.Value[0], key.Value[1], key.Value[2]);
+		}
+
+		for (u32 k=0; k<cooked.ScaleKeyCount; ++k)
+		{
+			SCookedKey key;
+			memcpy(&key, scaleKeys + k * sizeof(key), sizeof(key));
+			ISkinnedMesh::SScaleKey* out = mesh->addScaleKey(joint);
+			out->frame = key.Frame;
+			out->scale.set(key.Value[0], key.Value[1], key.Value[2]);
+		}
+
+		for (u32 k=0; k<cooked.RotationKeyCount; ++k)
+		{
+			SCookedRotationKey key;
+			memcpy(&key, rotationKeys + k * sizeof(key), sizeof(key));
+			ISkinnedMesh::SRotationKey* out = mesh->addRotationKey(joint);
+			out->frame = key.Frame;
+			out->rotation = core::quaternion(key.Value[0], key.Value[1], key.Value[2], key.Value[3]);
+		}
+
+		for (u32 k=0; k<cooked.WeightCount; ++k)
+		{
+			SCookedWeight weight;
+			memcpy(&weight, weights + k * sizeof(weight), sizeof(weight));
+			if (weight.Buffer >= header.BufferCount || weight.Vertex >= vertexCounts[weight.Buffer])
+			{
+				mesh->drop();
+				return 0;
+			}
+			ISkinnedMesh::SWeight* out = mesh->addWeight(joint);
+			out->buffer_id = (u16)weight.Buffer;
+			out->vertex_id = weight.Vertex;
+			out->strength = weight.Strength;
+		}
+	}
+
+	if (header.AnimationSpeed > 0.f)
+		mesh->setAnimationSpeed(header.AnimationSpeed);
+	mesh->finalize();
+	return mesh;
+}
+
+} // end namespace scene
+} // end namespace irr
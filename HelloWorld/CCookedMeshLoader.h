@@ -0,0 +1,78 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_COOKED_MESH_LOADER_H_INCLUDED__
+#define __C_COOKED_MESH_LOADER_H_INCLUDED__
+
+#include <irrlicht.h>
+#include "CookedMeshFormat.h"
+
+namespace irr
+{
+namespace scene
+{
+
+//! Loads the .cmesh files written by CCookedMeshWriter.
+/** The file is memory mapped and the vertex and index arrays are copied
+straight into the mesh buffers, so loading does no parsing, welding or
+normal calculation. Every read is bounds checked; a truncated or foreign
+file makes createMesh() return 0. */
+class CCookedMeshLoader : public IMeshLoader
+{
+public:
+
+	//! The scene manager, driver and logger are not grabbed, the scene manager owns the loader.
+	CCookedMeshLoader(ISceneManager* smgr, video::IVideoDriver* driver, ILogger* logger);
+
+	virtual bool isALoadableFileExtension(const io::path& filename) const;
+
+	virtual IAnimatedMesh* createMesh(io::IReadFile* file);
+
+	//! Texture of a mesh buffer which still has to be loaded.
+	struct STextureSlot
+	{
+		IMeshBuffer* Buffer;
+		u32 Layer;
+		io::path Name;
+	};
+
+	//! Reads a cooked mesh from memory without loading its textures.
+	/** Uses neither the driver nor the logger, so it can run on a worker
+	thread while the main thread renders. The textures are appended to
+	textures and have to be set with loadTextures() on the main thread.
+	\param outOldVersion Set to true if data is a cooked mesh of another version.
+	\return The mesh, or 0 if data is no valid cooked mesh. */
+	IAnimatedMesh* readMesh(const u8* data, u32 size,
+		core::array<STextureSlot>& textures, bool* outOldVersion=0);
+
+	//! Loads the textures returned by readMesh() into their mesh buffers.
+	void loadTextures(const core::array<STextureSlot>& textures);
+
+private:
+
+	class CReader;
+
+	IAnimatedMesh* readStaticMesh(CReader& reader, const SCookedMeshHeader& header,
+		core::array<STextureSlot>& textures);
+
+	IAnimatedMesh* readSkinnedMesh(CReader& reader, const SCookedMeshHeader& header,
+		core::array<STextureSlot>& textures);
+
+	//! Reads the buffer record, its material and its texture names.
+	bool readBuffer(CReader& reader, SCookedBuffer& cooked, video::SMaterial& material,
+		core::stringc* textureNames);
+
+	//! Adds the named textures of buffer to textures.
+	void addTextureSlots(IMeshBuffer* buffer, const core::stringc* textureNames,
+		core::array<STextureSlot>& textures);
+
+	ISceneManager* SceneManager;
+	video::IVideoDriver* Driver;
+	ILogger* Logger;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
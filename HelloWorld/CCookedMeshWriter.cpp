@@ -0,0 +1,302 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CCookedMeshWriter.h"
+#include <string.h>
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+void setBox(f32* outMin, f32* outMax, const core::aabbox3df& box)
+{
+	outMin[0] = box.MinEdge.X; outMin[1] = box.MinEdge.Y; outMin[2] = box.MinEdge.Z;
+	outMax[0] = box.MaxEdge.X; outMax[1] = box.MaxEdge.Y; outMax[2] = box.MaxEdge.Z;
+}
+
+void setMaterial(SCookedMaterial& out, const video::SMaterial& material)
+{
+	out.MaterialType = material.MaterialType;
+	out.AmbientColor = material.AmbientColor.color;
+	out.DiffuseColor = material.DiffuseColor.color;
+	out.EmissiveColor = material.EmissiveColor.color;
+	out.SpecularColor = material.SpecularColor.color;
+	out.Shininess = material.Shininess;
+	out.MaterialTypeParam = material.MaterialTypeParam;
+	out.MaterialTypeParam2 = material.MaterialTypeParam2;
+	out.Thickness = material.Thickness;
+	out.ZBuffer = material.ZBuffer;
+	out.AntiAliasing = material.AntiAliasing;
+	out.ColorMask = material.ColorMask;
+
+	out.Flags = 0;
+	if (material.Wireframe) out.Flags |= ECMAT_WIREFRAME;
+	if (material.PointCloud) out.Flags |= ECMAT_POINTCLOUD;
+	if (material.GouraudShading) out.Flags |= ECMAT_GOURAUD_SHADING;
+	if (material.Lighting) out.Flags |= ECMAT_LIGHTING;
+	if (material.ZWriteEnable) out.Flags |= ECMAT_ZWRITE_ENABLE;
+	if (material.BackfaceCulling) out.Flags |= ECMAT_BACK_FACE_CULLING;
+	if (material.FrontfaceCulling) out.Flags |= ECMAT_FRONT_FACE_CULLING;
+	if (material.FogEnable) out.Flags |= ECMAT_FOG_ENABLE;
+	if (material.NormalizeNormals) out.Flags |= ECMAT_NORMALIZE_NORMALS;
+	if (material.UseMipMaps) out.Flags |= ECMAT_USE_MIP_MAPS;
+}
+
+// Appends joint and all its children to ordered, parents first.
+void addJointTree(ISkinnedMesh::SJoint* joint, core::array<ISkinnedMesh::SJoint*>& ordered)
+{
+	ordered.push_back(joint);
+	for (u32 i=0; i<joint->Children.size(); ++i)
+		addJointTree(joint->Children[i], ordered);
+}
+
+s32 findJoint(const core::array<ISkinnedMesh::SJoint*>& joints, const ISkinnedMesh::SJoint* joint)
+{
+	for (u32 i=0; i<joints.size(); ++i)
+		if (joints[i] == joint)
+			return (s32)i;
+	return -1;
+}
+
+} // end anonymous namespace
+
+
+CCookedMeshWriter::CCookedMeshWriter(CMeshDerivationCache* meshes, io::IFileSystem* fileSystem)
+	: Meshes(meshes), FileSystem(fileSystem), Failed(false)
+{
+	#ifdef _DEBUG
+	setDebugName("CCookedMeshWriter");
+	#endif
+
+	if (Meshes)
+		Meshes->grab();
+	if (FileSystem)
+		FileSystem->grab();
+}
+
+
+CCookedMeshWriter::~CCookedMeshWriter()
+{
+	if (Meshes)
+		Meshes->drop();
+	if (FileSystem)
+		FileSystem->drop();
+}
+
+
+EMESH_WRITER_TYPE CCookedMeshWriter::getType() const
+{
+	return EMWT_COOKED_MESH;
+}
+
+
+bool CCookedMeshWriter::writeMesh(io::IWriteFile* file, IMesh* mesh, s32 /*flags*/)
+{
+	return writeStaticMesh(file, mesh, 0.f);
+}
+
+
+bool CCookedMeshWriter::writeAnimatedMesh(io::IWriteFile* file, IAnimatedMesh* mesh)
+{
+	if (!mesh)
+		return false;
+
+	if (mesh->getMeshType() == EAMT_SKINNED)
+		return writeSkinnedMesh(file, (ISkinnedMesh*)mesh);
+
+	return writeStaticMesh(file, mesh->getMesh(0), mesh->getAnimationSpeed());
+}
+
+
+bool CCookedMeshWriter::writeStaticMesh(io::IWriteFile* file, IMesh* mesh, f32 animationSpeed)
+{
+	if (!file || !mesh)
+		return false;
+
+	Failed = false;
+
+	// the manipulator can only weld 16 bit buffers
+	bool canWeld = Meshes != 0;
+	for (u32 i=0; i<mesh->getMeshBufferCount(); ++i)
+		if (mesh->getMeshBuffer(i)->getIndexType() != video::EIT_16BIT)
+			canWeld = false;
+
+	// the welded mesh belongs to the cache
+	IMesh* welded = canWeld ? Meshes->getMeshWelded(mesh) : 0;
+	IMesh* source = welded ? welded : mesh;
+
+	writeHeader(file, 0, source->getMeshBufferCount(), 0, animationSpeed, mesh->getBoundingBox());
+
+	const core::matrix4 identity;
+	for (u32 i=0; i<source->getMeshBufferCount(); ++i)
+		writeBuffer(file, source->getMeshBuffer(i), identity);
+
+	return !Failed;
+}
+
+
+bool CCookedMeshWriter::writeSkinnedMesh(io::IWriteFile* file, ISkinnedMesh* mesh)
+{
+	if (!file || !mesh)
+		return false;
+
+	Failed = false;
+
+	// order the joints parents first, so the loader can add every joint
+	// to its already created parent
+	const core::array<ISkinnedMesh::SJoint*>& allJoints = mesh->getAllJoints();
+	core::array<ISkinnedMesh::SJoint*> joints;
+	for (u32 i=0; i<allJoints.size(); ++i)
+	{
+		bool isChild = false;
+		for (u32 j=0; j<allJoints.size() && !isChild; ++j)
+			isChild = allJoints[j]->Children.linear_search(allJoints[i]) >= 0;
+
+		if (!isChild)
+			addJointTree(allJoints[i], joints);
+	}
+
+	core::array<SSkinMeshBuffer*>& buffers = mesh->getMeshBuffers();
+
+	writeHeader(file, ECMF_SKINNED, buffers.size(), joints.size(),
+		mesh->getAnimationSpeed(), mesh->getBoundingBox());
+
+	for (u32 i=0; i<buffers.size(); ++i)
+		writeBuffer(file, buffers[i], buffers[i]->Transformation);
+
+	for (u32 i=0; i<joints.size(); ++i)
+	{
+		const ISkinnedMesh::SJoint* joint = joints[i];
+
+		s32 parent = -1;
+		for (u32 j=0; j<joints.size() && parent < 0; ++j)
+			if (joints[j]->Children.linear_search(const_cast<ISkinnedMesh::SJoint*>(joint)) >= 0)
+				parent = findJoint(joints, joints[j]);
+
+		writeName(file, joint->Name);
+
+		SCookedJoint cooked;
+		cooked.Parent = parent;
+		memcpy(cooked.LocalMatrix, joint->LocalMatrix.pointer(), sizeof(cooked.LocalMatrix));
+		memcpy(cooked.GlobalInversedMatrix, joint->GlobalInversedMatrix.pointer(), sizeof(cooked.GlobalInversedMatrix));
+		cooked.AttachedMeshCount = joint->AttachedMeshes.size();
+		cooked.PositionKeyCount = joint->PositionKeys.size();
+		cooked.ScaleKeyCount = joint->ScaleKeys.size();
+		cooked.RotationKeyCount = joint->RotationKeys.size();
+		cooked.WeightCount = joint->Weights.size();
+		write(file, &cooked, sizeof(cooked));
+
+		for (u32 k=0; k<joint->AttachedMeshes.size(); ++k)
+			write(file, &joint->AttachedMeshes[k], sizeof(u32));
+
+		for (u32 k=0; k<joint->PositionKeys.size(); ++k)
+		{
+			const ISkinnedMesh::SPositionKey& key = joint->PositionKeys[k];
+			const SCookedKey cookedKey = { key.frame, { key.position.X, key.position.Y, key.position.Z } };
+			write(file, &cookedKey, sizeof(cookedKey));
+		}
+
+		for (u32 k=0; k<joint->ScaleKeys.size(); ++k)
+		{
+			const ISkinnedMesh::SScaleKey& key = joint->ScaleKeys[k];
+			const SCookedKey cookedKey = { key.frame, { key.scale.X, key.scale.Y, key.scale.Z } };
+			write(file, &cookedKey, sizeof(cookedKey));
+		}
+
+		for (u32 k=0; k<joint->RotationKeys.size(); ++k)
+		{
+			const ISkinnedMesh::SRotationKey& key = joint->RotationKeys[k];
+			const SCookedRotationKey cookedKey = { key.frame,
+				{ key.rotation.X, key.rotation.Y, key.rotation.Z, key.rotation.W } };
+			write(file, &cookedKey, sizeof(cookedKey));
+		}
+
+		for (u32 k=0; k<joint->Weights.size(); ++k)
+		{
+			const ISkinnedMesh::SWeight& weight = joint->Weights[k];
+			const SCookedWeight cookedWeight = { weight.buffer_id, weight.vertex_id, weight.strength };
+			write(file, &cookedWeight, sizeof(cookedWeight));
+		}
+	}
+
+	return !Failed;
+}
+
+
+void CCookedMeshWriter::writeHeader(io::IWriteFile* file, u32 flags, u32 bufferCount,
+		u32 jointCount, f32 animationSpeed, const core::aabbox3df& box)
+{
+	SCookedMeshHeader header;
+	header.Magic = COOKED_MESH_MAGIC;
+	header.Version = COOKED_MESH_VERSION;
+	header.Flags = flags;
+	header.BufferCount = bufferCount;
+	header.JointCount = jointCount;
+	header.AnimationSpeed = animationSpeed;
+	setBox(header.BoxMin, header.BoxMax, box);
+	write(file, &header, sizeof(header));
+}
+
+
+void CCookedMeshWriter::writeBuffer(io::IWriteFile* file, const IMeshBuffer* mb,
+		const core::matrix4& transformation)
+{
+	SCookedBuffer cooked;
+	cooked.VertexType = mb->getVertexType();
+	cooked.IndexType = mb->getIndexType();
+	cooked.VertexCount = mb->getVertexCount();
+	cooked.IndexCount = mb->getIndexCount();
+	setBox(cooked.BoxMin, cooked.BoxMax, mb->getBoundingBox());
+	memcpy(cooked.Transformation, transformation.pointer(), sizeof(cooked.Transformation));
+	setMaterial(cooked.Material, mb->getMaterial());
+	write(file, &cooked, sizeof(cooked));
+
+	for (u32 t=0; t<video::MATERIAL_MAX_TEXTURES; ++t)
+	{
+		const video::ITexture* texture = mb->getMaterial().getTexture(t);
+		io::path name;
+		if (texture && FileSystem)
+			name = FileSystem->getRelativeFilename(texture->getName(), FileSystem->getWorkingDirectory());
+		writeName(file, name);
+	}
+
+	const u32 vertexSize = cooked.VertexCount * video::getVertexPitchFromType(mb->getVertexType());
+	write(file, mb->getVertices(), vertexSize);
+	writePadding(file, vertexSize);
+
+	const u32 indexSize = cooked.IndexCount * (cooked.IndexType == video::EIT_32BIT ? 4 : 2);
+	write(file, mb->getIndices(), indexSize);
+	writePadding(file, indexSize);
+}
+
+
+void CCookedMeshWriter::writeName(io::IWriteFile* file, const core::stringc& name)
+{
+	const u32 length = name.size();
+	write(file, &length, sizeof(length));
+	write(file, name.c_str(), length);
+	writePadding(file, length);
+}
+
+
+void CCookedMeshWriter::write(io::IWriteFile* file, const void* data, u32 size)
+{
+	if (size && file->write(data, size) != (s32)size)
+		Failed = true;
+}
+
+
+void CCookedMeshWriter::writePadding(io::IWriteFile* file, u32 size)
+{
+	const u32 zero = 0;
+	if (size & 3)
+		write(file, &zero, 4 - (size & 3));
+}
+
+} // end namespace scene
+} // end namespace irr
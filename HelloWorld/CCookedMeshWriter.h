@@ -0,0 +1,76 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_COOKED_MESH_WRITER_H_INCLUDED__
+#define __C_COOKED_MESH_WRITER_H_INCLUDED__
+
+#include <irrlicht.h>
+#include "CookedMeshFormat.h"
+#include "CMeshDerivationCache.h"
+
+namespace irr
+{
+namespace scene
+{
+
+//! Type of the cooked mesh writer.
+const EMESH_WRITER_TYPE EMWT_COOKED_MESH = (EMESH_WRITER_TYPE)MAKE_IRR_ID('c','m','s','h');
+
+//! Writes meshes in the binary format read by CCookedMeshLoader.
+/** Static meshes are welded before they are written, so the loader gets
+the smallest vertex buffers without doing any work. The welded meshes come
+from a CMeshDerivationCache, so a mesh written more than once is only
+welded once. Texture names are stored relative to the working directory
+of the cooker. */
+class CCookedMeshWriter : public IMeshWriter
+{
+public:
+
+	//! Without meshes, the meshes are written as they are.
+	CCookedMeshWriter(CMeshDerivationCache* meshes, io::IFileSystem* fileSystem);
+
+	virtual ~CCookedMeshWriter();
+
+	virtual EMESH_WRITER_TYPE getType() const;
+
+	//! Writes a static mesh.
+	/** The E_MESH_WRITER_FLAGS are ignored, the format has only one way to
+	store a mesh. */
+	virtual bool writeMesh(io::IWriteFile* file, IMesh* mesh, s32 flags=EMWF_NONE);
+
+	//! Writes an animated mesh.
+	/** Skinned meshes are written with their joints, weights and keys.
+	Other animated meshes are written as their first frame. */
+	bool writeAnimatedMesh(io::IWriteFile* file, IAnimatedMesh* mesh);
+
+private:
+
+	bool writeStaticMesh(io::IWriteFile* file, IMesh* mesh, f32 animationSpeed);
+
+	bool writeSkinnedMesh(io::IWriteFile* file, ISkinnedMesh* mesh);
+
+	void writeHeader(io::IWriteFile* file, u32 flags, u32 bufferCount,
+		u32 jointCount, f32 animationSpeed, const core::aabbox3df& box);
+
+	void writeBuffer(io::IWriteFile* file, const IMeshBuffer* mb,
+		const core::matrix4& transformation);
+
+	void writeName(io::IWriteFile* file, const core::stringc& name);
+
+	void write(io::IWriteFile* file, const void* data, u32 size);
+
+	//! Pads the file to a multiple of 4 bytes after size bytes of data.
+	void writePadding(io::IWriteFile* file, u32 size);
+
+	CMeshDerivationCache* Meshes;
+	io::IFileSystem* FileSystem;
+
+	//! Set when any write was incomplete.
+	bool Failed;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
@@ -0,0 +1,449 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CCubeFieldSceneNode.h"
+#include <math.h>
+#include <string.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Selector with the 12 triangles of the bounding box of every instance.
+class CCubeFieldTriangleSelector : public ITriangleSelector
+{
+public:
+
+	CCubeFieldTriangleSelector(CCubeFieldSceneNode* node)
+		: Node(node)
+	{
+		#ifdef _DEBUG
+		setDebugName("CCubeFieldTriangleSelector");
+		#endif
+	}
+
+	virtual s32 getTriangleCount() const
+	{
+		return Node->getInstanceCount() * 12;
+	}
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::matrix4* transform=0) const
+	{
+		outTriangleCount = 0;
+		for (u32 i=0; i<Node->getInstanceCount(); ++i)
+			addBox(getWorldBox(i), triangles, arraySize, outTriangleCount, transform);
+	}
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::aabbox3d<f32>& box,
+		const core::matrix4* transform=0) const
+	{
+		outTriangleCount = 0;
+		for (u32 i=0; i<Node->getInstanceCount(); ++i)
+		{
+			const core::aabbox3df instanceBox(getWorldBox(i));
+			if (instanceBox.intersectsWithBox(box))
+				addBox(instanceBox, triangles, arraySize, outTriangleCount, transform);
+		}
+	}
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::line3d<f32>& line,
+		const core::matrix4* transform=0) const
+	{
+		outTriangleCount = 0;
+		for (u32 i=0; i<Node->getInstanceCount(); ++i)
+		{
+			const core::aabbox3df instanceBox(getWorldBox(i));
+			if (instanceBox.intersectsWithLine(line))
+				addBox(instanceBox, triangles, arraySize, outTriangleCount, transform);
+		}
+	}
+
+	virtual ISceneNode* getSceneNodeForTriangle(u32 triangleIndex) const
+	{
+		return Node;
+	}
+
+	virtual u32 getSelectorCount() const
+	{
+		return 1;
+	}
+
+	virtual ITriangleSelector* getSelector(u32 index)
+	{
+		return index ? 0 : this;
+	}
+
+	virtual const ITriangleSelector* getSelector(u32 index) const
+	{
+		return index ? 0 : this;
+	}
+
+private:
+
+	core::aabbox3df getWorldBox(u32 instance) const
+	{
+		core::aabbox3df box(Node->getInstanceBox(instance));
+		Node->getAbsoluteTransformation().transformBoxEx(box);
+		return box;
+	}
+
+	// same triangles as CTriangleSelector creates for a bounding box
+	static void addBox(const core::aabbox3df& box, core::triangle3df* triangles,
+		s32 arraySize, s32& outTriangleCount, const core::matrix4* transform)
+	{
+		if (outTriangleCount + 12 > arraySize)
+			return;
+
+		core::vector3df edges[8];
+		box.getEdges(edges);
+
+		core::triangle3df* t = triangles + outTriangleCount;
+		t[0].set(edges[3], edges[1], edges[2]);
+		t[1].set(edges[1], edges[0], edges[2]);
+		t[2].set(edges[3], edges[7], edges[1]);
+		t[3].set(edges[7], edges[5], edges[1]);
+		t[4].set(edges[7], edges[6], edges[5]);
+		t[5].set(edges[6], edges[4], edges[5]);
+		t[6].set(edges[2], edges[0], edges[6]);
+		t[7].set(edges[0], edges[4], edges[6]);
+		t[8].set(edges[1], edges[5], edges[0]);
+		t[9].set(edges[5], edges[4], edges[0]);
+		t[10].set(edges[3], edges[2], edges[7]);
+		t[11].set(edges[2], edges[6], edges[7]);
+
+		if (transform)
+		{
+			for (u32 i=0; i<12; ++i)
+			{
+				transform->transformVect(t[i].pointA);
+				transform->transformVect(t[i].pointB);
+				transform->transformVect(t[i].pointC);
+			}
+		}
+
+		outTriangleCount += 12;
+	}
+
+	// the node owns no reference to the selector, so the selector must not
+	// own one to the node either. It is only used while the node lives.
+	CCubeFieldSceneNode* Node;
+};
+
+
+CCubeFieldSceneNode::CCubeFieldSceneNode(IMesh* mesh, const core::vector3df& instanceScale,
+		ISceneNode* parent, ISceneManager* mgr, s32 id)
+	: ISceneNode(parent, mgr, id), VertexType(video::EVT_STANDARD), VertexPitch(0),
+	TemplateVertexCount(0), TemplateRadius(0.f), MergedBuffer(0), MergedMesh(0),
+	MergedDirty(true), StartTimeMs(0), Started(false)
+{
+	#ifdef _DEBUG
+	setDebugName("CCubeFieldSceneNode");
+	#endif
+
+	TemplateBox.reset(0,0,0);
+	Box.reset(0,0,0);
+
+	const IMeshBuffer* mb = (mesh && mesh->getMeshBufferCount()) ? mesh->getMeshBuffer(0) : 0;
+	if (mb && mb->getIndexType() == video::EIT_16BIT)
+	{
+		VertexType = mb->getVertexType();
+		VertexPitch = video::getVertexPitchFromType(VertexType);
+		TemplateVertexCount = mb->getVertexCount();
+		Material = mb->getMaterial();
+
+		TemplateVertices.set_used(TemplateVertexCount * VertexPitch);
+		memcpy(TemplateVertices.pointer(), mb->getVertices(), TemplateVertices.size());
+
+		// apply the scale once, the instances are only rotated and moved
+		for (u32 i=0; i<TemplateVertexCount; ++i)
+		{
+			video::S3DVertex& v = *(video::S3DVertex*)(TemplateVertices.pointer() + i * VertexPitch);
+			v.Pos *= instanceScale;
+
+			if (i)
+				TemplateBox.addInternalPoint(v.Pos);
+			else
+				TemplateBox.reset(v.Pos);
+			TemplateRadius = core::max_(TemplateRadius, v.Pos.getLength());
+		}
+
+		TemplateIndices.set_used(mb->getIndexCount());
+		memcpy(TemplateIndices.pointer(), mb->getIndices(), TemplateIndices.size() * sizeof(u16));
+	}
+
+	MergedBuffer = new CDynamicMeshBuffer(VertexType, video::EIT_16BIT);
+	// the vertices change every frame, the indices only with the instances
+	MergedBuffer->setHardwareMappingHint(EHM_STREAM, EBT_VERTEX);
+	MergedBuffer->setHardwareMappingHint(EHM_STATIC, EBT_INDEX);
+
+	MergedMesh = new SMesh();
+	MergedMesh->addMeshBuffer(MergedBuffer);
+}
+
+
+CCubeFieldSceneNode::~CCubeFieldSceneNode()
+{
+	MergedMesh->drop();
+	MergedBuffer->drop();
+}
+
+
+void CCubeFieldSceneNode::addInstance(const core::vector3df& position, f32 rotationSpeed)
+{
+	u32 group = 0;
+	while (group < Groups.size() && Groups[group].Speed != rotationSpeed)
+		++group;
+
+	if (group == Groups.size())
+	{
+		SGroup g;
+		g.Speed = rotationSpeed;
+		g.Sin = 0.f;
+		g.Cos = 1.f;
+		g.HalfExtent = TemplateBox.getExtent() * 0.5f;
+		g.Center = TemplateBox.getCenter();
+		Groups.push_back(g);
+	}
+
+	SInstance instance;
+	instance.Position = position;
+	instance.Group = group;
+	Instances.push_back(instance);
+
+	// conservative box which holds the instance at any rotation
+	const core::aabbox3df box(position - core::vector3df(TemplateRadius),
+		position + core::vector3df(TemplateRadius));
+	if (Instances.size() == 1)
+		Box = box;
+	else
+		Box.addInternalBox(box);
+
+	MergedDirty = true;
+}
+
+
+IShadowVolumeSceneNode* CCubeFieldSceneNode::addShadowVolumeSceneNode(s32 id,
+		bool zfailmethod, f32 infinity)
+{
+	// Shadow volumes can only be attached to mesh scene nodes. This one has
+	// no mesh of its own, it only carries the volume of the merged mesh.
+	SMesh* empty = new SMesh();
+	IMeshSceneNode* carrier = SceneManager->addMeshSceneNode(empty, this, -1,
+		core::vector3df(0,0,0), core::vector3df(0,0,0), core::vector3df(1,1,1), true);
+	empty->drop();
+
+	if (!carrier)
+		return 0;
+
+	return carrier->addShadowVolumeSceneNode(MergedMesh, id, zfailmethod, infinity);
+}
+
+
+ITriangleSelector* CCubeFieldSceneNode::createTriangleSelector()
+{
+	return new CCubeFieldTriangleSelector(this);
+}
+
+
+void CCubeFieldSceneNode::rebuildMergedBuffer()
+{
+	IVertexBuffer& vertices = MergedBuffer->getVertexBuffer();
+	IIndexBuffer& indices = MergedBuffer->getIndexBuffer();
+
+	// keep the indices 16 bit, the shadow volumes can not use anything else
+	const u32 maxInstances = TemplateVertexCount ? 65536 / TemplateVertexCount : 0;
+	_IRR_DEBUG_BREAK_IF(Instances.size() > maxInstances);
+	const u32 count = core::min_(Instances.size(), maxInstances);
+
+	vertices.set_used(count * TemplateVertexCount);
+	u8* dst = (u8*)vertices.pointer();
+	for (u32 i=0; i<count; ++i)
+		memcpy(dst + i * TemplateVertices.size(), TemplateVertices.const_pointer(), TemplateVertices.size());
+
+	indices.set_used(0);
+	indices.reallocate(count * TemplateIndices.size());
+	for (u32 i=0; i<count; ++i)
+	{
+		const u32 base = i * TemplateVertexCount;
+		for (u32 j=0; j<TemplateIndices.size(); ++j)
+			indices.push_back(base + TemplateIndices[j]);
+	}
+
+	MergedBuffer->setBoundingBox(Box);
+	MergedMesh->setBoundingBox(Box);
+	MergedBuffer->setDirty();
+	MergedDirty = false;
+}
+
+
+void CCubeFieldSceneNode::updateVertices()
+{
+	const u32 count = MergedBuffer->getVertexBuffer().size() / core::max_(TemplateVertexCount, 1u);
+	u8* dst = (u8*)MergedBuffer->getVertexBuffer().pointer();
+	const bool tangents = VertexType == video::EVT_TANGENTS;
+
+	for (u32 i=0; i<count; ++i)
+	{
+		const SGroup& g = Groups[Instances[i].Group];
+		const core::vector3df& p = Instances[i].Position;
+		const u8* src = TemplateVertices.const_pointer();
+
+		// rotation around Y as matrix4::setRotationDegrees() builds it
+		for (u32 v=0; v<TemplateVertexCount; ++v)
+		{
+			const video::S3DVertex& s = *(const video::S3DVertex*)src;
+			video::S3DVertex& d = *(video::S3DVertex*)dst;
+
+			d.Pos.X = s.Pos.X * g.Cos + s.Pos.Z * g.Sin + p.X;
+			d.Pos.Y = s.Pos.Y + p.Y;
+			d.Pos.Z = s.Pos.Z * g.Cos - s.Pos.X * g.Sin + p.Z;
+
+			d.Normal.X = s.Normal.X * g.Cos + s.Normal.Z * g.Sin;
+			d.Normal.Y = s.Normal.Y;
+			d.Normal.Z = s.Normal.Z * g.Cos - s.Normal.X * g.Sin;
+
+			if (tangents)
+			{
+				const video::S3DVertexTangents& st = (const video::S3DVertexTangents&)s;
+				video::S3DVertexTangents& dt = (video::S3DVertexTangents&)d;
+
+				dt.Tangent.X = st.Tangent.X * g.Cos + st.Tangent.Z * g.Sin;
+				dt.Tangent.Y = st.Tangent.Y;
+				dt.Tangent.Z = st.Tangent.Z * g.Cos - st.Tangent.X * g.Sin;
+
+				dt.Binormal.X = st.Binormal.X * g.Cos + st.Binormal.Z * g.Sin;
+				dt.Binormal.Y = st.Binormal.Y;
+				dt.Binormal.Z = st.Binormal.Z * g.Cos - st.Binormal.X * g.Sin;
+			}
+
+			src += VertexPitch;
+			dst += VertexPitch;
+		}
+	}
+
+	MergedBuffer->setDirty(EBT_VERTEX);
+}
+
+
+core::aabbox3df CCubeFieldSceneNode::getInstanceBox(u32 instance) const
+{
+	const SGroup& g = Groups[Instances[instance].Group];
+	const core::vector3df center = Instances[instance].Position + g.Center;
+	return core::aabbox3df(center - g.HalfExtent, center + g.HalfExtent);
+}
+
+
+core::matrix4 CCubeFieldSceneNode::getInstanceTransformation(u32 instance) const
+{
+	const SGroup& g = Groups[Instances[instance].Group];
+
+	// the rotation updateVertices() applies
+	core::matrix4 mat;
+	mat[0] = g.Cos;
+	mat[2] = -g.Sin;
+	mat[8] = g.Sin;
+	mat[10] = g.Cos;
+	mat.setTranslation(Instances[instance].Position);
+	return mat;
+}
+
+
+void CCubeFieldSceneNode::getInstanceGeometry(core::array<core::vector3df>& outPositions,
+	core::array<u16>& outIndices) const
+{
+	outPositions.set_used(TemplateVertexCount);
+	for (u32 i=0; i<TemplateVertexCount; ++i)
+		outPositions[i] = ((const video::S3DVertex*)(TemplateVertices.const_pointer() + i * VertexPitch))->Pos;
+
+	outIndices = TemplateIndices;
+}
+
+
+void CCubeFieldSceneNode::OnRegisterSceneNode()
+{
+	if (IsVisible && Instances.size())
+		SceneManager->registerNodeForRendering(this);
+
+	ISceneNode::OnRegisterSceneNode();
+}
+
+
+void CCubeFieldSceneNode::OnAnimate(u32 timeMs)
+{
+	if (!Started)
+	{
+		StartTimeMs = timeMs;
+		Started = true;
+	}
+
+	if (MergedDirty)
+		rebuildMergedBuffer();
+
+	// Same angle as a rotation animator created at StartTimeMs would give.
+	// It is computed from the total time instead of being accumulated, so
+	// it does not drift.
+	const f64 elapsed = (f64)(timeMs - StartTimeMs) * 0.1;
+	const core::vector3df half = TemplateBox.getExtent() * 0.5f;
+	const core::vector3df center = TemplateBox.getCenter();
+
+	for (u32 i=0; i<Groups.size(); ++i)
+	{
+		SGroup& g = Groups[i];
+		const f64 angle = fmod(g.Speed * elapsed, 360.0) * core::DEGTORAD64;
+		g.Sin = (f32)sin(angle);
+		g.Cos = (f32)cos(angle);
+
+		const f32 absSin = core::abs_(g.Sin);
+		const f32 absCos = core::abs_(g.Cos);
+		g.HalfExtent.set(absCos * half.X + absSin * half.Z, half.Y, absSin * half.X + absCos * half.Z);
+		g.Center.set(center.X * g.Cos + center.Z * g.Sin, center.Y, center.Z * g.Cos - center.X * g.Sin);
+	}
+
+	updateVertices();
+
+	ISceneNode::OnAnimate(timeMs);
+}
+
+
+void CCubeFieldSceneNode::render()
+{
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+
+	driver->setTransform(video::ETS_WORLD, AbsoluteTransformation);
+	driver->setMaterial(Material);
+	driver->drawMeshBuffer(MergedBuffer);
+
+	if (DebugDataVisible & EDS_BBOX)
+	{
+		video::SMaterial debugMaterial;
+		debugMaterial.Lighting = false;
+		driver->setMaterial(debugMaterial);
+		driver->draw3DBox(Box, video::SColor(255,255,255,255));
+	}
+}
+
+
+const core::aabbox3d<f32>& CCubeFieldSceneNode::getBoundingBox() const
+{
+	return Box;
+}
+
+
+u32 CCubeFieldSceneNode::getMaterialCount() const
+{
+	return 1;
+}
+
+
+video::SMaterial& CCubeFieldSceneNode::getMaterial(u32 i)
+{
+	return Material;
+}
+
+} // end namespace scene
+} // end namespace irr
@@ -0,0 +1,139 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_CUBE_FIELD_SCENE_NODE_H_INCLUDED__
+#define __C_CUBE_FIELD_SCENE_NODE_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Type of the cube field scene node.
+const ESCENE_NODE_TYPE ESNT_CUBE_FIELD = (ESCENE_NODE_TYPE)MAKE_IRR_ID('c','u','b','f');
+
+//! Draws many copies of one small mesh, each rotating around its Y axis.
+/** The cube tower used to be one cube scene node per cube, each with its
+own rotation animator, shadow volume and triangle selector, so every cube
+cost a draw call plus two for its shadow. Irrlicht has no hardware
+instancing, so this node keeps all instances in one array and every frame
+writes the rotated copies of the mesh into a single dynamic mesh buffer,
+which is drawn with one call. Instances rotating at the same speed share
+the sine and cosine, so the update is one pass over the vertices.
+
+The instance positions are relative to the node. The mesh should have one
+mesh buffer with 16 bit indices; only the first buffer is used. */
+class CCubeFieldSceneNode : public ISceneNode
+{
+public:
+
+	//! Creates the node. mesh is the mesh of one instance and is not kept.
+	/** \param instanceScale Scale applied to every instance. */
+	CCubeFieldSceneNode(IMesh* mesh, const core::vector3df& instanceScale,
+		ISceneNode* parent, ISceneManager* mgr, s32 id=-1);
+
+	virtual ~CCubeFieldSceneNode();
+
+	//! Adds an instance.
+	/** \param rotationSpeed Degrees around Y per 10 milliseconds, the same
+	unit as createRotationAnimator() uses. */
+	void addInstance(const core::vector3df& position, f32 rotationSpeed);
+
+	u32 getInstanceCount() const { return Instances.size(); }
+
+	//! Returns the transformation of an instance at its current rotation, relative to the node.
+	core::matrix4 getInstanceTransformation(u32 instance) const;
+
+	//! Returns the positions and indices of the scaled mesh of one instance.
+	void getInstanceGeometry(core::array<core::vector3df>& outPositions,
+		core::array<u16>& outIndices) const;
+
+	//! Adds a shadow volume for all instances.
+	/** The volume is built from the merged mesh, so it costs one shadow
+	node instead of one per instance. */
+	IShadowVolumeSceneNode* addShadowVolumeSceneNode(s32 id=-1,
+		bool zfailmethod=true, f32 infinity=10000.0f);
+
+	//! Creates a selector returning the current bounding box of every instance.
+	/** This is what createTriangleSelectorFromBoundingBox() returned for
+	every single cube node. */
+	ITriangleSelector* createTriangleSelector();
+
+	//! The buffer with all rotated instances, relative to the node. Updated in OnAnimate().
+	IMeshBuffer* getMergedBuffer() const { return MergedBuffer; }
+
+	virtual void OnRegisterSceneNode();
+
+	virtual void OnAnimate(u32 timeMs);
+
+	virtual void render();
+
+	virtual const core::aabbox3d<f32>& getBoundingBox() const;
+
+	virtual u32 getMaterialCount() const;
+
+	virtual video::SMaterial& getMaterial(u32 i);
+
+	virtual ESCENE_NODE_TYPE getType() const { return ESNT_CUBE_FIELD; }
+
+private:
+
+	friend class CCubeFieldTriangleSelector;
+
+	struct SInstance
+	{
+		core::vector3df Position;
+		//! Index into Groups.
+		u32 Group;
+	};
+
+	//! All instances rotating at the same speed.
+	struct SGroup
+	{
+		f32 Speed;
+		f32 Sin;
+		f32 Cos;
+		//! Half size of the bounding box of one rotated instance.
+		core::vector3df HalfExtent;
+		core::vector3df Center;
+	};
+
+	//! Resizes the merged buffer and copies the static vertex data into it.
+	void rebuildMergedBuffer();
+
+	//! Writes the rotated instances into the merged buffer.
+	void updateVertices();
+
+	//! Returns the bounding box of an instance at the current rotation.
+	core::aabbox3df getInstanceBox(u32 instance) const;
+
+	core::array<SInstance> Instances;
+	core::array<SGroup> Groups;
+
+	//! Scaled template vertices, in the vertex type of the template buffer.
+	core::array<u8> TemplateVertices;
+	core::array<u16> TemplateIndices;
+	video::E_VERTEX_TYPE VertexType;
+	u32 VertexPitch;
+	u32 TemplateVertexCount;
+	core::aabbox3df TemplateBox;
+	f32 TemplateRadius;
+
+	CDynamicMeshBuffer* MergedBuffer;
+	SMesh* MergedMesh;
+	bool MergedDirty;
+
+	video::SMaterial Material;
+	core::aabbox3df Box;
+
+	u32 StartTimeMs;
+	bool Started;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
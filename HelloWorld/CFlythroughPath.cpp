@@ -0,0 +1,102 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CFlythroughPath.h"
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+core::vector3df catmullRom(const core::vector3df& p0, const core::vector3df& p1,
+		const core::vector3df& p2, const core::vector3df& p3, f32 t)
+{
+	const f32 t2 = t * t;
+	const f32 t3 = t2 * t;
+	return ((p1 * 2.f) +
+		(p2 - p0) * t +
+		(p0 * 2.f - p1 * 5.f + p2 * 4.f - p3) * t2 +
+		(p1 * 3.f - p0 - p2 * 3.f + p3) * t3) * 0.5f;
+}
+
+} // end anonymous namespace
+
+
+void CFlythroughPath::addKey(const core::vector3df& position, const core::vector3df& target)
+{
+	Keys.push_back(SKey(position, target));
+}
+
+
+void CFlythroughPath::evaluate(f32 t, core::vector3df& position, core::vector3df& target) const
+{
+	if (Keys.empty())
+		return;
+
+	if (Keys.size() == 1)
+	{
+		position = Keys[0].Position;
+		target = Keys[0].Target;
+		return;
+	}
+
+	t = core::clamp(t, 0.f, 1.f);
+
+	const s32 last = (s32)Keys.size() - 1;
+	const f32 scaled = t * last;
+	const s32 segment = core::min_(core::floor32(scaled), last - 1);
+	const f32 local = scaled - segment;
+
+	const SKey& k0 = Keys[core::max_(segment - 1, 0)];
+	const SKey& k1 = Keys[segment];
+	const SKey& k2 = Keys[segment + 1];
+	const SKey& k3 = Keys[core::min_(segment + 2, last)];
+
+	position = catmullRom(k0.Position, k1.Position, k2.Position, k3.Position, local);
+	target = catmullRom(k0.Target, k1.Target, k2.Target, k3.Target, local);
+}
+
+
+void CFlythroughPath::apply(ICameraSceneNode* camera, f32 t) const
+{
+	if (!camera)
+		return;
+
+	core::vector3df position, target;
+	evaluate(t, position, target);
+	camera->setPosition(position);
+	camera->updateAbsolutePosition();
+	camera->setTarget(target);
+}
+
+
+CFlythroughPath CFlythroughPath::createMarsColonyPath()
+{
+	CFlythroughPath path;
+
+	// spawn point of the FPS camera, looking at Zuleyka
+	path.addKey(core::vector3df(200,270,-80), core::vector3df(300,-100,400));
+	// around the cube tower
+	path.addKey(core::vector3df(-900,900,-600), core::vector3df(200,400,700));
+	path.addKey(core::vector3df(-700,1400,1900), core::vector3df(200,500,700));
+	path.addKey(core::vector3df(1400,1100,2200), core::vector3df(200,300,700));
+	// over to the gate arrays
+	path.addKey(core::vector3df(6000,1500,-600), core::vector3df(12000,550,-2000));
+	path.addKey(core::vector3df(10800,1200,-500), core::vector3df(14000,550,-2000));
+	path.addKey(core::vector3df(16500,1300,-700), core::vector3df(12000,550,-2000));
+	// the lava lake with the fire particles
+	path.addKey(core::vector3df(14000,1600,3000), core::vector3df(11000,200,5000));
+	path.addKey(core::vector3df(9000,1400,6800), core::vector3df(11000,200,5000));
+	// back over the colony to the mother ship
+	path.addKey(core::vector3df(3000,2500,2000), core::vector3df(0,-1000,-15500));
+	path.addKey(core::vector3df(500,1800,-6000), core::vector3df(0,-1000,-15500));
+
+	return path;
+}
+
+} // end namespace scene
+} // end namespace irr
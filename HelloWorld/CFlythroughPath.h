@@ -0,0 +1,61 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_FLYTHROUGH_PATH_H_INCLUDED__
+#define __C_FLYTHROUGH_PATH_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! A fixed camera path used by the benchmark.
+/** The path is a Catmull-Rom spline through a list of camera positions and
+look-at targets. It is evaluated by a normalized parameter instead of by
+time, so the same frame always sees the same camera no matter how fast the
+machine is. */
+class CFlythroughPath
+{
+public:
+
+	//! One recorded point of the path.
+	struct SKey
+	{
+		SKey() {}
+		SKey(const core::vector3df& position, const core::vector3df& target)
+			: Position(position), Target(target) {}
+
+		core::vector3df Position;
+		core::vector3df Target;
+	};
+
+	//! Adds a point at the end of the path.
+	void addKey(const core::vector3df& position, const core::vector3df& target);
+
+	//! Returns the amount of points.
+	u32 getKeyCount() const { return Keys.size(); }
+
+	//! Evaluates the path. t is clamped to 0..1.
+	void evaluate(f32 t, core::vector3df& position, core::vector3df& target) const;
+
+	//! Moves the camera to the point of the path belonging to t.
+	void apply(ICameraSceneNode* camera, f32 t) const;
+
+	//! Returns the recorded flight over the Mars colony.
+	/** It starts at the spawn point of the FPS camera, circles the cube
+	tower, passes the gate arrays and the lava lake and ends looking at the
+	mother ship. */
+	static CFlythroughPath createMarsColonyPath();
+
+private:
+
+	core::array<SKey> Keys;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
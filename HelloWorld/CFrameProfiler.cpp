@@ -0,0 +1,276 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CFrameProfiler.h"
+#include "CTextWriter.h"
+
+namespace irr
+{
+
+CFrameProfiler* CFrameProfiler::Active = 0;
+
+
+CFrameProfiler::CFrameProfiler()
+	: TraceCapacity(0), DroppedEvents(0), StartMs(getPreciseTimeMs()), FrameStartMs(0),
+	FramePhase(0), FrameCount(0), InFrame(false), Overlay(0), OverlayIntervalMs(500), LastOverlayMs(0)
+{
+	#ifdef _DEBUG
+	setDebugName("CFrameProfiler");
+	#endif
+
+	Threads.push_back(std::this_thread::get_id());
+	FramePhase = getPhase("frame");
+}
+
+
+CFrameProfiler::~CFrameProfiler()
+{
+	if (Overlay)
+		Overlay->drop();
+
+	for (u32 i=0; i<Phases.size(); ++i)
+		delete Phases[i];
+}
+
+
+void CFrameProfiler::setActive(CFrameProfiler* profiler)
+{
+	if (profiler)
+		profiler->grab();
+	if (Active)
+		Active->drop();
+	Active = profiler;
+}
+
+
+void CFrameProfiler::setTraceCapacity(u32 maxEvents)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	TraceCapacity = maxEvents;
+	Events.reallocate(core::min_(maxEvents, 65536u));
+}
+
+
+u32 CFrameProfiler::getPhase(const c8* name)
+{
+	for (u32 i=0; i<Names.size(); ++i)
+		if (Names[i].Pointer == name)
+			return Names[i].Phase;
+
+	// the same literal can have another address in another file
+	SName entry;
+	entry.Pointer = name;
+	entry.Phase = Phases.size();
+	for (u32 i=0; i<Phases.size(); ++i)
+		if (Phases[i]->Name == name)
+			entry.Phase = i;
+
+	if (entry.Phase == Phases.size())
+	{
+		SPhase* phase = new SPhase();
+		phase->Name = name;
+		phase->FrameMs = 0.0;
+		for (u32 f=0; f<HistoryFrames; ++f)
+			phase->History[f] = 0.0;
+		Phases.push_back(phase);
+	}
+
+	Names.push_back(entry);
+	return entry.Phase;
+}
+
+
+u32 CFrameProfiler::getThread()
+{
+	const std::thread::id id = std::this_thread::get_id();
+	for (u32 i=0; i<Threads.size(); ++i)
+		if (Threads[i] == id)
+			return i;
+
+	Threads.push_back(id);
+	return Threads.size() - 1;
+}
+
+
+void CFrameProfiler::addEventLocked(u32 phase, f64 startMs, f64 endMs)
+{
+	if (InFrame)
+		Phases[phase]->FrameMs += endMs - startMs;
+
+	if (Events.size() < TraceCapacity)
+	{
+		SEvent event;
+		event.Phase = phase;
+		event.Thread = getThread();
+		event.StartMs = startMs;
+		event.DurationMs = endMs - startMs;
+		Events.push_back(event);
+	}
+	else if (TraceCapacity)
+		++DroppedEvents;
+}
+
+
+void CFrameProfiler::addEvent(const c8* name, f64 startMs, f64 endMs)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	addEventLocked(getPhase(name), startMs, endMs);
+}
+
+
+void CFrameProfiler::addEvent(const core::stringc& name, f64 startMs, f64 endMs)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	u32 phase = Phases.size();
+	for (u32 i=0; i<Phases.size(); ++i)
+		if (Phases[i]->Name == name)
+			phase = i;
+
+	if (phase == Phases.size())
+	{
+		// not in Names, the string does not live on
+		SPhase* entry = new SPhase();
+		entry->Name = name;
+		entry->FrameMs = 0.0;
+		for (u32 f=0; f<HistoryFrames; ++f)
+			entry->History[f] = 0.0;
+		Phases.push_back(entry);
+	}
+
+	addEventLocked(phase, startMs, endMs);
+}
+
+
+void CFrameProfiler::beginFrame()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	FrameStartMs = getPreciseTimeMs();
+	InFrame = true;
+}
+
+
+void CFrameProfiler::endFrame()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		if (!InFrame)
+			return;
+
+		addEventLocked(FramePhase, FrameStartMs, getPreciseTimeMs());
+		InFrame = false;
+
+		const u32 slot = FrameCount % HistoryFrames;
+		for (u32 i=0; i<Phases.size(); ++i)
+		{
+			Phases[i]->History[slot] = Phases[i]->FrameMs;
+			Phases[i]->FrameMs = 0.0;
+		}
+		++FrameCount;
+	}
+
+	if (Overlay && getPreciseTimeMs() - LastOverlayMs >= OverlayIntervalMs)
+		updateOverlay();
+}
+
+
+void CFrameProfiler::setOverlay(gui::IGUIStaticText* text, u32 intervalMs)
+{
+	if (text)
+		text->grab();
+	if (Overlay)
+		Overlay->drop();
+	Overlay = text;
+	OverlayIntervalMs = intervalMs;
+}
+
+
+void CFrameProfiler::updateOverlay()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	LastOverlayMs = getPreciseTimeMs();
+
+	const u32 frames = core::min_(FrameCount, HistoryFrames);
+	if (!frames)
+		return;
+
+	core::stringc text;
+	for (u32 i=0; i<Phases.size(); ++i)
+	{
+		const SPhase& phase = *Phases[i];
+
+		f64 sum = 0.0;
+		f64 slowest = 0.0;
+		for (u32 f=0; f<frames; ++f)
+		{
+			sum += phase.History[f];
+			slowest = core::max_(slowest, phase.History[f]);
+		}
+
+		// phases of the loading screen and of other frames
+		if (slowest <= 0.0)
+			continue;
+
+		const f64 average = sum / frames;
+		if (i == FramePhase)
+			appendf(text, "frame %.2f ms (%.0f fps), slowest %.2f\n", average, average > 0.0 ? 1000.0 / average : 0.0, slowest);
+		else
+			appendf(text, "%s %.2f ms, slowest %.2f\n", phase.Name.c_str(), average, slowest);
+	}
+
+	Overlay->setText(core::stringw(text.c_str()).c_str());
+}
+
+
+bool CFrameProfiler::writeTrace(io::IFileSystem* fileSystem, const io::path& filename) const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	io::IWriteFile* file = fileSystem->createAndWriteFile(filename);
+	if (!file)
+		return false;
+
+	// the trace has up to millions of events, it is streamed to the file
+	// instead of built in one string
+	CTextWriter out(file);
+	out.print("{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [\n");
+
+	for (u32 i=0; i<Threads.size(); ++i)
+	{
+		out.print("%s    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": ",
+			i ? ",\n" : "", i);
+		if (i == 0)
+			out.print("\"main\"}}");
+		else
+			out.print("\"worker %u\"}}", i);
+	}
+
+	// the names are quoted once per phase, not once per event
+	core::array<core::stringc> names;
+	names.reallocate(Phases.size());
+	for (u32 i=0; i<Phases.size(); ++i)
+	{
+		names.push_back(core::stringc());
+		appendQuoted(names.getLast(), Phases[i]->Name);
+	}
+
+	// complete events, in microseconds since the profiler was created
+	for (u32 i=0; i<Events.size(); ++i)
+	{
+		const SEvent& event = Events[i];
+		const core::stringc& name = names[event.Phase];
+		out.print(",\n    {\"name\": ");
+		out.write(name);
+		out.print(", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+			event.Thread, (event.StartMs - StartMs) * 1000.0, event.DurationMs * 1000.0);
+	}
+
+	out.print("\n  ]\n}\n");
+
+	const bool written = out.flush();
+	file->drop();
+	return written;
+}
+
+} // end namespace irr
@@ -0,0 +1,204 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_FRAME_PROFILER_H_INCLUDED__
+#define __C_FRAME_PROFILER_H_INCLUDED__
+
+#include <irrlicht.h>
+#include <mutex>
+#include <thread>
+#include "PreciseTimer.h"
+
+namespace irr
+{
+
+//! Collects how long the phases of every frame take.
+/** Phases are reported with MARS_PROFILE_SCOPE() or CFrameProfiler::report()
+to the active profiler. Without one, a scope costs a test of a pointer, and
+building with _MARS_NO_PROFILER_ removes the scopes altogether.
+
+Every phase is summed per frame and averaged over the last frames, which
+setOverlay() shows on screen. With setTraceCapacity() every single scope is
+kept as well and writeTrace() saves them in the trace event format of
+chrome://tracing and ui.perfetto.dev, with one track per thread.
+
+Phases can be reported from any thread. Their names are kept by pointer, so
+they have to stay valid as long as the profiler, like string literals;
+names built at run time, like file names, are copied. */
+class CFrameProfiler : public virtual IReferenceCounted
+{
+public:
+
+	//! The thread creating the profiler is the main thread of the trace.
+	CFrameProfiler();
+
+	virtual ~CFrameProfiler();
+
+	//! Makes profiler the one phases are reported to, 0 to turn profiling off.
+	/** The active profiler is grabbed. */
+	static void setActive(CFrameProfiler* profiler);
+
+	static CFrameProfiler* getActive() { return Active; }
+
+	//! Reports a phase to the active profiler, if there is one.
+	static void report(const c8* name, f64 startMs, f64 endMs)
+	{
+#ifndef _MARS_NO_PROFILER_
+		if (Active)
+			Active->addEvent(name, startMs, endMs);
+#endif
+	}
+
+	//! Keeps up to maxEvents phases for writeTrace(), 0 to keep none.
+	void setTraceCapacity(u32 maxEvents);
+
+	//! Starts a frame, phases until endFrame() are added to it.
+	void beginFrame();
+
+	//! Ends the frame, which is reported as the phase "frame".
+	void endFrame();
+
+	//! Adds a phase which ran from startMs to endMs, see getPreciseTimeMs().
+	void addEvent(const c8* name, f64 startMs, f64 endMs);
+
+	//! Adds a phase with a name which is copied.
+	void addEvent(const core::stringc& name, f64 startMs, f64 endMs);
+
+	//! Shows the average and the slowest time of every phase in text.
+	/** text is grabbed and updated every intervalMs, 0 to remove it. */
+	void setOverlay(gui::IGUIStaticText* text, u32 intervalMs=500);
+
+	//! Writes the kept phases as trace events. Returns false if the file could not be written.
+	bool writeTrace(io::IFileSystem* fileSystem, const io::path& filename) const;
+
+	//! Phases kept for the trace.
+	u32 getEventCount() const { return Events.size(); }
+
+	//! Phases not kept because the trace was full.
+	u32 getDroppedEventCount() const { return DroppedEvents; }
+
+private:
+
+	//! Frames the averages and the slowest times are taken over.
+	static const u32 HistoryFrames = 120;
+
+	struct SPhase
+	{
+		core::stringc Name;
+		//! Time of the current frame.
+		f64 FrameMs;
+		//! Times of the last frames.
+		f64 History[HistoryFrames];
+	};
+
+	//! A name pointer which was reported before.
+	struct SName
+	{
+		const c8* Pointer;
+		u32 Phase;
+	};
+
+	struct SEvent
+	{
+		u32 Phase;
+		u32 Thread;
+		f64 StartMs;
+		f64 DurationMs;
+	};
+
+	//! Under the mutex.
+	u32 getPhase(const c8* name);
+	u32 getThread();
+	void addEventLocked(u32 phase, f64 startMs, f64 endMs);
+
+	void updateOverlay();
+
+	static CFrameProfiler* Active;
+
+	mutable std::mutex Mutex;
+
+	core::array<SPhase*> Phases;
+	core::array<SName> Names;
+	core::array<std::thread::id> Threads;
+
+	core::array<SEvent> Events;
+	u32 TraceCapacity;
+	u32 DroppedEvents;
+
+	//! Times are written relative to this.
+	f64 StartMs;
+	f64 FrameStartMs;
+	u32 FramePhase;
+	u32 FrameCount;
+	bool InFrame;
+
+	gui::IGUIStaticText* Overlay;
+	u32 OverlayIntervalMs;
+	f64 LastOverlayMs;
+};
+
+
+//! Reports the time from its construction to its destruction as a phase.
+class CProfileScope
+{
+public:
+
+	CProfileScope(const c8* name)
+		: Name(name), StartMs(CFrameProfiler::getActive() ? getPreciseTimeMs() : 0.0)
+	{
+	}
+
+	~CProfileScope()
+	{
+		if (StartMs > 0.0)
+			CFrameProfiler::report(Name, StartMs, getPreciseTimeMs());
+	}
+
+private:
+
+	const c8* Name;
+	f64 StartMs;
+};
+
+
+//! Reports a phase about a file or another object, named "name detail".
+class CProfileDetailScope
+{
+public:
+
+	CProfileDetailScope(const c8* name, const c8* detail)
+		: Name(name), Detail(detail), StartMs(CFrameProfiler::getActive() ? getPreciseTimeMs() : 0.0)
+	{
+	}
+
+	~CProfileDetailScope()
+	{
+		CFrameProfiler* profiler = CFrameProfiler::getActive();
+		if (StartMs > 0.0 && profiler)
+			profiler->addEvent(core::stringc(Name) + " " + Detail, StartMs, getPreciseTimeMs());
+	}
+
+private:
+
+	const c8* Name;
+	const c8* Detail;
+	f64 StartMs;
+};
+
+} // end namespace irr
+
+#define _MARS_PROFILE_JOIN2_(a, b) a##b
+#define _MARS_PROFILE_JOIN_(a, b) _MARS_PROFILE_JOIN2_(a, b)
+
+#ifdef _MARS_NO_PROFILER_
+#define MARS_PROFILE_SCOPE(name)
+#define MARS_PROFILE_DETAIL_SCOPE(name, detail)
+#else
+//! Reports the rest of the enclosing block as the phase name.
+#define MARS_PROFILE_SCOPE(name) irr::CProfileScope _MARS_PROFILE_JOIN_(profileScope, __LINE__)(name)
+//! Same, with a detail like a file name appended to the name.
+#define MARS_PROFILE_DETAIL_SCOPE(name, detail) irr::CProfileDetailScope _MARS_PROFILE_JOIN_(profileScope, __LINE__)(name, detail)
+#endif
+
+#endif
@@ -0,0 +1,241 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CHeightField.h"
+#include "CMappedFile.h"
+#include <math.h>
+
+namespace irr
+{
+namespace scene
+{
+
+CHeightField::CHeightField(video::IVideoDriver* driver, io::IFileSystem* fileSystem,
+	const io::path& fileName, s32 smoothFactor)
+	: MappedFile(0), RawSamples(0), Columns(0), Rows(0), MinHeight(0.f), MaxHeight(0.f)
+{
+	#ifdef _DEBUG
+	setDebugName("CHeightField");
+	#endif
+
+	if (core::hasFileExtension(fileName, "r16"))
+	{
+		io::IReadFile* file = fileSystem->createAndOpenFile(fileName);
+		if (file)
+		{
+			MappedFile = new io::CMappedFile(file);
+			file->drop();
+
+			const u32 samples = MappedFile->getSize() / 2;
+			const u32 size = (u32)sqrt((f64)samples);
+			if (MappedFile->getData() && size > 1 && size * size == samples)
+			{
+				RawSamples = (const u16*)MappedFile->getData();
+				Columns = size;
+				Rows = size;
+				MaxHeight = 65535.f / 256.f;
+			}
+		}
+		return;
+	}
+
+	video::IImage* image = driver->createImageFromFile(fileName);
+	if (!image)
+		return;
+
+	Columns = image->getDimension().Width;
+	Rows = image->getDimension().Height;
+	Heights.set_used(Columns * Rows);
+	for (u32 z=0; z<Rows; ++z)
+		for (u32 x=0; x<Columns; ++x)
+			Heights[z * Columns + x] = image->getPixel(x, z).getLuminance();
+	image->drop();
+
+	// the same passes as Irrlicht's terrain
+	for (s32 run=0; run<smoothFactor; ++run)
+	{
+		for (u32 z=1; z+1<Rows; ++z)
+		{
+			for (u32 x=1; x+1<Columns; ++x)
+			{
+				const u32 i = z * Columns + x;
+				Heights[i] = (Heights[i-1] + Heights[i+1] +
+					Heights[i-Columns] + Heights[i+Columns]) * 0.25f;
+			}
+		}
+	}
+
+	if (Heights.size())
+		MinHeight = MaxHeight = Heights[0];
+	for (u32 i=1; i<Heights.size(); ++i)
+	{
+		MinHeight = core::min_(MinHeight, Heights[i]);
+		MaxHeight = core::max_(MaxHeight, Heights[i]);
+	}
+}
+
+
+CHeightField::~CHeightField()
+{
+	delete MappedFile;
+}
+
+
+namespace
+{
+
+//! Returns the triangles of the cells of a height field.
+class CHeightFieldTriangleSelector : public ITriangleSelector
+{
+public:
+
+	CHeightFieldTriangleSelector(CHeightField* field, ISceneNode* node)
+		: Field(field), SceneNode(node)
+	{
+		#ifdef _DEBUG
+		setDebugName("CHeightFieldTriangleSelector");
+		#endif
+
+		Field->grab();
+		Box.reset(0.f, Field->getMinHeight(), 0.f);
+		Box.addInternalPoint((f32)(Field->getColumns() - 1), Field->getMaxHeight(), (f32)(Field->getRows() - 1));
+	}
+
+	virtual ~CHeightFieldTriangleSelector()
+	{
+		Field->drop();
+	}
+
+	virtual s32 getTriangleCount() const
+	{
+		return (s32)((Field->getColumns() - 1) * (Field->getRows() - 1) * 2);
+	}
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::matrix4* transform=0) const
+	{
+		outTriangleCount = 0;
+		addTriangles(Box, triangles, arraySize, outTriangleCount, transform);
+	}
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::aabbox3d<f32>& box,
+		const core::matrix4* transform=0) const
+	{
+		outTriangleCount = 0;
+		addTriangles(getLocalBox(box), triangles, arraySize, outTriangleCount, transform);
+	}
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::line3d<f32>& line,
+		const core::matrix4* transform=0) const
+	{
+		outTriangleCount = 0;
+		core::aabbox3df box(line.start);
+		box.addInternalPoint(line.end);
+		addTriangles(getLocalBox(box), triangles, arraySize, outTriangleCount, transform);
+	}
+
+	virtual ISceneNode* getSceneNodeForTriangle(u32 triangleIndex) const
+	{
+		return SceneNode;
+	}
+
+	virtual u32 getSelectorCount() const
+	{
+		return 1;
+	}
+
+	virtual ITriangleSelector* getSelector(u32 index)
+	{
+		return index ? 0 : this;
+	}
+
+	virtual const ITriangleSelector* getSelector(u32 index) const
+	{
+		return index ? 0 : this;
+	}
+
+private:
+
+	core::aabbox3df getLocalBox(const core::aabbox3df& box) const
+	{
+		core::aabbox3df local(box);
+		core::matrix4 inverse;
+		if (SceneNode && SceneNode->getAbsoluteTransformation().getInverse(inverse))
+			inverse.transformBoxEx(local);
+		return local;
+	}
+
+	// Adds the triangles of the cells which overlap box, a box relative
+	// to the node. Only reads the field, so selectors of several worlds
+	// can share it while they run on different threads.
+	void addTriangles(const core::aabbox3df& box, core::triangle3df* triangles,
+		s32 arraySize, s32& outTriangleCount, const core::matrix4* transform) const
+	{
+		core::matrix4 mat;
+		if (transform)
+			mat = *transform;
+		if (SceneNode)
+			mat *= SceneNode->getAbsoluteTransformation();
+
+		const s32 lastX = (s32)Field->getColumns() - 2;
+		const s32 lastZ = (s32)Field->getRows() - 2;
+		const s32 x0 = core::max_((s32)floorf(box.MinEdge.X), 0);
+		const s32 z0 = core::max_((s32)floorf(box.MinEdge.Z), 0);
+		const s32 x1 = core::min_((s32)floorf(box.MaxEdge.X), lastX);
+		const s32 z1 = core::min_((s32)floorf(box.MaxEdge.Z), lastZ);
+		if (x0 > x1 || z0 > z1)
+			return;
+
+		for (s32 z=z0; z<=z1; ++z)
+		{
+			for (s32 x=x0; x<=x1; ++x)
+			{
+				const core::vector3df a((f32)x, Field->getSample(x, z), (f32)z);
+				const core::vector3df b((f32)(x + 1), Field->getSample(x + 1, z), (f32)z);
+				const core::vector3df c((f32)x, Field->getSample(x, z + 1), (f32)(z + 1));
+				const core::vector3df d((f32)(x + 1), Field->getSample(x + 1, z + 1), (f32)(z + 1));
+
+				const f32 minY = core::min_(core::min_(a.Y, b.Y), core::min_(c.Y, d.Y));
+				const f32 maxY = core::max_(core::max_(a.Y, b.Y), core::max_(c.Y, d.Y));
+				if (maxY < box.MinEdge.Y || minY > box.MaxEdge.Y)
+					continue;
+
+				if (outTriangleCount + 2 > arraySize)
+					return;
+
+				// the same triangles as the tiles of the paged terrain
+				core::triangle3df* t = triangles + outTriangleCount;
+				t[0].set(a, c, b);
+				t[1].set(b, c, d);
+				for (u32 i=0; i<2; ++i)
+				{
+					mat.transformVect(t[i].pointA);
+					mat.transformVect(t[i].pointB);
+					mat.transformVect(t[i].pointC);
+				}
+				outTriangleCount += 2;
+			}
+		}
+	}
+
+	CHeightField* Field;
+	// not grabbed, like the node of a mesh triangle selector
+	ISceneNode* SceneNode;
+	core::aabbox3df Box;
+};
+
+} // end anonymous namespace
+
+
+ITriangleSelector* createHeightFieldTriangleSelector(CHeightField* field, ISceneNode* node)
+{
+	if (!field || !field->isValid())
+		return 0;
+	return new CHeightFieldTriangleSelector(field, node);
+}
+
+} // end namespace scene
+} // end namespace irr
@@ -0,0 +1,91 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_HEIGHT_FIELD_H_INCLUDED__
+#define __C_HEIGHT_FIELD_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+
+namespace io
+{
+	class CMappedFile;
+} // end namespace io
+
+namespace scene
+{
+
+//! The samples of a height map, loaded once and never changed.
+/** Height maps ending in .r16 are raw little endian 16 bit heights of a
+square map. They are memory mapped, so only the parts being read are loaded
+from disk, and heights are in 1/256 units so a 16 bit map has the same scale
+as an 8 bit image. Other files are loaded as image with the heights and the
+orientation of addTerrainSceneNode().
+
+The field is immutable after construction, so one field can be shared by
+the paged terrain and the collision of several worlds, and read from any
+thread. */
+class CHeightField : public virtual IReferenceCounted
+{
+public:
+
+	//! Loads the height map.
+	/** \param smoothFactor Smoothing passes, only done for images. */
+	CHeightField(video::IVideoDriver* driver, io::IFileSystem* fileSystem,
+		const io::path& fileName, s32 smoothFactor=0);
+
+	virtual ~CHeightField();
+
+	//! Returns false if the height map could not be loaded.
+	bool isValid() const { return Columns > 1 && Rows > 1; }
+
+	u32 getColumns() const { return Columns; }
+
+	u32 getRows() const { return Rows; }
+
+	//! Height at a sample, in the orientation of Irrlicht's terrain.
+	f32 getSample(u32 x, u32 z) const
+	{
+		// Irrlicht's terrain mirrors the height map in X
+		const u32 index = z * Columns + (Columns - 1 - x);
+		return RawSamples ? RawSamples[index] * (1.f / 256.f) : Heights[index];
+	}
+
+	f32 getMinHeight() const { return MinHeight; }
+
+	f32 getMaxHeight() const { return MaxHeight; }
+
+	//! Memory of the samples, 0 for a mapped file.
+	u32 getMemoryBytes() const { return Heights.size() * sizeof(f32); }
+
+private:
+
+	// not copyable
+	CHeightField(const CHeightField&);
+	CHeightField& operator=(const CHeightField&);
+
+	// either mapped or loaded
+	io::CMappedFile* MappedFile;
+	const u16* RawSamples;
+	core::array<f32> Heights;
+	u32 Columns;
+	u32 Rows;
+
+	f32 MinHeight;
+	f32 MaxHeight;
+};
+
+
+//! Creates a selector returning the full resolution triangles of field, placed like node.
+/** The field is grabbed. The cells are at integer X and Z in the space of
+the node, like the tiles of CPagedTerrainSceneNode, so a node with the
+transformation of a paged terrain collides with its surface. */
+ITriangleSelector* createHeightFieldTriangleSelector(CHeightField* field, ISceneNode* node);
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
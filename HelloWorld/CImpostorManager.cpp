@@ -0,0 +1,402 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CImpostorManager.h"
+#include "CFrameProfiler.h"
+#include "PreciseTimer.h"
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+//! Returns the bounding sphere of node in world space.
+void getWorldSphere(const ISceneNode* node, core::vector3df& center, f32& radius)
+{
+	core::aabbox3df box = node->getBoundingBox();
+	node->getAbsoluteTransformation().transformBoxEx(box);
+	center = box.getCenter();
+	radius = box.getExtent().getLength() * 0.5f;
+}
+
+//! Returns the direction to the camera and the up vector of the camera in the space of node.
+void getNodeView(const ISceneNode* node, const ICameraSceneNode* camera,
+	core::vector3df& direction, core::vector3df& up)
+{
+	core::matrix4 inverse;
+	node->getAbsoluteTransformation().getInverse(inverse);
+
+	core::vector3df cameraPosition = camera->getAbsolutePosition();
+	inverse.transformVect(cameraPosition);
+	direction = cameraPosition - node->getBoundingBox().getCenter();
+	direction.normalize();
+
+	up = camera->getUpVector();
+	inverse.rotateVect(up);
+	up.normalize();
+}
+
+} // end anonymous namespace
+
+
+CImpostorManager::CImpostorManager(ISceneNode* parent, ISceneManager* mgr, s32 id)
+	: ISceneNode(parent, mgr, id), Hidden(false), Atlas(0), AtlasSize(512), SlotSize(128),
+	Supported(true), SwitchSize(64.f), Hysteresis(0.15f), MaxAngleCos(0.f), RefreshBudget(4),
+	LastImpostorCount(0), LastRefreshCount(0), LastRefreshTimeMs(0.0), RefreshCount(0)
+{
+	#ifdef _DEBUG
+	setDebugName("CImpostorManager");
+	#endif
+
+	// the quads are anywhere, and the nodes have to be shown again
+	setAutomaticCulling(EAC_OFF);
+	setMaxAngle(4.f);
+
+	Material.MaterialType = video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF;
+	Material.Lighting = false;
+	Material.BackfaceCulling = false;
+}
+
+
+CImpostorManager::~CImpostorManager()
+{
+	showImpostors();
+
+	for (u32 i=0; i<Impostors.size(); ++i)
+		Impostors[i].Node->drop();
+
+	if (Atlas)
+		SceneManager->getVideoDriver()->removeTexture(Atlas);
+}
+
+
+void CImpostorManager::setAtlasSize(u32 atlasSize, u32 slotSize)
+{
+	if (Atlas)
+	{
+		SceneManager->getVideoDriver()->removeTexture(Atlas);
+		Atlas = 0;
+		Material.setTexture(0, 0);
+	}
+
+	AtlasSize = atlasSize;
+	SlotSize = core::max_(slotSize, 1u);
+
+	// the nodes beyond the new atlas are not drawn as impostors any more
+	const u32 slotsPerRow = AtlasSize / SlotSize;
+	for (u32 i=0; i<Impostors.size(); ++i)
+	{
+		SImpostor& impostor = Impostors[i];
+		const s32 x = (s32)((i % core::max_(slotsPerRow, 1u)) * SlotSize);
+		const s32 y = (s32)((i / core::max_(slotsPerRow, 1u)) * SlotSize);
+		impostor.Slot = core::rect<s32>(x, y, x + SlotSize, y + SlotSize);
+		impostor.Valid = false;
+		impostor.Active = false;
+	}
+}
+
+
+bool CImpostorManager::addNode(ISceneNode* node)
+{
+	const u32 slotsPerRow = AtlasSize / SlotSize;
+	const u32 i = Impostors.size();
+	if (i >= slotsPerRow * slotsPerRow)
+		return false;
+
+	SImpostor impostor;
+	impostor.Node = node;
+	const s32 x = (s32)((i % slotsPerRow) * SlotSize);
+	const s32 y = (s32)((i / slotsPerRow) * SlotSize);
+	impostor.Slot = core::rect<s32>(x, y, x + SlotSize, y + SlotSize);
+	impostor.Valid = false;
+	impostor.Active = false;
+	Impostors.push_back(impostor);
+
+	node->grab();
+	return true;
+}
+
+
+void CImpostorManager::setMaxAngle(f32 degrees)
+{
+	MaxAngleCos = cosf(degrees * core::DEGTORAD);
+}
+
+
+bool CImpostorManager::wasImpostor(const ISceneNode* node) const
+{
+	return Replaced.binary_search(const_cast<ISceneNode*>(node)) != -1;
+}
+
+
+bool CImpostorManager::createAtlas()
+{
+	if (Atlas)
+		return true;
+
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+	if (Supported && driver->queryFeature(video::EVDF_RENDER_TO_TARGET))
+		Atlas = driver->addRenderTargetTexture(core::dimension2d<u32>(AtlasSize, AtlasSize),
+			"impostor_atlas", video::ECF_A8R8G8B8);
+
+	if (!Atlas)
+	{
+		Supported = false;
+		return false;
+	}
+
+	// nothing in any slot yet
+	driver->setRenderTarget(Atlas, true, true, video::SColor(0,0,0,0));
+	Material.setTexture(0, Atlas);
+	return true;
+}
+
+
+bool CImpostorManager::isStale(const SImpostor& impostor, const ICameraSceneNode* camera) const
+{
+	if (!impostor.Valid)
+		return true;
+
+	core::vector3df direction, up;
+	getNodeView(impostor.Node, camera, direction, up);
+	return direction.dotProduct(impostor.ViewDirection) < MaxAngleCos ||
+		up.dotProduct(impostor.ViewUp) < MaxAngleCos;
+}
+
+
+void CImpostorManager::refresh(SImpostor& impostor, const ICameraSceneNode* camera)
+{
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+	driver->setViewPort(impostor.Slot);
+
+	// the slot is cleared with a quad, clearing the target would clear all slots
+	video::SMaterial clear;
+	clear.Lighting = false;
+	clear.BackfaceCulling = false;
+	clear.ZBuffer = video::ECFN_NEVER;
+	clear.ZWriteEnable = false;
+
+	const video::SColor transparent(0,0,0,0);
+	const video::S3DVertex corners[4] =
+	{
+		video::S3DVertex(-1.f, 1.f, 0.5f, 0.f, 0.f, -1.f, transparent, 0.f, 0.f),
+		video::S3DVertex(1.f, 1.f, 0.5f, 0.f, 0.f, -1.f, transparent, 1.f, 0.f),
+		video::S3DVertex(1.f, -1.f, 0.5f, 0.f, 0.f, -1.f, transparent, 1.f, 1.f),
+		video::S3DVertex(-1.f, -1.f, 0.5f, 0.f, 0.f, -1.f, transparent, 0.f, 1.f)
+	};
+	const u16 indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+	driver->setTransform(video::ETS_WORLD, core::IdentityMatrix);
+	driver->setTransform(video::ETS_VIEW, core::IdentityMatrix);
+	driver->setTransform(video::ETS_PROJECTION, core::IdentityMatrix);
+	driver->setMaterial(clear);
+	driver->drawIndexedTriangleList(corners, 4, indices, 2);
+
+	// the bounding sphere of the node fills the slot, seen from the camera
+	core::vector3df center;
+	f32 radius;
+	getWorldSphere(impostor.Node, center, radius);
+
+	core::vector3df toCamera = camera->getAbsolutePosition() - center;
+	toCamera.normalize();
+
+	core::matrix4 view;
+	view.buildCameraLookAtMatrixLH(center + toCamera * (radius * 2.f), center, camera->getUpVector());
+	core::matrix4 projection;
+	projection.buildProjectionMatrixOrthoLH(radius * 2.f, radius * 2.f, radius * 0.5f, radius * 3.5f);
+
+	driver->setTransform(video::ETS_VIEW, view);
+	driver->setTransform(video::ETS_PROJECTION, projection);
+	impostor.Node->render();
+
+	getNodeView(impostor.Node, camera, impostor.ViewDirection, impostor.ViewUp);
+	impostor.Valid = true;
+	++LastRefreshCount;
+	++RefreshCount;
+}
+
+
+void CImpostorManager::addQuad(const SImpostor& impostor, const ICameraSceneNode* camera)
+{
+	core::vector3df center;
+	f32 radius;
+	getWorldSphere(impostor.Node, center, radius);
+
+	// the axes of the view of the snapshot, like a billboard
+	core::vector3df view = center - camera->getAbsolutePosition();
+	view.normalize();
+	core::vector3df right = camera->getUpVector().crossProduct(view);
+	right.normalize();
+	core::vector3df up = view.crossProduct(right);
+	up.normalize();
+	right *= radius;
+	up *= radius;
+
+	// half a texel inside the slot, so the filter does not reach the next one
+	const f32 scale = 1.f / AtlasSize;
+	const f32 u0 = (impostor.Slot.UpperLeftCorner.X + 0.5f) * scale;
+	const f32 v0 = (impostor.Slot.UpperLeftCorner.Y + 0.5f) * scale;
+	const f32 u1 = (impostor.Slot.LowerRightCorner.X - 0.5f) * scale;
+	const f32 v1 = (impostor.Slot.LowerRightCorner.Y - 0.5f) * scale;
+
+	const video::SColor white(255,255,255,255);
+	const core::vector3df normal = -view;
+	const u16 first = (u16)Vertices.size();
+	Vertices.push_back(video::S3DVertex(center - right + up, normal, white, core::vector2df(u0, v0)));
+	Vertices.push_back(video::S3DVertex(center + right + up, normal, white, core::vector2df(u1, v0)));
+	Vertices.push_back(video::S3DVertex(center + right - up, normal, white, core::vector2df(u1, v1)));
+	Vertices.push_back(video::S3DVertex(center - right - up, normal, white, core::vector2df(u0, v1)));
+
+	Indices.push_back(first);
+	Indices.push_back(first + 1);
+	Indices.push_back(first + 2);
+	Indices.push_back(first);
+	Indices.push_back(first + 2);
+	Indices.push_back(first + 3);
+}
+
+
+void CImpostorManager::showImpostors()
+{
+	if (!Hidden)
+		return;
+
+	for (u32 i=0; i<Replaced.size(); ++i)
+		Replaced[i]->setVisible(true);
+	Hidden = false;
+}
+
+
+void CImpostorManager::OnAnimate(u32 timeMs)
+{
+	// in case drawAll() did not get to the transparent pass
+	showImpostors();
+
+	ISceneNode::OnAnimate(timeMs);
+}
+
+
+void CImpostorManager::OnRegisterSceneNode()
+{
+	showImpostors();
+	Replaced.set_used(0);
+	Vertices.set_used(0);
+	Indices.set_used(0);
+	LastImpostorCount = 0;
+	LastRefreshCount = 0;
+	LastRefreshTimeMs = 0.0;
+
+	const ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	if (IsVisible && camera && Supported && Impostors.size())
+	{
+		video::IVideoDriver* driver = SceneManager->getVideoDriver();
+		const f32 height = (f32)driver->getCurrentRenderTargetSize().Height;
+		const f32 tanHalfFov = tanf(camera->getFOV() * 0.5f);
+
+		// nodes without a snapshot first, the others are only a bit off
+		core::array<u32> missing;
+		core::array<u32> stale;
+		for (u32 i=0; i<Impostors.size(); ++i)
+		{
+			SImpostor& impostor = Impostors[i];
+			const u32 slotsPerRow = AtlasSize / SlotSize;
+			if (!impostor.Node->isTrulyVisible() || SceneManager->isCulled(impostor.Node) ||
+				i >= slotsPerRow * slotsPerRow)
+			{
+				impostor.Active = false;
+				continue;
+			}
+
+			core::vector3df center;
+			f32 radius;
+			getWorldSphere(impostor.Node, center, radius);
+			const f32 distance = center.getDistanceFrom(camera->getAbsolutePosition());
+			const f32 size = distance > radius ? radius * height / (distance * tanHalfFov) : height;
+
+			impostor.Active = impostor.Active ?
+				size < SwitchSize * (1.f + Hysteresis) :
+				size < SwitchSize * (1.f - Hysteresis);
+
+			if (impostor.Active && isStale(impostor, camera))
+			{
+				if (impostor.Valid)
+					stale.push_back(i);
+				else
+					missing.push_back(i);
+			}
+		}
+
+		for (u32 i=0; i<stale.size(); ++i)
+			missing.push_back(stale[i]);
+
+		if (missing.size())
+		{
+			const f64 start = getPreciseTimeMs();
+			const core::rect<s32> viewPort = driver->getViewPort();
+			const u32 count = RefreshBudget ? core::min_(RefreshBudget, missing.size()) : missing.size();
+
+			if (createAtlas())
+			{
+				driver->setRenderTarget(Atlas, false, true);
+				for (u32 i=0; i<count; ++i)
+					refresh(Impostors[missing[i]], camera);
+				driver->setRenderTarget(0, false, false);
+				driver->setViewPort(viewPort);
+			}
+
+			// a node waiting for its first snapshot is drawn as itself
+			for (u32 i=0; i<missing.size(); ++i)
+				if (!Impostors[missing[i]].Valid)
+					Impostors[missing[i]].Active = false;
+
+			const f64 end = getPreciseTimeMs();
+			LastRefreshTimeMs = end - start;
+			CFrameProfiler::report("impostor_refresh", start, end);
+		}
+
+		for (u32 i=0; i<Impostors.size(); ++i)
+		{
+			const SImpostor& impostor = Impostors[i];
+			if (!impostor.Active)
+				continue;
+
+			impostor.Node->setVisible(false);
+			Replaced.push_back(impostor.Node);
+			addQuad(impostor, camera);
+		}
+
+		LastImpostorCount = Replaced.size();
+		if (Replaced.size())
+		{
+			Replaced.sort();
+			Hidden = true;
+
+			// render() shows them again
+			SceneManager->registerNodeForRendering(this, ESNRP_TRANSPARENT);
+		}
+	}
+
+	ISceneNode::OnRegisterSceneNode();
+}
+
+
+void CImpostorManager::render()
+{
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+	if (Indices.size())
+	{
+		driver->setTransform(video::ETS_WORLD, core::IdentityMatrix);
+		driver->setMaterial(Material);
+		driver->drawIndexedTriangleList(Vertices.pointer(), Vertices.size(),
+			Indices.pointer(), Indices.size() / 3);
+	}
+
+	showImpostors();
+}
+
+} // end namespace scene
+} // end namespace irr
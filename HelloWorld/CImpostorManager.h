@@ -0,0 +1,170 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_IMPOSTOR_MANAGER_H_INCLUDED__
+#define __C_IMPOSTOR_MANAGER_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Type of the impostor manager scene node.
+const ESCENE_NODE_TYPE ESNT_IMPOSTOR_MANAGER = (ESCENE_NODE_TYPE)MAKE_IRR_ID('i','m','p','m');
+
+//! Draws distant nodes as camera facing quads with a snapshot of the node.
+/** A ufo or a gate far away covers a few dozen pixels, but still costs a
+full mesh draw and a shadow volume. When a node added here is smaller on the
+screen than the switch size, the manager hides it for the frame and draws a
+quad in its place, like a billboard:
+
+- The snapshot is drawn into a slot of one render target texture, the
+  atlas, with an orthographic view of the bounding sphere of the node from
+  the direction of the camera. All quads use the atlas, so they are drawn in
+  a single call.
+- A snapshot is drawn again when the camera sees the node from a direction
+  more than the maximum angle away from the one of the snapshot, measured in
+  the space of the node, so a turning node is drawn again too. Only a few
+  snapshots are drawn per frame; a node waiting for one is drawn as before.
+- A node close to the switch size would flip between both every few
+  frames, so it only becomes an impostor a hysteresis fraction below the
+  switch size, and a node again that much above.
+
+The snapshots are drawn when the manager is registered, before anything of
+the frame, and the nodes stay hidden until the transparent pass, like with
+the occlusion culler. So the manager has to be added before its nodes, and
+hidden nodes get no shadow volumes from the shadow volume manager. Their
+children are hidden with them.
+
+The driver has to support render targets, the software drivers do. Without
+them nodes are always drawn as themselves. */
+class CImpostorManager : public ISceneNode
+{
+public:
+
+	CImpostorManager(ISceneNode* parent, ISceneManager* mgr, s32 id=-1);
+
+	virtual ~CImpostorManager();
+
+	//! Sets the size of the atlas and its slots in pixels, all snapshots are drawn again.
+	/** The atlas holds (atlasSize / slotSize)^2 nodes. */
+	void setAtlasSize(u32 atlasSize, u32 slotSize);
+
+	//! Adds a node to be drawn as impostor when it is small. The node is grabbed.
+	/** \return False if the atlas is full. */
+	bool addNode(ISceneNode* node);
+
+	u32 getNodeCount() const { return Impostors.size(); }
+
+	//! Sets the size on the screen in pixels below which nodes become impostors.
+	void setSwitchSize(f32 pixels) { SwitchSize = pixels; }
+
+	f32 getSwitchSize() const { return SwitchSize; }
+
+	//! Sets how far, as fraction of the switch size, the size has to pass it to switch.
+	void setHysteresis(f32 fraction) { Hysteresis = fraction; }
+
+	//! Sets the angle in degrees the view may turn before a snapshot is drawn again.
+	void setMaxAngle(f32 degrees);
+
+	//! Sets the maximum amount of snapshots drawn per frame, 0 for all.
+	void setRefreshBudget(u32 snapshots) { RefreshBudget = snapshots; }
+
+	//! Returns false once the driver could not create the atlas.
+	bool isSupported() const { return Supported; }
+
+	//! Returns true if node was drawn as impostor in the last frame.
+	bool wasImpostor(const ISceneNode* node) const;
+
+	//! Nodes drawn as impostors in the last frame.
+	u32 getLastImpostorCount() const { return LastImpostorCount; }
+
+	//! Snapshots drawn in the last frame.
+	u32 getLastRefreshCount() const { return LastRefreshCount; }
+
+	//! Time the snapshots of the last frame took.
+	f64 getLastRefreshTimeMs() const { return LastRefreshTimeMs; }
+
+	//! Snapshots drawn since the manager was created.
+	u32 getRefreshCount() const { return RefreshCount; }
+
+	video::ITexture* getAtlas() const { return Atlas; }
+
+	virtual void OnAnimate(u32 timeMs);
+
+	//! Picks the impostors, draws their snapshots and hides their nodes.
+	virtual void OnRegisterSceneNode();
+
+	//! Draws the quads and shows the nodes again.
+	virtual void render();
+
+	virtual const core::aabbox3d<f32>& getBoundingBox() const { return Box; }
+
+	virtual u32 getMaterialCount() const { return 1; }
+
+	virtual video::SMaterial& getMaterial(u32 i) { return Material; }
+
+	virtual ESCENE_NODE_TYPE getType() const { return ESNT_IMPOSTOR_MANAGER; }
+
+private:
+
+	struct SImpostor
+	{
+		ISceneNode* Node;
+		//! Slot in the atlas, in pixels.
+		core::rect<s32> Slot;
+		//! Direction to the camera and up vector of the camera in the space of the node, at the snapshot.
+		core::vector3df ViewDirection;
+		core::vector3df ViewUp;
+		bool Valid;
+		bool Active;
+	};
+
+	//! Creates the atlas if there is none yet, returns false if it can not be.
+	bool createAtlas();
+
+	//! Returns true if the snapshot of impostor does not show the node as seen from camera.
+	bool isStale(const SImpostor& impostor, const ICameraSceneNode* camera) const;
+
+	//! Draws the snapshot of impostor as seen from camera into its slot.
+	void refresh(SImpostor& impostor, const ICameraSceneNode* camera);
+
+	//! Adds the quad of impostor, facing camera, to the vertices.
+	void addQuad(const SImpostor& impostor, const ICameraSceneNode* camera);
+
+	void showImpostors();
+
+	core::array<SImpostor> Impostors;
+	//! Nodes drawn as impostors, sorted for wasImpostor().
+	core::array<ISceneNode*> Replaced;
+	bool Hidden;
+
+	video::ITexture* Atlas;
+	u32 AtlasSize;
+	u32 SlotSize;
+	bool Supported;
+
+	f32 SwitchSize;
+	f32 Hysteresis;
+	f32 MaxAngleCos;
+	u32 RefreshBudget;
+
+	core::array<video::S3DVertex> Vertices;
+	core::array<u16> Indices;
+	video::SMaterial Material;
+
+	u32 LastImpostorCount;
+	u32 LastRefreshCount;
+	f64 LastRefreshTimeMs;
+	u32 RefreshCount;
+
+	core::aabbox3d<f32> Box;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
@@ -0,0 +1,196 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CLodMeshSceneNode.h"
+
+namespace irr
+{
+namespace scene
+{
+
+CLodMeshSceneNode::CLodMeshSceneNode(const core::array<IMesh*>& levels, ISceneNode* parent, ISceneManager* mgr, s32 id,
+	const core::vector3df& position, const core::vector3df& rotation, const core::vector3df& scale)
+	: ISceneNode(parent, mgr, id, position, rotation, scale),
+	CurrentLevel(0), Hysteresis(0.15f), ScreenSize(0.f)
+{
+	#ifdef _DEBUG
+	setDebugName("CLodMeshSceneNode");
+	#endif
+
+	for (u32 l=0; l<levels.size(); ++l)
+	{
+		IMesh* mesh = levels[l];
+		mesh->grab();
+		Levels.push_back(mesh);
+
+		u32 triangles = 0;
+		for (u32 b=0; b<mesh->getMeshBufferCount(); ++b)
+			triangles += mesh->getMeshBuffer(b)->getIndexCount() / 3;
+		TriangleCounts.push_back(triangles);
+
+		SwitchSizes.push_back(l ? 400.f / (1 << (l - 1)) : 0.f);
+	}
+
+	if (Levels.size())
+		for (u32 b=0; b<Levels[0]->getMeshBufferCount(); ++b)
+			Materials.push_back(Levels[0]->getMeshBuffer(b)->getMaterial());
+}
+
+
+CLodMeshSceneNode::~CLodMeshSceneNode()
+{
+	for (u32 l=0; l<Levels.size(); ++l)
+		Levels[l]->drop();
+}
+
+
+IMesh* CLodMeshSceneNode::getLevelMesh(u32 level) const
+{
+	return Levels[core::min_(level, Levels.size() - 1)];
+}
+
+
+u32 CLodMeshSceneNode::getLevelTriangleCount(u32 level) const
+{
+	return TriangleCounts[core::min_(level, Levels.size() - 1)];
+}
+
+
+void CLodMeshSceneNode::setSwitchSize(u32 level, f32 pixels)
+{
+	if (level && level < SwitchSizes.size())
+		SwitchSizes[level] = pixels;
+}
+
+
+f32 CLodMeshSceneNode::getSwitchSize(u32 level) const
+{
+	return level < SwitchSizes.size() ? SwitchSizes[level] : 0.f;
+}
+
+
+f32 CLodMeshSceneNode::measureScreenSize() const
+{
+	const ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	if (!camera || !Levels.size())
+		return 0.f;
+
+	core::aabbox3df box = Levels[0]->getBoundingBox();
+	AbsoluteTransformation.transformBoxEx(box);
+	const f32 radius = box.getExtent().getLength() * 0.5f;
+	const f32 distance = box.getCenter().getDistanceFrom(camera->getAbsolutePosition());
+
+	// inside the sphere, the node covers the screen
+	const f32 height = (f32)SceneManager->getVideoDriver()->getCurrentRenderTargetSize().Height;
+	if (distance <= radius)
+		return height;
+
+	return radius * height / (distance * tanf(camera->getFOV() * 0.5f));
+}
+
+
+void CLodMeshSceneNode::updateLevel()
+{
+	if (!Levels.size())
+		return;
+
+	ScreenSize = measureScreenSize();
+
+	while (CurrentLevel + 1 < Levels.size() &&
+		ScreenSize < SwitchSizes[CurrentLevel + 1] * (1.f - Hysteresis))
+		++CurrentLevel;
+	while (CurrentLevel > 0 &&
+		ScreenSize > SwitchSizes[CurrentLevel] * (1.f + Hysteresis))
+		--CurrentLevel;
+}
+
+
+void CLodMeshSceneNode::OnRegisterSceneNode()
+{
+	if (IsVisible && Levels.size())
+	{
+		updateLevel();
+
+		// once per pass with any of the materials, like a mesh scene node
+		video::IVideoDriver* driver = SceneManager->getVideoDriver();
+		bool solid = false;
+		bool transparent = false;
+		for (u32 i=0; i<Materials.size(); ++i)
+		{
+			video::IMaterialRenderer* renderer = driver->getMaterialRenderer(Materials[i].MaterialType);
+			if (renderer && renderer->isTransparent())
+				transparent = true;
+			else
+				solid = true;
+		}
+
+		if (solid)
+			SceneManager->registerNodeForRendering(this, ESNRP_SOLID);
+		if (transparent)
+			SceneManager->registerNodeForRendering(this, ESNRP_TRANSPARENT);
+	}
+
+	ISceneNode::OnRegisterSceneNode();
+}
+
+
+void CLodMeshSceneNode::render()
+{
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+	if (!Levels.size())
+		return;
+
+	const bool transparentPass = SceneManager->getSceneNodeRenderPass() == ESNRP_TRANSPARENT;
+	IMesh* mesh = Levels[CurrentLevel];
+
+	driver->setTransform(video::ETS_WORLD, AbsoluteTransformation);
+	const u32 count = core::min_(mesh->getMeshBufferCount(), Materials.size());
+	for (u32 i=0; i<count; ++i)
+	{
+		IMeshBuffer* buffer = mesh->getMeshBuffer(i);
+		if (!buffer->getIndexCount())
+			continue;
+
+		video::IMaterialRenderer* renderer = driver->getMaterialRenderer(Materials[i].MaterialType);
+		const bool transparent = renderer && renderer->isTransparent();
+		if (transparent != transparentPass)
+			continue;
+
+		driver->setMaterial(Materials[i]);
+		driver->drawMeshBuffer(buffer);
+	}
+
+	if (DebugDataVisible & EDS_BBOX)
+	{
+		video::SMaterial debugMaterial;
+		debugMaterial.Lighting = false;
+		driver->setMaterial(debugMaterial);
+		driver->draw3DBox(getBoundingBox(), video::SColor(255,255,255,255));
+	}
+}
+
+
+const core::aabbox3d<f32>& CLodMeshSceneNode::getBoundingBox() const
+{
+	static const core::aabbox3d<f32> empty(0,0,0,0,0,0);
+	return Levels.size() ? Levels[0]->getBoundingBox() : empty;
+}
+
+
+u32 CLodMeshSceneNode::getMaterialCount() const
+{
+	return Materials.size();
+}
+
+
+video::SMaterial& CLodMeshSceneNode::getMaterial(u32 i)
+{
+	if (i >= Materials.size())
+		return ISceneNode::getMaterial(i);
+
+	return Materials[i];
+}
+
+} // end namespace scene
+} // end namespace irr
@@ -0,0 +1,108 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_LOD_MESH_SCENE_NODE_H_INCLUDED__
+#define __C_LOD_MESH_SCENE_NODE_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Type of the level of detail mesh scene node.
+const ESCENE_NODE_TYPE ESNT_LOD_MESH = (ESCENE_NODE_TYPE)MAKE_IRR_ID('l','o','d','m');
+
+//! Draws one of several levels of detail of a mesh, picked by its size on the screen.
+/** Level 0 is the full mesh, every further level is coarser. All levels
+need the same mesh buffers in the same order, like the meshes made by
+createSimplifiedMesh(); they are drawn with the materials of the node, which
+start as the materials of level 0.
+
+Before it is drawn, the node measures the diameter of its bounding sphere
+on the screen in pixels and picks the coarsest level whose switch size is
+above it. A node close to a switch size would flip between two levels every
+few frames, so it only goes to a coarser level when it is a hysteresis
+fraction below the switch size, and back when it is that much above. */
+class CLodMeshSceneNode : public ISceneNode
+{
+public:
+
+	//! The meshes of levels are grabbed.
+	CLodMeshSceneNode(const core::array<IMesh*>& levels, ISceneNode* parent, ISceneManager* mgr, s32 id=-1,
+		const core::vector3df& position = core::vector3df(0,0,0),
+		const core::vector3df& rotation = core::vector3df(0,0,0),
+		const core::vector3df& scale = core::vector3df(1.0f, 1.0f, 1.0f));
+
+	virtual ~CLodMeshSceneNode();
+
+	u32 getLevelCount() const { return Levels.size(); }
+
+	//! Returns the mesh of a level, the coarsest one for levels beyond it.
+	/** So shadows and collision can ask for a level the node may not have,
+	like when it was built with a single level. */
+	IMesh* getLevelMesh(u32 level) const;
+
+	u32 getLevelTriangleCount(u32 level) const;
+
+	//! Level picked for the last frame.
+	u32 getCurrentLevel() const { return CurrentLevel; }
+
+	IMesh* getCurrentMesh() const { return Levels[CurrentLevel]; }
+
+	//! Sets the size in pixels on the screen below which level is used.
+	/** Level 1 starts at 400 pixels, and every further level at half the
+	size of the one before. */
+	void setSwitchSize(u32 level, f32 pixels);
+
+	f32 getSwitchSize(u32 level) const;
+
+	//! Sets how far, as fraction of the switch size, the size has to pass it to switch.
+	void setHysteresis(f32 fraction) { Hysteresis = fraction; }
+
+	f32 getHysteresis() const { return Hysteresis; }
+
+	//! Size on the screen in pixels, measured when the node was last registered.
+	f32 getScreenSize() const { return ScreenSize; }
+
+	//! Measures the size on the screen and picks the level for it.
+	/** Called when the node is registered, and by the render queue, which
+	draws the node without registering it. */
+	void updateLevel();
+
+	//! Picks the level and registers for the solid or transparent pass.
+	virtual void OnRegisterSceneNode();
+
+	virtual void render();
+
+	//! The box of level 0.
+	virtual const core::aabbox3d<f32>& getBoundingBox() const;
+
+	virtual u32 getMaterialCount() const;
+
+	virtual video::SMaterial& getMaterial(u32 i);
+
+	virtual ESCENE_NODE_TYPE getType() const { return ESNT_LOD_MESH; }
+
+private:
+
+	//! Measures the size of the node as seen by the active camera.
+	f32 measureScreenSize() const;
+
+	core::array<IMesh*> Levels;
+	core::array<u32> TriangleCounts;
+	//! Switch size of each level, the one of level 0 is unused.
+	core::array<f32> SwitchSizes;
+	core::array<video::SMaterial> Materials;
+
+	u32 CurrentLevel;
+	f32 Hysteresis;
+	f32 ScreenSize;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
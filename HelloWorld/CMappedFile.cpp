@@ -0,0 +1,139 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CMappedFile.h"
+
+#ifdef _IRR_WINDOWS_
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace irr
+{
+namespace io
+{
+
+CMappedFile::CMappedFile(IReadFile* file)
+	: Data(0), Size(0), Mapped(false), FileHandle(0), MappingHandle(0)
+{
+	if (!file)
+		return;
+
+	if (map(file->getFileName()) && Size == (u32)file->getSize())
+		return;
+
+	// not a plain file, or a different one than the one opened
+	release();
+
+	Size = (u32)file->getSize();
+	u8* buffer = new u8[Size];
+	file->seek(0);
+	if (file->read(buffer, Size) != (s32)Size)
+	{
+		delete [] buffer;
+		Size = 0;
+		return;
+	}
+	Data = buffer;
+}
+
+
+CMappedFile::~CMappedFile()
+{
+	release();
+}
+
+
+void CMappedFile::release()
+{
+	if (!Mapped)
+	{
+		delete [] Data;
+	}
+	else
+	{
+#ifdef _IRR_WINDOWS_
+		UnmapViewOfFile(Data);
+		CloseHandle((HANDLE)MappingHandle);
+		CloseHandle((HANDLE)FileHandle);
+#else
+		munmap((void*)Data, Size);
+#endif
+	}
+
+	Data = 0;
+	Size = 0;
+	Mapped = false;
+	FileHandle = 0;
+	MappingHandle = 0;
+}
+
+
+bool CMappedFile::map(const path& filename)
+{
+#ifdef _IRR_WINDOWS_
+	HANDLE file = CreateFileA(core::stringc(filename).c_str(), GENERIC_READ,
+		FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || size.HighPart)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	FileHandle = file;
+	MappingHandle = mapping;
+	Data = (const u8*)view;
+	Size = size.LowPart;
+#else
+	const int fd = open(core::stringc(filename).c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* view = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping stays valid after the descriptor is closed
+	close(fd);
+	if (view == MAP_FAILED)
+		return false;
+
+	Data = (const u8*)view;
+	Size = (u32)info.st_size;
+#endif
+
+	Mapped = true;
+	return true;
+}
+
+} // end namespace io
+} // end namespace irr
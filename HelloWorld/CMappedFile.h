@@ -0,0 +1,60 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_MAPPED_FILE_H_INCLUDED__
+#define __C_MAPPED_FILE_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace io
+{
+
+//! Read only view of a whole file.
+/** The file is memory mapped when it is a plain file on disk, so the pages
+are only read when they are touched and no copy is made. Files which can
+not be mapped, for example files inside a zip archive, are read into memory
+through the IReadFile instead. Either way getData() returns the contents. */
+class CMappedFile
+{
+public:
+
+	//! Maps the file file was opened from, or reads it if that fails.
+	explicit CMappedFile(IReadFile* file);
+
+	~CMappedFile();
+
+	//! Returns the contents of the file, or 0 if it could not be read.
+	const u8* getData() const { return Data; }
+
+	u32 getSize() const { return Size; }
+
+	//! Returns true if the file is mapped and not copied.
+	bool isMapped() const { return Mapped; }
+
+private:
+
+	// not copyable
+	CMappedFile(const CMappedFile&);
+	CMappedFile& operator=(const CMappedFile&);
+
+	bool map(const path& filename);
+
+	//! Unmaps or frees the data.
+	void release();
+
+	const u8* Data;
+	u32 Size;
+	bool Mapped;
+
+	//! Platform handles of the mapping.
+	void* FileHandle;
+	void* MappingHandle;
+};
+
+} // end namespace io
+} // end namespace irr
+
+#endif
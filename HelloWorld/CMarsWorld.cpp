@@ -0,0 +1,229 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CMarsWorld.h"
+#include "CBroadphaseTriangleSelector.h"
+#include "CBvhTree.h"
+#include "CBvhTriangleSelector.h"
+#include "CHeightField.h"
+#include "CMeshDerivationCache.h"
+#include "CSoaParticleSystemSceneNode.h"
+#include "MeshCooker.h"
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+// the level of detail main() collides with
+const u32 CollisionLevel = 1;
+
+// time the camera takes for the path one way, it flies back and forth
+const u32 PathDurationMs = 60000;
+
+u32 getTreeBytes(const CBvhTree* tree)
+{
+	// 32 bytes per node, see CBvhTree.h
+	return tree ? tree->getTriangleCount() * sizeof(core::triangle3df) + tree->getNodeCount() * 32 : 0;
+}
+
+// Returns the collision level of a game mesh, grabbed, or 0.
+IMesh* loadCollisionMesh(ISceneManager* smgr, const io::path& source)
+{
+	core::array<IMesh*> levels;
+	if (!getGameMeshLevels(smgr, source, levels, CollisionLevel + 1))
+		return 0;
+
+	IMesh* mesh = levels.getLast();
+	mesh->grab();
+	return mesh;
+}
+
+} // end anonymous namespace
+
+
+CMarsWorldAssets::CMarsWorldAssets(IrrlichtDevice* device)
+	: Terrain(0), GateMesh(0), GateTree(0), MotherShipMesh(0), MotherShipTree(0),
+	UfoMesh(0), ParticleTexture(0), Path(CFlythroughPath::createMarsColonyPath())
+{
+	#ifdef _DEBUG
+	setDebugName("CMarsWorldAssets");
+	#endif
+
+	ISceneManager* smgr = device->getSceneManager();
+	video::IVideoDriver* driver = device->getVideoDriver();
+
+	Terrain = new CHeightField(driver, device->getFileSystem(), "Objects/hm.png", 4);
+
+	GateMesh = loadCollisionMesh(smgr, "MayaObjects/SciFIGateArray2.obj");
+	if (GateMesh)
+		GateTree = new CBvhTree(GateMesh);
+
+	MotherShipMesh = loadCollisionMesh(smgr, "MayaObjects/MotherShip.obj");
+	if (MotherShipMesh)
+		MotherShipTree = new CBvhTree(MotherShipMesh);
+
+	UfoMesh = loadCollisionMesh(smgr, "MayaObjects/UFO.obj");
+
+	ParticleTexture = driver->getTexture("../../../media/fireball.bmp");
+}
+
+
+CMarsWorldAssets::~CMarsWorldAssets()
+{
+	Terrain->drop();
+
+	if (GateTree)
+		GateTree->drop();
+	if (GateMesh)
+		GateMesh->drop();
+	if (MotherShipTree)
+		MotherShipTree->drop();
+	if (MotherShipMesh)
+		MotherShipMesh->drop();
+	if (UfoMesh)
+		UfoMesh->drop();
+}
+
+
+bool CMarsWorldAssets::isValid() const
+{
+	return Terrain->isValid() && GateTree && MotherShipTree && UfoMesh;
+}
+
+
+u32 CMarsWorldAssets::getSharedBytes() const
+{
+	return Terrain->getMemoryBytes() +
+		CMeshDerivationCache::getMeshDataSize(GateMesh) + getTreeBytes(GateTree) +
+		CMeshDerivationCache::getMeshDataSize(MotherShipMesh) + getTreeBytes(MotherShipTree) +
+		CMeshDerivationCache::getMeshDataSize(UfoMesh);
+}
+
+
+CMarsWorld::CMarsWorld(IrrlichtDevice* device, CMarsWorldAssets* assets, f32 pathOffset)
+	: Assets(assets), SceneManager(0), Camera(0), PathOffset(pathOffset), TickCount(0)
+{
+	#ifdef _DEBUG
+	setDebugName("CMarsWorld");
+	#endif
+
+	Assets->grab();
+	SceneManager = device->getSceneManager()->createNewSceneManager(false);
+	ISceneNode* root = SceneManager->getRootSceneNode();
+
+	CBroadphaseTriangleSelector* worldSelector = new CBroadphaseTriangleSelector();
+
+	// the terrain is only collided with, its node has no bounding box, so
+	// it is asked for triangles by every query
+	ISceneNode* terrain = SceneManager->addEmptySceneNode(root);
+	terrain->setPosition(core::vector3df(-1400.f, -600.f, -1800.f));
+	terrain->setScale(core::vector3df(80.f, 16.4f, 80.f));
+	ITriangleSelector* selector = createHeightFieldTriangleSelector(Assets->getTerrain(), terrain);
+	if (selector)
+	{
+		terrain->setTriangleSelector(selector);
+		worldSelector->addTriangleSelector(selector, 0);
+		selector->drop();
+	}
+
+	for (s32 i=0; i<4; ++i)
+	{
+		IMeshSceneNode* gate = SceneManager->addMeshSceneNode(Assets->getGateMesh(), root, -1,
+			core::vector3df((f32)(9800 + i * 2500), 550.f, -2000.f),
+			core::vector3df(0.f, 0.f, 0.f), core::vector3df(20.f, 20.f, 20.f));
+		selector = createBvhTriangleSelector(Assets->getGateTree(), gate);
+		gate->setTriangleSelector(selector);
+		worldSelector->addTriangleSelector(selector);
+		selector->drop();
+	}
+
+	IMeshSceneNode* motherShip = SceneManager->addMeshSceneNode(Assets->getMotherShipMesh(), root, -1,
+		core::vector3df(0.f, -1000.f, -15500.f),
+		core::vector3df(0.f, -45.f, 0.f), core::vector3df(40.f, 40.f, 40.f));
+	selector = createBvhTriangleSelector(Assets->getMotherShipTree(), motherShip);
+	motherShip->setTriangleSelector(selector);
+	worldSelector->addTriangleSelector(selector);
+	selector->drop();
+
+	// the ufos fly high above everything, like in main() they do not collide
+	IMeshSceneNode* ufo = SceneManager->addMeshSceneNode(Assets->getUfoMesh(), root, -1,
+		core::vector3df(740.f, -2000.f, -1400.f),
+		core::vector3df(0.f, 0.f, 0.f), core::vector3df(10.f, 10.f, 10.f));
+	ISceneNodeAnimator* anim = SceneManager->createFlyCircleAnimator(
+		core::vector3df(-740.f, 4500.f, -4400.f), 20000.f, 0.001f);
+	ufo->addAnimator(anim);
+	anim->drop();
+
+	IMeshSceneNode* ufo2 = SceneManager->addMeshSceneNode(Assets->getUfoMesh(), root, -1,
+		core::vector3df(740.f, -2000.f, -1400.f),
+		core::vector3df(0.f, 0.f, 0.f), core::vector3df(20.f, 20.f, 20.f));
+	anim = SceneManager->createFlyCircleAnimator(
+		core::vector3df(740.f, 6500.f, -2400.f), 40000.f, 0.0005f);
+	ufo2->addAnimator(anim);
+	anim->drop();
+
+	IMeshSceneNode* ufo3 = SceneManager->addMeshSceneNode(Assets->getUfoMesh(), root, -1,
+		core::vector3df(740.f, 2000.f, -2400.f),
+		core::vector3df(-30.f, 0.f, 0.f), core::vector3df(20.f, 20.f, 20.f));
+	anim = SceneManager->createRotationAnimator(core::vector3df(0.f, 0.1f, 0.f));
+	ufo3->addAnimator(anim);
+	anim->drop();
+
+	// the lava fire, next to the lake of main()
+	CSoaParticleSystemSceneNode* ps = new CSoaParticleSystemSceneNode(root, SceneManager);
+	ps->setBoxEmitter(
+		core::aabbox3d<f32>(-70,0,-70,70,450,470),
+		core::vector3df(0.0f,0.06f,0.0f),
+		1800,2000,
+		video::SColor(0,255,255,255),
+		video::SColor(0,100,255,100),
+		15800,17000,0,
+		core::dimension2df(100.f,100.f),
+		core::dimension2df(400.f,400.f));
+	ps->setFadeOut();
+	ps->setPosition(core::vector3df(11700.f, -200.f, 4600.f));
+	ps->setScale(core::vector3df(30.f, 30.f, 30.f));
+	ps->setMaterialTexture(0, Assets->getParticleTexture());
+	ps->setMaterialType(video::EMT_TRANSPARENT_ADD_COLOR);
+	ps->drop(); // the root node keeps it
+
+	Camera = SceneManager->addCameraSceneNode(root);
+	Camera->setFarValue(42000.0f);
+	Assets->getPath().apply(Camera, PathOffset);
+
+	anim = SceneManager->createCollisionResponseAnimator(
+		worldSelector, Camera, core::vector3df(60,100,60),
+		core::vector3df(0,-9.8f,0), // gravity
+		core::vector3df(0,50,0));
+	Camera->addAnimator(anim);
+	anim->drop();
+	worldSelector->drop();
+}
+
+
+CMarsWorld::~CMarsWorld()
+{
+	SceneManager->drop();
+	Assets->drop();
+}
+
+
+void CMarsWorld::tick(u32 timeMs)
+{
+	// back and forth along the path, starting at PathOffset
+	const u32 period = PathDurationMs * 2;
+	const u32 phase = (timeMs + (u32)(PathOffset * PathDurationMs)) % period;
+	const f32 t = (f32)(phase < PathDurationMs ? phase : period - phase) / PathDurationMs;
+	Assets->getPath().apply(Camera, t);
+
+	SceneManager->getRootSceneNode()->OnAnimate(timeMs);
+	++TickCount;
+}
+
+} // end namespace scene
+} // end namespace irr
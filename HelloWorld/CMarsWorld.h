@@ -0,0 +1,115 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_MARS_WORLD_H_INCLUDED__
+#define __C_MARS_WORLD_H_INCLUDED__
+
+#include <irrlicht.h>
+#include "CFlythroughPath.h"
+
+namespace irr
+{
+namespace scene
+{
+
+class CBvhTree;
+class CHeightField;
+
+//! The read-only part of the Mars scene, loaded once and shared by every CMarsWorld.
+/** Holds the terrain heights, the collision levels of the gates and of the
+mother ship with their bounding volume hierarchies, the ufo mesh, the
+particle texture and the flythrough path. Nothing in here is changed after
+construction, so worlds ticking on different threads read it at the same
+time. The meshes stay in the mesh cache of the device, the texture in its
+driver. */
+class CMarsWorldAssets : public virtual IReferenceCounted
+{
+public:
+
+	//! Loads the assets with the scene manager and the driver of device.
+	CMarsWorldAssets(IrrlichtDevice* device);
+
+	virtual ~CMarsWorldAssets();
+
+	//! Returns false if one of the assets could not be loaded.
+	bool isValid() const;
+
+	CHeightField* getTerrain() const { return Terrain; }
+
+	IMesh* getGateMesh() const { return GateMesh; }
+
+	CBvhTree* getGateTree() const { return GateTree; }
+
+	IMesh* getMotherShipMesh() const { return MotherShipMesh; }
+
+	CBvhTree* getMotherShipTree() const { return MotherShipTree; }
+
+	IMesh* getUfoMesh() const { return UfoMesh; }
+
+	video::ITexture* getParticleTexture() const { return ParticleTexture; }
+
+	const CFlythroughPath& getPath() const { return Path; }
+
+	//! Memory of the heights, meshes and trees, shared by all worlds.
+	u32 getSharedBytes() const;
+
+private:
+
+	CHeightField* Terrain;
+	IMesh* GateMesh;
+	CBvhTree* GateTree;
+	IMesh* MotherShipMesh;
+	CBvhTree* MotherShipTree;
+	IMesh* UfoMesh;
+	video::ITexture* ParticleTexture;
+	CFlythroughPath Path;
+};
+
+
+//! One independent copy of the simulated Mars scene.
+/** Every world has its own scene manager, made with
+ISceneManager::createNewSceneManager(), so it shares the mesh cache and the
+driver of the device but has its own nodes, animators and collision
+manager. It places the gates, the mother ship, the ufos, the lava fire and
+the terrain like main() does, with the collision level of every mesh and a
+node without geometry for the terrain, and a camera which flies the path
+of the benchmark and collides with all of them through one world selector.
+Nothing is drawn, which is why the water and the characters are left out.
+
+tick() only touches the world itself and the shared assets, so different
+worlds may be ticked on different threads, see CWorldServer.h. Build and
+drop the worlds on the main thread, both grab the shared assets. */
+class CMarsWorld : public virtual IReferenceCounted
+{
+public:
+
+	//! Builds a world.
+	/** \param pathOffset Where on the path the camera starts, 0 to 1, so
+	the worlds do not all collide against the same triangles. */
+	CMarsWorld(IrrlichtDevice* device, CMarsWorldAssets* assets, f32 pathOffset=0.f);
+
+	virtual ~CMarsWorld();
+
+	//! Moves the camera along the path and runs all animators at timeMs.
+	void tick(u32 timeMs);
+
+	ISceneManager* getSceneManager() const { return SceneManager; }
+
+	ICameraSceneNode* getCamera() const { return Camera; }
+
+	u32 getTickCount() const { return TickCount; }
+
+private:
+
+	CMarsWorldAssets* Assets;
+	ISceneManager* SceneManager;
+	ICameraSceneNode* Camera;
+	f32 PathOffset;
+	u32 TickCount;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
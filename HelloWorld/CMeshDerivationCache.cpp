@@ -0,0 +1,173 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CMeshDerivationCache.h"
+
+namespace irr
+{
+namespace scene
+{
+
+CMeshDerivationCache::CMeshDerivationCache(IMeshManipulator* manipulator)
+	: Manipulator(manipulator), HitCount(0), MissCount(0), BytesSaved(0), BytesCached(0)
+{
+	#ifdef _DEBUG
+	setDebugName("CMeshDerivationCache");
+	#endif
+
+	if (Manipulator)
+		Manipulator->grab();
+}
+
+
+CMeshDerivationCache::~CMeshDerivationCache()
+{
+	clear();
+
+	if (Manipulator)
+		Manipulator->drop();
+}
+
+
+u32 CMeshDerivationCache::getMeshDataSize(const IMesh* mesh)
+{
+	if (!mesh)
+		return 0;
+
+	u32 size = 0;
+	for (u32 i=0; i<mesh->getMeshBufferCount(); ++i)
+	{
+		const IMeshBuffer* mb = mesh->getMeshBuffer(i);
+		size += mb->getVertexCount() * video::getVertexPitchFromType(mb->getVertexType());
+		size += mb->getIndexCount() * (mb->getIndexType() == video::EIT_32BIT ? 4 : 2);
+	}
+	return size;
+}
+
+
+IMesh* CMeshDerivationCache::find(IMesh* source, E_DERIVATION derivation, u32 flags, f32 parameter)
+{
+	for (u32 i=0; i<Entries.size(); ++i)
+	{
+		const SEntry& e = Entries[i];
+		if (e.Source == source && e.Derivation == derivation &&
+			e.Flags == flags && e.Parameter == parameter)
+		{
+			++HitCount;
+			BytesSaved += e.Size;
+			return e.Result;
+		}
+	}
+
+	return 0;
+}
+
+
+IMesh* CMeshDerivationCache::add(IMesh* source, E_DERIVATION derivation, u32 flags,
+		f32 parameter, IMesh* result)
+{
+	++MissCount;
+	if (!result)
+		return 0;
+
+	SEntry e;
+	e.Source = source;
+	e.Derivation = derivation;
+	e.Flags = flags;
+	e.Parameter = parameter;
+	e.Result = result;
+	e.Size = getMeshDataSize(result);
+	Entries.push_back(e);
+
+	// result comes from a create call, so the reference is already ours
+	source->grab();
+	BytesCached += e.Size;
+	return result;
+}
+
+
+IMesh* CMeshDerivationCache::getMeshWithTangents(IMesh* mesh, bool recalculateNormals,
+		bool smooth, bool angleWeighted, bool recalculateTangents)
+{
+	if (!mesh || !Manipulator)
+		return 0;
+
+	const u32 flags = (recalculateNormals ? 1 : 0) | (smooth ? 2 : 0) |
+		(angleWeighted ? 4 : 0) | (recalculateTangents ? 8 : 0);
+
+	IMesh* result = find(mesh, EMD_TANGENTS, flags, 0.f);
+	if (result)
+		return result;
+
+	return add(mesh, EMD_TANGENTS, flags, 0.f, Manipulator->createMeshWithTangents(
+		mesh, recalculateNormals, smooth, angleWeighted, recalculateTangents));
+}
+
+
+IMesh* CMeshDerivationCache::getMeshWith2TCoords(IMesh* mesh)
+{
+	if (!mesh || !Manipulator)
+		return 0;
+
+	IMesh* result = find(mesh, EMD_2TCOORDS, 0, 0.f);
+	if (result)
+		return result;
+
+	return add(mesh, EMD_2TCOORDS, 0, 0.f, Manipulator->createMeshWith2TCoords(mesh));
+}
+
+
+IMesh* CMeshDerivationCache::getMeshWith1TCoords(IMesh* mesh)
+{
+	if (!mesh || !Manipulator)
+		return 0;
+
+	IMesh* result = find(mesh, EMD_1TCOORDS, 0, 0.f);
+	if (result)
+		return result;
+
+	return add(mesh, EMD_1TCOORDS, 0, 0.f, Manipulator->createMeshWith1TCoords(mesh));
+}
+
+
+IMesh* CMeshDerivationCache::getMeshWelded(IMesh* mesh, f32 tolerance)
+{
+	if (!mesh || !Manipulator)
+		return 0;
+
+	IMesh* result = find(mesh, EMD_WELDED, 0, tolerance);
+	if (result)
+		return result;
+
+	return add(mesh, EMD_WELDED, 0, tolerance, Manipulator->createMeshWelded(mesh, tolerance));
+}
+
+
+IMesh* CMeshDerivationCache::getMeshUniquePrimitives(IMesh* mesh)
+{
+	if (!mesh || !Manipulator)
+		return 0;
+
+	IMesh* result = find(mesh, EMD_UNIQUE_PRIMITIVES, 0, 0.f);
+	if (result)
+		return result;
+
+	return add(mesh, EMD_UNIQUE_PRIMITIVES, 0, 0.f, Manipulator->createMeshUniquePrimitives(mesh));
+}
+
+
+void CMeshDerivationCache::clear()
+{
+	for (u32 i=0; i<Entries.size(); ++i)
+	{
+		Entries[i].Result->drop();
+		Entries[i].Source->drop();
+	}
+
+	Entries.clear();
+	BytesCached = 0;
+}
+
+} // end namespace scene
+} // end namespace irr
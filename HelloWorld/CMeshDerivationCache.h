@@ -0,0 +1,110 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_MESH_DERIVATION_CACHE_H_INCLUDED__
+#define __C_MESH_DERIVATION_CACHE_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Caches meshes derived from other meshes by the mesh manipulator.
+/** IMeshManipulator::createMeshWithTangents() and friends build a new mesh
+on every call, even for a source mesh they have already converted. This
+cache remembers every result by source mesh, operation and parameters and
+returns the same mesh again, so the memory and time spent is per unique
+mesh instead of per scene node using it.
+
+The cache grabs the source meshes, so their addresses can not be reused by
+another mesh while they are keys. The returned meshes belong to the cache:
+do not drop them, grab them if they have to outlive the cache. */
+class CMeshDerivationCache : public virtual IReferenceCounted
+{
+public:
+
+	CMeshDerivationCache(IMeshManipulator* manipulator);
+
+	virtual ~CMeshDerivationCache();
+
+	//! Cached IMeshManipulator::createMeshWithTangents().
+	IMesh* getMeshWithTangents(IMesh* mesh, bool recalculateNormals=false,
+		bool smooth=false, bool angleWeighted=false, bool recalculateTangents=true);
+
+	//! Cached IMeshManipulator::createMeshWith2TCoords().
+	IMesh* getMeshWith2TCoords(IMesh* mesh);
+
+	//! Cached IMeshManipulator::createMeshWith1TCoords().
+	IMesh* getMeshWith1TCoords(IMesh* mesh);
+
+	//! Cached IMeshManipulator::createMeshWelded().
+	IMesh* getMeshWelded(IMesh* mesh, f32 tolerance=core::ROUNDING_ERROR_f32);
+
+	//! Cached IMeshManipulator::createMeshUniquePrimitives().
+	IMesh* getMeshUniquePrimitives(IMesh* mesh);
+
+	//! Drops all cached meshes.
+	void clear();
+
+	//! Amount of requests answered from the cache.
+	u32 getHitCount() const { return HitCount; }
+
+	//! Amount of requests which had to build a mesh.
+	u32 getMissCount() const { return MissCount; }
+
+	//! Memory of the vertices and indices not allocated thanks to hits.
+	u32 getBytesSaved() const { return BytesSaved; }
+
+	//! Memory of the vertices and indices of all cached meshes.
+	u32 getBytesCached() const { return BytesCached; }
+
+	u32 getMeshCount() const { return Entries.size(); }
+
+	//! Returns the size of the vertex and index data of mesh.
+	static u32 getMeshDataSize(const IMesh* mesh);
+
+private:
+
+	enum E_DERIVATION
+	{
+		EMD_TANGENTS = 0,
+		EMD_2TCOORDS,
+		EMD_1TCOORDS,
+		EMD_WELDED,
+		EMD_UNIQUE_PRIMITIVES
+	};
+
+	struct SEntry
+	{
+		IMesh* Source;
+		E_DERIVATION Derivation;
+		//! Boolean parameters of the operation, one bit each.
+		u32 Flags;
+		f32 Parameter;
+
+		IMesh* Result;
+		u32 Size;
+	};
+
+	//! Returns the cached result or 0, counting a hit if found.
+	IMesh* find(IMesh* source, E_DERIVATION derivation, u32 flags, f32 parameter);
+
+	//! Stores a freshly created result, counting a miss.
+	IMesh* add(IMesh* source, E_DERIVATION derivation, u32 flags, f32 parameter, IMesh* result);
+
+	IMeshManipulator* Manipulator;
+	core::array<SEntry> Entries;
+
+	u32 HitCount;
+	u32 MissCount;
+	u32 BytesSaved;
+	u32 BytesCached;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
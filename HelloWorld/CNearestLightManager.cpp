@@ -0,0 +1,395 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CNearestLightManager.h"
+#include "CFrameProfiler.h"
+#include "PreciseTimer.h"
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+// lights wider than this many cells are scored for every node
+const f32 GlobalCellSpan = 8.f;
+
+// upper limit of cells per grid side, the cells grow beyond it
+const u32 MaxGridSide = 256;
+
+bool isLit(ISceneNode* node)
+{
+	for (u32 i=0; i<node->getMaterialCount(); ++i)
+		if (node->getMaterial(i).Lighting)
+			return true;
+	return false;
+}
+
+const c8* getPassName(E_SCENE_NODE_RENDER_PASS pass)
+{
+	switch (pass)
+	{
+	case ESNRP_CAMERA:
+		return "pass_camera";
+	case ESNRP_LIGHT:
+		return "pass_light";
+	case ESNRP_SKY_BOX:
+		return "pass_sky_box";
+	case ESNRP_SOLID:
+		return "pass_solid";
+	case ESNRP_SHADOW:
+		return "pass_shadow";
+	case ESNRP_TRANSPARENT:
+		return "pass_transparent";
+	case ESNRP_TRANSPARENT_EFFECT:
+		return "pass_transparent_effect";
+	default:
+		return "pass_other";
+	}
+}
+
+} // end anonymous namespace
+
+
+CNearestLightManager::CNearestLightManager(ISceneManager* smgr)
+	: SceneManager(smgr), GridWidth(0), GridHeight(0), SelectionCount(0),
+	CurrentPass(ESNRP_NONE), Stamp(0), MaxShadowLights(2), CellSize(1000.f),
+	LastNodeCount(0), LastScoredCount(0), LastSelectionTimeMs(0), PassStartMs(0)
+{
+	#ifdef _DEBUG
+	setDebugName("CNearestLightManager");
+	#endif
+
+	// the scene manager grabs this manager, so it is not grabbed back
+	setMaxLightsPerNode(smgr->getVideoDriver()->getMaximalDynamicLightAmount());
+}
+
+
+void CNearestLightManager::setMaxLightsPerNode(u32 count)
+{
+	MaxLightsPerNode = count ? core::min_(count, (u32)MAX_NODE_LIGHTS) : (u32)MAX_NODE_LIGHTS;
+}
+
+
+f32 CNearestLightManager::getInfluence(const SLightInfo& light, const core::aabbox3df& box)
+{
+	if (light.Directional)
+		return light.Intensity;
+
+	// distance to the nearest point of the box, 0 inside
+	const core::vector3df nearest(
+		core::clamp(light.Position.X, box.MinEdge.X, box.MaxEdge.X),
+		core::clamp(light.Position.Y, box.MinEdge.Y, box.MaxEdge.Y),
+		core::clamp(light.Position.Z, box.MinEdge.Z, box.MaxEdge.Z));
+	const f32 distance = nearest.getDistanceFrom(light.Position);
+	if (distance >= light.Radius)
+		return 0.f;
+
+	f32 attenuation = light.Attenuation.X + light.Attenuation.Y * distance + light.Attenuation.Z * distance * distance;
+	if (attenuation <= 0.f)
+		attenuation = 1.f;
+
+	// the radius cuts the light off, fade towards it so nodes at the edge
+	// prefer lights they are well inside of
+	return light.Intensity / attenuation * (1.f - distance / light.Radius);
+}
+
+
+void CNearestLightManager::buildGrid()
+{
+	GlobalLights.set_used(0);
+	GridWidth = 0;
+	GridHeight = 0;
+
+	core::rectf bounds;
+	bool hasLocal = false;
+
+	for (u32 i=0; i<Lights.size(); ++i)
+	{
+		const SLightInfo& light = Lights[i];
+		if (light.Directional || light.Radius * 2.f > CellSize * GlobalCellSpan)
+		{
+			GlobalLights.push_back(i);
+			continue;
+		}
+
+		const core::rectf reach(light.Position.X - light.Radius, light.Position.Z - light.Radius,
+			light.Position.X + light.Radius, light.Position.Z + light.Radius);
+		if (hasLocal)
+		{
+			bounds.addInternalPoint(reach.UpperLeftCorner);
+			bounds.addInternalPoint(reach.LowerRightCorner);
+		}
+		else
+		{
+			bounds = reach;
+			hasLocal = true;
+		}
+	}
+
+	if (!hasLocal)
+		return;
+
+	const f32 width = core::max_(bounds.getWidth(), 1.f);
+	const f32 height = core::max_(bounds.getHeight(), 1.f);
+	GridWidth = core::clamp((u32)ceilf(width / CellSize), 1u, MaxGridSide);
+	GridHeight = core::clamp((u32)ceilf(height / CellSize), 1u, MaxGridSide);
+	GridOrigin.set(bounds.UpperLeftCorner.X, bounds.UpperLeftCorner.Y);
+	GridCellSize.set(width / GridWidth, height / GridHeight);
+
+	// count the lights per cell, turn the counts into cell ends and fill the
+	// cells backwards, which leaves CellStart at the start of every cell
+	const u32 cellCount = GridWidth * GridHeight;
+	CellStart.set_used(cellCount + 1);
+	memset(CellStart.pointer(), 0, CellStart.size() * sizeof(u32));
+
+	for (u32 pass=0; pass<2; ++pass)
+	{
+		for (u32 i=0; i<Lights.size(); ++i)
+		{
+			const SLightInfo& light = Lights[i];
+			if (light.Directional || light.Radius * 2.f > CellSize * GlobalCellSpan)
+				continue;
+
+			const s32 x0 = (s32)((light.Position.X - light.Radius - GridOrigin.X) / GridCellSize.X);
+			const s32 z0 = (s32)((light.Position.Z - light.Radius - GridOrigin.Y) / GridCellSize.Y);
+			const s32 x1 = core::min_((s32)((light.Position.X + light.Radius - GridOrigin.X) / GridCellSize.X), (s32)GridWidth - 1);
+			const s32 z1 = core::min_((s32)((light.Position.Z + light.Radius - GridOrigin.Y) / GridCellSize.Y), (s32)GridHeight - 1);
+
+			for (s32 z=core::max_(z0, 0); z<=z1; ++z)
+				for (s32 x=core::max_(x0, 0); x<=x1; ++x)
+				{
+					const u32 cell = z * GridWidth + x;
+					if (pass == 0)
+						++CellStart[cell];
+					else
+						CellLights[--CellStart[cell]] = i;
+				}
+		}
+
+		if (pass == 0)
+		{
+			u32 end = 0;
+			for (u32 c=0; c<cellCount; ++c)
+			{
+				end += CellStart[c];
+				CellStart[c] = end;
+			}
+			CellStart[cellCount] = end;
+			CellLights.set_used(end);
+		}
+	}
+}
+
+
+void CNearestLightManager::scoreLight(u32 index, const core::aabbox3df& box, u32 maxCount)
+{
+	++LastScoredCount;
+
+	const f32 influence = getInfluence(Lights[index], box);
+	if (influence <= 0.f)
+		return;
+
+	// insertion into the few best
+	u32 slot = SelectionCount;
+	while (slot && SelectionInfluence[slot-1] < influence)
+		--slot;
+	if (slot >= maxCount)
+		return;
+
+	const u32 last = core::min_(SelectionCount, maxCount - 1);
+	for (u32 i=last; i>slot; --i)
+	{
+		Selection[i] = Selection[i-1];
+		SelectionInfluence[i] = SelectionInfluence[i-1];
+	}
+	Selection[slot] = index;
+	SelectionInfluence[slot] = influence;
+	SelectionCount = core::min_(SelectionCount + 1, maxCount);
+}
+
+
+void CNearestLightManager::setLightOn(u32 index, bool on)
+{
+	SLightInfo& light = Lights[index];
+	if (light.On != on)
+	{
+		light.On = on;
+		// also switches the light in the driver
+		light.Node->setVisible(on);
+	}
+}
+
+
+void CNearestLightManager::applySelection()
+{
+	++Stamp;
+	for (u32 i=0; i<SelectionCount; ++i)
+		Lights[Selection[i]].Stamp = Stamp;
+
+	for (u32 i=0; i<Enabled.size(); ++i)
+		if (Lights[Enabled[i]].Stamp != Stamp)
+			setLightOn(Enabled[i], false);
+
+	Enabled.set_used(SelectionCount);
+	for (u32 i=0; i<SelectionCount; ++i)
+	{
+		setLightOn(Selection[i], true);
+		Enabled[i] = Selection[i];
+	}
+}
+
+
+void CNearestLightManager::OnPreRender(core::array<ISceneNode*>& lightList)
+{
+	const f64 start = getPreciseTimeMs();
+
+	LastNodeCount = 0;
+	LastScoredCount = 0;
+	CurrentPass = ESNRP_NONE;
+
+	// the list only has the visible lights, the scene manager turns all
+	// of them on in the driver
+	Lights.set_used(lightList.size());
+	Enabled.set_used(lightList.size());
+	for (u32 i=0; i<lightList.size(); ++i)
+	{
+		ILightSceneNode* node = (ILightSceneNode*)lightList[i];
+		const video::SLight& data = node->getLightData();
+
+		SLightInfo& light = Lights[i];
+		light.Node = node;
+		light.Position = node->getAbsolutePosition();
+		light.Attenuation = data.Attenuation;
+		light.Radius = data.Radius;
+		light.Intensity = data.DiffuseColor.r * 0.3f + data.DiffuseColor.g * 0.59f + data.DiffuseColor.b * 0.11f;
+		light.Directional = data.Type == video::ELT_DIRECTIONAL;
+		light.CastShadows = data.CastShadows;
+		light.On = true;
+		light.Stamp = 0;
+
+		Enabled[i] = i;
+	}
+	Stamp = 0;
+
+	buildGrid();
+
+	// shadow casting lights with the most influence where the camera is
+	const ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	const core::vector3df eye = camera ? camera->getAbsolutePosition() : core::vector3df();
+	const core::aabbox3df eyeBox(eye);
+
+	SelectionCount = 0;
+	if (MaxShadowLights)
+		for (u32 i=0; i<Lights.size(); ++i)
+			if (Lights[i].CastShadows)
+				scoreLight(i, eyeBox, core::min_(MaxShadowLights, (u32)MAX_NODE_LIGHTS));
+
+	ShadowLights.set_used(SelectionCount);
+	for (u32 i=0; i<SelectionCount; ++i)
+		ShadowLights[i] = Selection[i];
+
+	const f64 end = getPreciseTimeMs();
+	LastSelectionTimeMs = end - start;
+	CFrameProfiler::report("light_select", start, end);
+}
+
+
+void CNearestLightManager::OnPostRender()
+{
+	// back on, so the lights register again next frame
+	for (u32 i=0; i<Lights.size(); ++i)
+		setLightOn(i, true);
+
+	Enabled.set_used(0);
+	CurrentPass = ESNRP_NONE;
+}
+
+
+void CNearestLightManager::OnRenderPassPreRender(E_SCENE_NODE_RENDER_PASS renderPass)
+{
+	CurrentPass = renderPass;
+	PassStartMs = CFrameProfiler::getActive() ? getPreciseTimeMs() : 0.0;
+
+	if (renderPass == ESNRP_SHADOW)
+	{
+		SelectionCount = ShadowLights.size();
+		for (u32 i=0; i<SelectionCount; ++i)
+			Selection[i] = ShadowLights[i];
+		applySelection();
+	}
+}
+
+
+void CNearestLightManager::OnRenderPassPostRender(E_SCENE_NODE_RENDER_PASS renderPass)
+{
+	// the light manager is told about every pass of drawAll(), a good
+	// place to see how long each takes
+	if (PassStartMs > 0.0)
+		CFrameProfiler::report(getPassName(renderPass), PassStartMs, getPreciseTimeMs());
+	PassStartMs = 0.0;
+}
+
+
+void CNearestLightManager::OnNodePreRender(ISceneNode* node)
+{
+	// the shadow pass keeps the shadow lights, the camera, light and sky
+	// passes are not lit
+	if (CurrentPass != ESNRP_SOLID && CurrentPass != ESNRP_TRANSPARENT &&
+		CurrentPass != ESNRP_TRANSPARENT_EFFECT)
+		return;
+
+	if (!isLit(node))
+		return;
+
+	const f64 start = getPreciseTimeMs();
+
+	const core::aabbox3df box = node->getTransformedBoundingBox();
+
+	++Stamp;
+	SelectionCount = 0;
+
+	for (u32 i=0; i<GlobalLights.size(); ++i)
+		scoreLight(GlobalLights[i], box, MaxLightsPerNode);
+
+	if (GridWidth)
+	{
+		const s32 x0 = core::max_((s32)floorf((box.MinEdge.X - GridOrigin.X) / GridCellSize.X), 0);
+		const s32 z0 = core::max_((s32)floorf((box.MinEdge.Z - GridOrigin.Y) / GridCellSize.Y), 0);
+		const s32 x1 = core::min_((s32)floorf((box.MaxEdge.X - GridOrigin.X) / GridCellSize.X), (s32)GridWidth - 1);
+		const s32 z1 = core::min_((s32)floorf((box.MaxEdge.Z - GridOrigin.Y) / GridCellSize.Y), (s32)GridHeight - 1);
+
+		for (s32 z=z0; z<=z1; ++z)
+		{
+			for (s32 x=x0; x<=x1; ++x)
+			{
+				const u32 cell = z * GridWidth + x;
+				for (u32 i=CellStart[cell]; i<CellStart[cell+1]; ++i)
+				{
+					// a light covering several cells of the box is scored once
+					SLightInfo& light = Lights[CellLights[i]];
+					if (light.Stamp == Stamp)
+						continue;
+					light.Stamp = Stamp;
+					scoreLight(CellLights[i], box, MaxLightsPerNode);
+				}
+			}
+		}
+	}
+
+	applySelection();
+
+	++LastNodeCount;
+	LastSelectionTimeMs += getPreciseTimeMs() - start;
+}
+
+
+void CNearestLightManager::OnNodePostRender(ISceneNode* node)
+{
+}
+
+} // end namespace scene
+} // end namespace irr
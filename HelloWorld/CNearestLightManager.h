@@ -0,0 +1,145 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_NEAREST_LIGHT_MANAGER_H_INCLUDED__
+#define __C_NEAREST_LIGHT_MANAGER_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Light manager which only turns on the lights that matter for each node.
+/** Without a light manager the scene manager hands the first lights it
+finds to the driver and every lit node is shaded with all of them, however
+far away they are. This manager scores the lights for each lit node by
+intensity, attenuation and how far inside their radius the node is, and
+only turns on the best few.
+
+To keep the cost per node independent of the amount of lights, the lights
+are sorted into a grid over the XZ plane once per frame. A node only
+scores the lights of the cells its bounding box touches, plus the global
+lights: directional lights and lights whose radius spans much of the map.
+
+The manager also decides which lights cast shadows. Only the few shadow
+casting lights with the most influence at the camera are left on while the
+shadow pass renders, so the shadow volume nodes, which build volumes for
+every visible shadow casting light, only build them for those. */
+class CNearestLightManager : public ILightManager
+{
+public:
+
+	//! Maximal amount of lights turned on for one node.
+	enum { MAX_NODE_LIGHTS = 8 };
+
+	CNearestLightManager(ISceneManager* smgr);
+
+	//! Sets how many lights are turned on per node, up to MAX_NODE_LIGHTS.
+	/** Defaults to what the driver supports. */
+	void setMaxLightsPerNode(u32 count);
+
+	u32 getMaxLightsPerNode() const { return MaxLightsPerNode; }
+
+	//! Sets how many lights may cast shadows in a frame.
+	void setMaxShadowLights(u32 count) { MaxShadowLights = count; }
+
+	u32 getMaxShadowLights() const { return MaxShadowLights; }
+
+	//! Sets the size of a grid cell. Lights wider than GlobalCellSpan cells are global.
+	void setCellSize(f32 size) { CellSize = size; }
+
+	//! Amount of lights of the last frame.
+	u32 getLightCount() const { return Lights.size(); }
+
+	//! Amount of lights of the last frame which every node scores.
+	u32 getGlobalLightCount() const { return GlobalLights.size(); }
+
+	//! Amount of lit nodes lights were chosen for in the last frame.
+	u32 getLastNodeCount() const { return LastNodeCount; }
+
+	//! Amount of lights scored for all nodes of the last frame.
+	u32 getLastScoredLightCount() const { return LastScoredCount; }
+
+	//! Time spent choosing lights in the last frame.
+	f64 getLastSelectionTimeMs() const { return LastSelectionTimeMs; }
+
+	virtual void OnPreRender(core::array<ISceneNode*>& lightList);
+	virtual void OnPostRender();
+	virtual void OnRenderPassPreRender(E_SCENE_NODE_RENDER_PASS renderPass);
+	virtual void OnRenderPassPostRender(E_SCENE_NODE_RENDER_PASS renderPass);
+	virtual void OnNodePreRender(ISceneNode* node);
+	virtual void OnNodePostRender(ISceneNode* node);
+
+private:
+
+	struct SLightInfo
+	{
+		ILightSceneNode* Node;
+		core::vector3df Position;
+		core::vector3df Attenuation;
+		f32 Radius;
+		f32 Intensity;
+		bool Directional;
+		bool CastShadows;
+		//! Turned on in the driver.
+		bool On;
+		//! Frame stamp of the last node which scored or chose it.
+		u32 Stamp;
+	};
+
+	//! Influence of a light on a box, 0 if it does not reach it.
+	static f32 getInfluence(const SLightInfo& light, const core::aabbox3df& box);
+
+	//! Sorts the lights which are not global into the grid.
+	void buildGrid();
+
+	//! Scores one light for box and keeps it if it is among the maxCount best.
+	void scoreLight(u32 index, const core::aabbox3df& box, u32 maxCount);
+
+	//! Turns on the chosen lights and off the ones which were on before.
+	void applySelection();
+
+	void setLightOn(u32 index, bool on);
+
+	ISceneManager* SceneManager;
+
+	core::array<SLightInfo> Lights;
+	core::array<u32> GlobalLights;
+	core::array<u32> ShadowLights;
+	//! Indices of the lights which are on, valid once Enabled is set up.
+	core::array<u32> Enabled;
+
+	// grid over the XZ plane, cell c holds CellLights[CellStart[c]] up to CellStart[c+1]
+	core::array<u32> CellStart;
+	core::array<u32> CellLights;
+	core::vector2df GridOrigin;
+	core::vector2df GridCellSize;
+	u32 GridWidth;
+	u32 GridHeight;
+
+	// best lights of the current node, most influential first
+	u32 Selection[MAX_NODE_LIGHTS];
+	f32 SelectionInfluence[MAX_NODE_LIGHTS];
+	u32 SelectionCount;
+
+	E_SCENE_NODE_RENDER_PASS CurrentPass;
+	u32 Stamp;
+
+	u32 MaxLightsPerNode;
+	u32 MaxShadowLights;
+	f32 CellSize;
+
+	u32 LastNodeCount;
+	u32 LastScoredCount;
+	f64 LastSelectionTimeMs;
+	//! Start of the current pass, for the profiler.
+	f64 PassStartMs;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
@@ -0,0 +1,517 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "COcclusionCuller.h"
+#include "CFrameProfiler.h"
+#include "PreciseTimer.h"
+#include <float.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define _MARS_OCCLUSION_SSE_
+#include <xmmintrin.h>
+#endif
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+struct STriangleArea
+{
+	f32 Area;
+	u32 First;
+
+	// largest first
+	bool operator<(const STriangleArea& other) const { return Area > other.Area; }
+};
+
+u32 getIndex(const IMeshBuffer* buffer, u32 i)
+{
+	if (buffer->getIndexType() == video::EIT_32BIT)
+		return ((const u32*)buffer->getIndices())[i];
+	return buffer->getIndices()[i];
+}
+
+//! Returns true if the box is completely outside one plane of the frustum.
+bool isOutsideFrustum(const core::aabbox3df& box, const core::matrix4& mvp, f32 nearW)
+{
+	core::vector3df corners[8];
+	box.getEdges(corners);
+
+	u32 left = 0, right = 0, bottom = 0, top = 0, behind = 0;
+	for (u32 i=0; i<8; ++i)
+	{
+		f32 clip[4];
+		mvp.transformVect(clip, corners[i]);
+		left += clip[0] < -clip[3];
+		right += clip[0] > clip[3];
+		bottom += clip[1] < -clip[3];
+		top += clip[1] > clip[3];
+		behind += clip[3] < nearW;
+	}
+
+	return left == 8 || right == 8 || bottom == 8 || top == 8 || behind == 8;
+}
+
+} // end anonymous namespace
+
+
+COcclusionCuller::COcclusionCuller(ISceneNode* parent, ISceneManager* mgr, s32 id)
+	: ISceneNode(parent, mgr, id), Hidden(false), DepthMemory(0), Depth(0),
+	LastTriangleCount(0), LastTestedCount(0), LastCullTimeMs(0.0)
+{
+	#ifdef _DEBUG
+	setDebugName("COcclusionCuller");
+	#endif
+
+	// only registered to show the occluded nodes again, never drawn
+	setAutomaticCulling(EAC_OFF);
+	setResolution(256, 128);
+}
+
+
+COcclusionCuller::~COcclusionCuller()
+{
+	showOccluded();
+
+	for (u32 i=0; i<Occluders.size(); ++i)
+		Occluders[i].Node->drop();
+	for (u32 i=0; i<Occludees.size(); ++i)
+		Occludees[i]->drop();
+
+	delete [] DepthMemory;
+}
+
+
+void COcclusionCuller::setResolution(u32 width, u32 height)
+{
+	const u32 alignedWidth = core::max_((width + 3) & ~3u, 4u);
+	const u32 alignedHeight = core::max_(height, 1u);
+
+	delete [] DepthMemory;
+	DepthMemory = new u8[alignedWidth * alignedHeight * sizeof(f32) + 15];
+	Depth = (f32*)(((size_t)DepthMemory + 15) & ~(size_t)15);
+	Size.set(alignedWidth, alignedHeight);
+	memset(Depth, 0, alignedWidth * alignedHeight * sizeof(f32));
+}
+
+
+void COcclusionCuller::addOccluder(ISceneNode* node, IMesh* mesh, u32 maxTriangles)
+{
+	if (!node || !mesh)
+		return;
+
+	core::array<core::vector3df> positions;
+	core::array<STriangleArea> areas;
+	for (u32 b=0; b<mesh->getMeshBufferCount(); ++b)
+	{
+		const IMeshBuffer* buffer = mesh->getMeshBuffer(b);
+
+		// what can be seen through hides nothing
+		if (buffer->getMaterial().isTransparent())
+			continue;
+
+		for (u32 i=0; i+2<buffer->getIndexCount(); i+=3)
+		{
+			const core::vector3df& a = buffer->getPosition(getIndex(buffer, i));
+			const core::vector3df& b = buffer->getPosition(getIndex(buffer, i+1));
+			const core::vector3df& c = buffer->getPosition(getIndex(buffer, i+2));
+
+			STriangleArea area;
+			area.Area = (b - a).crossProduct(c - a).getLengthSQ();
+			if (area.Area <= 0.f)
+				continue;
+
+			area.First = positions.size();
+			positions.push_back(a);
+			positions.push_back(b);
+			positions.push_back(c);
+			areas.push_back(area);
+		}
+	}
+
+	if (!areas.size())
+		return;
+
+	if (maxTriangles && areas.size() > maxTriangles)
+	{
+		areas.sort();
+		areas.set_used(maxTriangles);
+	}
+
+	Occluders.push_back(SOccluder());
+	SOccluder& occluder = Occluders.getLast();
+	occluder.Node = node;
+	occluder.Triangles.reallocate(areas.size() * 3);
+	occluder.Box.reset(positions[areas[0].First]);
+	for (u32 t=0; t<areas.size(); ++t)
+	{
+		for (u32 k=0; k<3; ++k)
+		{
+			const core::vector3df& p = positions[areas[t].First + k];
+			occluder.Triangles.push_back(p);
+			occluder.Box.addInternalPoint(p);
+		}
+	}
+
+	node->grab();
+}
+
+
+void COcclusionCuller::addOccludee(ISceneNode* node)
+{
+	if (!node)
+		return;
+
+	node->grab();
+	Occludees.push_back(node);
+}
+
+
+u32 COcclusionCuller::addOccludees(ISceneNode* root)
+{
+	u32 added = 0;
+	const core::list<ISceneNode*>& children = root->getChildren();
+	for (core::list<ISceneNode*>::ConstIterator it = children.begin(); it != children.end(); ++it)
+	{
+		ISceneNode* node = *it;
+		if (!node->getChildren().empty())
+			added += addOccludees(node);
+		else if (node != this && node->getMaterialCount() && node->getAutomaticCulling() != EAC_OFF)
+		{
+			addOccludee(node);
+			++added;
+		}
+	}
+	return added;
+}
+
+
+void COcclusionCuller::cull(const ICameraSceneNode* camera)
+{
+	const f64 start = getPreciseTimeMs();
+
+	Occluded.set_used(0);
+	LastTriangleCount = 0;
+	LastTestedCount = 0;
+
+	memset(Depth, 0, Size.Width * Size.Height * sizeof(f32));
+
+	core::matrix4 viewProjection(camera->getProjectionMatrix());
+	viewProjection *= camera->getViewMatrix();
+	const f32 nearW = core::max_(camera->getNearValue(), 0.001f);
+
+	for (u32 o=0; o<Occluders.size(); ++o)
+	{
+		const SOccluder& occluder = Occluders[o];
+		if (!occluder.Node->getParent() || !occluder.Node->isTrulyVisible())
+			continue;
+
+		core::matrix4 mvp(viewProjection);
+		mvp *= occluder.Node->getAbsoluteTransformation();
+		if (isOutsideFrustum(occluder.Box, mvp, nearW))
+			continue;
+
+		for (u32 i=0; i<occluder.Triangles.size(); i+=3)
+		{
+			f32 clip[3][4];
+			mvp.transformVect(clip[0], occluder.Triangles[i]);
+			mvp.transformVect(clip[1], occluder.Triangles[i+1]);
+			mvp.transformVect(clip[2], occluder.Triangles[i+2]);
+			drawTriangle(clip[0], clip[1], clip[2], nearW);
+		}
+		LastTriangleCount += occluder.Triangles.size() / 3;
+	}
+
+	if (LastTriangleCount)
+	{
+		for (u32 i=0; i<Occludees.size(); ++i)
+		{
+			ISceneNode* node = Occludees[i];
+			if (!node->getParent() || !node->isTrulyVisible())
+				continue;
+
+			++LastTestedCount;
+			if (isBoxOccluded(node->getTransformedBoundingBox(), viewProjection, nearW))
+				Occluded.push_back(node);
+		}
+		Occluded.sort();
+	}
+
+	const f64 end = getPreciseTimeMs();
+	LastCullTimeMs = end - start;
+	CFrameProfiler::report("occlusion_cull", start, end);
+}
+
+
+void COcclusionCuller::drawTriangle(const f32* a, const f32* b, const f32* c, f32 nearW)
+{
+	// one plane cuts a triangle into at most a quad
+	const f32* in[3] = { a, b, c };
+	f32 polygon[4][4];
+	u32 count = 0;
+	for (u32 i=0; i<3; ++i)
+	{
+		const f32* from = in[i];
+		const f32* to = in[i == 2 ? 0 : i + 1];
+		const bool fromInside = from[3] >= nearW;
+		const bool toInside = to[3] >= nearW;
+
+		if (fromInside)
+		{
+			memcpy(polygon[count], from, 4 * sizeof(f32));
+			++count;
+		}
+
+		if (fromInside != toInside)
+		{
+			const f32 t = (nearW - from[3]) / (to[3] - from[3]);
+			for (u32 k=0; k<4; ++k)
+				polygon[count][k] = from[k] + (to[k] - from[k]) * t;
+			++count;
+		}
+	}
+
+	if (count < 3)
+		return;
+
+	SScreenVertex screen[4];
+	for (u32 i=0; i<count; ++i)
+	{
+		const f32 invW = 1.f / polygon[i][3];
+		screen[i].X = (polygon[i][0] * invW * 0.5f + 0.5f) * Size.Width;
+		screen[i].Y = (0.5f - polygon[i][1] * invW * 0.5f) * Size.Height;
+		screen[i].Z = invW;
+	}
+
+	for (u32 i=1; i+1<count; ++i)
+		rasterize(screen[0], screen[i], screen[i+1]);
+}
+
+
+void COcclusionCuller::rasterize(const SScreenVertex& v0, const SScreenVertex& v1, const SScreenVertex& v2)
+{
+	f32 area = (v1.X - v0.X) * (v2.Y - v0.Y) - (v1.Y - v0.Y) * (v2.X - v0.X);
+	if (area == 0.f)
+		return;
+
+	// no back face culling, both windings are turned into the same
+	const SScreenVertex* p[3] = { &v0, &v1, &v2 };
+	if (area < 0.f)
+	{
+		p[1] = &v2;
+		p[2] = &v1;
+		area = -area;
+	}
+
+	// the pixels whose centers are within the bounds of the triangle
+	const f32 minX = core::min_(p[0]->X, p[1]->X, p[2]->X);
+	const f32 maxX = core::max_(p[0]->X, p[1]->X, p[2]->X);
+	const f32 minY = core::min_(p[0]->Y, p[1]->Y, p[2]->Y);
+	const f32 maxY = core::max_(p[0]->Y, p[1]->Y, p[2]->Y);
+	if (maxX < 0.f || maxY < 0.f || minX > (f32)Size.Width || minY > (f32)Size.Height)
+		return;
+
+	const s32 x0 = core::max_((s32)ceilf(minX - 0.5f), 0) & ~3;
+	const s32 x1 = core::min_((s32)floorf(maxX - 0.5f), (s32)Size.Width - 1);
+	const s32 y0 = core::max_((s32)ceilf(minY - 0.5f), 0);
+	const s32 y1 = core::min_((s32)floorf(maxY - 0.5f), (s32)Size.Height - 1);
+	if (x0 > x1 || y0 > y1)
+		return;
+
+	// edge i runs from p[i] to the next vertex and is positive inside,
+	// and 1/w is a plane over the screen
+	f32 edgeA[3], edgeB[3], edgeC[3];
+	for (u32 i=0; i<3; ++i)
+	{
+		const SScreenVertex& from = *p[i];
+		const SScreenVertex& to = *p[i == 2 ? 0 : i + 1];
+		edgeA[i] = from.Y - to.Y;
+		edgeB[i] = to.X - from.X;
+		edgeC[i] = -edgeA[i] * from.X - edgeB[i] * from.Y;
+	}
+
+	// the weight of a vertex is the edge across from it
+	const f32 invArea = 1.f / area;
+	const f32 depthA = (edgeA[1] * p[0]->Z + edgeA[2] * p[1]->Z + edgeA[0] * p[2]->Z) * invArea;
+	const f32 depthB = (edgeB[1] * p[0]->Z + edgeB[2] * p[1]->Z + edgeB[0] * p[2]->Z) * invArea;
+	const f32 depthC = (edgeC[1] * p[0]->Z + edgeC[2] * p[1]->Z + edgeC[0] * p[2]->Z) * invArea;
+
+#ifdef _MARS_OCCLUSION_SSE_
+	const __m128 lanes = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 a0 = _mm_set1_ps(edgeA[0]), a1 = _mm_set1_ps(edgeA[1]), a2 = _mm_set1_ps(edgeA[2]);
+	const __m128 depthX = _mm_set1_ps(depthA);
+
+	for (s32 y=y0; y<=y1; ++y)
+	{
+		const f32 centerY = y + 0.5f;
+		const __m128 row0 = _mm_set1_ps(edgeB[0] * centerY + edgeC[0]);
+		const __m128 row1 = _mm_set1_ps(edgeB[1] * centerY + edgeC[1]);
+		const __m128 row2 = _mm_set1_ps(edgeB[2] * centerY + edgeC[2]);
+		const __m128 rowDepth = _mm_set1_ps(depthB * centerY + depthC);
+		f32* row = Depth + y * Size.Width;
+
+		// the width is a multiple of 4, so the last lanes are still in the row
+		for (s32 x=x0; x<=x1; x+=4)
+		{
+			const __m128 centerX = _mm_add_ps(_mm_set1_ps((f32)x), lanes);
+			const __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, centerX), row0);
+			const __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, centerX), row1);
+			const __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, centerX), row2);
+			const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+			if (!_mm_movemask_ps(inside))
+				continue;
+
+			const __m128 depth = _mm_add_ps(_mm_mul_ps(depthX, centerX), rowDepth);
+			const __m128 old = _mm_load_ps(row + x);
+			_mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(inside, _mm_max_ps(old, depth)), _mm_andnot_ps(inside, old)));
+		}
+	}
+#else
+	for (s32 y=y0; y<=y1; ++y)
+	{
+		const f32 centerY = y + 0.5f;
+		f32* row = Depth + y * Size.Width;
+		for (s32 x=x0; x<=x1; ++x)
+		{
+			const f32 centerX = x + 0.5f;
+			if (edgeA[0] * centerX + edgeB[0] * centerY + edgeC[0] < 0.f ||
+				edgeA[1] * centerX + edgeB[1] * centerY + edgeC[1] < 0.f ||
+				edgeA[2] * centerX + edgeB[2] * centerY + edgeC[2] < 0.f)
+				continue;
+
+			row[x] = core::max_(row[x], depthA * centerX + depthB * centerY + depthC);
+		}
+	}
+#endif
+}
+
+
+bool COcclusionCuller::isBoxOccluded(const core::aabbox3df& box, const core::matrix4& viewProjection, f32 nearW) const
+{
+	core::vector3df corners[8];
+	box.getEdges(corners);
+
+	f32 minX = FLT_MAX, minY = FLT_MAX;
+	f32 maxX = -FLT_MAX, maxY = -FLT_MAX;
+	f32 nearest = 0.f;
+	for (u32 i=0; i<8; ++i)
+	{
+		f32 clip[4];
+		viewProjection.transformVect(clip, corners[i]);
+		if (clip[3] < nearW)
+			return false;
+
+		const f32 invW = 1.f / clip[3];
+		const f32 x = (clip[0] * invW * 0.5f + 0.5f) * Size.Width;
+		const f32 y = (0.5f - clip[1] * invW * 0.5f) * Size.Height;
+		minX = core::min_(minX, x);
+		maxX = core::max_(maxX, x);
+		minY = core::min_(minY, y);
+		maxY = core::max_(maxY, y);
+		nearest = core::max_(nearest, invW);
+	}
+
+	// every pixel the box touches, the part off the screen cannot be seen
+	if (maxX < 0.f || maxY < 0.f || minX >= (f32)Size.Width || minY >= (f32)Size.Height)
+		return false;
+
+	const s32 x0 = core::max_((s32)floorf(minX), 0);
+	const s32 x1 = core::min_((s32)floorf(maxX), (s32)Size.Width - 1);
+	const s32 y0 = core::max_((s32)floorf(minY), 0);
+	const s32 y1 = core::min_((s32)floorf(maxY), (s32)Size.Height - 1);
+
+#ifdef _MARS_OCCLUSION_SSE_
+	const __m128 lanes = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+	const __m128 first = _mm_set1_ps((f32)x0);
+	const __m128 last = _mm_set1_ps((f32)x1);
+	const __m128 boxDepth = _mm_set1_ps(nearest);
+
+	for (s32 y=y0; y<=y1; ++y)
+	{
+		const f32* row = Depth + y * Size.Width;
+		for (s32 x=x0 & ~3; x<=x1; x+=4)
+		{
+			const __m128 pixelX = _mm_add_ps(_mm_set1_ps((f32)x), lanes);
+			const __m128 covered = _mm_and_ps(_mm_cmpge_ps(pixelX, first), _mm_cmple_ps(pixelX, last));
+			const __m128 visible = _mm_and_ps(covered, _mm_cmple_ps(_mm_load_ps(row + x), boxDepth));
+			if (_mm_movemask_ps(visible))
+				return false;
+		}
+	}
+#else
+	for (s32 y=y0; y<=y1; ++y)
+	{
+		const f32* row = Depth + y * Size.Width;
+		for (s32 x=x0; x<=x1; ++x)
+			if (row[x] <= nearest)
+				return false;
+	}
+#endif
+
+	return true;
+}
+
+
+bool COcclusionCuller::wasOccluded(const ISceneNode* node) const
+{
+	return Occluded.binary_search(const_cast<ISceneNode*>(node)) != -1;
+}
+
+
+void COcclusionCuller::showOccluded()
+{
+	if (!Hidden)
+		return;
+
+	for (u32 i=0; i<Occluded.size(); ++i)
+		Occluded[i]->setVisible(true);
+	Hidden = false;
+}
+
+
+void COcclusionCuller::OnAnimate(u32 timeMs)
+{
+	// in case drawAll() did not get to the transparent effect pass
+	showOccluded();
+
+	ISceneNode::OnAnimate(timeMs);
+}
+
+
+void COcclusionCuller::OnRegisterSceneNode()
+{
+	const ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	if (IsVisible && camera && Occluders.size() && Occludees.size())
+	{
+		showOccluded();
+		cull(camera);
+
+		if (Occluded.size())
+		{
+			for (u32 i=0; i<Occluded.size(); ++i)
+				Occluded[i]->setVisible(false);
+			Hidden = true;
+
+			// render() shows them again, in the last pass of drawAll()
+			SceneManager->registerNodeForRendering(this, ESNRP_TRANSPARENT_EFFECT);
+		}
+	}
+
+	ISceneNode::OnRegisterSceneNode();
+}
+
+
+void COcclusionCuller::render()
+{
+	showOccluded();
+}
+
+} // end namespace scene
+} // end namespace irr
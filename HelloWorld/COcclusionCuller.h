@@ -0,0 +1,154 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_OCCLUSION_CULLER_H_INCLUDED__
+#define __C_OCCLUSION_CULLER_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Type of the occlusion culler scene node.
+const ESCENE_NODE_TYPE ESNT_OCCLUSION_CULLER = (ESCENE_NODE_TYPE)MAKE_IRR_ID('o','c','c','l');
+
+//! Hides the nodes which are behind large occluders before they are drawn.
+/** Irrlicht only culls against the view frustum, so the ufos and the cube
+tower behind the mother ship are drawn and get shadow volumes all the same.
+Every frame, this node draws the triangles of a few occluders into a small
+depth buffer on the CPU and tests the bounding box of every occludee
+against it:
+
+- The buffer holds 1/w of the nearest occluder in each pixel, 0 where there
+  is none. Four pixels of a row are filled and tested at once with SSE.
+- An occludee is hidden when every pixel its box covers on the screen holds
+  an occluder nearer than the nearest corner of the box. A box reaching
+  through the near plane or off the screen is left to Irrlicht.
+- Occluders are drawn without back face culling. Their triangles have to
+  lie on or inside opaque surfaces, else they hide what can be seen; see
+  addOccluder().
+
+drawAll() registers the children of the root node in the order they were
+added, so the culler has to be added before its occludees. It culls when
+it is registered itself, after the active camera was updated, and keeps the
+occluded nodes invisible until the transparent effect pass. So they are not
+drawn and the shadow volume manager skips them, but they animate as before.
+
+Runs on the CPU only, so it works with every driver, the null driver too. */
+class COcclusionCuller : public ISceneNode
+{
+public:
+
+	COcclusionCuller(ISceneNode* parent, ISceneManager* mgr, s32 id=-1);
+
+	virtual ~COcclusionCuller();
+
+	//! Sets the size of the depth buffer. The width is rounded up to a multiple of 4.
+	void setResolution(u32 width, u32 height);
+
+	const core::dimension2d<u32>& getResolution() const { return Size; }
+
+	//! Adds the triangles of mesh, in the space of node, as occluder.
+	/** With maxTriangles, only the largest triangles are kept: a part of the
+	real surface hides no more than the surface, and the few largest
+	triangles of a big model cover most of what it covers. The node is
+	grabbed, an occluder removed from the scene is skipped. */
+	void addOccluder(ISceneNode* node, IMesh* mesh, u32 maxTriangles=0);
+
+	//! Adds a node to be hidden when it is occluded. The node is grabbed.
+	void addOccludee(ISceneNode* node);
+
+	//! Adds every node below root which can be hidden on its own.
+	/** These are the nodes with materials, automatic culling and no
+	children; hiding a node would hide its children too, like the light of a
+	gate. Returns the amount of nodes added. */
+	u32 addOccludees(ISceneNode* root);
+
+	//! Draws the occluders as seen by camera and tests the occludees.
+	/** drawAll() calls this, nothing is hidden by calling it directly. */
+	void cull(const ICameraSceneNode* camera);
+
+	//! Returns true if node was occluded in the last cull().
+	bool wasOccluded(const ISceneNode* node) const;
+
+	u32 getOccluderCount() const { return Occluders.size(); }
+
+	u32 getOccludeeCount() const { return Occludees.size(); }
+
+	//! Occluder triangles drawn into the buffer in the last cull().
+	u32 getLastTriangleCount() const { return LastTriangleCount; }
+
+	//! Visible occludees tested in the last cull(), none without occluders in view.
+	u32 getLastTestedCount() const { return LastTestedCount; }
+
+	//! Occludees found occluded in the last cull().
+	u32 getLastOccludedCount() const { return Occluded.size(); }
+
+	//! Time the last cull() took.
+	f64 getLastCullTimeMs() const { return LastCullTimeMs; }
+
+	virtual void OnAnimate(u32 timeMs);
+
+	virtual void OnRegisterSceneNode();
+
+	//! Shows the occluded nodes again.
+	virtual void render();
+
+	virtual const core::aabbox3d<f32>& getBoundingBox() const { return Box; }
+
+	virtual ESCENE_NODE_TYPE getType() const { return ESNT_OCCLUSION_CULLER; }
+
+private:
+
+	struct SOccluder
+	{
+		ISceneNode* Node;
+		//! 3 per triangle, in the space of the node.
+		core::array<core::vector3df> Triangles;
+		core::aabbox3df Box;
+	};
+
+	//! A vertex after the projection, x and y in pixels.
+	struct SScreenVertex
+	{
+		f32 X;
+		f32 Y;
+		//! 1/w, larger is nearer.
+		f32 Z;
+	};
+
+	//! Clips a triangle in clip space against the near plane and draws it.
+	void drawTriangle(const f32* a, const f32* b, const f32* c, f32 nearW);
+
+	void rasterize(const SScreenVertex& v0, const SScreenVertex& v1, const SScreenVertex& v2);
+
+	//! Returns true if the world space box is hidden by the buffer.
+	bool isBoxOccluded(const core::aabbox3df& box, const core::matrix4& viewProjection, f32 nearW) const;
+
+	void showOccluded();
+
+	core::array<SOccluder> Occluders;
+	core::array<ISceneNode*> Occludees;
+	//! Sorted, for wasOccluded().
+	core::array<ISceneNode*> Occluded;
+	bool Hidden;
+
+	core::dimension2d<u32> Size;
+	u8* DepthMemory;
+	//! 16 byte aligned, Size.Width * Size.Height.
+	f32* Depth;
+
+	u32 LastTriangleCount;
+	u32 LastTestedCount;
+	f64 LastCullTimeMs;
+
+	core::aabbox3df Box;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
@@ -0,0 +1,883 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CPagedTerrainSceneNode.h"
+#include "CFrameProfiler.h"
+#include "CHeightField.h"
+#include "CThreadPool.h"
+#include "PreciseTimer.h"
+#include <math.h>
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+// largest tile side, so a tile with skirts fits 16 bit indices
+const u32 MaxTileQuads = 128;
+
+// tiles are dropped this much farther away than they are loaded, so moving
+// back and forth over a border does not load and drop the same tiles
+const f32 UnloadDistanceFactor = 1.25f;
+
+bool isOutsideFrustum(const core::aabbox3df& box, const SViewFrustum& frustum)
+{
+	// the planes point out of the frustum; the box is outside if even its
+	// corner farthest behind one plane is in front of it
+	for (u32 i=0; i<SViewFrustum::VF_PLANE_COUNT; ++i)
+	{
+		const core::plane3df& plane = frustum.planes[i];
+		const core::vector3df corner(
+			plane.Normal.X < 0.f ? box.MaxEdge.X : box.MinEdge.X,
+			plane.Normal.Y < 0.f ? box.MaxEdge.Y : box.MinEdge.Y,
+			plane.Normal.Z < 0.f ? box.MaxEdge.Z : box.MinEdge.Z);
+		if (plane.getDistanceTo(corner) > 0.f)
+			return true;
+	}
+	return false;
+}
+
+} // end anonymous namespace
+
+
+//! Returns the full resolution triangles of the resident tiles.
+class CPagedTerrainTriangleSelector : public ITriangleSelector
+{
+public:
+
+	CPagedTerrainTriangleSelector(CPagedTerrainSceneNode* node)
+		: Node(node)
+	{
+		#ifdef _DEBUG
+		setDebugName("CPagedTerrainTriangleSelector");
+		#endif
+	}
+
+	virtual s32 getTriangleCount() const
+	{
+		return Node->Resident.size() * Node->TileQuads * Node->TileQuads * 2;
+	}
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::matrix4* transform=0) const
+	{
+		outTriangleCount = 0;
+		addTriangles(Node->Box, triangles, arraySize, outTriangleCount, transform);
+	}
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::aabbox3d<f32>& box,
+		const core::matrix4* transform=0) const
+	{
+		outTriangleCount = 0;
+		addTriangles(getLocalBox(box), triangles, arraySize, outTriangleCount, transform);
+	}
+
+	virtual void getTriangles(core::triangle3df* triangles, s32 arraySize,
+		s32& outTriangleCount, const core::line3d<f32>& line,
+		const core::matrix4* transform=0) const
+	{
+		outTriangleCount = 0;
+		core::aabbox3df box(line.start);
+		box.addInternalPoint(line.end);
+		addTriangles(getLocalBox(box), triangles, arraySize, outTriangleCount, transform);
+	}
+
+	virtual ISceneNode* getSceneNodeForTriangle(u32 triangleIndex) const
+	{
+		return Node;
+	}
+
+	virtual u32 getSelectorCount() const
+	{
+		return 1;
+	}
+
+	virtual ITriangleSelector* getSelector(u32 index)
+	{
+		return index ? 0 : this;
+	}
+
+	virtual const ITriangleSelector* getSelector(u32 index) const
+	{
+		return index ? 0 : this;
+	}
+
+private:
+
+	core::aabbox3df getLocalBox(const core::aabbox3df& box) const
+	{
+		core::aabbox3df local(box);
+		core::matrix4 inverse;
+		if (Node->getAbsoluteTransformation().getInverse(inverse))
+			inverse.transformBoxEx(local);
+		return local;
+	}
+
+	// Adds the triangles of the grid cells of the resident tiles which
+	// overlap box, a box relative to the node.
+	void addTriangles(const core::aabbox3df& box, core::triangle3df* triangles,
+		s32 arraySize, s32& outTriangleCount, const core::matrix4* transform) const
+	{
+		core::matrix4 mat;
+		if (transform)
+			mat = *transform;
+		mat *= Node->getAbsoluteTransformation();
+
+		const s32 lastX = (s32)Node->Columns - 2;
+		const s32 lastZ = (s32)Node->Rows - 2;
+		const s32 x0 = core::max_((s32)floorf(box.MinEdge.X), 0);
+		const s32 z0 = core::max_((s32)floorf(box.MinEdge.Z), 0);
+		const s32 x1 = core::min_((s32)floorf(box.MaxEdge.X), lastX);
+		const s32 z1 = core::min_((s32)floorf(box.MaxEdge.Z), lastZ);
+		if (x0 > x1 || z0 > z1)
+			return;
+
+		const u32 quads = Node->TileQuads;
+		const u32 side = quads + 1;
+		const u32 tilesX = (Node->Columns - 2) / quads + 1;
+
+		for (s32 z=z0; z<=z1; ++z)
+		{
+			for (s32 x=x0; x<=x1; ++x)
+			{
+				const CPagedTerrainSceneNode::STile& tile = Node->Tiles[(z / quads) * tilesX + x / quads];
+				if (!tile.Buffer)
+					continue;
+
+				const video::S3DVertex2TCoords* v = tile.Buffer->Vertices.const_pointer() +
+					(z - tile.Z) * side + (x - tile.X);
+				const core::vector3df& a = v[0].Pos;
+				const core::vector3df& b = v[1].Pos;
+				const core::vector3df& c = v[side].Pos;
+				const core::vector3df& d = v[side + 1].Pos;
+
+				const f32 minY = core::min_(core::min_(a.Y, b.Y), core::min_(c.Y, d.Y));
+				const f32 maxY = core::max_(core::max_(a.Y, b.Y), core::max_(c.Y, d.Y));
+				if (maxY < box.MinEdge.Y || minY > box.MaxEdge.Y)
+					continue;
+
+				if (outTriangleCount + 2 > arraySize)
+					return;
+
+				core::triangle3df* t = triangles + outTriangleCount;
+				t[0].set(a, c, b);
+				t[1].set(b, c, d);
+				for (u32 i=0; i<2; ++i)
+				{
+					mat.transformVect(t[i].pointA);
+					mat.transformVect(t[i].pointB);
+					mat.transformVect(t[i].pointC);
+				}
+				outTriangleCount += 2;
+			}
+		}
+	}
+
+	// the node owns no reference to the selector, so the selector must not
+	// own one to the node either. It is only used while the node lives.
+	CPagedTerrainSceneNode* Node;
+};
+
+
+CPagedTerrainSceneNode::CPagedTerrainSceneNode(const io::path& heightMapFileName,
+	ISceneNode* parent, ISceneManager* mgr, s32 id,
+	const core::vector3df& position, const core::vector3df& rotation,
+	const core::vector3df& scale, video::SColor vertexColor,
+	s32 maxLOD, u32 tileSize, s32 smoothFactor)
+	: ISceneNode(parent, mgr, id, position, rotation, scale), HeightField(0),
+	Columns(0), Rows(0), TileQuads(2), LODCount(1), Loader(0),
+	VertexColor(vertexColor), TextureScale(1.f), TextureScale2(1.f),
+	LoadDistance(0.f), LODTolerance(0.005f), MaxUploadsPerFrame(2), MaxPendingTiles(8),
+	StreamedTileCount(0), LastDrawnTileCount(0), LastStreamTimeMs(0.0)
+{
+	#ifdef _DEBUG
+	setDebugName("CPagedTerrainSceneNode");
+	#endif
+
+	HeightField = new CHeightField(SceneManager->getVideoDriver(),
+		SceneManager->getFileSystem(), heightMapFileName, smoothFactor);
+	init(maxLOD, tileSize);
+}
+
+
+CPagedTerrainSceneNode::CPagedTerrainSceneNode(CHeightField* heightField,
+	ISceneNode* parent, ISceneManager* mgr, s32 id,
+	const core::vector3df& position, const core::vector3df& rotation,
+	const core::vector3df& scale, video::SColor vertexColor,
+	s32 maxLOD, u32 tileSize)
+	: ISceneNode(parent, mgr, id, position, rotation, scale), HeightField(heightField),
+	Columns(0), Rows(0), TileQuads(2), LODCount(1), Loader(0),
+	VertexColor(vertexColor), TextureScale(1.f), TextureScale2(1.f),
+	LoadDistance(0.f), LODTolerance(0.005f), MaxUploadsPerFrame(2), MaxPendingTiles(8),
+	StreamedTileCount(0), LastDrawnTileCount(0), LastStreamTimeMs(0.0)
+{
+	#ifdef _DEBUG
+	setDebugName("CPagedTerrainSceneNode");
+	#endif
+
+	HeightField->grab();
+	init(maxLOD, tileSize);
+}
+
+
+void CPagedTerrainSceneNode::init(s32 maxLOD, u32 tileSize)
+{
+	Columns = HeightField->getColumns();
+	Rows = HeightField->getRows();
+
+	// isValid() tells the caller
+	if (Columns < 2 || Rows < 2)
+	{
+		Box.reset(0,0,0);
+		return;
+	}
+
+	// the tile side is a power of two, so every LOD halves it evenly
+	while (TileQuads < core::min_(tileSize, MaxTileQuads))
+		TileQuads <<= 1;
+	while (LODCount < (u32)core::max_(maxLOD, 1) && (1u << LODCount) <= TileQuads)
+		++LODCount;
+
+	const u32 tilesX = (Columns - 2) / TileQuads + 1;
+	const u32 tilesZ = (Rows - 2) / TileQuads + 1;
+	Tiles.set_used(tilesX * tilesZ);
+	for (u32 z=0; z<tilesZ; ++z)
+	{
+		for (u32 x=0; x<tilesX; ++x)
+		{
+			STile& tile = Tiles[z * tilesX + x];
+			tile.X = x * TileQuads;
+			tile.Z = z * TileQuads;
+			tile.Buffer = 0;
+			tile.Job = 0;
+			tile.LOD = -1;
+			for (u32 l=0; l<MAX_LODS; ++l)
+				tile.Error[l] = 0.f;
+		}
+	}
+
+	// index buffers of all LODs: the grid with every step-th vertex, then
+	// the skirts hanging down from the edges
+	const u32 side = TileQuads + 1;
+	const u32 skirts = side * side;
+	for (u32 l=0; l<LODCount; ++l)
+	{
+		const u32 step = 1 << l;
+		core::array<u16>& indices = LODIndices[l];
+		const u32 quads = TileQuads / step;
+		indices.reallocate(quads * quads * 6 + quads * 4 * 6);
+
+		for (u32 z=0; z<TileQuads; z+=step)
+		{
+			for (u32 x=0; x<TileQuads; x+=step)
+			{
+				const u16 a = (u16)(z * side + x);
+				const u16 b = (u16)(a + step);
+				const u16 c = (u16)(a + step * side);
+				const u16 d = (u16)(c + step);
+				indices.push_back(a);
+				indices.push_back(c);
+				indices.push_back(b);
+				indices.push_back(b);
+				indices.push_back(c);
+				indices.push_back(d);
+			}
+		}
+
+		for (u32 i=0; i<TileQuads; i+=step)
+		{
+			// the grid vertices of the edge at i and i+step, in the order of the skirts
+			const u16 edges[4][2] =
+			{
+				{ (u16)i, (u16)(i + step) },
+				{ (u16)(TileQuads * side + i), (u16)(TileQuads * side + i + step) },
+				{ (u16)(i * side), (u16)((i + step) * side) },
+				{ (u16)(i * side + TileQuads), (u16)((i + step) * side + TileQuads) }
+			};
+
+			for (u32 e=0; e<4; ++e)
+			{
+				const u16 skirtA = (u16)(skirts + e * side + i);
+				const u16 skirtB = (u16)(skirtA + step);
+				indices.push_back(edges[e][0]);
+				indices.push_back(edges[e][1]);
+				indices.push_back(skirtA);
+				indices.push_back(edges[e][1]);
+				indices.push_back(skirtB);
+				indices.push_back(skirtA);
+			}
+		}
+	}
+
+	Box.reset(0.f, HeightField->getMinHeight(), 0.f);
+	Box.addInternalPoint((f32)(Columns - 1), HeightField->getMaxHeight(), (f32)(Rows - 1));
+
+	Loader = new CThreadPool(1);
+}
+
+
+CPagedTerrainSceneNode::~CPagedTerrainSceneNode()
+{
+	// cancel everything still queued, then wait for the worker
+	for (u32 i=0; i<Pending.size(); ++i)
+		Pending[i]->Cancelled = true;
+	delete Loader;
+
+	for (u32 i=0; i<Pending.size(); ++i)
+		delete Pending[i];
+
+	for (u32 i=0; i<Tiles.size(); ++i)
+		if (Tiles[i].Buffer)
+			Tiles[i].Buffer->drop();
+
+	HeightField->drop();
+}
+
+
+void CPagedTerrainSceneNode::scaleTexture(f32 resolution, f32 resolution2)
+{
+	TextureScale = resolution;
+	TextureScale2 = resolution2 != 0.f ? resolution2 : resolution;
+
+	// jobs with the old coordinates stay cancelled, even when streaming
+	// wants their tiles again; the tiles are requested again once they
+	// are done
+	for (u32 i=0; i<Pending.size(); ++i)
+	{
+		Pending[i]->Superseded = true;
+		Pending[i]->Cancelled = true;
+	}
+
+	// the resident tiles are built again and keep their old buffer until
+	// the new one is uploaded
+	const core::vector3df scale = AbsoluteTransformation.getScale();
+	for (u32 i=0; i<Resident.size(); ++i)
+		queueTile(Resident[i], scale);
+}
+
+
+void CPagedTerrainSceneNode::preload(const core::vector3df& position)
+{
+	if (!isValid())
+		return;
+
+	updateAbsolutePosition();
+
+	core::vector3df local(position);
+	core::matrix4 inverse;
+	if (AbsoluteTransformation.getInverse(inverse))
+		inverse.transformVect(local);
+
+	const ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	const f32 distance = LoadDistance > 0.f ? LoadDistance : (camera ? camera->getFarValue() : 0.f);
+	updateStreaming(local, distance / AbsoluteTransformation.getScale().X, true);
+
+	Loader->waitForAll();
+	collectBuiltTiles(Pending.size());
+	updateLODs(position);
+}
+
+
+ITriangleSelector* CPagedTerrainSceneNode::createTriangleSelector()
+{
+	return new CPagedTerrainTriangleSelector(this);
+}
+
+
+IMesh* CPagedTerrainSceneNode::createOccluderMesh(u32 cellSamples) const
+{
+	if (!isValid())
+		return 0;
+
+	const u32 lastX = Columns - 1;
+	const u32 lastZ = Rows - 1;
+
+	// coarser until the grid fits 16 bit indices
+	u32 step = core::max_(cellSamples, 1u);
+	while ((lastX / step + 2) * (lastZ / step + 2) > 65535)
+		step *= 2;
+
+	core::array<u32> gridX;
+	for (u32 x=0; x<lastX; x+=step)
+		gridX.push_back(x);
+	gridX.push_back(lastX);
+
+	core::array<u32> gridZ;
+	for (u32 z=0; z<lastZ; z+=step)
+		gridZ.push_back(z);
+	gridZ.push_back(lastZ);
+
+	SMeshBuffer* buffer = new SMeshBuffer();
+	buffer->Vertices.reallocate(gridX.size() * gridZ.size());
+	for (u32 j=0; j<gridZ.size(); ++j)
+	{
+		const u32 z0 = gridZ[j ? j - 1 : j];
+		const u32 z1 = gridZ[core::min_(j + 1, gridZ.size() - 1)];
+		for (u32 i=0; i<gridX.size(); ++i)
+		{
+			const u32 x0 = gridX[i ? i - 1 : i];
+			const u32 x1 = gridX[core::min_(i + 1, gridX.size() - 1)];
+
+			// the surface of every cell touching the vertex is above it
+			f32 height = getSample(x0, z0);
+			for (u32 z=z0; z<=z1; ++z)
+				for (u32 x=x0; x<=x1; ++x)
+					height = core::min_(height, getSample(x, z));
+
+			video::S3DVertex vertex;
+			vertex.Pos.set((f32)gridX[i], height, (f32)gridZ[j]);
+			buffer->Vertices.push_back(vertex);
+		}
+	}
+
+	const u32 pitch = gridX.size();
+	for (u32 j=0; j+1<gridZ.size(); ++j)
+	{
+		for (u32 i=0; i+1<gridX.size(); ++i)
+		{
+			const u16 corner = (u16)(j * pitch + i);
+			buffer->Indices.push_back(corner);
+			buffer->Indices.push_back((u16)(corner + pitch));
+			buffer->Indices.push_back((u16)(corner + 1));
+			buffer->Indices.push_back((u16)(corner + 1));
+			buffer->Indices.push_back((u16)(corner + pitch));
+			buffer->Indices.push_back((u16)(corner + pitch + 1));
+		}
+	}
+	buffer->recalculateBoundingBox();
+
+	SMesh* mesh = new SMesh();
+	mesh->addMeshBuffer(buffer);
+	mesh->recalculateBoundingBox();
+	buffer->drop();
+	return mesh;
+}
+
+
+u32 CPagedTerrainSceneNode::getResidentBytes() const
+{
+	u32 bytes = 0;
+	for (u32 i=0; i<Resident.size(); ++i)
+	{
+		const SMeshBufferLightMap* mb = Tiles[Resident[i]].Buffer;
+		bytes += mb->Vertices.size() * sizeof(video::S3DVertex2TCoords) + mb->Indices.size() * sizeof(u16);
+	}
+	return bytes;
+}
+
+
+f32 CPagedTerrainSceneNode::getSample(u32 x, u32 z) const
+{
+	return HeightField->getSample(x, z);
+}
+
+
+void CPagedTerrainSceneNode::buildJob(void* data)
+{
+	STileJob* job = (STileJob*)data;
+	if (!job->Cancelled)
+	{
+		job->Node->buildTile(*job);
+		job->Built = true;
+	}
+	job->Done = true;
+}
+
+
+void CPagedTerrainSceneNode::buildTile(STileJob& job) const
+{
+	const u32 side = TileQuads + 1;
+	const u32 lastX = Columns - 1;
+	const u32 lastZ = Rows - 1;
+
+	// samples beyond the end of the map repeat the last one, the cells
+	// there are flat and never reached by the selector
+	core::array<f32> heights;
+	heights.set_used(side * side);
+	for (u32 j=0; j<side; ++j)
+		for (u32 i=0; i<side; ++i)
+			heights[j * side + i] = getSample(core::min_(job.X + i, lastX), core::min_(job.Z + j, lastZ));
+
+	// normals from the neighbouring samples, scaled like the node
+	const f32 slopeX = job.Scale.Y / job.Scale.X;
+	const f32 slopeZ = job.Scale.Y / job.Scale.Z;
+
+	job.Vertices.set_used(side * side + 4 * side);
+	video::S3DVertex2TCoords* v = job.Vertices.pointer();
+
+	for (u32 j=0; j<side; ++j)
+	{
+		for (u32 i=0; i<side; ++i, ++v)
+		{
+			const u32 x = core::min_(job.X + i, lastX);
+			const u32 z = core::min_(job.Z + j, lastZ);
+			const u32 left = x ? x - 1 : x;
+			const u32 right = core::min_(x + 1, lastX);
+			const u32 back = z ? z - 1 : z;
+			const u32 front = core::min_(z + 1, lastZ);
+
+			const f32 dx = right != left ? (getSample(right, z) - getSample(left, z)) / (right - left) : 0.f;
+			const f32 dz = front != back ? (getSample(x, front) - getSample(x, back)) / (front - back) : 0.f;
+
+			v->Pos.set((f32)x, heights[j * side + i], (f32)z);
+			v->Normal.set(-dx * slopeX, 1.f, -dz * slopeZ);
+			v->Normal.normalize();
+			v->Color = VertexColor;
+
+			// same texture coordinates as Irrlicht's terrain
+			const f32 u = 1.f - (f32)x / lastX;
+			const f32 w = (f32)z / lastZ;
+			v->TCoords.set(u * job.TextureScale, w * job.TextureScale);
+			v->TCoords2.set(u * job.TextureScale2, w * job.TextureScale2);
+		}
+	}
+
+	// error of every LOD: how far the full resolution surface is from the
+	// bilinear surface through the samples the LOD keeps
+	job.Error[0] = 0.f;
+	for (u32 l=1; l<MAX_LODS; ++l)
+	{
+		job.Error[l] = job.Error[l-1];
+		if (l >= LODCount)
+			continue;
+
+		const u32 step = 1 << l;
+		const f32 invStep = 1.f / step;
+		for (u32 j=0; j<side; ++j)
+		{
+			const u32 j0 = (j / step) * step;
+			const u32 j1 = core::min_(j0 + step, TileQuads);
+			const f32 fz = (j - j0) * invStep;
+
+			for (u32 i=0; i<side; ++i)
+			{
+				const u32 i0 = (i / step) * step;
+				const u32 i1 = core::min_(i0 + step, TileQuads);
+				const f32 fx = (i - i0) * invStep;
+
+				const f32 h0 = core::lerp(heights[j0 * side + i0], heights[j0 * side + i1], fx);
+				const f32 h1 = core::lerp(heights[j1 * side + i0], heights[j1 * side + i1], fx);
+				const f32 error = core::abs_(heights[j * side + i] - core::lerp(h0, h1, fz));
+				job.Error[l] = core::max_(job.Error[l], error);
+			}
+		}
+	}
+
+	// skirts, deep enough to cover the gap to a neighbour at any LOD
+	const f32 skirtDepth = job.Error[MAX_LODS - 1] + 1.f;
+	const video::S3DVertex2TCoords* grid = job.Vertices.const_pointer();
+	for (u32 i=0; i<side; ++i)
+	{
+		const u32 edges[4] = { i, TileQuads * side + i, i * side, i * side + TileQuads };
+		for (u32 e=0; e<4; ++e)
+		{
+			video::S3DVertex2TCoords& skirt = job.Vertices[side * side + e * side + i];
+			skirt = grid[edges[e]];
+			skirt.Pos.Y -= skirtDepth;
+		}
+	}
+
+	job.MinHeight = heights[0];
+	job.MaxHeight = heights[0];
+	for (u32 i=1; i<heights.size(); ++i)
+	{
+		job.MinHeight = core::min_(job.MinHeight, heights[i]);
+		job.MaxHeight = core::max_(job.MaxHeight, heights[i]);
+	}
+	job.MinHeight -= skirtDepth;
+}
+
+
+f32 CPagedTerrainSceneNode::getTileDistance(const STile& tile, const core::vector3df& position) const
+{
+	const f32 dx = core::max_(tile.X - position.X, position.X - (tile.X + TileQuads), 0.f);
+	const f32 dz = core::max_(tile.Z - position.Z, position.Z - (tile.Z + TileQuads), 0.f);
+	return sqrtf(dx * dx + dz * dz);
+}
+
+
+void CPagedTerrainSceneNode::updateStreaming(const core::vector3df& position, f32 radius, bool preloading)
+{
+	const f32 unloadRadius = radius * UnloadDistanceFactor + TileQuads;
+
+	for (u32 i=Resident.size(); i--; )
+	{
+		if (getTileDistance(Tiles[Resident[i]], position) > unloadRadius)
+		{
+			unloadTile(Resident[i]);
+			Resident[i] = Resident.getLast();
+			Resident.erase(Resident.size() - 1);
+		}
+	}
+
+	// jobs of tiles which are wanted again are not cancelled any more; if
+	// the worker skipped one already, the tile is requested again later
+	for (u32 i=0; i<Pending.size(); ++i)
+		Pending[i]->Cancelled = Pending[i]->Superseded || getTileDistance(Tiles[Pending[i]->Tile], position) > unloadRadius;
+
+	const u32 freeSlots = MaxPendingTiles > Pending.size() ? MaxPendingTiles - Pending.size() : 0;
+	if (!preloading && !freeSlots)
+		return;
+
+	// the tiles in reach which are neither resident nor being built
+	const u32 tilesX = (Columns - 2) / TileQuads + 1;
+	const u32 tilesZ = Tiles.size() / tilesX;
+	const s32 x0 = core::max_((s32)floorf((position.X - radius) / TileQuads), 0);
+	const s32 z0 = core::max_((s32)floorf((position.Z - radius) / TileQuads), 0);
+	const s32 x1 = core::min_((s32)floorf((position.X + radius) / TileQuads), (s32)tilesX - 1);
+	const s32 z1 = core::min_((s32)floorf((position.Z + radius) / TileQuads), (s32)tilesZ - 1);
+
+	Candidates.set_used(0);
+	for (s32 z=z0; z<=z1; ++z)
+	{
+		for (s32 x=x0; x<=x1; ++x)
+		{
+			const u32 index = z * tilesX + x;
+			const STile& tile = Tiles[index];
+			if (tile.Buffer || tile.Job)
+				continue;
+
+			SCandidate candidate;
+			candidate.Tile = index;
+			candidate.Distance = getTileDistance(tile, position);
+			if (candidate.Distance <= radius)
+				Candidates.push_back(candidate);
+		}
+	}
+
+	// nearest first, and only as many as keep the queue short, so a fast
+	// camera does not leave a queue of tiles it has already passed
+	Candidates.sort();
+	const u32 count = preloading ? Candidates.size() : core::min_(Candidates.size(), freeSlots);
+	const core::vector3df scale = AbsoluteTransformation.getScale();
+
+	for (u32 i=0; i<count; ++i)
+		queueTile(Candidates[i].Tile, scale);
+}
+
+
+void CPagedTerrainSceneNode::queueTile(u32 index, const core::vector3df& scale)
+{
+	STile& tile = Tiles[index];
+
+	STileJob* job = new STileJob();
+	job->Node = this;
+	job->Tile = index;
+	job->X = tile.X;
+	job->Z = tile.Z;
+	job->Scale = scale;
+	job->TextureScale = TextureScale;
+	job->TextureScale2 = TextureScale2;
+	job->Cancelled = false;
+	job->Superseded = false;
+	job->Done = false;
+	job->Built = false;
+
+	tile.Job = job;
+	Pending.push_back(job);
+	Loader->addJob(buildJob, job);
+}
+
+
+void CPagedTerrainSceneNode::collectBuiltTiles(u32 maxUploads)
+{
+	u32 uploads = 0;
+
+	for (u32 i=0; i<Pending.size(); )
+	{
+		STileJob* job = Pending[i];
+		if (!job->Done)
+		{
+			++i;
+			continue;
+		}
+
+		const bool wanted = job->Built && !job->Cancelled;
+		if (wanted && uploads == maxUploads)
+		{
+			// next frame
+			++i;
+			continue;
+		}
+
+		STile& tile = Tiles[job->Tile];
+		if (wanted)
+		{
+			// a rebuilt tile replaces its old buffer and stays resident
+			const bool rebuilt = tile.Buffer != 0;
+			if (rebuilt)
+				unloadTile(job->Tile);
+
+			SMeshBufferLightMap* mb = new SMeshBufferLightMap();
+			mb->Vertices = job->Vertices;
+			mb->BoundingBox.reset((f32)tile.X, job->MinHeight, (f32)tile.Z);
+			mb->BoundingBox.addInternalPoint((f32)(tile.X + TileQuads), job->MaxHeight, (f32)(tile.Z + TileQuads));
+			mb->setHardwareMappingHint(EHM_STATIC, EBT_VERTEX);
+			mb->setHardwareMappingHint(EHM_DYNAMIC, EBT_INDEX);
+
+			tile.Buffer = mb;
+			tile.LOD = -1;
+			for (u32 l=0; l<MAX_LODS; ++l)
+				tile.Error[l] = job->Error[l];
+			tile.WorldBox = mb->BoundingBox;
+			AbsoluteTransformation.transformBoxEx(tile.WorldBox);
+
+			if (!rebuilt)
+				Resident.push_back(job->Tile);
+			++StreamedTileCount;
+			++uploads;
+		}
+
+		// a superseded job may already have been replaced by a new one
+		if (tile.Job == job)
+			tile.Job = 0;
+		delete job;
+		Pending[i] = Pending.getLast();
+		Pending.erase(Pending.size() - 1);
+	}
+}
+
+
+void CPagedTerrainSceneNode::unloadTile(u32 index)
+{
+	STile& tile = Tiles[index];
+	SceneManager->getVideoDriver()->removeHardwareBuffer(tile.Buffer);
+	tile.Buffer->drop();
+	tile.Buffer = 0;
+	tile.LOD = -1;
+}
+
+
+void CPagedTerrainSceneNode::updateLODs(const core::vector3df& cameraPosition)
+{
+	const f32 scaleY = core::abs_(AbsoluteTransformation.getScale().Y);
+
+	for (u32 i=0; i<Resident.size(); ++i)
+	{
+		STile& tile = Tiles[Resident[i]];
+
+		const core::vector3df nearest(
+			core::clamp(cameraPosition.X, tile.WorldBox.MinEdge.X, tile.WorldBox.MaxEdge.X),
+			core::clamp(cameraPosition.Y, tile.WorldBox.MinEdge.Y, tile.WorldBox.MaxEdge.Y),
+			core::clamp(cameraPosition.Z, tile.WorldBox.MinEdge.Z, tile.WorldBox.MaxEdge.Z));
+		const f32 allowed = LODTolerance * nearest.getDistanceFrom(cameraPosition);
+
+		s32 lod = 0;
+		while (lod + 1 < (s32)LODCount && tile.Error[lod + 1] * scaleY <= allowed)
+			++lod;
+
+		if (lod != tile.LOD)
+		{
+			tile.Buffer->Indices = LODIndices[lod];
+			tile.Buffer->setDirty(EBT_INDEX);
+			tile.LOD = lod;
+		}
+	}
+}
+
+
+void CPagedTerrainSceneNode::OnRegisterSceneNode()
+{
+	if (IsVisible && Resident.size())
+		SceneManager->registerNodeForRendering(this, ESNRP_SOLID);
+
+	ISceneNode::OnRegisterSceneNode();
+}
+
+
+void CPagedTerrainSceneNode::OnAnimate(u32 timeMs)
+{
+	ISceneNode::OnAnimate(timeMs);
+
+	const ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	if (!IsVisible || !isValid() || !camera)
+		return;
+
+	const f64 start = getPreciseTimeMs();
+
+	collectBuiltTiles(MaxUploadsPerFrame);
+
+	const core::vector3df cameraPosition = camera->getAbsolutePosition();
+	core::vector3df local(cameraPosition);
+	core::matrix4 inverse;
+	if (AbsoluteTransformation.getInverse(inverse))
+		inverse.transformVect(local);
+
+	const f32 distance = LoadDistance > 0.f ? LoadDistance : camera->getFarValue();
+	updateStreaming(local, distance / AbsoluteTransformation.getScale().X, false);
+	updateLODs(cameraPosition);
+
+	const f64 end = getPreciseTimeMs();
+	LastStreamTimeMs = end - start;
+	CFrameProfiler::report("terrain_lod", start, end);
+}
+
+
+void CPagedTerrainSceneNode::render()
+{
+	const ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	if (!camera)
+		return;
+
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+	driver->setTransform(video::ETS_WORLD, AbsoluteTransformation);
+	driver->setMaterial(Material);
+
+	const SViewFrustum* frustum = camera->getViewFrustum();
+	LastDrawnTileCount = 0;
+	for (u32 i=0; i<Resident.size(); ++i)
+	{
+		const STile& tile = Tiles[Resident[i]];
+		if (isOutsideFrustum(tile.WorldBox, *frustum))
+			continue;
+
+		driver->drawMeshBuffer(tile.Buffer);
+		++LastDrawnTileCount;
+	}
+
+	if (DebugDataVisible & EDS_BBOX)
+	{
+		video::SMaterial debugMaterial;
+		debugMaterial.Lighting = false;
+		driver->setMaterial(debugMaterial);
+		for (u32 i=0; i<Resident.size(); ++i)
+			driver->draw3DBox(Tiles[Resident[i]].Buffer->BoundingBox, video::SColor(255,255,255,255));
+	}
+}
+
+
+void CPagedTerrainSceneNode::getVisibleTiles(const SViewFrustum& frustum, core::array<IMeshBuffer*>& outBuffers) const
+{
+	for (u32 i=0; i<Resident.size(); ++i)
+	{
+		const STile& tile = Tiles[Resident[i]];
+		if (!isOutsideFrustum(tile.WorldBox, frustum))
+			outBuffers.push_back(tile.Buffer);
+	}
+}
+
+
+const core::aabbox3d<f32>& CPagedTerrainSceneNode::getBoundingBox() const
+{
+	return Box;
+}
+
+
+u32 CPagedTerrainSceneNode::getMaterialCount() const
+{
+	return 1;
+}
+
+
+video::SMaterial& CPagedTerrainSceneNode::getMaterial(u32 i)
+{
+	return Material;
+}
+
+} // end namespace scene
+} // end namespace irr
@@ -0,0 +1,259 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_PAGED_TERRAIN_SCENE_NODE_H_INCLUDED__
+#define __C_PAGED_TERRAIN_SCENE_NODE_H_INCLUDED__
+
+#include <irrlicht.h>
+#include <atomic>
+
+namespace irr
+{
+
+class CThreadPool;
+
+namespace scene
+{
+
+class CHeightField;
+
+//! Type of the paged terrain scene node.
+const ESCENE_NODE_TYPE ESNT_PAGED_TERRAIN = (ESCENE_NODE_TYPE)MAKE_IRR_ID('p','t','e','r');
+
+//! Terrain which only keeps the tiles around the camera in memory.
+/** Irrlicht's terrain scene node builds one vertex buffer for the whole
+height map and recalculates the LOD and the index buffer of every patch on
+the main thread whenever the camera moves. That limits it to small height
+maps. This node splits the height map into square tiles:
+
+- Tiles within the load distance of the active camera are built on a
+  background thread and handed to the main thread, a few per frame, so
+  crossing a tile border never builds geometry on the render thread.
+  Tiles farther away than the load distance are dropped again.
+- The worker also measures how far the surface of a tile is off at every
+  LOD. The main thread picks the coarsest LOD whose error is small for the
+  distance of the tile. The index buffers of the LODs are built once and
+  shared by all tiles; skirts hide the cracks between tiles of different
+  LOD, so no tile depends on its neighbours.
+
+The heights come from a CHeightField, see there for the file formats. A
+field loaded once can be passed to several terrains, and to the collision
+of worlds which do not draw the terrain at all.
+
+The triangle selector of createTriangleSelector() returns the full
+resolution triangles of the resident tiles only. */
+class CPagedTerrainSceneNode : public ISceneNode
+{
+public:
+
+	//! Opens the height map, with the parameters of addTerrainSceneNode().
+	/** \param tileSize Quads per tile side, a power of two up to 128.
+	\param smoothFactor Smoothing passes, only done for images. */
+	CPagedTerrainSceneNode(const io::path& heightMapFileName,
+		ISceneNode* parent, ISceneManager* mgr, s32 id=-1,
+		const core::vector3df& position = core::vector3df(0.0f,0.0f,0.0f),
+		const core::vector3df& rotation = core::vector3df(0.0f,0.0f,0.0f),
+		const core::vector3df& scale = core::vector3df(1.0f,1.0f,1.0f),
+		video::SColor vertexColor = video::SColor(255,255,255,255),
+		s32 maxLOD=5, u32 tileSize=64, s32 smoothFactor=0);
+
+	//! Uses an already loaded height field, which is grabbed.
+	CPagedTerrainSceneNode(CHeightField* heightField,
+		ISceneNode* parent, ISceneManager* mgr, s32 id=-1,
+		const core::vector3df& position = core::vector3df(0.0f,0.0f,0.0f),
+		const core::vector3df& rotation = core::vector3df(0.0f,0.0f,0.0f),
+		const core::vector3df& scale = core::vector3df(1.0f,1.0f,1.0f),
+		video::SColor vertexColor = video::SColor(255,255,255,255),
+		s32 maxLOD=5, u32 tileSize=64);
+
+	virtual ~CPagedTerrainSceneNode();
+
+	//! Returns false if the height map could not be loaded.
+	bool isValid() const { return Tiles.size() != 0; }
+
+	CHeightField* getHeightField() const { return HeightField; }
+
+	//! Scales the texture coordinates like ITerrainSceneNode::scaleTexture(). Rebuilds the resident tiles.
+	void scaleTexture(f32 resolution=1.0f, f32 resolution2=0.0f);
+
+	//! Sets the distance around the camera in which tiles are loaded, 0 for the camera's far value.
+	void setLoadDistance(f32 distance) { LoadDistance = distance; }
+
+	//! Sets how much error a LOD may have per unit of distance to the camera.
+	void setLODTolerance(f32 tolerance) { LODTolerance = tolerance; }
+
+	//! Sets how many built tiles are made resident per frame at most.
+	void setMaxUploadsPerFrame(u32 count) { MaxUploadsPerFrame = core::max_(count, 1u); }
+
+	//! Loads all tiles around a world position and waits for them.
+	/** For the start of a level, so the first frames have no holes. */
+	void preload(const core::vector3df& position);
+
+	//! Creates a selector returning the triangles of the resident tiles.
+	/** The selector does not keep the node, it must not outlive it. */
+	ITriangleSelector* createTriangleSelector();
+
+	//! Creates a coarse mesh of the whole map which stays below the surface.
+	/** For occlusion culling: a vertex every cellSamples samples, as low as
+	the lowest sample of the cells around it, in the space of the tiles. The
+	coarse LODs of far tiles can still cut a little below it. Reads the
+	whole height map once. */
+	IMesh* createOccluderMesh(u32 cellSamples) const;
+
+	u32 getTileCount() const { return Tiles.size(); }
+
+	u32 getResidentTileCount() const { return Resident.size(); }
+
+	//! Amount of tiles queued or being built.
+	u32 getPendingTileCount() const { return Pending.size(); }
+
+	//! Memory of the vertices and indices of the resident tiles.
+	u32 getResidentBytes() const;
+
+	//! Amount of tiles made resident, since the start.
+	u32 getStreamedTileCount() const { return StreamedTileCount; }
+
+	//! Adds the buffers of the resident tiles within frustum, in the space of the node.
+	/** What render() draws, for renderers which do not go through the driver. */
+	void getVisibleTiles(const SViewFrustum& frustum, core::array<IMeshBuffer*>& outBuffers) const;
+
+	//! Amount of tiles drawn in the last render().
+	u32 getLastDrawnTileCount() const { return LastDrawnTileCount; }
+
+	//! Time the main thread spent on streaming and LODs in the last frame.
+	f64 getLastStreamTimeMs() const { return LastStreamTimeMs; }
+
+	virtual void OnRegisterSceneNode();
+
+	virtual void OnAnimate(u32 timeMs);
+
+	virtual void render();
+
+	virtual const core::aabbox3d<f32>& getBoundingBox() const;
+
+	virtual u32 getMaterialCount() const;
+
+	virtual video::SMaterial& getMaterial(u32 i);
+
+	virtual ESCENE_NODE_TYPE getType() const { return ESNT_PAGED_TERRAIN; }
+
+private:
+
+	friend class CPagedTerrainTriangleSelector;
+
+	enum { MAX_LODS = 8 };
+
+	//! A tile built on the worker.
+	struct STileJob
+	{
+		CPagedTerrainSceneNode* Node;
+		u32 Tile;
+		//! First sample of the tile.
+		u32 X;
+		u32 Z;
+		//! Parameters at the time of the request.
+		core::vector3df Scale;
+		f32 TextureScale;
+		f32 TextureScale2;
+
+		//! Set by the main thread when the tile is not wanted any more.
+		std::atomic<bool> Cancelled;
+		//! Set by the main thread when the parameters changed. Keeps the job cancelled.
+		bool Superseded;
+		//! Set by the worker when it is done with the job, built or not.
+		std::atomic<bool> Done;
+		//! Set by the worker before Done if the fields below are valid.
+		bool Built;
+
+		//! The grid row by row, then the skirts of the 4 edges.
+		core::array<video::S3DVertex2TCoords> Vertices;
+		//! Largest height difference to the full resolution per LOD.
+		f32 Error[MAX_LODS];
+		f32 MinHeight;
+		f32 MaxHeight;
+	};
+
+	struct STile
+	{
+		u32 X;
+		u32 Z;
+		//! 0 while the tile is not resident.
+		SMeshBufferLightMap* Buffer;
+		//! 0 while the tile is not being built.
+		STileJob* Job;
+		f32 Error[MAX_LODS];
+		s32 LOD;
+		core::aabbox3df WorldBox;
+	};
+
+	struct SCandidate
+	{
+		u32 Tile;
+		f32 Distance;
+		bool operator<(const SCandidate& other) const { return Distance < other.Distance; }
+	};
+
+	//! Sets up the tiles and LODs for HeightField. Called by the constructors.
+	void init(s32 maxLOD, u32 tileSize);
+
+	static void buildJob(void* data);
+
+	//! Builds the vertices and errors of a tile. Runs on the worker.
+	void buildTile(STileJob& job) const;
+
+	//! Height at a sample, in the orientation of Irrlicht's terrain.
+	f32 getSample(u32 x, u32 z) const;
+
+	//! Distance in samples from a position relative to the node to a tile, in X and Z.
+	f32 getTileDistance(const STile& tile, const core::vector3df& position) const;
+
+	//! Queues a job which builds a tile with the current parameters.
+	void queueTile(u32 index, const core::vector3df& scale);
+
+	//! Requests the tiles within radius samples and drops those farther away.
+	void updateStreaming(const core::vector3df& position, f32 radius, bool preloading);
+
+	//! Makes up to maxUploads built tiles resident and deletes finished jobs.
+	void collectBuiltTiles(u32 maxUploads);
+
+	void unloadTile(u32 tile);
+
+	void updateLODs(const core::vector3df& cameraPosition);
+
+	CHeightField* HeightField;
+	u32 Columns;
+	u32 Rows;
+
+	u32 TileQuads;
+	u32 LODCount;
+	core::array<STile> Tiles;
+	//! Index buffer of every LOD, shared by all tiles.
+	core::array<u16> LODIndices[MAX_LODS];
+
+	//! Indices of the resident tiles.
+	core::array<u32> Resident;
+	core::array<STileJob*> Pending;
+	core::array<SCandidate> Candidates;
+	CThreadPool* Loader;
+
+	video::SColor VertexColor;
+	f32 TextureScale;
+	f32 TextureScale2;
+	f32 LoadDistance;
+	f32 LODTolerance;
+	u32 MaxUploadsPerFrame;
+	u32 MaxPendingTiles;
+
+	u32 StreamedTileCount;
+	u32 LastDrawnTileCount;
+	f64 LastStreamTimeMs;
+
+	video::SMaterial Material;
+	core::aabbox3df Box;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
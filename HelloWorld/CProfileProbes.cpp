@@ -0,0 +1,107 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CProfileProbes.h"
+#include "CFrameProfiler.h"
+
+namespace irr
+{
+namespace scene
+{
+
+CProfileProbeSceneNode::CProfileProbeSceneNode(ISceneNode* parent, ISceneManager* mgr, s32 id)
+	: ISceneNode(parent, mgr, id), AnimateStartMs(0.0)
+{
+	#ifdef _DEBUG
+	setDebugName("CProfileProbeSceneNode");
+	#endif
+
+	// never drawn, and never in view
+	setAutomaticCulling(EAC_OFF);
+}
+
+
+void CProfileProbeSceneNode::OnAnimate(u32 timeMs)
+{
+	// simulation ticks animate as well, only the last animation before
+	// registering is drawAll()'s
+	AnimateStartMs = CFrameProfiler::getActive() ? getPreciseTimeMs() : 0.0;
+
+	ISceneNode::OnAnimate(timeMs);
+}
+
+
+void CProfileProbeSceneNode::OnRegisterSceneNode()
+{
+	if (AnimateStartMs > 0.0)
+		CFrameProfiler::report("animators", AnimateStartMs, getPreciseTimeMs());
+	AnimateStartMs = 0.0;
+
+	ISceneNode::OnRegisterSceneNode();
+}
+
+
+CSceneNodeAnimatorProfileMarker::CSceneNodeAnimatorProfileMarker(const c8* name, CSceneNodeAnimatorProfileMarker* begin)
+	: Name(name), Begin(begin), StartMs(0.0)
+{
+	#ifdef _DEBUG
+	setDebugName("CSceneNodeAnimatorProfileMarker");
+	#endif
+
+	if (Begin)
+		Begin->grab();
+}
+
+
+CSceneNodeAnimatorProfileMarker::~CSceneNodeAnimatorProfileMarker()
+{
+	if (Begin)
+		Begin->drop();
+}
+
+
+void CSceneNodeAnimatorProfileMarker::animateNode(ISceneNode* node, u32 timeMs)
+{
+	if (!Begin)
+	{
+		StartMs = CFrameProfiler::getActive() ? getPreciseTimeMs() : 0.0;
+		return;
+	}
+
+	if (Begin->StartMs > 0.0)
+		CFrameProfiler::report(Name, Begin->StartMs, getPreciseTimeMs());
+	Begin->StartMs = 0.0;
+}
+
+
+CProfileProbeSceneNode* addProfileProbe(ISceneManager* smgr)
+{
+	if (!CFrameProfiler::getActive())
+		return 0;
+
+	CProfileProbeSceneNode* probe = new CProfileProbeSceneNode(smgr->getRootSceneNode(), smgr);
+	probe->drop(); // the root node keeps it
+	return probe;
+}
+
+
+void addProfiledAnimator(ISceneNode* node, ISceneNodeAnimator* animator, const c8* name)
+{
+	if (!CFrameProfiler::getActive())
+	{
+		node->addAnimator(animator);
+		return;
+	}
+
+	CSceneNodeAnimatorProfileMarker* begin = new CSceneNodeAnimatorProfileMarker(name);
+	CSceneNodeAnimatorProfileMarker* end = new CSceneNodeAnimatorProfileMarker(name, begin);
+	node->addAnimator(begin);
+	node->addAnimator(animator);
+	node->addAnimator(end);
+	begin->drop();
+	end->drop();
+}
+
+} // end namespace scene
+} // end namespace irr
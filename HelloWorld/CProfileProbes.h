@@ -0,0 +1,87 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_PROFILE_PROBES_H_INCLUDED__
+#define __C_PROFILE_PROBES_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Type of the profile probe scene node.
+const ESCENE_NODE_TYPE ESNT_PROFILE_PROBE = (ESCENE_NODE_TYPE)MAKE_IRR_ID('p','r','f','p');
+
+//! Type of the profile marker animators.
+const ESCENE_NODE_ANIMATOR_TYPE ESNAT_PROFILE_MARKER = (ESCENE_NODE_ANIMATOR_TYPE)MAKE_IRR_ID('p','r','f','m');
+
+//! Reports how long drawAll() spends on the animators, as the phase "animators".
+/** drawAll() first animates the whole scene graph and then lets it
+register for rendering, both times children in the order they were added.
+As the first child of the root node, the probe is the first node animated
+and the first registered, so the time between the two is what all
+animators took. Add it with addProfileProbe() before any other node. */
+class CProfileProbeSceneNode : public ISceneNode
+{
+public:
+
+	CProfileProbeSceneNode(ISceneNode* parent, ISceneManager* mgr, s32 id=-1);
+
+	virtual void OnAnimate(u32 timeMs);
+
+	virtual void OnRegisterSceneNode();
+
+	virtual void render() {}
+
+	virtual const core::aabbox3d<f32>& getBoundingBox() const { return Box; }
+
+	virtual ESCENE_NODE_TYPE getType() const { return ESNT_PROFILE_PROBE; }
+
+private:
+
+	core::aabbox3df Box;
+	f64 AnimateStartMs;
+};
+
+
+//! Marks where a profiled animator starts or ends in the animators of a node.
+/** Created in pairs by addProfiledAnimator(). The animator between them
+keeps its own type, so code looking for it, like the FPS camera looking
+for the collision response to jump, still finds it. */
+class CSceneNodeAnimatorProfileMarker : public ISceneNodeAnimator
+{
+public:
+
+	//! A start marker without begin, else the end marker of begin.
+	CSceneNodeAnimatorProfileMarker(const c8* name, CSceneNodeAnimatorProfileMarker* begin=0);
+
+	virtual ~CSceneNodeAnimatorProfileMarker();
+
+	virtual void animateNode(ISceneNode* node, u32 timeMs);
+
+	virtual ISceneNodeAnimator* createClone(ISceneNode* node, ISceneManager* newManager=0) { return 0; }
+
+	virtual ESCENE_NODE_ANIMATOR_TYPE getType() const { return ESNAT_PROFILE_MARKER; }
+
+private:
+
+	const c8* Name;
+	CSceneNodeAnimatorProfileMarker* Begin;
+	f64 StartMs;
+};
+
+
+//! Adds the probe as the first child of the root node, returns 0 without an active profiler.
+CProfileProbeSceneNode* addProfileProbe(ISceneManager* smgr);
+
+//! Adds animator to node, reported as the phase name when a profiler is active.
+/** name must stay valid as long as the node, like a string literal. */
+void addProfiledAnimator(ISceneNode* node, ISceneNodeAnimator* animator, const c8* name);
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
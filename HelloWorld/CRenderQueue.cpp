@@ -0,0 +1,317 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CRenderQueue.h"
+#include "CFrameProfiler.h"
+#include "CLodMeshSceneNode.h"
+#include "PreciseTimer.h"
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+//! Packs the flags two materials of the same type and textures most often differ in.
+u32 getMaterialState(const video::SMaterial& material)
+{
+	return (material.Lighting ? 1 : 0) |
+		(material.ZWriteEnable ? 2 : 0) |
+		(material.BackfaceCulling ? 4 : 0) |
+		(material.FrontfaceCulling ? 8 : 0) |
+		(material.FogEnable ? 16 : 0) |
+		(material.NormalizeNormals ? 32 : 0) |
+		(material.GouraudShading ? 64 : 0) |
+		(material.Wireframe ? 128 : 0) |
+		((u32)material.ZBuffer << 8);
+}
+
+} // end anonymous namespace
+
+
+bool CRenderQueue::SItem::operator<(const SItem& other) const
+{
+	if (Material->MaterialType != other.Material->MaterialType)
+		return Material->MaterialType < other.Material->MaterialType;
+
+	for (u32 t=0; t<video::MATERIAL_MAX_TEXTURES; ++t)
+	{
+		const video::ITexture* texture = Material->getTexture(t);
+		const video::ITexture* otherTexture = other.Material->getTexture(t);
+		if (texture != otherTexture)
+			return texture < otherTexture;
+	}
+
+	if (State != other.State)
+		return State < other.State;
+
+	// front to back
+	return Depth < other.Depth;
+}
+
+
+CRenderQueue::CRenderQueue(ISceneNode* parent, ISceneManager* mgr, s32 id)
+	: ISceneNode(parent, mgr, id), Hidden(false), LightManager(0), LastDrawTimeMs(0.0)
+{
+	#ifdef _DEBUG
+	setDebugName("CRenderQueue");
+	#endif
+
+	// draws the buffers wherever they are, and has to show the nodes again
+	setAutomaticCulling(EAC_OFF);
+}
+
+
+CRenderQueue::~CRenderQueue()
+{
+	showNodes();
+
+	for (u32 i=0; i<Nodes.size(); ++i)
+		Nodes[i]->drop();
+}
+
+
+IMesh* CRenderQueue::getMesh(ISceneNode* node) const
+{
+	switch (node->getType())
+	{
+	case ESNT_MESH:
+	case ESNT_CUBE:
+	case ESNT_SPHERE:
+		return ((IMeshSceneNode*)node)->getMesh();
+	case ESNT_ANIMATED_MESH:
+		{
+			// an animated mesh changes its buffers in render()
+			IAnimatedMesh* mesh = ((IAnimatedMeshSceneNode*)node)->getMesh();
+			if (!mesh || mesh->getFrameCount() > 1 || mesh->getMeshType() == EAMT_SKINNED)
+				return 0;
+			return mesh->getMesh(0);
+		}
+	default:
+		break;
+	}
+
+	if (node->getType() == ESNT_LOD_MESH)
+		return ((CLodMeshSceneNode*)node)->getCurrentMesh();
+
+	return 0;
+}
+
+
+const video::SMaterial& CRenderQueue::getMaterial(ISceneNode* node, IMesh* mesh, u32 b) const
+{
+	bool readOnly = false;
+	if (node->getType() == ESNT_ANIMATED_MESH)
+		readOnly = ((IAnimatedMeshSceneNode*)node)->isReadOnlyMaterials();
+	else if (node->getType() != ESNT_LOD_MESH)
+		readOnly = ((IMeshSceneNode*)node)->isReadOnlyMaterials();
+
+	if (readOnly || b >= node->getMaterialCount())
+		return mesh->getMeshBuffer(b)->getMaterial();
+
+	return node->getMaterial(b);
+}
+
+
+bool CRenderQueue::addNode(ISceneNode* node)
+{
+	if (node == this || !node->getChildren().empty())
+		return false;
+
+	IMesh* mesh = getMesh(node);
+	if (!mesh)
+		return false;
+
+	// the transparent buffers are sorted back to front by drawAll()
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+	for (u32 b=0; b<mesh->getMeshBufferCount(); ++b)
+	{
+		video::IMaterialRenderer* renderer = driver->getMaterialRenderer(getMaterial(node, mesh, b).MaterialType);
+		if (renderer && renderer->isTransparent())
+			return false;
+	}
+
+	node->grab();
+	Nodes.push_back(node);
+	return true;
+}
+
+
+u32 CRenderQueue::addNodes(ISceneNode* root)
+{
+	u32 added = 0;
+	const core::list<ISceneNode*>& children = root->getChildren();
+	for (core::list<ISceneNode*>::ConstIterator it = children.begin(); it != children.end(); ++it)
+	{
+		ISceneNode* node = *it;
+		if (!node->getChildren().empty())
+			added += addNodes(node);
+		else if (Nodes.linear_search(node) == -1 && addNode(node))
+			++added;
+	}
+	return added;
+}
+
+
+void CRenderQueue::countStats(SRenderQueueStats& stats) const
+{
+	stats = SRenderQueueStats();
+
+	const ISceneNode* lastNode = 0;
+	const video::SMaterial* last = 0;
+	for (u32 i=0; i<Items.size(); ++i)
+	{
+		const SItem& item = Items[i];
+		if (item.Node != lastNode)
+		{
+			++stats.TransformChanges;
+			lastNode = item.Node;
+		}
+
+		const video::SMaterial& material = *item.Material;
+		if (!last || material != *last)
+		{
+			++stats.MaterialSwitches;
+			if (!last || material.MaterialType != last->MaterialType)
+				++stats.ShaderSwitches;
+
+			for (u32 t=0; t<video::MATERIAL_MAX_TEXTURES; ++t)
+			{
+				const video::ITexture* texture = material.getTexture(t);
+				if (texture && (!last || texture != last->getTexture(t)))
+					++stats.TextureBinds;
+			}
+			last = item.Material;
+		}
+
+		++stats.DrawCalls;
+	}
+}
+
+
+void CRenderQueue::showNodes()
+{
+	if (!Hidden)
+		return;
+
+	for (u32 i=0; i<Drawn.size(); ++i)
+		Drawn[i]->setVisible(true);
+	Hidden = false;
+}
+
+
+void CRenderQueue::OnAnimate(u32 timeMs)
+{
+	// in case drawAll() did not get to the solid pass
+	showNodes();
+
+	ISceneNode::OnAnimate(timeMs);
+}
+
+
+void CRenderQueue::OnRegisterSceneNode()
+{
+	showNodes();
+	Drawn.set_used(0);
+	Items.set_used(0);
+
+	const ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	if (IsVisible && camera && Nodes.size())
+	{
+		const core::vector3df cameraPosition = camera->getAbsolutePosition();
+		for (u32 i=0; i<Nodes.size(); ++i)
+		{
+			ISceneNode* node = Nodes[i];
+			if (!node->getParent() || !node->isTrulyVisible() || SceneManager->isCulled(node))
+				continue;
+
+			// what its own registration would have done
+			if (node->getType() == ESNT_LOD_MESH)
+				((CLodMeshSceneNode*)node)->updateLevel();
+
+			IMesh* mesh = getMesh(node);
+			if (!mesh)
+				continue;
+
+			SItem item;
+			item.Node = node;
+			item.Depth = node->getTransformedBoundingBox().getCenter().getDistanceFromSQ(cameraPosition);
+			for (u32 b=0; b<mesh->getMeshBufferCount(); ++b)
+			{
+				item.Buffer = mesh->getMeshBuffer(b);
+				if (!item.Buffer->getIndexCount())
+					continue;
+
+				item.Material = &getMaterial(node, mesh, b);
+				item.State = getMaterialState(*item.Material);
+				Items.push_back(item);
+			}
+
+			node->setVisible(false);
+			Drawn.push_back(node);
+		}
+
+		if (Drawn.size())
+		{
+			Hidden = true;
+			SceneManager->registerNodeForRendering(this, ESNRP_SOLID);
+		}
+	}
+
+	ISceneNode::OnRegisterSceneNode();
+}
+
+
+void CRenderQueue::render()
+{
+	MARS_PROFILE_SCOPE("render_queue");
+	const f64 start = getPreciseTimeMs();
+
+	countStats(LastUnsortedStats);
+	Items.sort();
+	countStats(LastStats);
+
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+	ISceneNode* lastNode = 0;
+	ISceneNode* litNode = 0;
+	const video::SMaterial* last = 0;
+	for (u32 i=0; i<Items.size(); ++i)
+	{
+		const SItem& item = Items[i];
+		if (item.Node != lastNode)
+		{
+			driver->setTransform(video::ETS_WORLD, item.Node->getAbsoluteTransformation());
+			lastNode = item.Node;
+		}
+
+		if (LightManager && item.Material->Lighting && item.Node != litNode)
+		{
+			if (litNode)
+				LightManager->OnNodePostRender(litNode);
+			LightManager->OnNodePreRender(item.Node);
+			litNode = item.Node;
+		}
+
+		if (!last || *item.Material != *last)
+		{
+			driver->setMaterial(*item.Material);
+			last = item.Material;
+		}
+
+		driver->drawMeshBuffer(item.Buffer);
+	}
+
+	if (litNode)
+		LightManager->OnNodePostRender(litNode);
+
+	Items.set_used(0);
+	showNodes();
+
+	LastDrawTimeMs = getPreciseTimeMs() - start;
+}
+
+} // end namespace scene
+} // end namespace irr
@@ -0,0 +1,146 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_RENDER_QUEUE_H_INCLUDED__
+#define __C_RENDER_QUEUE_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Type of the render queue scene node.
+const ESCENE_NODE_TYPE ESNT_RENDER_QUEUE = (ESCENE_NODE_TYPE)MAKE_IRR_ID('r','n','d','q');
+
+//! State changes and draw calls of one frame of the render queue.
+struct SRenderQueueStats
+{
+	SRenderQueueStats()
+		: DrawCalls(0), MaterialSwitches(0), ShaderSwitches(0), TextureBinds(0), TransformChanges(0)
+	{
+	}
+
+	u32 DrawCalls;
+	//! Calls to setMaterial() with a material other than the one before.
+	u32 MaterialSwitches;
+	//! Changes of the material type.
+	u32 ShaderSwitches;
+	//! Texture layers which got another texture.
+	u32 TextureBinds;
+	//! Changes of the world transformation.
+	u32 TransformChanges;
+};
+
+//! Draws the solid mesh buffers of many nodes sorted by their state.
+/** Irrlicht sorts the solid nodes by their first texture only, and draws
+all buffers of a node after another, so the terrain, the cubes and the ships
+switch materials and textures for almost every buffer. The queue takes over
+drawing the nodes added to it:
+
+- When the queue is registered, it hides its nodes which are visible and
+  not culled, so they are not registered, and collects their mesh buffers.
+- In the solid pass, it sorts the buffers by material type, textures and
+  the rest of the material, and within the same state front to back, so
+  the depth test rejects more pixels. Each run of buffers with the same
+  state is drawn after one setMaterial(); then it shows the nodes again.
+- The light manager picks the lights for each lit node, when the node
+  changes within the sorted buffers.
+
+It counts the draw calls and state changes of the sorted order, and what
+the buffers in the order the nodes were added would have cost.
+
+Like the occlusion culler, the queue has to be added before its nodes.
+Nodes the culler or the impostor manager hid are skipped, so it has to be
+added after those. Hidden nodes are shown again before the shadow pass, so
+they still cast shadows. */
+class CRenderQueue : public ISceneNode
+{
+public:
+
+	CRenderQueue(ISceneNode* parent, ISceneManager* mgr, s32 id=-1);
+
+	virtual ~CRenderQueue();
+
+	//! Sets the light manager to pick lights for the lit nodes, may be 0.
+	void setLightManager(ILightManager* lightManager) { LightManager = lightManager; }
+
+	//! Adds a node to be drawn by the queue. The node is grabbed.
+	/** \return False if the queue can not draw it: only mesh, cube, sphere
+	and level of detail nodes and animated mesh nodes of static meshes
+	with only solid materials and no children are drawn. */
+	bool addNode(ISceneNode* node);
+
+	//! Adds every node below root the queue can draw, returns the amount of nodes added.
+	u32 addNodes(ISceneNode* root);
+
+	u32 getNodeCount() const { return Nodes.size(); }
+
+	//! Statistics of the last frame, in the sorted order.
+	const SRenderQueueStats& getLastStats() const { return LastStats; }
+
+	//! Statistics the last frame would have had in the order the nodes were added.
+	const SRenderQueueStats& getLastUnsortedStats() const { return LastUnsortedStats; }
+
+	//! Time sorting and drawing took in the last frame.
+	f64 getLastDrawTimeMs() const { return LastDrawTimeMs; }
+
+	virtual void OnAnimate(u32 timeMs);
+
+	//! Collects the buffers and hides their nodes.
+	virtual void OnRegisterSceneNode();
+
+	//! Sorts and draws the buffers, and shows the nodes again.
+	virtual void render();
+
+	virtual const core::aabbox3d<f32>& getBoundingBox() const { return Box; }
+
+	virtual ESCENE_NODE_TYPE getType() const { return ESNT_RENDER_QUEUE; }
+
+private:
+
+	struct SItem
+	{
+		ISceneNode* Node;
+		IMeshBuffer* Buffer;
+		const video::SMaterial* Material;
+		//! Flags of the material which are not compared one by one.
+		u32 State;
+		//! Squared distance of the node to the camera.
+		f32 Depth;
+
+		bool operator<(const SItem& other) const;
+	};
+
+	//! Returns the mesh to draw for node, 0 if there is none.
+	IMesh* getMesh(ISceneNode* node) const;
+
+	//! Returns the material buffer b of node is drawn with.
+	const video::SMaterial& getMaterial(ISceneNode* node, IMesh* mesh, u32 b) const;
+
+	//! Counts the state changes of drawing the items in their order.
+	void countStats(SRenderQueueStats& stats) const;
+
+	void showNodes();
+
+	core::array<ISceneNode*> Nodes;
+	//! Nodes hidden for the frame.
+	core::array<ISceneNode*> Drawn;
+	bool Hidden;
+
+	core::array<SItem> Items;
+	ILightManager* LightManager;
+
+	SRenderQueueStats LastStats;
+	SRenderQueueStats LastUnsortedStats;
+	f64 LastDrawTimeMs;
+
+	core::aabbox3d<f32> Box;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
@@ -0,0 +1,498 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CShadowVolumeManager.h"
+#include "CCubeFieldSceneNode.h"
+#include "CFrameProfiler.h"
+#include "PreciseTimer.h"
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+// a light closer than this to where it was, in object space, keeps the volume
+const f32 LightTolerance = 0.01f;
+
+struct SWeldVertex
+{
+	core::vector3df Position;
+	u32 Index;
+
+	bool operator<(const SWeldVertex& other) const
+	{
+		if (Position.X != other.Position.X)
+			return Position.X < other.Position.X;
+		if (Position.Y != other.Position.Y)
+			return Position.Y < other.Position.Y;
+		return Position.Z < other.Position.Z;
+	}
+};
+
+struct SEdgeEntry
+{
+	//! Smaller vertex index in the high, larger in the low 32 bits.
+	u64 Key;
+	//! Triangle * 3 + edge of the triangle.
+	u32 Slot;
+
+	bool operator<(const SEdgeEntry& other) const { return Key < other.Key; }
+};
+
+void getMeshGeometry(const IMesh* mesh, core::array<core::vector3df>& positions, core::array<u32>& indices)
+{
+	for (u32 b=0; b<mesh->getMeshBufferCount(); ++b)
+	{
+		const IMeshBuffer* mb = mesh->getMeshBuffer(b);
+		const u32 base = positions.size();
+
+		for (u32 i=0; i<mb->getVertexCount(); ++i)
+			positions.push_back(mb->getPosition(i));
+
+		if (mb->getIndexType() == video::EIT_32BIT)
+		{
+			const u32* source = (const u32*)mb->getIndices();
+			for (u32 i=0; i<mb->getIndexCount(); ++i)
+				indices.push_back(base + source[i]);
+		}
+		else
+		{
+			const u16* source = mb->getIndices();
+			for (u32 i=0; i<mb->getIndexCount(); ++i)
+				indices.push_back(base + source[i]);
+		}
+	}
+}
+
+} // end anonymous namespace
+
+
+CShadowVolumeManager::CShadowVolumeManager(ISceneNode* parent, ISceneManager* mgr, s32 id)
+	: ISceneNode(parent, mgr, id), Budget(0), MaxDistance(0.f), Infinity(10000.f),
+	ZFailMethod(true), LastFrameTimeMs(0.0), LastCasterCount(0), VolumeHits(0),
+	SilhouetteHits(0), Rebuilds(0)
+{
+	#ifdef _DEBUG
+	setDebugName("CShadowVolumeManager");
+	#endif
+
+	// the volumes can be anywhere, the node is never culled
+	setAutomaticCulling(EAC_OFF);
+	Box.reset(0,0,0);
+}
+
+
+CShadowVolumeManager::~CShadowVolumeManager()
+{
+	for (u32 i=0; i<Casters.size(); ++i)
+		Casters[i].Node->drop();
+
+	for (u32 i=0; i<Meshes.size(); ++i)
+		delete Meshes[i];
+}
+
+
+void CShadowVolumeManager::addCaster(ISceneNode* node, IMesh* mesh)
+{
+	if (!node || !mesh)
+		return;
+
+	SShadowMesh* shadowMesh = 0;
+	for (u32 i=0; i<Meshes.size() && !shadowMesh; ++i)
+		if (Meshes[i]->Key == mesh)
+			shadowMesh = Meshes[i];
+
+	if (!shadowMesh)
+	{
+		core::array<core::vector3df> positions;
+		core::array<u32> indices;
+		getMeshGeometry(mesh, positions, indices);
+		shadowMesh = getShadowMesh(mesh, positions, indices);
+	}
+
+	SCaster caster;
+	caster.Node = node;
+	caster.Field = 0;
+	caster.Instance = 0;
+	caster.Mesh = shadowMesh;
+	Casters.push_back(caster);
+	node->grab();
+}
+
+
+void CShadowVolumeManager::addCubeField(CCubeFieldSceneNode* field)
+{
+	if (!field || !field->getInstanceCount())
+		return;
+
+	core::array<core::vector3df> positions;
+	core::array<u16> fieldIndices;
+	field->getInstanceGeometry(positions, fieldIndices);
+
+	core::array<u32> indices;
+	indices.reallocate(fieldIndices.size());
+	for (u32 i=0; i<fieldIndices.size(); ++i)
+		indices.push_back(fieldIndices[i]);
+
+	SShadowMesh* shadowMesh = getShadowMesh(field, positions, indices);
+
+	for (u32 i=0; i<field->getInstanceCount(); ++i)
+	{
+		SCaster caster;
+		caster.Node = field;
+		caster.Field = field;
+		caster.Instance = i;
+		caster.Mesh = shadowMesh;
+		Casters.push_back(caster);
+		field->grab();
+	}
+}
+
+
+void CShadowVolumeManager::setVolumeParameters(f32 infinity, bool zfailMethod)
+{
+	Infinity = infinity;
+	ZFailMethod = zfailMethod;
+
+	for (u32 i=0; i<Casters.size(); ++i)
+		for (u32 l=0; l<Casters[i].Volumes.size(); ++l)
+			Casters[i].Volumes[l].Valid = false;
+}
+
+
+CShadowVolumeManager::SShadowMesh* CShadowVolumeManager::getShadowMesh(const void* key,
+	const core::array<core::vector3df>& positions, const core::array<u32>& indices)
+{
+	for (u32 i=0; i<Meshes.size(); ++i)
+		if (Meshes[i]->Key == key)
+			return Meshes[i];
+
+	SShadowMesh* mesh = new SShadowMesh();
+	mesh->Key = key;
+	Meshes.push_back(mesh);
+
+	// weld equal positions, mesh buffers duplicate the vertices at every
+	// seam and the neighbours are only found across shared vertices
+	core::array<SWeldVertex> sorted;
+	sorted.set_used(positions.size());
+	for (u32 i=0; i<positions.size(); ++i)
+	{
+		sorted[i].Position = positions[i];
+		sorted[i].Index = i;
+	}
+	sorted.sort();
+
+	core::array<u32> remap;
+	remap.set_used(positions.size());
+	for (u32 i=0; i<sorted.size(); ++i)
+	{
+		if (!i || sorted[i].Position != sorted[i-1].Position)
+			mesh->Positions.push_back(sorted[i].Position);
+		remap[sorted[i].Index] = mesh->Positions.size() - 1;
+	}
+
+	// degenerate triangles have no facing and are left out
+	for (u32 i=0; i+2<indices.size(); i+=3)
+	{
+		const u32 a = remap[indices[i]], b = remap[indices[i+1]], c = remap[indices[i+2]];
+		if (a == b || b == c || c == a)
+			continue;
+		mesh->Indices.push_back(a);
+		mesh->Indices.push_back(b);
+		mesh->Indices.push_back(c);
+	}
+
+	// pair every edge with the edge running the other way in another triangle
+	const u32 triangleCount = mesh->Indices.size() / 3;
+	core::array<SEdgeEntry> edges;
+	edges.set_used(triangleCount * 3);
+	for (u32 i=0; i<edges.size(); ++i)
+	{
+		const u32 a = mesh->Indices[i];
+		const u32 b = mesh->Indices[i % 3 == 2 ? i - 2 : i + 1];
+		edges[i].Key = ((u64)core::min_(a, b) << 32) | core::max_(a, b);
+		edges[i].Slot = i;
+	}
+	edges.sort();
+
+	mesh->Adjacency.set_used(triangleCount * 3);
+	for (u32 i=0; i<mesh->Adjacency.size(); ++i)
+		mesh->Adjacency[i] = i / 3;
+
+	for (u32 i=0; i+1<edges.size(); )
+	{
+		if (edges[i].Key == edges[i+1].Key &&
+			mesh->Indices[edges[i].Slot] != mesh->Indices[edges[i+1].Slot])
+		{
+			mesh->Adjacency[edges[i].Slot] = edges[i+1].Slot / 3;
+			mesh->Adjacency[edges[i+1].Slot] = edges[i].Slot / 3;
+			i += 2;
+		}
+		else
+			++i;
+	}
+
+	core::aabbox3df box;
+	if (mesh->Positions.size())
+		box.reset(mesh->Positions[0]);
+	else
+		box.reset(0,0,0);
+	for (u32 i=1; i<mesh->Positions.size(); ++i)
+		box.addInternalPoint(mesh->Positions[i]);
+
+	mesh->Center = box.getCenter();
+	mesh->Radius = box.getExtent().getLength() * 0.5f;
+	return mesh;
+}
+
+
+core::matrix4 CShadowVolumeManager::getCasterTransformation(const SCaster& caster) const
+{
+	if (caster.Field)
+		return caster.Field->getAbsoluteTransformation() * caster.Field->getInstanceTransformation(caster.Instance);
+
+	return caster.Node->getAbsoluteTransformation();
+}
+
+
+void CShadowVolumeManager::gatherLights()
+{
+	LightNodes.set_used(0);
+	SceneManager->getSceneNodesFromType(ESNT_LIGHT, LightNodes);
+
+	Lights.set_used(0);
+	for (u32 i=0; i<LightNodes.size(); ++i)
+	{
+		const ILightSceneNode* light = (const ILightSceneNode*)LightNodes[i];
+		if (!light->isTrulyVisible() || !light->getLightData().CastShadows)
+			continue;
+
+		SLight l;
+		l.Position = light->getAbsolutePosition();
+		l.RangeSQ = light->getLightData().Radius * light->getLightData().Radius * 4.f;
+		Lights.push_back(l);
+	}
+}
+
+
+void CShadowVolumeManager::OnRegisterSceneNode()
+{
+	if (IsVisible && Casters.size())
+		SceneManager->registerNodeForRendering(this, ESNRP_SHADOW);
+
+	ISceneNode::OnRegisterSceneNode();
+}
+
+
+void CShadowVolumeManager::render()
+{
+	const f64 start = getPreciseTimeMs();
+
+	gatherLights();
+	const ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	const core::vector3df cameraPosition = camera ? camera->getAbsolutePosition() : core::vector3df();
+	const f32 maxDistance = MaxDistance > 0.f ? MaxDistance : (camera ? camera->getFarValue() : 0.f);
+
+	// casters near enough to the camera and to a light
+	Candidates.set_used(0);
+	for (u32 i=0; i<Casters.size(); ++i)
+	{
+		const SCaster& caster = Casters[i];
+		if (!caster.Node->getParent() || !caster.Node->isTrulyVisible())
+			continue;
+
+		const core::matrix4 mat = getCasterTransformation(caster);
+		core::vector3df center = caster.Mesh->Center;
+		mat.transformVect(center);
+		const core::vector3df scale = mat.getScale();
+		const f32 radius = caster.Mesh->Radius * core::max_(scale.X, scale.Y, scale.Z);
+
+		const f32 distance = center.getDistanceFrom(cameraPosition);
+		if (maxDistance > 0.f && distance - radius > maxDistance)
+			continue;
+
+		bool lit = false;
+		for (u32 l=0; l<Lights.size() && !lit; ++l)
+			lit = (Lights[l].Position - center).getLengthSQ() <= Lights[l].RangeSQ;
+		if (!lit)
+			continue;
+
+		SCandidate candidate;
+		candidate.Caster = i;
+		candidate.DistanceSQ = distance * distance;
+		Candidates.push_back(candidate);
+	}
+
+	if (Budget && Candidates.size() > Budget)
+	{
+		Candidates.sort();
+		Candidates.set_used(Budget);
+	}
+
+	FrameTriangles.set_used(0);
+	for (u32 c=0; c<Candidates.size(); ++c)
+	{
+		SCaster& caster = Casters[Candidates[c].Caster];
+		const core::matrix4 mat = getCasterTransformation(caster);
+		core::matrix4 inverse;
+		if (!mat.getInverse(inverse))
+			continue;
+
+		core::vector3df center = caster.Mesh->Center;
+		mat.transformVect(center);
+
+		if (caster.Volumes.size() != Lights.size())
+			caster.Volumes.set_used(Lights.size());
+
+		for (u32 l=0; l<Lights.size(); ++l)
+		{
+			if ((Lights[l].Position - center).getLengthSQ() > Lights[l].RangeSQ)
+				continue;
+
+			core::vector3df lightPosition = Lights[l].Position;
+			inverse.transformVect(lightPosition);
+
+			SLightVolume& volume = caster.Volumes[l];
+			updateVolume(*caster.Mesh, volume, lightPosition);
+
+			const u32 first = FrameTriangles.size();
+			FrameTriangles.set_used(first + volume.Triangles.size());
+			for (u32 i=0; i<volume.Triangles.size(); ++i)
+				mat.transformVect(FrameTriangles[first + i], volume.Triangles[i]);
+		}
+	}
+
+	if (FrameTriangles.size())
+	{
+		video::IVideoDriver* driver = SceneManager->getVideoDriver();
+		driver->setTransform(video::ETS_WORLD, core::IdentityMatrix);
+		driver->drawStencilShadowVolume(FrameTriangles, ZFailMethod, DebugDataVisible);
+	}
+
+	LastCasterCount = Candidates.size();
+	const f64 end = getPreciseTimeMs();
+	LastFrameTimeMs = end - start;
+	CFrameProfiler::report("shadow_volumes", start, end);
+}
+
+
+void CShadowVolumeManager::updateVolume(const SShadowMesh& mesh, SLightVolume& volume,
+	const core::vector3df& lightPosition)
+{
+	if (volume.Valid && volume.LightPosition.equals(lightPosition, LightTolerance))
+	{
+		++VolumeHits;
+		return;
+	}
+
+	const u32 triangleCount = mesh.Indices.size() / 3;
+	Facing.set_used((triangleCount + 31) / 32);
+	for (u32 i=0; i<Facing.size(); ++i)
+		Facing[i] = 0;
+
+	for (u32 t=0; t<triangleCount; ++t)
+	{
+		const core::vector3df& a = mesh.Positions[mesh.Indices[3*t]];
+		const core::vector3df& b = mesh.Positions[mesh.Indices[3*t+1]];
+		const core::vector3df& c = mesh.Positions[mesh.Indices[3*t+2]];
+		const core::vector3df normal = (b - a).crossProduct(c - a);
+		if (normal.dotProduct(lightPosition - a) >= 0.f)
+			Facing[t >> 5] |= 1u << (t & 31);
+	}
+
+	bool sameFacing = volume.Valid && volume.Facing.size() == Facing.size();
+	for (u32 i=0; sameFacing && i<Facing.size(); ++i)
+		sameFacing = volume.Facing[i] == Facing[i];
+
+	if (sameFacing)
+		++SilhouetteHits;
+	else
+	{
+		++Rebuilds;
+		volume.Facing = Facing;
+		volume.Edges.set_used(0);
+		volume.LitTriangles.set_used(0);
+
+		// an edge of a lit triangle is on the silhouette if the triangle
+		// across it is not lit or if there is none
+		for (u32 t=0; t<triangleCount; ++t)
+		{
+			if (!(Facing[t >> 5] & (1u << (t & 31))))
+				continue;
+
+			volume.LitTriangles.push_back(t);
+			for (u32 e=0; e<3; ++e)
+			{
+				const u32 other = mesh.Adjacency[3*t+e];
+				if (other == t || !(Facing[other >> 5] & (1u << (other & 31))))
+				{
+					volume.Edges.push_back(mesh.Indices[3*t+e]);
+					volume.Edges.push_back(mesh.Indices[3*t+(e+1)%3]);
+				}
+			}
+		}
+	}
+
+	extrudeVolume(mesh, volume, lightPosition);
+	volume.LightPosition = lightPosition;
+	volume.Valid = true;
+}
+
+
+void CShadowVolumeManager::extrudeVolume(const SShadowMesh& mesh, SLightVolume& volume,
+	const core::vector3df& lightPosition) const
+{
+	core::array<core::vector3df>& triangles = volume.Triangles;
+	triangles.set_used(0);
+
+	// same winding as CShadowVolumeSceneNode
+	if (ZFailMethod)
+	{
+		for (u32 i=0; i<volume.LitTriangles.size(); ++i)
+		{
+			const u32 t = volume.LitTriangles[i];
+			const core::vector3df& v0 = mesh.Positions[mesh.Indices[3*t]];
+			const core::vector3df& v1 = mesh.Positions[mesh.Indices[3*t+1]];
+			const core::vector3df& v2 = mesh.Positions[mesh.Indices[3*t+2]];
+
+			// front cap
+			triangles.push_back(v2);
+			triangles.push_back(v1);
+			triangles.push_back(v0);
+
+			// back cap
+			triangles.push_back(v0 + (v0 - lightPosition).normalize() * Infinity);
+			triangles.push_back(v1 + (v1 - lightPosition).normalize() * Infinity);
+			triangles.push_back(v2 + (v2 - lightPosition).normalize() * Infinity);
+		}
+	}
+
+	for (u32 i=0; i<volume.Edges.size(); i+=2)
+	{
+		const core::vector3df& v1 = mesh.Positions[volume.Edges[i]];
+		const core::vector3df& v2 = mesh.Positions[volume.Edges[i+1]];
+		const core::vector3df v3(v1 + (v1 - lightPosition).normalize() * Infinity);
+		const core::vector3df v4(v2 + (v2 - lightPosition).normalize() * Infinity);
+
+		triangles.push_back(v1);
+		triangles.push_back(v2);
+		triangles.push_back(v3);
+
+		triangles.push_back(v2);
+		triangles.push_back(v4);
+		triangles.push_back(v3);
+	}
+}
+
+
+const core::aabbox3d<f32>& CShadowVolumeManager::getBoundingBox() const
+{
+	return Box;
+}
+
+} // end namespace scene
+} // end namespace irr
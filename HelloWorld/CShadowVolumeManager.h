@@ -0,0 +1,191 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_SHADOW_VOLUME_MANAGER_H_INCLUDED__
+#define __C_SHADOW_VOLUME_MANAGER_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+class CCubeFieldSceneNode;
+
+//! Type of the shadow volume manager scene node.
+const ESCENE_NODE_TYPE ESNT_SHADOW_VOLUME_MANAGER = (ESCENE_NODE_TYPE)MAKE_IRR_ID('s','h','d','m');
+
+//! Builds and draws the stencil shadow volumes of all registered casters.
+/** Irrlicht's shadow volume nodes rebuild the volume of every caster for
+every shadow casting light in every frame, whether anything moved or not.
+This node replaces them for the casters added to it:
+
+- Every caster keeps the volume of each light in object space. It is only
+  built again when the light has moved relative to the caster. When it has,
+  but the same triangles still face the light, the silhouette is kept and
+  only extruded again. A cube rotating under a light keeps its silhouette
+  for most frames.
+- Casters beyond twice the radius of a light get no volume for it, the same
+  rule Irrlicht uses, and casters farther from the camera than the maximum
+  distance get none at all.
+- Only the nearest casters within the budget get volumes in a frame.
+
+All volumes of a frame are drawn with one call in the shadow pass. The
+casters are grabbed, a caster removed from the scene is skipped. */
+class CShadowVolumeManager : public ISceneNode
+{
+public:
+
+	CShadowVolumeManager(ISceneNode* parent, ISceneManager* mgr, s32 id=-1);
+
+	virtual ~CShadowVolumeManager();
+
+	//! Adds a caster with the shape of mesh and the transformation of node.
+	/** Casters with the same mesh share its edge data. */
+	void addCaster(ISceneNode* node, IMesh* mesh);
+
+	//! Adds every instance of field as its own caster.
+	void addCubeField(CCubeFieldSceneNode* field);
+
+	//! Sets the maximum amount of casters which get volumes in a frame, 0 for all.
+	void setBudget(u32 maxCasters) { Budget = maxCasters; }
+
+	u32 getBudget() const { return Budget; }
+
+	//! Sets how far from the camera a caster may be to get volumes, 0 for the camera's far value.
+	void setMaxDistance(f32 distance) { MaxDistance = distance; }
+
+	//! Sets the length volumes are extruded to and the stencil method.
+	/** Like the parameters of addShadowVolumeSceneNode(). Drops all cached volumes. */
+	void setVolumeParameters(f32 infinity, bool zfailMethod);
+
+	u32 getCasterCount() const { return Casters.size(); }
+
+	//! Time spent building and submitting the volumes of the last frame.
+	f64 getLastFrameTimeMs() const { return LastFrameTimeMs; }
+
+	//! Amount of casters which got at least one volume in the last frame.
+	u32 getLastCasterCount() const { return LastCasterCount; }
+
+	//! Volumes used as they were, since the start.
+	u32 getVolumeHitCount() const { return VolumeHits; }
+
+	//! Volumes extruded again from a kept silhouette, since the start.
+	u32 getSilhouetteHitCount() const { return SilhouetteHits; }
+
+	//! Volumes built from scratch, since the start.
+	u32 getRebuildCount() const { return Rebuilds; }
+
+	virtual void OnRegisterSceneNode();
+
+	virtual void render();
+
+	virtual const core::aabbox3d<f32>& getBoundingBox() const;
+
+	virtual ESCENE_NODE_TYPE getType() const { return ESNT_SHADOW_VOLUME_MANAGER; }
+
+private:
+
+	//! Triangles of a caster mesh with welded positions and edge neighbours.
+	struct SShadowMesh
+	{
+		//! Mesh or node the data was built from, to share it.
+		const void* Key;
+		core::array<core::vector3df> Positions;
+		//! 3 per triangle.
+		core::array<u32> Indices;
+		//! 3 per triangle, the triangle across each edge, or the triangle
+		//! itself for an open edge.
+		core::array<u32> Adjacency;
+		//! Bounding sphere in object space.
+		core::vector3df Center;
+		f32 Radius;
+	};
+
+	//! Volume of one caster for one light.
+	struct SLightVolume
+	{
+		SLightVolume() : Valid(false) {}
+
+		//! Light position in object space the volume was built for.
+		core::vector3df LightPosition;
+		//! One bit per triangle, set if it faces the light.
+		core::array<u32> Facing;
+		//! Pairs of vertex indices of the silhouette.
+		core::array<u32> Edges;
+		//! Triangles facing the light, for the caps.
+		core::array<u32> LitTriangles;
+		//! Triangles of the volume in object space.
+		core::array<core::vector3df> Triangles;
+		bool Valid;
+	};
+
+	struct SCaster
+	{
+		ISceneNode* Node;
+		//! Set for instances of a cube field.
+		CCubeFieldSceneNode* Field;
+		u32 Instance;
+		SShadowMesh* Mesh;
+		core::array<SLightVolume> Volumes;
+	};
+
+	struct SLight
+	{
+		core::vector3df Position;
+		f32 RangeSQ;
+	};
+
+	struct SCandidate
+	{
+		u32 Caster;
+		f32 DistanceSQ;
+		bool operator<(const SCandidate& other) const { return DistanceSQ < other.DistanceSQ; }
+	};
+
+	//! Returns the shared data for key, building it from positions and indices if it is new.
+	SShadowMesh* getShadowMesh(const void* key, const core::array<core::vector3df>& positions,
+		const core::array<u32>& indices);
+
+	core::matrix4 getCasterTransformation(const SCaster& caster) const;
+
+	void gatherLights();
+
+	//! Brings volume up to date for a light at lightPosition in object space.
+	void updateVolume(const SShadowMesh& mesh, SLightVolume& volume,
+		const core::vector3df& lightPosition);
+
+	void extrudeVolume(const SShadowMesh& mesh, SLightVolume& volume,
+		const core::vector3df& lightPosition) const;
+
+	core::array<SCaster> Casters;
+	core::array<SShadowMesh*> Meshes;
+	core::array<SLight> Lights;
+	core::array<SCandidate> Candidates;
+	core::array<ISceneNode*> LightNodes;
+
+	//! Volumes of all casters of the current frame in world space.
+	core::array<core::vector3df> FrameTriangles;
+	//! Facing bits of the volume being updated.
+	core::array<u32> Facing;
+
+	u32 Budget;
+	f32 MaxDistance;
+	f32 Infinity;
+	bool ZFailMethod;
+
+	f64 LastFrameTimeMs;
+	u32 LastCasterCount;
+	u32 VolumeHits;
+	u32 SilhouetteHits;
+	u32 Rebuilds;
+
+	core::aabbox3df Box;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
@@ -0,0 +1,266 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CSimulationClock.h"
+#include "CAnimationPhase.h"
+#include "CFrameProfiler.h"
+#include "PreciseTimer.h"
+
+namespace irr
+{
+
+namespace
+{
+
+// the rotation animator wraps its angles at 360, take the short way
+f32 lerpAngle(f32 from, f32 to, f32 t)
+{
+	f32 delta = fmodf(to - from, 360.f);
+	if (delta > 180.f)
+		delta -= 360.f;
+	else if (delta < -180.f)
+		delta += 360.f;
+	return from + delta * t;
+}
+
+} // end anonymous namespace
+
+
+namespace scene
+{
+
+CSceneNodeAnimatorInterpolation::CSceneNodeAnimatorInterpolation(CSimulationClock* clock)
+	: Clock(clock), Node(0), HasTick(false)
+{
+	#ifdef _DEBUG
+	setDebugName("CSceneNodeAnimatorInterpolation");
+	#endif
+
+	Clock->grab();
+	Clock->Interpolations.push_back(this);
+}
+
+
+CSceneNodeAnimatorInterpolation::~CSceneNodeAnimatorInterpolation()
+{
+	Clock->removeInterpolation(this);
+	Clock->drop();
+}
+
+
+void CSceneNodeAnimatorInterpolation::animateNode(ISceneNode* node, u32 timeMs)
+{
+	if (!node)
+		return;
+
+	if (Clock->isTicking())
+	{
+		Node = node;
+		Position[0] = HasTick ? Position[1] : node->getPosition();
+		Rotation[0] = HasTick ? Rotation[1] : node->getRotation();
+		Scale[0] = HasTick ? Scale[1] : node->getScale();
+		Position[1] = node->getPosition();
+		Rotation[1] = node->getRotation();
+		Scale[1] = node->getScale();
+		HasTick = true;
+	}
+	else if (Clock->isDrawing() && HasTick && node == Node)
+	{
+		const f32 t = Clock->getInterpolation();
+		node->setPosition(Position[0].getInterpolated(Position[1], 1.f - t));
+		node->setRotation(core::vector3df(
+			lerpAngle(Rotation[0].X, Rotation[1].X, t),
+			lerpAngle(Rotation[0].Y, Rotation[1].Y, t),
+			lerpAngle(Rotation[0].Z, Rotation[1].Z, t)));
+		node->setScale(Scale[0].getInterpolated(Scale[1], 1.f - t));
+	}
+}
+
+
+ISceneNodeAnimator* CSceneNodeAnimatorInterpolation::createClone(ISceneNode* node, ISceneManager* newManager)
+{
+	return new CSceneNodeAnimatorInterpolation(Clock);
+}
+
+
+void CSceneNodeAnimatorInterpolation::restore()
+{
+	if (!Node || !HasTick)
+		return;
+
+	// the rotation animator adds to the rotation, and the collision
+	// response of the next tick looks at the absolute transformation
+	Node->setPosition(Position[1]);
+	Node->setRotation(Rotation[1]);
+	Node->setScale(Scale[1]);
+	Node->updateAbsolutePosition();
+}
+
+} // end namespace scene
+
+
+CSimulationClock::CSimulationClock(IrrlichtDevice* device, f32 tickRate)
+	: Device(device), AnimationPhase(0), FrameMs(0), SimulationMs(0), LastRealMs(0),
+	AccumulatedMs(0), NextFrameMs(0), DroppedMs(0), LastTickTimeMs(0),
+	Interpolation(0.f), MaxTicksPerFrame(5), TickCount(0),
+	FreeRunning(false), Ticking(false), Drawing(false)
+{
+	#ifdef _DEBUG
+	setDebugName("CSimulationClock");
+	#endif
+
+	setTickRate(tickRate);
+
+	ITimer* timer = Device->getTimer();
+	timer->stop();
+	SimulationMs = timer->getTime();
+	LastRealMs = getPreciseTimeMs();
+	NextFrameMs = LastRealMs;
+}
+
+
+CSimulationClock::~CSimulationClock()
+{
+	// the interpolation animators grab the clock, so the last of them may
+	// release it while the device is being destroyed: do not touch it here
+}
+
+
+void CSimulationClock::setTickRate(f32 tickRate)
+{
+	TickMs = 1000.0 / (tickRate > 0.f ? tickRate : 60.f);
+}
+
+
+void CSimulationClock::addInterpolation(scene::ISceneNode* node)
+{
+	scene::ISceneNodeAnimator* animator = new scene::CSceneNodeAnimatorInterpolation(this);
+	node->addAnimator(animator);
+	animator->drop();
+}
+
+
+void CSimulationClock::removeInterpolation(scene::CSceneNodeAnimatorInterpolation* animator)
+{
+	for (u32 i=0; i<Interpolations.size(); ++i)
+	{
+		if (Interpolations[i] == animator)
+		{
+			Interpolations.erase(i);
+			return;
+		}
+	}
+}
+
+
+void CSimulationClock::tick()
+{
+	MARS_PROFILE_SCOPE("tick");
+
+	SimulationMs += TickMs;
+	const u32 time = (u32)SimulationMs;
+	Device->getTimer()->setTime(time);
+
+	Ticking = true;
+	if (AnimationPhase)
+		AnimationPhase->animate(time);
+	Device->getSceneManager()->getRootSceneNode()->OnAnimate(time);
+	Ticking = false;
+
+	++TickCount;
+}
+
+
+u32 CSimulationClock::advance()
+{
+	const f64 now = getPreciseTimeMs();
+	const f64 start = now;
+	u32 ticks = 0;
+
+	if (FreeRunning)
+	{
+		tick();
+		ticks = 1;
+		AccumulatedMs = 0;
+		Interpolation = 1.f;
+	}
+	else
+	{
+		AccumulatedMs += now - LastRealMs;
+
+		while (AccumulatedMs >= TickMs && ticks < MaxTicksPerFrame)
+		{
+			tick();
+			AccumulatedMs -= TickMs;
+			++ticks;
+		}
+
+		// too far behind, drop the whole ticks which are left
+		if (AccumulatedMs >= TickMs)
+		{
+			const f64 dropped = AccumulatedMs - fmod(AccumulatedMs, TickMs);
+			DroppedMs += dropped;
+			AccumulatedMs -= dropped;
+		}
+
+		Interpolation = (f32)(AccumulatedMs / TickMs);
+	}
+
+	LastRealMs = now;
+	LastTickTimeMs = getPreciseTimeMs() - start;
+	return ticks;
+}
+
+
+void CSimulationClock::resync()
+{
+	LastRealMs = getPreciseTimeMs();
+	NextFrameMs = LastRealMs;
+}
+
+
+void CSimulationClock::beginFrame()
+{
+	// drawAll() animates once more, that is when the nodes move
+	Drawing = true;
+}
+
+
+void CSimulationClock::endFrame()
+{
+	Drawing = false;
+	for (u32 i=0; i<Interpolations.size(); ++i)
+		Interpolations[i]->restore();
+}
+
+
+void CSimulationClock::limitFrame()
+{
+	if (FrameMs <= 0.0 || FreeRunning)
+		return;
+
+	NextFrameMs += FrameMs;
+
+	f64 now = getPreciseTimeMs();
+	if (now > NextFrameMs)
+	{
+		// late already, do not try to make up for it with short frames
+		NextFrameMs = now;
+		return;
+	}
+
+	// sleep most of the wait, the scheduler is not precise enough for the rest
+	while (NextFrameMs - now > 2.0)
+	{
+		Device->sleep((u32)(NextFrameMs - now) - 1);
+		now = getPreciseTimeMs();
+	}
+	while (now < NextFrameMs)
+	{
+		Device->yield();
+		now = getPreciseTimeMs();
+	}
+}
+
+} // end namespace irr
@@ -0,0 +1,173 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_SIMULATION_CLOCK_H_INCLUDED__
+#define __C_SIMULATION_CLOCK_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+
+class CSimulationClock;
+
+namespace scene
+{
+
+class CAnimationPhase;
+
+//! Type of the interpolation animator.
+const ESCENE_NODE_ANIMATOR_TYPE ESNAT_INTERPOLATION = (ESCENE_NODE_ANIMATOR_TYPE)MAKE_IRR_ID('i','n','t','p');
+
+//! Smooths the movement of a node between the ticks of a CSimulationClock.
+/** Created by CSimulationClock::addInterpolation(). It has to be the last
+animator of its node: on every tick it records where the other animators
+have put the node, and while the frame is drawn it moves the node between
+the last two ticks. Outside of the clock's ticks and frames, for example in
+benchmark mode, it does nothing. */
+class CSceneNodeAnimatorInterpolation : public ISceneNodeAnimator
+{
+public:
+
+	CSceneNodeAnimatorInterpolation(CSimulationClock* clock);
+
+	virtual ~CSceneNodeAnimatorInterpolation();
+
+	virtual void animateNode(ISceneNode* node, u32 timeMs);
+
+	virtual ISceneNodeAnimator* createClone(ISceneNode* node, ISceneManager* newManager=0);
+
+	virtual ESCENE_NODE_ANIMATOR_TYPE getType() const { return ESNAT_INTERPOLATION; }
+
+	//! Puts the node back where the last tick left it.
+	void restore();
+
+private:
+
+	CSimulationClock* Clock;
+	//! Not grabbed, the node owns this animator.
+	ISceneNode* Node;
+
+	core::vector3df Position[2];
+	core::vector3df Rotation[2];
+	core::vector3df Scale[2];
+	bool HasTick;
+};
+
+} // end namespace scene
+
+
+//! Runs the animators at a fixed rate, independent of the frame rate.
+/** Irrlicht animates the scene once per drawAll(), with whatever time has
+passed since the last frame. A slow frame makes the collision response and
+the animators take one big step, a fast one many small steps.
+
+The clock takes over the device timer and advances it in fixed ticks:
+advance() animates the scene once for every tick which is due, and at most
+setMaxTicksPerFrame() times, so after a long stall the simulation slows down
+instead of never catching up. drawAll() then animates again at the time of
+the last tick, which leaves absolute animators where they are and moves
+time based ones by 0. Nodes with an interpolation animator are drawn
+between their last two ticks, so they move smoothly at any frame rate.
+
+Free running, each frame runs exactly one tick without waiting for real
+time, so headless runs simulate as fast as the machine can. */
+class CSimulationClock : public virtual IReferenceCounted
+{
+public:
+
+	//! Stops the device timer, the clock advances it from now on.
+	CSimulationClock(IrrlichtDevice* device, f32 tickRate);
+
+	virtual ~CSimulationClock();
+
+	//! Sets the ticks per second.
+	void setTickRate(f32 tickRate);
+
+	f32 getTickRate() const { return 1000.f / (f32)TickMs; }
+
+	//! Sets how many ticks one frame may catch up at most.
+	void setMaxTicksPerFrame(u32 count) { MaxTicksPerFrame = core::max_(count, 1u); }
+
+	//! Sets the most frames per second limitFrame() lets through, 0 for no limit.
+	void setFrameLimit(f32 framesPerSecond) { FrameMs = framesPerSecond > 0.f ? 1000.0 / framesPerSecond : 0.0; }
+
+	//! Runs one tick per frame instead of following real time.
+	void setFreeRunning(bool freeRunning) { FreeRunning = freeRunning; }
+
+	//! Runs the animation phase on every tick, before the scene is animated.
+	/** Also run it before drawAll(). The phase is not grabbed: it holds
+	interpolation animators, which grab the clock. */
+	void setAnimationPhase(scene::CAnimationPhase* phase) { AnimationPhase = phase; }
+
+	//! Lets the node be drawn between ticks, call after adding its other animators.
+	void addInterpolation(scene::ISceneNode* node);
+
+	//! Runs the ticks which are due, returns how many.
+	u32 advance();
+
+	//! Forgets the real time passed since the last advance(), for example while paused.
+	void resync();
+
+	//! Moves the interpolated nodes between their last two ticks, call before drawAll().
+	void beginFrame();
+
+	//! Moves the interpolated nodes back to their last tick, call after drawAll().
+	void endFrame();
+
+	//! Waits until the frame limit allows the next frame.
+	void limitFrame();
+
+	//! True while advance() animates the scene.
+	bool isTicking() const { return Ticking; }
+
+	//! True between beginFrame() and endFrame().
+	bool isDrawing() const { return Drawing; }
+
+	//! How far the frame is between the last two ticks, 0 to 1.
+	f32 getInterpolation() const { return Interpolation; }
+
+	//! Simulated time of the last tick.
+	u32 getTime() const { return (u32)SimulationMs; }
+
+	//! Ticks run so far.
+	u32 getTickCount() const { return TickCount; }
+
+	//! Real time which was not simulated because the frames were too slow.
+	f64 getDroppedTimeMs() const { return DroppedMs; }
+
+	//! Real time the ticks of the last advance() took.
+	f64 getLastTickTimeMs() const { return LastTickTimeMs; }
+
+private:
+
+	friend class scene::CSceneNodeAnimatorInterpolation;
+
+	void tick();
+
+	void removeInterpolation(scene::CSceneNodeAnimatorInterpolation* animator);
+
+	IrrlichtDevice* Device;
+	scene::CAnimationPhase* AnimationPhase;
+	core::array<scene::CSceneNodeAnimatorInterpolation*> Interpolations;
+
+	f64 TickMs;
+	f64 FrameMs;
+	f64 SimulationMs;
+	f64 LastRealMs;
+	f64 AccumulatedMs;
+	f64 NextFrameMs;
+	f64 DroppedMs;
+	f64 LastTickTimeMs;
+	f32 Interpolation;
+	u32 MaxTicksPerFrame;
+	u32 TickCount;
+	bool FreeRunning;
+	bool Ticking;
+	bool Drawing;
+};
+
+} // end namespace irr
+
+#endif
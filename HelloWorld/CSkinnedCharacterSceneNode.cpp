@@ -0,0 +1,217 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CSkinnedCharacterSceneNode.h"
+#include "CFrameProfiler.h"
+#include "CSoaSkin.h"
+#include <string.h>
+
+namespace irr
+{
+namespace scene
+{
+
+CSkinnedCharacterSceneNode::CSkinnedCharacterSceneNode(CSoaSkin* skin, ISceneNode* parent, ISceneManager* mgr, s32 id,
+	const core::vector3df& position, const core::vector3df& rotation, const core::vector3df& scale)
+	: ISceneNode(parent, mgr, id, position, rotation, scale), Skin(skin),
+	StartFrame(0), EndFrame(0), FramesPerSecond(0.025f), CurrentFrame(0.f), LastTimeMs(0),
+	Looping(true), Started(false), UsePoseCache(true), PoseFrame(0.f), HasPose(false)
+{
+	#ifdef _DEBUG
+	setDebugName("CSkinnedCharacterSceneNode");
+	#endif
+
+	Skin->grab();
+
+	ISkinnedMesh* mesh = Skin->getMesh();
+	const core::array<SSkinMeshBuffer*>& sources = mesh->getMeshBuffers();
+	for (u32 b=0; b<Skin->getBufferCount(); ++b)
+	{
+		const SSkinMeshBuffer* source = sources[b];
+		SMeshBuffer* buffer = new SMeshBuffer();
+		buffer->Material = source->getMaterial();
+
+		buffer->Vertices.set_used(Skin->getVertexCount(b));
+		memcpy(buffer->Vertices.pointer(), Skin->getBindPose() + Skin->getBufferStart(b),
+			Skin->getVertexCount(b) * sizeof(video::S3DVertex));
+		buffer->Indices.set_used(source->getIndexCount());
+		memcpy(buffer->Indices.pointer(), source->getIndices(), source->getIndexCount() * sizeof(u16));
+		buffer->setBoundingBox(Skin->getAnimationBox());
+
+		// new vertices every frame, the same triangles
+		buffer->setHardwareMappingHint(EHM_STREAM, EBT_VERTEX);
+		buffer->setHardwareMappingHint(EHM_STATIC, EBT_INDEX);
+
+		Buffers.push_back(buffer);
+		Targets.push_back(buffer->Vertices.pointer());
+	}
+
+	Box = Skin->getAnimationBox();
+	setAnimationSpeed(mesh->getAnimationSpeed());
+	setFrameLoop(0, (s32)Skin->getFrameCount() - 1);
+}
+
+
+CSkinnedCharacterSceneNode::~CSkinnedCharacterSceneNode()
+{
+	for (u32 i=0; i<Buffers.size(); ++i)
+		Buffers[i]->drop();
+
+	Skin->drop();
+}
+
+
+bool CSkinnedCharacterSceneNode::setFrameLoop(s32 begin, s32 end)
+{
+	// the same clamping as Irrlicht's animated mesh scene node
+	const s32 maxFrame = (s32)Skin->getFrameCount() - 1;
+	if (end < begin)
+	{
+		StartFrame = core::clamp(end, 0, maxFrame);
+		EndFrame = core::clamp(begin, StartFrame, maxFrame);
+	}
+	else
+	{
+		StartFrame = core::clamp(begin, 0, maxFrame);
+		EndFrame = core::clamp(end, StartFrame, maxFrame);
+	}
+
+	if (FramesPerSecond < 0.f)
+		setCurrentFrame((f32)EndFrame);
+	else
+		setCurrentFrame((f32)StartFrame);
+
+	return true;
+}
+
+
+void CSkinnedCharacterSceneNode::setCurrentFrame(f32 frame)
+{
+	CurrentFrame = core::clamp(frame, (f32)StartFrame, (f32)EndFrame);
+}
+
+
+void CSkinnedCharacterSceneNode::buildFrameNr(u32 timeMs)
+{
+	if (StartFrame == EndFrame)
+	{
+		CurrentFrame = (f32)StartFrame;
+		return;
+	}
+
+	CurrentFrame += timeMs * FramesPerSecond;
+
+	const f32 length = (f32)(EndFrame - StartFrame);
+	if (Looping)
+	{
+		if (FramesPerSecond > 0.f && CurrentFrame > EndFrame)
+			CurrentFrame = StartFrame + fmodf(CurrentFrame - StartFrame, length);
+		else if (FramesPerSecond < 0.f && CurrentFrame < StartFrame)
+			CurrentFrame = EndFrame - fmodf(EndFrame - CurrentFrame, length);
+	}
+	else
+		CurrentFrame = core::clamp(CurrentFrame, (f32)StartFrame, (f32)EndFrame);
+}
+
+
+void CSkinnedCharacterSceneNode::OnRegisterSceneNode()
+{
+	if (IsVisible)
+		SceneManager->registerNodeForRendering(this);
+
+	ISceneNode::OnRegisterSceneNode();
+}
+
+
+void CSkinnedCharacterSceneNode::OnAnimate(u32 timeMs)
+{
+	if (IsVisible)
+	{
+		if (!Started)
+		{
+			LastTimeMs = timeMs;
+			Started = true;
+		}
+
+		// drawAll() after the simulation clock animates at the same time again
+		if (timeMs > LastTimeMs)
+			buildFrameNr(timeMs - LastTimeMs);
+		LastTimeMs = timeMs;
+	}
+
+	ISceneNode::OnAnimate(timeMs);
+}
+
+
+void CSkinnedCharacterSceneNode::updatePose()
+{
+	f32 frame = CurrentFrame;
+	const s32 pose = UsePoseCache ? Skin->getPoseIndex(frame) : -1;
+	if (pose >= 0)
+		frame = Skin->getPoseFrame(pose);
+
+	if (HasPose && frame == PoseFrame)
+		return;
+
+	MARS_PROFILE_SCOPE("skinning");
+
+	if (pose >= 0)
+	{
+		const video::S3DVertex* vertices = Skin->getPose(pose);
+		for (u32 b=0; b<Buffers.size(); ++b)
+			memcpy(Targets[b], vertices + Skin->getBufferStart(b), Skin->getVertexCount(b) * sizeof(video::S3DVertex));
+	}
+	else
+		Skin->skin(frame, Targets.pointer());
+
+	for (u32 b=0; b<Buffers.size(); ++b)
+		Buffers[b]->setDirty(EBT_VERTEX);
+
+	PoseFrame = frame;
+	HasPose = true;
+}
+
+
+void CSkinnedCharacterSceneNode::render()
+{
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+
+	updatePose();
+
+	driver->setTransform(video::ETS_WORLD, AbsoluteTransformation);
+	for (u32 i=0; i<Buffers.size(); ++i)
+	{
+		driver->setMaterial(Buffers[i]->Material);
+		driver->drawMeshBuffer(Buffers[i]);
+	}
+
+	if (DebugDataVisible & EDS_BBOX)
+	{
+		video::SMaterial debugMaterial;
+		debugMaterial.Lighting = false;
+		driver->setMaterial(debugMaterial);
+		driver->draw3DBox(Box, video::SColor(255,255,255,255));
+	}
+}
+
+
+const core::aabbox3d<f32>& CSkinnedCharacterSceneNode::getBoundingBox() const
+{
+	return Box;
+}
+
+
+u32 CSkinnedCharacterSceneNode::getMaterialCount() const
+{
+	return Buffers.size();
+}
+
+
+video::SMaterial& CSkinnedCharacterSceneNode::getMaterial(u32 i)
+{
+	return Buffers[i]->Material;
+}
+
+} // end namespace scene
+} // end namespace irr
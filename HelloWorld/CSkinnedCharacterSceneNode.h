@@ -0,0 +1,122 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_SKINNED_CHARACTER_SCENE_NODE_H_INCLUDED__
+#define __C_SKINNED_CHARACTER_SCENE_NODE_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+class CSoaSkin;
+
+//! Type of the skinned character scene node.
+const ESCENE_NODE_TYPE ESNT_SKINNED_CHARACTER = (ESCENE_NODE_TYPE)MAKE_IRR_ID('s','k','c','h');
+
+//! Plays the animation of a skinned mesh, skinned by a CSoaSkin.
+/** Does what an animated mesh scene node of a skinned mesh does, with the
+same frame loop and animation speed, but keeps its own vertices: many
+characters of one mesh each skin into their own buffers instead of all
+skinning the shared mesh over and over. Skinning happens in render(), so a
+culled character costs nothing; it is culled with the box around the whole
+animation. A character drawn twice at the same frame skins only once.
+
+With the pose cache of the skin turned on and used, the character snaps to
+the closest cached pose and only copies it. */
+class CSkinnedCharacterSceneNode : public ISceneNode
+{
+public:
+
+	//! The skin is grabbed.
+	CSkinnedCharacterSceneNode(CSoaSkin* skin, ISceneNode* parent, ISceneManager* mgr, s32 id=-1,
+		const core::vector3df& position = core::vector3df(0,0,0),
+		const core::vector3df& rotation = core::vector3df(0,0,0),
+		const core::vector3df& scale = core::vector3df(1.0f, 1.0f, 1.0f));
+
+	virtual ~CSkinnedCharacterSceneNode();
+
+	CSoaSkin* getSkin() const { return Skin; }
+
+	//! Sets the frames to play, like IAnimatedMeshSceneNode::setFrameLoop().
+	bool setFrameLoop(s32 begin, s32 end);
+
+	s32 getStartFrame() const { return StartFrame; }
+
+	s32 getEndFrame() const { return EndFrame; }
+
+	//! Frames per second, negative to play backwards.
+	void setAnimationSpeed(f32 framesPerSecond) { FramesPerSecond = framesPerSecond * 0.001f; }
+
+	f32 getAnimationSpeed() const { return FramesPerSecond * 1000.f; }
+
+	//! Jumps to frame, within the frame loop.
+	void setCurrentFrame(f32 frame);
+
+	f32 getFrameNr() const { return CurrentFrame; }
+
+	//! Plays the frame loop again and again, or stops at its end.
+	void setLoopMode(bool playAnimationLooped) { Looping = playAnimationLooped; }
+
+	//! Copies the poses from the pose cache of the skin, if it has one.
+	void setUsePoseCache(bool use) { UsePoseCache = use; }
+
+	bool getUsePoseCache() const { return UsePoseCache; }
+
+	//! Skins or copies the pose of the current frame into the buffers.
+	/** Done by render(), renderers which do not go through the driver
+	call it before reading the buffers. */
+	void updatePose();
+
+	u32 getBufferCount() const { return Buffers.size(); }
+
+	//! Skinned buffer, in the space of the node, with its material.
+	IMeshBuffer* getBuffer(u32 i) const { return Buffers[i]; }
+
+	virtual void OnRegisterSceneNode();
+
+	virtual void OnAnimate(u32 timeMs);
+
+	virtual void render();
+
+	virtual const core::aabbox3d<f32>& getBoundingBox() const;
+
+	virtual u32 getMaterialCount() const;
+
+	virtual video::SMaterial& getMaterial(u32 i);
+
+	virtual ESCENE_NODE_TYPE getType() const { return ESNT_SKINNED_CHARACTER; }
+
+private:
+
+	//! Moves the current frame on by timeMs.
+	void buildFrameNr(u32 timeMs);
+
+	CSoaSkin* Skin;
+	core::array<SMeshBuffer*> Buffers;
+	//! Vertices of every buffer, what the skin writes to.
+	core::array<video::S3DVertex*> Targets;
+	core::aabbox3df Box;
+
+	s32 StartFrame;
+	s32 EndFrame;
+	//! Frames per millisecond.
+	f32 FramesPerSecond;
+	f32 CurrentFrame;
+	u32 LastTimeMs;
+	bool Looping;
+	bool Started;
+
+	bool UsePoseCache;
+	//! Frame the buffers show.
+	f32 PoseFrame;
+	bool HasPose;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
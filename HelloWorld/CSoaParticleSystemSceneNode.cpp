@@ -0,0 +1,534 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CSoaParticleSystemSceneNode.h"
+#include "CFrameProfiler.h"
+#include "CThreadPool.h"
+#include "PreciseTimer.h"
+#include <float.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define _MARS_PARTICLES_SSE_
+#include <xmmintrin.h>
+#endif
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+// particles per draw call, the most 16 bit indices can address
+const u32 BatchParticles = 65536 / 4 - 1;
+
+// amount of f32 and u32 arrays in the pool
+const u32 ParticleArrays = 11;
+
+} // end anonymous namespace
+
+
+CSoaParticleSystemSceneNode::CSoaParticleSystemSceneNode(ISceneNode* parent, ISceneManager* mgr, s32 id)
+	: ISceneNode(parent, mgr, id), MinParticlesPerSecond(0), MaxParticlesPerSecond(0),
+	LifeTimeMin(0), LifeTimeMax(0), MaxAngleDegrees(0), EmitTimeMs(0.f),
+	TargetColor(0,0,0,0), FadeOutTimeMs(1000.f), Memory(0),
+	PosX(0), PosY(0), PosZ(0), VelX(0), VelY(0), VelZ(0), Life(0), Fade(0),
+	Width(0), Height(0), Color(0), Capacity(0), Count(0), Pool(0),
+	MinParticlesPerJob(16384), Seed(0x2545F491), LastTimeMs(0), Started(false),
+	LastUpdateTimeMs(0.0), LastBuildTimeMs(0.0)
+{
+	#ifdef _DEBUG
+	setDebugName("CSoaParticleSystemSceneNode");
+	#endif
+
+	// two triangles per billboard, the same for every batch
+	Indices.set_used(BatchParticles * 6);
+	for (u32 i=0; i<BatchParticles; ++i)
+	{
+		const u16 v = (u16)(i * 4);
+		u16* index = Indices.pointer() + i * 6;
+		index[0] = v;
+		index[1] = v + 2;
+		index[2] = v + 1;
+		index[3] = v;
+		index[4] = v + 3;
+		index[5] = v + 2;
+	}
+
+	Box.reset(0,0,0);
+}
+
+
+CSoaParticleSystemSceneNode::~CSoaParticleSystemSceneNode()
+{
+	delete [] Memory;
+}
+
+
+void CSoaParticleSystemSceneNode::setBoxEmitter(const core::aabbox3df& box,
+	const core::vector3df& direction, u32 minParticlesPerSecond, u32 maxParticlesPerSecond,
+	const video::SColor& minStartColor, const video::SColor& maxStartColor,
+	u32 lifeTimeMin, u32 lifeTimeMax, s32 maxAngleDegrees,
+	const core::dimension2df& minStartSize, const core::dimension2df& maxStartSize)
+{
+	EmitBox = box;
+	Direction = direction;
+	MinParticlesPerSecond = minParticlesPerSecond;
+	MaxParticlesPerSecond = core::max_(minParticlesPerSecond, maxParticlesPerSecond);
+	MinStartColor = minStartColor;
+	MaxStartColor = maxStartColor;
+	LifeTimeMin = lifeTimeMin;
+	LifeTimeMax = core::max_(lifeTimeMin, lifeTimeMax);
+	MaxAngleDegrees = maxAngleDegrees;
+	MinStartSize = minStartSize;
+	MaxStartSize = maxStartSize;
+	EmitTimeMs = 0.f;
+
+	// everything emitted during the longest life, plus a frame of slack
+	const u64 needed = (u64)MaxParticlesPerSecond * (LifeTimeMax + 100) / 1000 + 1;
+	if (needed > Capacity)
+		setMaxParticles((u32)core::min_<u64>(needed, 0x3fffffff));
+}
+
+
+void CSoaParticleSystemSceneNode::setFadeOut(const video::SColor& targetColor, u32 timeNeededToFadeOut)
+{
+	TargetColor = targetColor;
+	FadeOutTimeMs = (f32)timeNeededToFadeOut;
+}
+
+
+void CSoaParticleSystemSceneNode::setMaxParticles(u32 count)
+{
+	// every array holds a multiple of 4 particles, for the SSE kernels
+	const u32 capacity = (count + 3) & ~3u;
+	if (capacity == Capacity)
+		return;
+
+	u8* memory = new u8[capacity * ParticleArrays * sizeof(f32) + 15];
+	f32* base = (f32*)(((size_t)memory + 15) & ~(size_t)15);
+	f32* arrays[ParticleArrays];
+	for (u32 i=0; i<ParticleArrays; ++i)
+		arrays[i] = base + i * capacity;
+
+	const u32 kept = core::min_(Count, capacity);
+	f32* old[ParticleArrays] = { PosX, PosY, PosZ, VelX, VelY, VelZ, Life, Fade, Width, Height, (f32*)Color };
+	if (kept)
+		for (u32 i=0; i<ParticleArrays; ++i)
+			memcpy(arrays[i], old[i], kept * sizeof(f32));
+
+	delete [] Memory;
+	Memory = memory;
+	PosX = arrays[0];
+	PosY = arrays[1];
+	PosZ = arrays[2];
+	VelX = arrays[3];
+	VelY = arrays[4];
+	VelZ = arrays[5];
+	Life = arrays[6];
+	Fade = arrays[7];
+	Width = arrays[8];
+	Height = arrays[9];
+	Color = (u32*)arrays[10];
+	Capacity = capacity;
+	Count = kept;
+
+	Vertices.clear();
+	Vertices.reallocate(Capacity * 4);
+}
+
+
+void CSoaParticleSystemSceneNode::clearParticles()
+{
+	Count = 0;
+	EmitTimeMs = 0.f;
+	Box.reset(0,0,0);
+}
+
+
+void CSoaParticleSystemSceneNode::setThreadPool(CThreadPool* pool, u32 minParticlesPerJob)
+{
+	Pool = pool;
+	MinParticlesPerJob = core::max_(minParticlesPerJob, 4u);
+}
+
+
+f32 CSoaParticleSystemSceneNode::frand()
+{
+	Seed = Seed * 1664525u + 1013904223u;
+	return (Seed >> 8) * (1.f / 16777215.f);
+}
+
+
+void CSoaParticleSystemSceneNode::OnRegisterSceneNode()
+{
+	if (IsVisible && Count)
+		SceneManager->registerNodeForRendering(this);
+
+	ISceneNode::OnRegisterSceneNode();
+}
+
+
+void CSoaParticleSystemSceneNode::OnAnimate(u32 timeMs)
+{
+	// first, so particles are emitted with this frame's transformation
+	ISceneNode::OnAnimate(timeMs);
+
+	// animated again at the same time, by drawAll() after a simulation tick
+	if (!IsVisible || (Started && timeMs == LastTimeMs))
+		return;
+
+	const f32 elapsed = Started && timeMs > LastTimeMs ? (f32)(timeMs - LastTimeMs) : 0.f;
+	LastTimeMs = timeMs;
+	Started = true;
+
+	const f64 start = getPreciseTimeMs();
+
+	runJobs(updateJob, elapsed);
+
+	core::vector3df min(FLT_MAX, FLT_MAX, FLT_MAX);
+	core::vector3df max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (u32 i=0; i<Jobs.size(); ++i)
+	{
+		if (Jobs[i].Begin == Jobs[i].End)
+			continue;
+		min.set(core::min_(min.X, Jobs[i].Min.X), core::min_(min.Y, Jobs[i].Min.Y), core::min_(min.Z, Jobs[i].Min.Z));
+		max.set(core::max_(max.X, Jobs[i].Max.X), core::max_(max.Y, Jobs[i].Max.Y), core::max_(max.Z, Jobs[i].Max.Z));
+	}
+
+	removeDead();
+	emit(elapsed, min, max);
+
+	// the particles are in world space, the box is relative to the node
+	if (Count)
+	{
+		Box = core::aabbox3df(min, max);
+		core::matrix4 inverse;
+		if (AbsoluteTransformation.getInverse(inverse))
+			inverse.transformBoxEx(Box);
+	}
+	else
+		Box.reset(0,0,0);
+
+	const f64 end = getPreciseTimeMs();
+	LastUpdateTimeMs = end - start;
+	CFrameProfiler::report("particles_update", start, end);
+}
+
+
+void CSoaParticleSystemSceneNode::runJobs(void (*function)(void*), f32 timeMs)
+{
+	u32 jobCount = 1;
+	if (Pool && Count >= MinParticlesPerJob * 2)
+		jobCount = core::min_(Count / MinParticlesPerJob, Pool->getThreadCount() + 1);
+
+	// every job starts at a multiple of 4, so the kernels only do aligned loads
+	const u32 perJob = ((Count + jobCount - 1) / jobCount + 3) & ~3u;
+
+	Jobs.set_used(jobCount);
+	for (u32 i=0; i<jobCount; ++i)
+	{
+		SJob& job = Jobs[i];
+		job.Node = this;
+		job.Begin = core::min_(i * perJob, Count);
+		job.End = core::min_(job.Begin + perJob, Count);
+		job.TimeMs = timeMs;
+	}
+
+	// the calling thread does the first job instead of only waiting
+	for (u32 i=1; i<jobCount; ++i)
+		Pool->addJob(function, &Jobs[i]);
+	function(&Jobs[0]);
+	if (jobCount > 1)
+		Pool->waitForAll();
+}
+
+
+void CSoaParticleSystemSceneNode::updateJob(void* data)
+{
+	SJob* job = (SJob*)data;
+	job->Node->updateRange(*job);
+}
+
+
+void CSoaParticleSystemSceneNode::buildJob(void* data)
+{
+	SJob* job = (SJob*)data;
+	job->Node->buildRange(job->Begin, job->End);
+}
+
+
+void CSoaParticleSystemSceneNode::updateRange(SJob& job)
+{
+	const f32 timeMs = job.TimeMs;
+	const f32 invFade = FadeOutTimeMs > 0.f ? 1.f / FadeOutTimeMs : 1e30f;
+
+	f32 minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+	f32 maxX = -FLT_MAX, maxY = -FLT_MAX, maxZ = -FLT_MAX;
+	u32 i = job.Begin;
+
+#ifdef _MARS_PARTICLES_SSE_
+	const __m128 dt = _mm_set1_ps(timeMs);
+	const __m128 fade = _mm_set1_ps(invFade);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+	__m128 minX4 = _mm_set1_ps(FLT_MAX), minY4 = minX4, minZ4 = minX4;
+	__m128 maxX4 = _mm_set1_ps(-FLT_MAX), maxY4 = maxX4, maxZ4 = maxX4;
+
+	for (; i+4<=job.End; i+=4)
+	{
+		const __m128 life = _mm_sub_ps(_mm_load_ps(Life + i), dt);
+		_mm_store_ps(Life + i, life);
+		_mm_store_ps(Fade + i, _mm_min_ps(_mm_max_ps(_mm_mul_ps(life, fade), zero), one));
+
+		const __m128 x = _mm_add_ps(_mm_load_ps(PosX + i), _mm_mul_ps(_mm_load_ps(VelX + i), dt));
+		const __m128 y = _mm_add_ps(_mm_load_ps(PosY + i), _mm_mul_ps(_mm_load_ps(VelY + i), dt));
+		const __m128 z = _mm_add_ps(_mm_load_ps(PosZ + i), _mm_mul_ps(_mm_load_ps(VelZ + i), dt));
+		_mm_store_ps(PosX + i, x);
+		_mm_store_ps(PosY + i, y);
+		_mm_store_ps(PosZ + i, z);
+
+		minX4 = _mm_min_ps(minX4, x);
+		minY4 = _mm_min_ps(minY4, y);
+		minZ4 = _mm_min_ps(minZ4, z);
+		maxX4 = _mm_max_ps(maxX4, x);
+		maxY4 = _mm_max_ps(maxY4, y);
+		maxZ4 = _mm_max_ps(maxZ4, z);
+	}
+
+	f32 lanes[6][4];
+	_mm_storeu_ps(lanes[0], minX4);
+	_mm_storeu_ps(lanes[1], minY4);
+	_mm_storeu_ps(lanes[2], minZ4);
+	_mm_storeu_ps(lanes[3], maxX4);
+	_mm_storeu_ps(lanes[4], maxY4);
+	_mm_storeu_ps(lanes[5], maxZ4);
+	for (u32 l=0; l<4; ++l)
+	{
+		minX = core::min_(minX, lanes[0][l]);
+		minY = core::min_(minY, lanes[1][l]);
+		minZ = core::min_(minZ, lanes[2][l]);
+		maxX = core::max_(maxX, lanes[3][l]);
+		maxY = core::max_(maxY, lanes[4][l]);
+		maxZ = core::max_(maxZ, lanes[5][l]);
+	}
+#endif
+
+	// the rest, or everything without SSE
+	for (; i<job.End; ++i)
+	{
+		Life[i] -= timeMs;
+		Fade[i] = core::clamp(Life[i] * invFade, 0.f, 1.f);
+
+		PosX[i] += VelX[i] * timeMs;
+		PosY[i] += VelY[i] * timeMs;
+		PosZ[i] += VelZ[i] * timeMs;
+
+		minX = core::min_(minX, PosX[i]);
+		minY = core::min_(minY, PosY[i]);
+		minZ = core::min_(minZ, PosZ[i]);
+		maxX = core::max_(maxX, PosX[i]);
+		maxY = core::max_(maxY, PosY[i]);
+		maxZ = core::max_(maxZ, PosZ[i]);
+	}
+
+	job.Min.set(minX, minY, minZ);
+	job.Max.set(maxX, maxY, maxZ);
+}
+
+
+void CSoaParticleSystemSceneNode::removeDead()
+{
+	f32* arrays[ParticleArrays] = { PosX, PosY, PosZ, VelX, VelY, VelZ, Life, Fade, Width, Height, (f32*)Color };
+
+	for (u32 i=0; i<Count; )
+	{
+		if (Life[i] > 0.f)
+		{
+			++i;
+			continue;
+		}
+
+		--Count;
+		for (u32 a=0; a<ParticleArrays; ++a)
+			arrays[a][i] = arrays[a][Count];
+	}
+}
+
+
+void CSoaParticleSystemSceneNode::emit(f32 timeMs, core::vector3df& min, core::vector3df& max)
+{
+	if (!MaxParticlesPerSecond)
+		return;
+
+	// same rate as the box emitter of Irrlicht, but the time left over is
+	// kept instead of dropped, so low frame rates do not emit less
+	const u32 range = MaxParticlesPerSecond - MinParticlesPerSecond;
+	const f32 perSecond = range ? MinParticlesPerSecond + frand() * range : (f32)MinParticlesPerSecond;
+	if (perSecond <= 0.f)
+		return;
+
+	const f32 everyMs = 1000.f / perSecond;
+	EmitTimeMs += timeMs;
+	u32 amount = (u32)(EmitTimeMs / everyMs);
+	EmitTimeMs -= amount * everyMs;
+
+	// a full pool drops the new particles
+	amount = core::min_(amount, Capacity - Count);
+
+	const core::vector3df extent = EmitBox.getExtent();
+	const f32 lifeRange = (f32)(LifeTimeMax - LifeTimeMin);
+	const f32 invFade = FadeOutTimeMs > 0.f ? 1.f / FadeOutTimeMs : 1e30f;
+
+	for (u32 n=0; n<amount; ++n)
+	{
+		const u32 i = Count++;
+
+		core::vector3df pos(EmitBox.MinEdge.X + frand() * extent.X,
+			EmitBox.MinEdge.Y + frand() * extent.Y,
+			EmitBox.MinEdge.Z + frand() * extent.Z);
+		AbsoluteTransformation.transformVect(pos);
+
+		core::vector3df vel = Direction;
+		if (MaxAngleDegrees)
+		{
+			vel.rotateXYBy(frand() * MaxAngleDegrees);
+			vel.rotateYZBy(frand() * MaxAngleDegrees);
+			vel.rotateXZBy(frand() * MaxAngleDegrees);
+		}
+		AbsoluteTransformation.rotateVect(vel);
+
+		PosX[i] = pos.X;
+		PosY[i] = pos.Y;
+		PosZ[i] = pos.Z;
+		VelX[i] = vel.X;
+		VelY[i] = vel.Y;
+		VelZ[i] = vel.Z;
+		Life[i] = LifeTimeMin + frand() * lifeRange;
+		Fade[i] = core::clamp(Life[i] * invFade, 0.f, 1.f);
+
+		const f32 size = frand();
+		Width[i] = core::lerp(MinStartSize.Width, MaxStartSize.Width, size);
+		Height[i] = core::lerp(MinStartSize.Height, MaxStartSize.Height, size);
+		Color[i] = MinStartColor.getInterpolated(MaxStartColor, frand()).color;
+
+		min.set(core::min_(min.X, pos.X), core::min_(min.Y, pos.Y), core::min_(min.Z, pos.Z));
+		max.set(core::max_(max.X, pos.X), core::max_(max.Y, pos.Y), core::max_(max.Z, pos.Z));
+	}
+}
+
+
+void CSoaParticleSystemSceneNode::buildRange(u32 begin, u32 end)
+{
+	const f32 targetA = (f32)TargetColor.getAlpha();
+	const f32 targetR = (f32)TargetColor.getRed();
+	const f32 targetG = (f32)TargetColor.getGreen();
+	const f32 targetB = (f32)TargetColor.getBlue();
+
+	video::S3DVertex* v = Vertices.pointer() + begin * 4;
+	for (u32 i=begin; i<end; ++i, v+=4)
+	{
+		const core::vector3df pos(PosX[i], PosY[i], PosZ[i]);
+		const core::vector3df horizontal(Axes.Horizontal * (0.5f * Width[i]));
+		// downwards like Irrlicht's particles, so the quads wind clockwise
+		const core::vector3df vertical(Axes.Vertical * (-0.5f * Height[i]));
+
+		// what the fade out affector does, start color towards target color
+		const f32 d = Fade[i];
+		const f32 inv = 1.f - d;
+		const video::SColor start(Color[i]);
+		const video::SColor color(
+			(u32)(targetA * inv + start.getAlpha() * d + 0.5f),
+			(u32)(targetR * inv + start.getRed() * d + 0.5f),
+			(u32)(targetG * inv + start.getGreen() * d + 0.5f),
+			(u32)(targetB * inv + start.getBlue() * d + 0.5f));
+
+		v[0].Pos = pos + horizontal + vertical;
+		v[0].TCoords.set(0.0f, 0.0f);
+		v[1].Pos = pos + horizontal - vertical;
+		v[1].TCoords.set(0.0f, 1.0f);
+		v[2].Pos = pos - horizontal - vertical;
+		v[2].TCoords.set(1.0f, 1.0f);
+		v[3].Pos = pos - horizontal + vertical;
+		v[3].TCoords.set(1.0f, 0.0f);
+
+		for (u32 k=0; k<4; ++k)
+		{
+			v[k].Color = color;
+			v[k].Normal = Axes.Normal;
+		}
+	}
+}
+
+
+void CSoaParticleSystemSceneNode::buildBillboards(const ICameraSceneNode* camera)
+{
+	const f64 start = getPreciseTimeMs();
+
+	// billboards face the camera like those of Irrlicht's particle system
+	const core::matrix4& view = camera->getViewMatrix();
+	Axes.Horizontal.set(view[0], view[4], view[8]);
+	Axes.Vertical.set(view[1], view[5], view[9]);
+	Axes.Normal.set(-view[2], -view[6], -view[10]);
+
+	Vertices.set_used(Count * 4);
+	runJobs(buildJob, 0.f);
+
+	const f64 end = getPreciseTimeMs();
+	LastBuildTimeMs = end - start;
+	CFrameProfiler::report("particles_build", start, end);
+}
+
+
+void CSoaParticleSystemSceneNode::render()
+{
+	const ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	if (!camera || !Count)
+		return;
+
+	buildBillboards(camera);
+
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+	driver->setTransform(video::ETS_WORLD, core::IdentityMatrix);
+	driver->setMaterial(Material);
+
+	for (u32 first=0; first<Count; first+=BatchParticles)
+	{
+		const u32 count = core::min_(BatchParticles, Count - first);
+		driver->drawVertexPrimitiveList(Vertices.const_pointer() + first * 4, count * 4,
+			Indices.const_pointer(), count * 2, video::EVT_STANDARD, EPT_TRIANGLES, video::EIT_16BIT);
+	}
+
+	if (DebugDataVisible & EDS_BBOX)
+	{
+		video::SMaterial debugMaterial;
+		debugMaterial.Lighting = false;
+		driver->setMaterial(debugMaterial);
+		driver->setTransform(video::ETS_WORLD, AbsoluteTransformation);
+		driver->draw3DBox(Box, video::SColor(255,255,255,255));
+	}
+}
+
+
+const core::aabbox3d<f32>& CSoaParticleSystemSceneNode::getBoundingBox() const
+{
+	return Box;
+}
+
+
+u32 CSoaParticleSystemSceneNode::getMaterialCount() const
+{
+	return 1;
+}
+
+
+video::SMaterial& CSoaParticleSystemSceneNode::getMaterial(u32 i)
+{
+	return Material;
+}
+
+} // end namespace scene
+} // end namespace irr
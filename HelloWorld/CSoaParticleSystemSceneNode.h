@@ -0,0 +1,218 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_SOA_PARTICLE_SYSTEM_SCENE_NODE_H_INCLUDED__
+#define __C_SOA_PARTICLE_SYSTEM_SCENE_NODE_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+
+class CThreadPool;
+
+namespace scene
+{
+
+//! Type of the structure of arrays particle system scene node.
+const ESCENE_NODE_TYPE ESNT_SOA_PARTICLE_SYSTEM = (ESCENE_NODE_TYPE)MAKE_IRR_ID('s','o','a','p');
+
+//! Particle system with a box emitter and a fade out affector, built for many particles.
+/** Irrlicht's particle system keeps an array of SParticle structs, runs
+every affector over it through a virtual call and stops at 16250
+particles because its billboards share one 16 bit index buffer. This
+node does the same as a particle system with a box emitter from
+createBoxEmitter() and one createFadeOutParticleAffector(), but
+
+- keeps every particle attribute in its own array, allocated once for
+  the maximum amount of particles,
+- ages, fades and moves four particles at a time with SSE (plain C++
+  when SSE is not available) and finds the bounding box in the same pass,
+- can split the update and the billboard building over a thread pool,
+- draws the billboards in batches of 16 bit indices, so it has no limit
+  besides the pool size.
+
+Particles are global like in Irrlicht's default: they are emitted with
+the transformation of the node and stay where they are when the node
+moves. Dead particles are replaced by the last one, so the drawing order
+changes; the additive materials used for particles do not mind. */
+class CSoaParticleSystemSceneNode : public ISceneNode
+{
+public:
+
+	CSoaParticleSystemSceneNode(ISceneNode* parent, ISceneManager* mgr, s32 id=-1);
+
+	virtual ~CSoaParticleSystemSceneNode();
+
+	//! Sets the emitter, with the parameters and defaults of IParticleSystemSceneNode::createBoxEmitter().
+	/** Grows the pool to the amount of particles the emitter can keep alive. */
+	void setBoxEmitter(const core::aabbox3df& box = core::aabbox3df(-10,28,-10,10,30,10),
+		const core::vector3df& direction = core::vector3df(0.0f,0.03f,0.0f),
+		u32 minParticlesPerSecond = 5, u32 maxParticlesPerSecond = 10,
+		const video::SColor& minStartColor = video::SColor(255,0,0,0),
+		const video::SColor& maxStartColor = video::SColor(255,255,255,255),
+		u32 lifeTimeMin=2000, u32 lifeTimeMax=4000, s32 maxAngleDegrees=0,
+		const core::dimension2df& minStartSize = core::dimension2df(5.0f,5.0f),
+		const core::dimension2df& maxStartSize = core::dimension2df(5.0f,5.0f));
+
+	//! Sets the fade out, like IParticleSystemSceneNode::createFadeOutParticleAffector().
+	void setFadeOut(const video::SColor& targetColor = video::SColor(0,0,0,0),
+		u32 timeNeededToFadeOut = 1000);
+
+	//! Sets the size of the pool. Particles beyond the new size are removed.
+	void setMaxParticles(u32 count);
+
+	u32 getMaxParticles() const { return Capacity; }
+
+	u32 getParticleCount() const { return Count; }
+
+	//! Removes all particles.
+	void clearParticles();
+
+	//! Splits the work over the workers of pool, 0 to do everything on the calling thread.
+	/** The pool is not owned and must outlive the node or be reset first. The
+	work is only split when there are at least minParticlesPerJob particles
+	per worker. */
+	void setThreadPool(CThreadPool* pool, u32 minParticlesPerJob=16384);
+
+	//! Time the last update took, aging, moving and emitting.
+	f64 getLastUpdateTimeMs() const { return LastUpdateTimeMs; }
+
+	//! Time building the billboards took in the last render().
+	f64 getLastBuildTimeMs() const { return LastBuildTimeMs; }
+
+	//! Writes the billboards of all particles, facing camera.
+	/** Done by render(), renderers which do not go through the driver
+	call it before reading the billboards. */
+	void buildBillboards(const ICameraSceneNode* camera);
+
+	//! Billboards of the last build, 4 world space vertices per particle.
+	const video::S3DVertex* getBillboardVertices() const { return Vertices.const_pointer(); }
+
+	//! Indices of the billboards of one batch, 6 per particle.
+	/** The same for every batch, relative to the first vertex of the batch. */
+	const u16* getBatchIndices() const { return Indices.const_pointer(); }
+
+	//! Most particles drawn with the indices of one batch.
+	u32 getBatchSize() const { return Indices.size() / 6; }
+
+	virtual void OnRegisterSceneNode();
+
+	virtual void OnAnimate(u32 timeMs);
+
+	virtual void render();
+
+	virtual const core::aabbox3d<f32>& getBoundingBox() const;
+
+	virtual u32 getMaterialCount() const;
+
+	virtual video::SMaterial& getMaterial(u32 i);
+
+	virtual ESCENE_NODE_TYPE getType() const { return ESNT_SOA_PARTICLE_SYSTEM; }
+
+private:
+
+	//! Work of one thread, a range of particles starting at a multiple of 4.
+	struct SJob
+	{
+		CSoaParticleSystemSceneNode* Node;
+		u32 Begin;
+		u32 End;
+		f32 TimeMs;
+		//! World space bounds of the moved particles.
+		core::vector3df Min;
+		core::vector3df Max;
+	};
+
+	//! Camera axes the billboards are built along.
+	struct SBillboardAxes
+	{
+		core::vector3df Horizontal;
+		core::vector3df Vertical;
+		core::vector3df Normal;
+	};
+
+	static void updateJob(void* data);
+	static void buildJob(void* data);
+
+	//! Ages, fades and moves the particles of job, and finds their bounds.
+	void updateRange(SJob& job);
+
+	//! Writes the billboards of the particles begin to end-1.
+	void buildRange(u32 begin, u32 end);
+
+	//! Runs function over all particles, split into jobs if there is a pool.
+	void runJobs(void (*function)(void*), f32 timeMs);
+
+	//! Removes the dead particles.
+	void removeDead();
+
+	void emit(f32 timeMs, core::vector3df& min, core::vector3df& max);
+
+	//! Returns a value in [0,1].
+	f32 frand();
+
+	// emitter
+	core::aabbox3df EmitBox;
+	core::vector3df Direction;
+	u32 MinParticlesPerSecond;
+	u32 MaxParticlesPerSecond;
+	video::SColor MinStartColor;
+	video::SColor MaxStartColor;
+	u32 LifeTimeMin;
+	u32 LifeTimeMax;
+	s32 MaxAngleDegrees;
+	core::dimension2df MinStartSize;
+	core::dimension2df MaxStartSize;
+	//! Time which has not emitted a particle yet.
+	f32 EmitTimeMs;
+
+	// fade out
+	video::SColor TargetColor;
+	f32 FadeOutTimeMs;
+
+	//! One allocation for all particle arrays, each 16 byte aligned.
+	u8* Memory;
+	f32* PosX;
+	f32* PosY;
+	f32* PosZ;
+	f32* VelX;
+	f32* VelY;
+	f32* VelZ;
+	//! Milliseconds left to live.
+	f32* Life;
+	//! 1 while not fading, down to 0 at the end of the life.
+	f32* Fade;
+	f32* Width;
+	f32* Height;
+	//! Start color as ARGB.
+	u32* Color;
+	u32 Capacity;
+	u32 Count;
+
+	CThreadPool* Pool;
+	u32 MinParticlesPerJob;
+	core::array<SJob> Jobs;
+
+	//! Billboards, 4 vertices per particle.
+	core::array<video::S3DVertex> Vertices;
+	//! Indices of one batch, the same for all batches.
+	core::array<u16> Indices;
+	SBillboardAxes Axes;
+
+	video::SMaterial Material;
+	core::aabbox3df Box;
+
+	u32 Seed;
+	u32 LastTimeMs;
+	bool Started;
+
+	f64 LastUpdateTimeMs;
+	f64 LastBuildTimeMs;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
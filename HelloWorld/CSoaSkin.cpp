@@ -0,0 +1,379 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CSoaSkin.h"
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define _MARS_SKINNING_SSE_
+#include <xmmintrin.h>
+#endif
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+//! A joint moving a vertex.
+struct SInfluence
+{
+	u16 Bone;
+	f32 Weight;
+};
+
+//! Irrlicht's vertex types all start with the members of a standard vertex.
+const video::S3DVertex& getStandardVertex(const SSkinMeshBuffer* buffer, u32 i)
+{
+	switch (buffer->VertexType)
+	{
+	case video::EVT_2TCOORDS:
+		return buffer->Vertices_2TCoords[i];
+	case video::EVT_TANGENTS:
+		return buffer->Vertices_Tangents[i];
+	default:
+		return buffer->Vertices_Standard[i];
+	}
+}
+
+} // end anonymous namespace
+
+
+CSoaSkin::CSoaSkin(ISkinnedMesh* mesh)
+	: Mesh(mesh), JointCount(0), FrameCount(1), Memory(0),
+	PosX(0), PosY(0), PosZ(0), NormalX(0), NormalY(0), NormalZ(0),
+	TargetBuffer(0), TargetVertex(0), PaletteMemory(0), Palette(0),
+	PosesPerFrame(0), CachedPoseCount(0)
+{
+	#ifdef _DEBUG
+	setDebugName("CSoaSkin");
+	#endif
+
+	Mesh->grab();
+
+	const core::array<SSkinMeshBuffer*>& buffers = Mesh->getMeshBuffers();
+	const core::array<ISkinnedMesh::SJoint*>& joints = Mesh->getAllJoints();
+	JointCount = joints.size();
+	FrameCount = core::max_(Mesh->getFrameCount(), 1u);
+
+	// the bind pose, and which joint moves every buffer as a whole
+	const u32 identity = JointCount * 2;
+	core::array<u32> attachedTo;
+	BufferStart.reallocate(buffers.size() + 1);
+	for (u32 b=0; b<buffers.size(); ++b)
+	{
+		BufferStart.push_back(BindPose.size());
+		attachedTo.push_back(identity);
+		for (u32 i=0; i<buffers[b]->getVertexCount(); ++i)
+			BindPose.push_back(getStandardVertex(buffers[b], i));
+	}
+	BufferStart.push_back(BindPose.size());
+
+	for (u32 j=0; j<JointCount; ++j)
+		for (u32 m=0; m<joints[j]->AttachedMeshes.size(); ++m)
+			if (joints[j]->AttachedMeshes[m] < attachedTo.size())
+				attachedTo[joints[j]->AttachedMeshes[m]] = JointCount + j;
+
+	// the 4 strongest joints of every vertex, strongest first
+	const u32 vertexCount = BindPose.size();
+	SInfluence none = { 0, 0.f };
+	core::array<SInfluence> influences;
+	influences.set_used(vertexCount * 4);
+	core::array<u8> counts;
+	counts.set_used(vertexCount);
+	core::array<f32> totals;
+	totals.set_used(vertexCount);
+	for (u32 v=0; v<vertexCount; ++v)
+	{
+		for (u32 k=0; k<4; ++k)
+			influences[v*4 + k] = none;
+		counts[v] = 0;
+		totals[v] = 0.f;
+	}
+
+	for (u32 j=0; j<JointCount; ++j)
+	{
+		const core::array<ISkinnedMesh::SWeight>& weights = joints[j]->Weights;
+		for (u32 w=0; w<weights.size(); ++w)
+		{
+			const ISkinnedMesh::SWeight& weight = weights[w];
+			if (weight.buffer_id >= buffers.size() || weight.strength <= 0.f ||
+				weight.vertex_id >= getVertexCount(weight.buffer_id))
+				continue;
+
+			const u32 v = BufferStart[weight.buffer_id] + weight.vertex_id;
+			totals[v] += weight.strength;
+
+			// insert sorted, a fifth joint pushes out the weakest
+			SInfluence* in = &influences[v*4];
+			u32 k = counts[v] < 4 ? counts[v]++ : 4;
+			while (k > 0 && in[k-1].Weight < weight.strength)
+			{
+				if (k < 4)
+					in[k] = in[k-1];
+				--k;
+			}
+			if (k < 4)
+			{
+				in[k].Bone = (u16)j;
+				in[k].Weight = weight.strength;
+			}
+		}
+	}
+
+	// sort the vertices by their amount of joints, so the kernels have no
+	// branches; a vertex without weights follows its buffer, like Irrlicht
+	// moves it with the transformation of the buffer
+	u32 groupSize[5] = { 0, 0, 0, 0, 0 };
+	for (u32 v=0; v<vertexCount; ++v)
+		++groupSize[core::max_<u32>(counts[v], 1)];
+
+	GroupStart[0] = 0;
+	for (u32 n=1; n<5; ++n)
+		GroupStart[n] = GroupStart[n-1] + groupSize[n];
+
+	// every array holds a multiple of 4 vertices, so all stay aligned
+	const u32 stride = (vertexCount + 3) & ~3u;
+	Memory = new u8[stride * (10 * sizeof(f32) + sizeof(u32) + 5 * sizeof(u16)) + 15];
+	f32* base = (f32*)(((size_t)Memory + 15) & ~(size_t)15);
+	PosX = base;
+	PosY = base + stride;
+	PosZ = base + stride * 2;
+	NormalX = base + stride * 3;
+	NormalY = base + stride * 4;
+	NormalZ = base + stride * 5;
+	for (u32 k=0; k<4; ++k)
+		Weight[k] = base + stride * (6 + k);
+	TargetVertex = (u32*)(base + stride * 10);
+	u16* shorts = (u16*)(TargetVertex + stride);
+	for (u32 k=0; k<4; ++k)
+		Bone[k] = shorts + stride * k;
+	TargetBuffer = shorts + stride * 4;
+
+	u32 next[5];
+	memcpy(next, GroupStart, sizeof(next));
+	u32 buffer = 0;
+	for (u32 v=0; v<vertexCount; ++v)
+	{
+		while (v >= BufferStart[buffer+1])
+			++buffer;
+
+		const u32 count = counts[v];
+		const u32 slot = next[core::max_<u32>(count, 1) - 1]++;
+		const video::S3DVertex& vertex = BindPose[v];
+		PosX[slot] = vertex.Pos.X;
+		PosY[slot] = vertex.Pos.Y;
+		PosZ[slot] = vertex.Pos.Z;
+		NormalX[slot] = vertex.Normal.X;
+		NormalY[slot] = vertex.Normal.Y;
+		NormalZ[slot] = vertex.Normal.Z;
+		TargetBuffer[slot] = (u16)buffer;
+		TargetVertex[slot] = v - BufferStart[buffer];
+
+		if (!count)
+		{
+			Bone[0][slot] = (u16)attachedTo[buffer];
+			Weight[0][slot] = 1.f;
+			for (u32 k=1; k<4; ++k)
+			{
+				Bone[k][slot] = 0;
+				Weight[k][slot] = 0.f;
+			}
+			continue;
+		}
+
+		// Irrlicht does not normalize the weights, so keep their sum
+		f32 kept = 0.f;
+		for (u32 k=0; k<count; ++k)
+			kept += influences[v*4 + k].Weight;
+		const f32 scale = totals[v] / kept;
+
+		for (u32 k=0; k<4; ++k)
+		{
+			Bone[k][slot] = influences[v*4 + k].Bone;
+			Weight[k][slot] = influences[v*4 + k].Weight * scale;
+		}
+	}
+
+	PaletteMemory = new u8[(JointCount * 2 + 1) * 16 * sizeof(f32) + 15];
+	Palette = (f32*)(((size_t)PaletteMemory + 15) & ~(size_t)15);
+	memcpy(Palette + identity * 16, core::IdentityMatrix.pointer(), 16 * sizeof(f32));
+
+	// skin every frame once, so characters can be culled before they are skinned
+	core::array<video::S3DVertex> scratch(BindPose);
+	core::array<video::S3DVertex*> targets;
+	for (u32 b=0; b<getBufferCount(); ++b)
+		targets.push_back(scratch.pointer() + BufferStart[b]);
+
+	AnimationBox.reset(vertexCount ? BindPose[0].Pos : core::vector3df(0.f,0.f,0.f));
+	for (u32 f=0; f<FrameCount; ++f)
+	{
+		skin((f32)f, targets.pointer());
+		for (u32 v=0; v<vertexCount; ++v)
+		{
+			AnimationBox.addInternalPoint(BindPose[v].Pos);
+			AnimationBox.addInternalPoint(scratch[v].Pos);
+		}
+	}
+}
+
+
+CSoaSkin::~CSoaSkin()
+{
+	setPoseCache(0);
+	delete [] PaletteMemory;
+	delete [] Memory;
+	Mesh->drop();
+}
+
+
+void CSoaSkin::buildPalette(f32 frame)
+{
+	// does nothing for meshes without animation, their animated matrices
+	// stay those of the bind pose
+	Mesh->animateMesh(frame, 1.f);
+
+	const core::array<ISkinnedMesh::SJoint*>& joints = Mesh->getAllJoints();
+	f32* skinning = Palette;
+	f32* attached = Palette + JointCount * 16;
+	core::matrix4 matrix;
+	for (u32 j=0; j<JointCount; ++j)
+	{
+		// the same product Irrlicht's skinMesh() moves the vertices with
+		matrix.setbyproduct(joints[j]->GlobalAnimatedMatrix, joints[j]->GlobalInversedMatrix);
+		memcpy(skinning + j * 16, matrix.pointer(), 16 * sizeof(f32));
+		memcpy(attached + j * 16, joints[j]->GlobalAnimatedMatrix.pointer(), 16 * sizeof(f32));
+	}
+}
+
+
+template <u32 Influences>
+void CSoaSkin::skinGroup(video::S3DVertex* const* buffers) const
+{
+	const u32 end = GroupStart[Influences];
+	for (u32 i=GroupStart[Influences-1]; i<end; ++i)
+	{
+		video::S3DVertex& out = buffers[TargetBuffer[i]][TargetVertex[i]];
+
+#ifdef _MARS_SKINNING_SSE_
+		// the columns of the blended matrix
+		const f32* m = Palette + ((u32)Bone[0][i] << 4);
+		__m128 w = _mm_set1_ps(Weight[0][i]);
+		__m128 c0 = _mm_mul_ps(_mm_load_ps(m), w);
+		__m128 c1 = _mm_mul_ps(_mm_load_ps(m + 4), w);
+		__m128 c2 = _mm_mul_ps(_mm_load_ps(m + 8), w);
+		__m128 c3 = _mm_mul_ps(_mm_load_ps(m + 12), w);
+		for (u32 k=1; k<Influences; ++k)
+		{
+			m = Palette + ((u32)Bone[k][i] << 4);
+			w = _mm_set1_ps(Weight[k][i]);
+			c0 = _mm_add_ps(c0, _mm_mul_ps(_mm_load_ps(m), w));
+			c1 = _mm_add_ps(c1, _mm_mul_ps(_mm_load_ps(m + 4), w));
+			c2 = _mm_add_ps(c2, _mm_mul_ps(_mm_load_ps(m + 8), w));
+			c3 = _mm_add_ps(c3, _mm_mul_ps(_mm_load_ps(m + 12), w));
+		}
+
+		const __m128 pos = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(PosX[i])), _mm_mul_ps(c1, _mm_set1_ps(PosY[i]))),
+			_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(PosZ[i])), c3));
+		const __m128 normal = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(NormalX[i])), _mm_mul_ps(c1, _mm_set1_ps(NormalY[i]))),
+			_mm_mul_ps(c2, _mm_set1_ps(NormalZ[i])));
+
+		// three floats each, the fourth would overwrite the next member
+		_mm_storel_pi((__m64*)&out.Pos.X, pos);
+		_mm_store_ss(&out.Pos.Z, _mm_movehl_ps(pos, pos));
+		_mm_storel_pi((__m64*)&out.Normal.X, normal);
+		_mm_store_ss(&out.Normal.Z, _mm_movehl_ps(normal, normal));
+#else
+		f32 c[16];
+		const f32* m = Palette + ((u32)Bone[0][i] << 4);
+		f32 w = Weight[0][i];
+		for (u32 e=0; e<16; ++e)
+			c[e] = m[e] * w;
+		for (u32 k=1; k<Influences; ++k)
+		{
+			m = Palette + ((u32)Bone[k][i] << 4);
+			w = Weight[k][i];
+			for (u32 e=0; e<16; ++e)
+				c[e] += m[e] * w;
+		}
+
+		const f32 x = PosX[i], y = PosY[i], z = PosZ[i];
+		out.Pos.X = c[0]*x + c[4]*y + c[8]*z + c[12];
+		out.Pos.Y = c[1]*x + c[5]*y + c[9]*z + c[13];
+		out.Pos.Z = c[2]*x + c[6]*y + c[10]*z + c[14];
+
+		const f32 nx = NormalX[i], ny = NormalY[i], nz = NormalZ[i];
+		out.Normal.X = c[0]*nx + c[4]*ny + c[8]*nz;
+		out.Normal.Y = c[1]*nx + c[5]*ny + c[9]*nz;
+		out.Normal.Z = c[2]*nx + c[6]*ny + c[10]*nz;
+#endif
+	}
+}
+
+
+void CSoaSkin::skin(f32 frame, video::S3DVertex* const* buffers)
+{
+	buildPalette(frame);
+
+	skinGroup<1>(buffers);
+	skinGroup<2>(buffers);
+	skinGroup<3>(buffers);
+	skinGroup<4>(buffers);
+}
+
+
+void CSoaSkin::setPoseCache(u32 posesPerFrame)
+{
+	if (posesPerFrame == PosesPerFrame)
+		return;
+
+	for (u32 i=0; i<Poses.size(); ++i)
+		delete [] Poses[i];
+	Poses.clear();
+	CachedPoseCount = 0;
+
+	PosesPerFrame = posesPerFrame;
+	if (PosesPerFrame)
+	{
+		Poses.set_used((FrameCount - 1) * PosesPerFrame + 1);
+		for (u32 i=0; i<Poses.size(); ++i)
+			Poses[i] = 0;
+	}
+}
+
+
+s32 CSoaSkin::getPoseIndex(f32 frame) const
+{
+	if (!PosesPerFrame)
+		return -1;
+
+	return core::clamp(core::round32(frame * PosesPerFrame), 0, (s32)Poses.size() - 1);
+}
+
+
+const video::S3DVertex* CSoaSkin::getPose(u32 index)
+{
+	if (!Poses[index])
+	{
+		video::S3DVertex* pose = new video::S3DVertex[BindPose.size()];
+		memcpy(pose, BindPose.const_pointer(), BindPose.size() * sizeof(video::S3DVertex));
+
+		core::array<video::S3DVertex*> targets;
+		for (u32 b=0; b<getBufferCount(); ++b)
+			targets.push_back(pose + BufferStart[b]);
+
+		skin(getPoseFrame(index), targets.pointer());
+		Poses[index] = pose;
+		++CachedPoseCount;
+	}
+
+	return Poses[index];
+}
+
+} // end namespace scene
+} // end namespace irr
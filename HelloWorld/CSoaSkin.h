@@ -0,0 +1,143 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_SOA_SKIN_H_INCLUDED__
+#define __C_SOA_SKIN_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Skinning data of one skinned mesh, shared by all characters drawing it.
+/** Irrlicht skins a skinned mesh joint by joint: it walks the weights of
+every joint and adds the moved vertex into the mesh buffers, which are
+shared by all nodes of the mesh, so each node skins the whole mesh again
+whenever it is drawn. This keeps
+
+- the bind pose of every vertex in its own arrays, sorted by the amount of
+  joints which move it, with at most 4 joints and weights per vertex in
+  arrays of their own,
+- one matrix per joint, built once per frame from the joint hierarchy,
+
+and skins a vertex at a time by blending the matrices of its joints, four
+floats at a time with SSE (plain C++ when SSE is not available). The
+result is written into vertex arrays owned by the caller, so every
+character has its own.
+
+Poses of the animation can also be cached: with setPoseCache(), skinned
+poses are kept for a fixed amount of steps per frame, baked the first time
+they are asked for, and a character of the same frame only copies them.
+
+The bind pose is read in the constructor, which must happen before the mesh
+is animated by Irrlicht for the first time: Irrlicht skins into the mesh
+buffers. Vertices of any type are drawn as standard vertices. */
+class CSoaSkin : public virtual IReferenceCounted
+{
+public:
+
+	//! Reads the bind pose and the weights of mesh, which is grabbed.
+	CSoaSkin(ISkinnedMesh* mesh);
+
+	virtual ~CSoaSkin();
+
+	ISkinnedMesh* getMesh() const { return Mesh; }
+
+	u32 getBufferCount() const { return BufferStart.size() - 1; }
+
+	//! Index of the first vertex of buffer in the vertices of all buffers.
+	u32 getBufferStart(u32 buffer) const { return BufferStart[buffer]; }
+
+	u32 getVertexCount(u32 buffer) const { return BufferStart[buffer+1] - BufferStart[buffer]; }
+
+	//! Vertices of all buffers.
+	u32 getVertexCount() const { return BindPose.size(); }
+
+	//! Bind pose of all buffers, one after the other.
+	const video::S3DVertex* getBindPose() const { return BindPose.const_pointer(); }
+
+	u32 getJointCount() const { return JointCount; }
+
+	u32 getFrameCount() const { return FrameCount; }
+
+	//! Box around every frame of the animation.
+	const core::aabbox3df& getAnimationBox() const { return AnimationBox; }
+
+	//! Skins frame into the vertices of every buffer, buffers[i] for buffer i.
+	/** Only positions and normals are written, the rest has to be copied
+	from the bind pose once. */
+	void skin(f32 frame, video::S3DVertex* const* buffers);
+
+	//! Keeps baked poses, posesPerFrame for every frame of the animation, 0 to turn it off.
+	void setPoseCache(u32 posesPerFrame);
+
+	u32 getPosesPerFrame() const { return PosesPerFrame; }
+
+	//! Index of the cached pose closest to frame, -1 if there is no pose cache.
+	s32 getPoseIndex(f32 frame) const;
+
+	//! Frame the pose at index shows.
+	f32 getPoseFrame(u32 index) const { return (f32)index / (f32)PosesPerFrame; }
+
+	//! Returns the vertices of all buffers of a cached pose, one after the other.
+	/** Bakes the pose the first time it is asked for. */
+	const video::S3DVertex* getPose(u32 index);
+
+	u32 getCachedPoseCount() const { return CachedPoseCount; }
+
+	//! Memory the baked poses take.
+	u32 getPoseCacheBytes() const { return CachedPoseCount * BindPose.size() * sizeof(video::S3DVertex); }
+
+private:
+
+	//! Fills the palette with the matrices of frame.
+	void buildPalette(f32 frame);
+
+	//! Skins the vertices moved by Influences joints.
+	template <u32 Influences>
+	void skinGroup(video::S3DVertex* const* buffers) const;
+
+	ISkinnedMesh* Mesh;
+	u32 JointCount;
+	u32 FrameCount;
+
+	core::array<video::S3DVertex> BindPose;
+	//! Plus the vertex count as last entry.
+	core::array<u32> BufferStart;
+
+	//! One allocation for all vertex arrays, each 16 byte aligned.
+	u8* Memory;
+	f32* PosX;
+	f32* PosY;
+	f32* PosZ;
+	f32* NormalX;
+	f32* NormalY;
+	f32* NormalZ;
+	//! Weights and palette entries of up to 4 joints.
+	f32* Weight[4];
+	u16* Bone[4];
+	//! Where a skinned vertex goes.
+	u16* TargetBuffer;
+	u32* TargetVertex;
+	//! Vertices moved by n joints are GroupStart[n-1] to GroupStart[n]-1.
+	u32 GroupStart[5];
+
+	//! 16 floats per entry: a skinning matrix per joint, the animated
+	//! matrix per joint for buffers attached to it, and the identity.
+	u8* PaletteMemory;
+	f32* Palette;
+
+	core::array<video::S3DVertex*> Poses;
+	u32 PosesPerFrame;
+	u32 CachedPoseCount;
+
+	core::aabbox3df AnimationBox;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
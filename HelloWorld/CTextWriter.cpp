@@ -0,0 +1,100 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CTextWriter.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+namespace irr
+{
+
+void appendf(core::stringc& out, const c8* format, ...)
+{
+	c8 buffer[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	buffer[sizeof(buffer)-1] = 0;
+	out += buffer;
+}
+
+
+void appendQuoted(core::stringc& out, const core::stringc& text)
+{
+	out += '"';
+	for (u32 i=0; i<text.size(); ++i)
+	{
+		const c8 c = text[i];
+		if (c == '"' || c == '\\')
+			out += '\\';
+		out += c;
+	}
+	out += '"';
+}
+
+
+CTextWriter::CTextWriter(io::IWriteFile* file)
+	: File(file), Used(0), Failed(false)
+{
+}
+
+
+void CTextWriter::print(const c8* format, ...)
+{
+	c8 line[256];
+	va_list args;
+	va_start(args, format);
+	const s32 length = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if (length > 0)
+		write(line, core::min_((u32)length, (u32)sizeof(line) - 1));
+}
+
+
+void CTextWriter::write(const c8* text, u32 length)
+{
+	if (Used + length > sizeof(Buffer))
+		flush();
+
+	if (length > sizeof(Buffer))
+		Failed |= File->write(text, length) != (s32)length;
+	else
+	{
+		memcpy(Buffer + Used, text, length);
+		Used += length;
+	}
+}
+
+
+void CTextWriter::writeQuoted(const core::stringc& text)
+{
+	write("\"", 1);
+
+	// the runs between the characters to escape are written in one piece
+	u32 start = 0;
+	for (u32 i=0; i<text.size(); ++i)
+	{
+		if (text[i] != '"' && text[i] != '\\')
+			continue;
+		write(text.c_str() + start, i - start);
+		write("\\", 1);
+		start = i;
+	}
+	write(text.c_str() + start, text.size() - start);
+
+	write("\"", 1);
+}
+
+
+bool CTextWriter::flush()
+{
+	if (Used)
+		Failed |= File->write(Buffer, Used) != (s32)Used;
+	Used = 0;
+	return !Failed;
+}
+
+} // end namespace irr
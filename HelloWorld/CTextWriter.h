@@ -0,0 +1,52 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_TEXT_WRITER_H_INCLUDED__
+#define __C_TEXT_WRITER_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+
+//! Appends printf formatted text, up to 255 characters, to out.
+void appendf(core::stringc& out, const c8* format, ...);
+
+//! Appends text as a JSON string, with quotes and backslashes escaped.
+void appendQuoted(core::stringc& out, const core::stringc& text);
+
+//! Writes text to a file through a fixed buffer.
+/** Reports and traces are streamed with it instead of built in one string,
+which Irrlicht grows to the exact size on every append. The file is not
+grabbed and has to stay valid until flush(). */
+class CTextWriter
+{
+public:
+
+	CTextWriter(io::IWriteFile* file);
+
+	//! Writes printf formatted text of up to 255 characters.
+	void print(const c8* format, ...);
+
+	void write(const c8* text, u32 length);
+
+	void write(const core::stringc& text) { write(text.c_str(), text.size()); }
+
+	//! Writes text as a JSON string, like appendQuoted().
+	void writeQuoted(const core::stringc& text);
+
+	//! Writes what is buffered, returns false if any write failed.
+	bool flush();
+
+private:
+
+	io::IWriteFile* File;
+	c8 Buffer[16384];
+	u32 Used;
+	bool Failed;
+};
+
+} // end namespace irr
+
+#endif
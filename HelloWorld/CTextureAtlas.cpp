@@ -0,0 +1,365 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CTextureAtlas.h"
+
+namespace irr
+{
+
+namespace
+{
+
+const u32 ATLAS_LAYOUT_MAGIC = MAKE_IRR_ID('C','A','T','L');
+
+//! Increase whenever the layout file changes, old files are then ignored.
+const u32 ATLAS_LAYOUT_VERSION = 1;
+
+//! Largest cell side, bigger images are scaled down to it.
+const u32 MaxCellSize = 1024;
+
+//! Texels around every cell which repeat the border of its image.
+const u32 Gutter = 4;
+
+// Coordinates this much outside of 0 to 1 still count as inside, the .obj
+// exporters round them.
+const f32 CoordTolerance = 0.001f;
+
+// The layout file is one header followed by one SAtlasLayoutCell per image,
+// each followed by the name of the image, padded to 4 bytes.
+struct SAtlasLayoutHeader
+{
+	u32 Magic;
+	u32 Version;
+	u32 Width;
+	u32 Height;
+	u32 CellCount;
+};
+
+struct SAtlasLayoutCell
+{
+	u32 X;
+	u32 Y;
+	u32 Width;
+	u32 Height;
+	u32 NameLength;
+};
+
+struct SPackedImage
+{
+	video::IImage* Image;
+	u32 Index;
+	//! Cell including the gutter.
+	u32 X, Y, Width, Height;
+	bool Placed;
+
+	// highest first, in the order they were passed for the same height
+	bool operator<(const SPackedImage& other) const
+	{
+		if (Height != other.Height)
+			return Height > other.Height;
+		return Index < other.Index;
+	}
+};
+
+u32 getPowerOfTwo(u32 size)
+{
+	u32 result = 1;
+	while (result < size)
+		result <<= 1;
+	return result;
+}
+
+} // end anonymous namespace
+
+
+CTextureAtlas::CTextureAtlas(video::IVideoDriver* driver, io::IFileSystem* fileSystem)
+	: Driver(driver), FileSystem(fileSystem), Texture(0), Size(0, 0),
+	RemappedBuffers(0), SkippedBuffers(0)
+{
+}
+
+
+CTextureAtlas::~CTextureAtlas()
+{
+	for (u32 i=0; i<RemappedMeshes.size(); ++i)
+		RemappedMeshes[i]->drop();
+}
+
+
+video::IImage* CTextureAtlas::build(const core::array<io::path>& images, u32 maxSize)
+{
+	Cells.clear();
+	Size = core::dimension2d<u32>(0, 0);
+
+	core::array<SPackedImage> packed;
+	for (u32 i=0; i<images.size(); ++i)
+	{
+		video::IImage* image = Driver->createImageFromFile(images[i]);
+		if (!image)
+			continue;
+
+		SPackedImage p;
+		p.Image = image;
+		p.Index = i;
+		p.X = p.Y = 0;
+		p.Width = core::min_(getPowerOfTwo(image->getDimension().Width), MaxCellSize);
+		p.Height = core::min_(getPowerOfTwo(image->getDimension().Height), MaxCellSize);
+		p.Placed = false;
+		packed.push_back(p);
+	}
+	packed.sort();
+
+	// shelves from the top, each as high as its first cell
+	u32 x = 0;
+	u32 y = 0;
+	u32 shelfHeight = 0;
+	u32 width = 0;
+	for (u32 i=0; i<packed.size(); ++i)
+	{
+		SPackedImage& p = packed[i];
+		if (p.Width > maxSize)
+			continue;
+
+		if (x + p.Width > maxSize)
+		{
+			y += shelfHeight;
+			x = 0;
+			shelfHeight = 0;
+		}
+		if (y + p.Height > maxSize)
+			continue;
+
+		p.X = x;
+		p.Y = y;
+		p.Placed = true;
+		x += p.Width;
+		shelfHeight = core::max_(shelfHeight, p.Height);
+		width = core::max_(width, x);
+	}
+
+	video::IImage* atlas = 0;
+	if (width)
+	{
+		Size.Width = getPowerOfTwo(width);
+		Size.Height = getPowerOfTwo(y + shelfHeight);
+		atlas = Driver->createImage(video::ECF_A8R8G8B8, Size);
+		atlas->fill(video::SColor(0, 0, 0, 0));
+
+		u32* target = (u32*)atlas->lock();
+		const u32 pitch = atlas->getPitch() / 4;
+		core::array<u32> pixels;
+		for (u32 i=0; i<packed.size(); ++i)
+		{
+			const SPackedImage& p = packed[i];
+			if (!p.Placed)
+				continue;
+
+			SCell cell;
+			cell.Name = images[p.Index];
+			cell.TextureName = io::SNamedPath(FileSystem->getAbsolutePath(cell.Name));
+			cell.X = p.X + Gutter;
+			cell.Y = p.Y + Gutter;
+			cell.Width = p.Width - Gutter * 2;
+			cell.Height = p.Height - Gutter * 2;
+			Cells.push_back(cell);
+
+			pixels.set_used(cell.Width * cell.Height);
+			p.Image->copyToScaling(pixels.pointer(), cell.Width, cell.Height, video::ECF_A8R8G8B8);
+
+			// the gutter repeats the nearest texel of the image
+			for (u32 ty=0; ty<p.Height; ++ty)
+			{
+				const u32 sy = (u32)core::clamp((s32)ty - (s32)Gutter, 0, (s32)cell.Height - 1);
+				const u32* source = pixels.const_pointer() + sy * cell.Width;
+				u32* row = target + (p.Y + ty) * pitch + p.X;
+				for (u32 tx=0; tx<p.Width; ++tx)
+					row[tx] = source[core::clamp((s32)tx - (s32)Gutter, 0, (s32)cell.Width - 1)];
+			}
+		}
+		atlas->unlock();
+	}
+
+	for (u32 i=0; i<packed.size(); ++i)
+		packed[i].Image->drop();
+
+	return atlas;
+}
+
+
+bool CTextureAtlas::writeLayout(const io::path& filename) const
+{
+	io::IWriteFile* file = FileSystem->createAndWriteFile(filename);
+	if (!file)
+		return false;
+
+	SAtlasLayoutHeader header;
+	header.Magic = ATLAS_LAYOUT_MAGIC;
+	header.Version = ATLAS_LAYOUT_VERSION;
+	header.Width = Size.Width;
+	header.Height = Size.Height;
+	header.CellCount = Cells.size();
+	bool written = file->write(&header, sizeof(header)) == (s32)sizeof(header);
+
+	const u32 zero = 0;
+	for (u32 i=0; written && i<Cells.size(); ++i)
+	{
+		const SCell& cell = Cells[i];
+		SAtlasLayoutCell cooked;
+		cooked.X = cell.X;
+		cooked.Y = cell.Y;
+		cooked.Width = cell.Width;
+		cooked.Height = cell.Height;
+		cooked.NameLength = cell.Name.size();
+
+		const u32 padding = (4 - (cooked.NameLength & 3)) & 3;
+		written = file->write(&cooked, sizeof(cooked)) == (s32)sizeof(cooked) &&
+			file->write(cell.Name.c_str(), cooked.NameLength) == (s32)cooked.NameLength &&
+			(!padding || file->write(&zero, padding) == (s32)padding);
+	}
+
+	file->drop();
+	return written;
+}
+
+
+bool CTextureAtlas::readLayout(const io::path& filename)
+{
+	io::IReadFile* file = FileSystem->createAndOpenFile(filename);
+	if (!file)
+		return false;
+
+	const u32 fileSize = (u32)file->getSize();
+	SAtlasLayoutHeader header;
+	bool valid = file->read(&header, sizeof(header)) == (s32)sizeof(header) &&
+		header.Magic == ATLAS_LAYOUT_MAGIC && header.Version == ATLAS_LAYOUT_VERSION &&
+		header.Width && header.Height && header.Width <= 16384 && header.Height <= 16384 &&
+		header.CellCount <= fileSize / sizeof(SAtlasLayoutCell);
+
+	core::array<SCell> cells;
+	core::array<c8> name;
+	for (u32 i=0; valid && i<header.CellCount; ++i)
+	{
+		SAtlasLayoutCell cooked;
+		valid = file->read(&cooked, sizeof(cooked)) == (s32)sizeof(cooked) &&
+			cooked.NameLength && cooked.NameLength < fileSize &&
+			cooked.X + cooked.Width <= header.Width && cooked.Y + cooked.Height <= header.Height;
+		if (!valid)
+			break;
+
+		const u32 padded = (cooked.NameLength + 3) & ~3u;
+		name.set_used(padded);
+		valid = file->read(name.pointer(), padded) == (s32)padded;
+		if (!valid)
+			break;
+
+		SCell cell;
+		cell.Name = core::stringc(name.const_pointer(), cooked.NameLength);
+		cell.TextureName = io::SNamedPath(FileSystem->getAbsolutePath(cell.Name));
+		cell.X = cooked.X;
+		cell.Y = cooked.Y;
+		cell.Width = cooked.Width;
+		cell.Height = cooked.Height;
+		cells.push_back(cell);
+	}
+	file->drop();
+
+	if (!valid)
+		return false;
+
+	Cells = cells;
+	Size = core::dimension2d<u32>(header.Width, header.Height);
+	return true;
+}
+
+
+s32 CTextureAtlas::findCell(const video::ITexture* texture) const
+{
+	if (!texture || texture == Texture)
+		return -1;
+
+	for (u32 i=0; i<Cells.size(); ++i)
+		if (texture->getName() == Cells[i].TextureName)
+			return (s32)i;
+	return -1;
+}
+
+
+bool CTextureAtlas::containsImage(const io::path& filename) const
+{
+	const io::SNamedPath name(FileSystem->getAbsolutePath(filename));
+	for (u32 i=0; i<Cells.size(); ++i)
+		if (name == Cells[i].TextureName)
+			return true;
+	return false;
+}
+
+
+u32 CTextureAtlas::remapMesh(scene::IMesh* mesh)
+{
+	if (!Texture || !mesh)
+		return 0;
+
+	// the skipped buffers of a cached mesh would be counted once per caller
+	if (RemappedMeshes.linear_search(mesh) >= 0)
+		return 0;
+	RemappedMeshes.push_back(mesh);
+	mesh->grab();
+
+	u32 remapped = 0;
+	for (u32 b=0; b<mesh->getMeshBufferCount(); ++b)
+	{
+		scene::IMeshBuffer* buffer = mesh->getMeshBuffer(b);
+		video::SMaterial& material = buffer->getMaterial();
+		const s32 c = findCell(material.getTexture(0));
+		if (c == -1)
+			continue;
+
+		// a second layer would still be bound, and repeating coordinates
+		// would run into the neighbouring cells
+		const u32 vertexCount = buffer->getVertexCount();
+		bool inside = !material.getTexture(1);
+		for (u32 v=0; inside && v<vertexCount; ++v)
+		{
+			const core::vector2df& coords = buffer->getTCoords(v);
+			inside = coords.X >= -CoordTolerance && coords.X <= 1.f + CoordTolerance &&
+				coords.Y >= -CoordTolerance && coords.Y <= 1.f + CoordTolerance;
+		}
+		if (!inside)
+		{
+			++SkippedBuffers;
+			continue;
+		}
+
+		const SCell& cell = Cells[c];
+		const core::vector2df offset((f32)cell.X / Size.Width, (f32)cell.Y / Size.Height);
+		const core::vector2df scale((f32)cell.Width / Size.Width, (f32)cell.Height / Size.Height);
+		for (u32 v=0; v<vertexCount; ++v)
+		{
+			core::vector2df& coords = buffer->getTCoords(v);
+			coords.X = offset.X + core::clamp(coords.X, 0.f, 1.f) * scale.X;
+			coords.Y = offset.Y + core::clamp(coords.Y, 0.f, 1.f) * scale.Y;
+		}
+
+		material.setTexture(0, Texture);
+		buffer->setDirty(scene::EBT_VERTEX);
+		++remapped;
+	}
+
+	RemappedBuffers += remapped;
+	return remapped;
+}
+
+
+f32 CTextureAtlas::getOccupancy() const
+{
+	if (!Size.Width || !Size.Height)
+		return 0.f;
+
+	u32 covered = 0;
+	for (u32 i=0; i<Cells.size(); ++i)
+		covered += (Cells[i].Width + Gutter * 2) * (Cells[i].Height + Gutter * 2);
+	return (f32)covered / ((f32)Size.Width * Size.Height);
+}
+
+} // end namespace irr
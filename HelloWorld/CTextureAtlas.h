@@ -0,0 +1,116 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_TEXTURE_ATLAS_H_INCLUDED__
+#define __C_TEXTURE_ATLAS_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+
+//! Packs several images into one texture and moves mesh buffers onto it.
+/** Every image gets a cell of its size rounded up to a power of two, at
+most 1024 texels a side. The image is scaled into the cell less a gutter of
+4 texels, which repeats its border, so bilinear filtering and the first mip
+levels do not pull in the colors of the neighbouring cells. The cells are
+packed in shelves, highest first, into the smallest power of two size which
+holds them.
+
+remapMesh() then moves the texture coordinates of every mesh buffer whose
+first texture is one of the packed images into its cell, and gives it the
+atlas texture instead. This only works for coordinates within 0 to 1, a
+buffer which repeats its texture or uses a second texture layer keeps its
+own texture.
+
+The layout can be written to a small binary file, so the atlas image and
+its layout are built once and loaded afterwards, see TextureCooker.h. */
+class CTextureAtlas
+{
+public:
+
+	CTextureAtlas(video::IVideoDriver* driver, io::IFileSystem* fileSystem);
+
+	~CTextureAtlas();
+
+	//! Packs images into a new layout and draws the atlas image of it.
+	/** Images which can not be loaded or do not fit into maxSize texels
+	a side are left out.
+	\return The atlas image, to be dropped by the caller, or 0 if no image
+	was packed. */
+	video::IImage* build(const core::array<io::path>& images, u32 maxSize=2048);
+
+	//! Writes the layout, returns false if the file could not be written.
+	bool writeLayout(const io::path& filename) const;
+
+	//! Replaces the layout by the one in filename.
+	/** \return False if the file is missing, broken or of another version. */
+	bool readLayout(const io::path& filename);
+
+	//! Sets the texture made of the atlas image. It is not grabbed, the driver keeps it.
+	void setTexture(video::ITexture* texture) { Texture = texture; }
+
+	video::ITexture* getTexture() const { return Texture; }
+
+	//! Moves the buffers of mesh using a packed image onto the atlas.
+	/** Meshes which were remapped before are left alone and not counted
+	again, so a mesh from the mesh cache can be remapped by every caller.
+	\return The amount of buffers moved. */
+	u32 remapMesh(scene::IMesh* mesh);
+
+	//! Size of the atlas in texels.
+	const core::dimension2d<u32>& getSize() const { return Size; }
+
+	u32 getImageCount() const { return Cells.size(); }
+
+	//! Name of a packed image, as it was passed to build().
+	const io::path& getImageName(u32 i) const { return Cells[i].Name; }
+
+	//! Returns true if the image of filename was packed.
+	bool containsImage(const io::path& filename) const;
+
+	//! Share of the atlas covered by cells, gutters included.
+	f32 getOccupancy() const;
+
+	//! Buffers moved onto the atlas by remapMesh().
+	u32 getRemappedBufferCount() const { return RemappedBuffers; }
+
+	//! Buffers using a packed image which could not be moved.
+	u32 getSkippedBufferCount() const { return SkippedBuffers; }
+
+private:
+
+	// the remapped meshes are grabbed, a copy would drop them twice
+	CTextureAtlas(const CTextureAtlas& other);
+	CTextureAtlas& operator=(const CTextureAtlas& other);
+
+	struct SCell
+	{
+		io::path Name;
+		//! Compared with the names of the textures of the buffers.
+		io::SNamedPath TextureName;
+		//! Area the image was scaled into, without the gutter.
+		u32 X, Y, Width, Height;
+	};
+
+	//! Returns the cell of the image of texture, -1 if it was not packed.
+	s32 findCell(const video::ITexture* texture) const;
+
+	video::IVideoDriver* Driver;
+	io::IFileSystem* FileSystem;
+	video::ITexture* Texture;
+
+	core::array<SCell> Cells;
+	core::dimension2d<u32> Size;
+
+	//! Meshes passed to remapMesh(), grabbed so their addresses are not reused.
+	core::array<scene::IMesh*> RemappedMeshes;
+
+	u32 RemappedBuffers;
+	u32 SkippedBuffers;
+};
+
+} // end namespace irr
+
+#endif
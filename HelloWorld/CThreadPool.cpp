@@ -0,0 +1,90 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CThreadPool.h"
+
+namespace irr
+{
+
+CThreadPool::CThreadPool(u32 threadCount)
+	: RunningJobs(0), Stopping(false)
+{
+	if (!threadCount)
+		threadCount = getHardwareThreadCount();
+
+	Threads.reserve(threadCount);
+	for (u32 i=0; i<threadCount; ++i)
+		Threads.push_back(std::thread(&CThreadPool::workerLoop, this));
+}
+
+
+CThreadPool::~CThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Stopping = true;
+	}
+	JobAdded.notify_all();
+
+	for (u32 i=0; i<Threads.size(); ++i)
+		Threads[i].join();
+}
+
+
+void CThreadPool::addJob(JobFunction function, void* data)
+{
+	SJob job;
+	job.Function = function;
+	job.Data = data;
+
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Jobs.push_back(job);
+	}
+	JobAdded.notify_one();
+}
+
+
+void CThreadPool::waitForAll()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	while (!Jobs.empty() || RunningJobs)
+		AllDone.wait(lock);
+}
+
+
+u32 CThreadPool::getHardwareThreadCount()
+{
+	const u32 count = std::thread::hardware_concurrency();
+	return count ? count : 1;
+}
+
+
+void CThreadPool::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	for (;;)
+	{
+		while (Jobs.empty() && !Stopping)
+			JobAdded.wait(lock);
+
+		// the queue is drained before the workers stop
+		if (Jobs.empty())
+			return;
+
+		const SJob job = Jobs.front();
+		Jobs.pop_front();
+		++RunningJobs;
+
+		lock.unlock();
+		job.Function(job.Data);
+		lock.lock();
+
+		--RunningJobs;
+		if (Jobs.empty() && !RunningJobs)
+			AllDone.notify_all();
+	}
+}
+
+} // end namespace irr
@@ -0,0 +1,74 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_THREAD_POOL_H_INCLUDED__
+#define __C_THREAD_POOL_H_INCLUDED__
+
+#include <irrlicht.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace irr
+{
+
+//! Fixed amount of worker threads running jobs from one queue.
+/** Jobs must not call into the video driver, the scene manager or the GUI
+environment; Irrlicht is not thread safe. They may use objects they own
+and engine functions which only work on their arguments, like decoding an
+image from a memory file. */
+class CThreadPool
+{
+public:
+
+	typedef void (*JobFunction)(void* data);
+
+	//! Starts the workers.
+	/** \param threadCount Amount of workers, 0 for one per hardware thread. */
+	explicit CThreadPool(u32 threadCount=0);
+
+	//! Finishes all queued jobs and stops the workers.
+	~CThreadPool();
+
+	//! Queues function(data) to run on one of the workers.
+	void addJob(JobFunction function, void* data);
+
+	//! Blocks until the queue is empty and no job is running.
+	void waitForAll();
+
+	u32 getThreadCount() const { return (u32)Threads.size(); }
+
+	//! Returns the amount of hardware threads, at least 1.
+	static u32 getHardwareThreadCount();
+
+private:
+
+	// not copyable
+	CThreadPool(const CThreadPool&);
+	CThreadPool& operator=(const CThreadPool&);
+
+	struct SJob
+	{
+		JobFunction Function;
+		void* Data;
+	};
+
+	void workerLoop();
+
+	std::vector<std::thread> Threads;
+	std::deque<SJob> Jobs;
+	std::mutex Mutex;
+	//! Signalled when a job is queued or the pool stops.
+	std::condition_variable JobAdded;
+	//! Signalled when the last running job finishes.
+	std::condition_variable AllDone;
+	u32 RunningJobs;
+	bool Stopping;
+};
+
+} // end namespace irr
+
+#endif
@@ -0,0 +1,1385 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CTiledSoftwareRenderer.h"
+#include "CCubeFieldSceneNode.h"
+#include "CFrameProfiler.h"
+#include "CLodMeshSceneNode.h"
+#include "CPagedTerrainSceneNode.h"
+#include "CSkinnedCharacterSceneNode.h"
+#include "CSoaParticleSystemSceneNode.h"
+#include "CWaveSurfaceSceneNode.h"
+#include "CWorkStealingPool.h"
+#include "PreciseTimer.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define _MARS_TILED_SSE_
+#include <xmmintrin.h>
+#endif
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+//! Side of a tile in pixels, a multiple of 4 so groups of pixels never cross tiles.
+const u32 TileSize = 64;
+
+const u32 VertexChunkSize = 1024;
+
+const u32 TriangleChunkSize = 512;
+
+//! Most lights per buffer, what the fixed function pipeline has.
+const u32 MaxLights = 8;
+
+//! Largest side of a copied texture, bigger ones are scaled down.
+const u32 MaxTextureSize = 1024;
+
+//! Two triangles per billboard, like the particle system and Irrlicht's billboards.
+const u16 BillboardIndices[6] = { 0, 2, 1, 0, 3, 2 };
+
+u32 getPowerOfTwo(u32 size)
+{
+	u32 result = 1;
+	while (result < size)
+		result <<= 1;
+	return result;
+}
+
+
+u32 getShift(u32 powerOfTwo)
+{
+	u32 shift = 0;
+	while ((1u << shift) < powerOfTwo)
+		++shift;
+	return shift;
+}
+
+
+//! Average of four A8R8G8B8 colors.
+u32 averageColor(u32 a, u32 b, u32 c, u32 d)
+{
+	u32 result = 0;
+	for (u32 shift=0; shift<32; shift+=8)
+	{
+		const u32 sum = ((a >> shift) & 255) + ((b >> shift) & 255) + ((c >> shift) & 255) + ((d >> shift) & 255);
+		result |= ((sum + 2) >> 2) << shift;
+	}
+	return result;
+}
+
+
+s32 clampColor(s32 value)
+{
+	return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+
+u32 getIndex(const void* indices, bool indices32, u32 i)
+{
+	return indices32 ? ((const u32*)indices)[i] : ((const u16*)indices)[i];
+}
+
+} // end anonymous namespace
+
+
+bool CTiledSoftwareRenderer::SItem::operator<(const SItem& other) const
+{
+	if (Pass != other.Pass)
+		return Pass < other.Pass;
+
+	// solid front to back, so the depth test drops more pixels before
+	// they are shaded, transparent back to front
+	if (Pass == 2)
+		return Depth > other.Depth;
+	return Depth < other.Depth;
+}
+
+
+CTiledSoftwareRenderer::CTiledSoftwareRenderer(ISceneManager* smgr, const core::dimension2d<u32>& size, u32 threadCount)
+	: SceneManager(smgr), Pool(0), Size(size), SkyDome(0), SkyDomeNode(0), NearW(1.f),
+	FogType(video::EFT_FOG_LINEAR), FogStart(0.f), FogEnd(0.f), FogDensity(0.f),
+	Target(0), ColorImage(0)
+{
+	#ifdef _DEBUG
+	setDebugName("CTiledSoftwareRenderer");
+	#endif
+
+	SceneManager->grab();
+	Pool = new CWorkStealingPool(threadCount);
+
+	TilesX = (Size.Width + TileSize - 1) / TileSize;
+	TilesY = (Size.Height + TileSize - 1) / TileSize;
+	Bins.set_used(0);
+	Bins.reallocate(TilesX * TilesY);
+	for (u32 i=0; i<TilesX * TilesY; ++i)
+		Bins.push_back(core::array<u32>());
+
+	Color.set_used(Size.Width * Size.Height);
+	// groups of four pixels at the end of the last row read a little further
+	Depth.set_used(Size.Width * Size.Height + 4);
+	memset(Color.pointer(), 0, Color.size() * sizeof(u32));
+	memset(Depth.pointer(), 0, Depth.size() * sizeof(f32));
+}
+
+
+CTiledSoftwareRenderer::~CTiledSoftwareRenderer()
+{
+	delete Pool;
+
+	for (u32 i=0; i<Textures.size(); ++i)
+	{
+		const_cast<video::ITexture*>(Textures[i]->Source)->drop();
+		delete Textures[i];
+	}
+
+	if (SkyDome)
+		SkyDome->drop();
+	if (ColorImage)
+		ColorImage->drop();
+	if (Target)
+		SceneManager->getVideoDriver()->removeTexture(Target);
+
+	SceneManager->drop();
+}
+
+
+u32 CTiledSoftwareRenderer::getThreadCount() const
+{
+	return Pool->getThreadCount();
+}
+
+
+u32 CTiledSoftwareRenderer::getTextureBytes() const
+{
+	u32 bytes = 0;
+	for (u32 i=0; i<Textures.size(); ++i)
+		for (u32 l=0; l<Textures[i]->Levels.size(); ++l)
+			bytes += Textures[i]->Levels[l].Texels.size() * sizeof(u32);
+	return bytes;
+}
+
+
+void CTiledSoftwareRenderer::drawAll(u32 timeMs)
+{
+	const f64 start = getPreciseTimeMs();
+	LastStats = STiledRenderStats();
+
+	ISceneNode* root = SceneManager->getRootSceneNode();
+	root->OnAnimate(timeMs);
+
+	ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	if (!camera)
+		return;
+
+	// the camera updates its matrices and its frustum when it is drawn
+	camera->render();
+	View = camera->getViewMatrix();
+	ViewProjection = camera->getProjectionMatrix();
+	ViewProjection *= View;
+	NearW = core::max_(camera->getNearValue(), 0.001f);
+	AmbientLight = SceneManager->getAmbientLight();
+
+	bool pixelFog, rangeFog;
+	SceneManager->getVideoDriver()->getFog(FogColor, FogType, FogStart, FogEnd, FogDensity, pixelFog, rangeFog);
+
+	Items.set_used(0);
+	Lights.set_used(0);
+	ItemLights.set_used(0);
+	Billboards.set_used(0);
+	gather(root, camera);
+
+	// the billboards do not move any more
+	for (u32 i=0; i<Items.size(); ++i)
+		if (!Items[i].Vertices)
+			Items[i].Vertices = Billboards.const_pointer() + Items[i].FirstBillboard;
+
+	Items.sort();
+
+	VertexChunks.set_used(0);
+	TriangleChunks.set_used(0);
+	u32 vertexCount = 0;
+	u32 triangleCount = 0;
+	u32 outputCount = 0;
+	for (u32 i=0; i<Items.size(); ++i)
+	{
+		SItem& item = Items[i];
+		pickLights(item);
+
+		item.FirstVertex = vertexCount;
+		vertexCount += item.VertexCount;
+
+		SChunk chunk;
+		chunk.Item = i;
+		chunk.FirstOutput = 0;
+		chunk.OutputCount = 0;
+		for (chunk.First=0; chunk.First<item.VertexCount; chunk.First+=VertexChunkSize)
+		{
+			chunk.Count = core::min_(VertexChunkSize, item.VertexCount - chunk.First);
+			VertexChunks.push_back(chunk);
+		}
+
+		// clipping at the near plane makes at most two triangles of one
+		const u32 triangles = item.IndexCount / 3;
+		for (chunk.First=0; chunk.First<triangles; chunk.First+=TriangleChunkSize)
+		{
+			chunk.Count = core::min_(TriangleChunkSize, triangles - chunk.First);
+			chunk.FirstOutput = outputCount;
+			outputCount += chunk.Count * 2;
+			TriangleChunks.push_back(chunk);
+		}
+		triangleCount += triangles;
+	}
+	Vertices.set_used(vertexCount);
+	Triangles.set_used(outputCount);
+
+	const f64 gathered = getPreciseTimeMs();
+	LastStats.GatherMs = gathered - start;
+	CFrameProfiler::report("tiled_gather", start, gathered);
+
+	Pool->run(transformJob, this, VertexChunks.size(), 1);
+	Pool->run(setupJob, this, TriangleChunks.size(), 1);
+
+	const f64 transformed = getPreciseTimeMs();
+	LastStats.TransformMs = transformed - gathered;
+	CFrameProfiler::report("tiled_transform", gathered, transformed);
+
+	Pool->run(binJob, this, TilesY, 1);
+
+	const f64 binned = getPreciseTimeMs();
+	LastStats.BinMs = binned - transformed;
+	CFrameProfiler::report("tiled_bin", transformed, binned);
+
+	Pool->run(rasterJob, this, TilesX * TilesY, 1);
+
+	const f64 end = getPreciseTimeMs();
+	LastStats.RasterMs = end - binned;
+	CFrameProfiler::report("tiled_raster", binned, end);
+
+	LastStats.Items = Items.size();
+	LastStats.Triangles = triangleCount;
+	for (u32 i=0; i<TriangleChunks.size(); ++i)
+		LastStats.SetupTriangles += TriangleChunks[i].OutputCount;
+	for (u32 i=0; i<Bins.size(); ++i)
+		LastStats.BinnedTriangles += Bins[i].size();
+}
+
+
+void CTiledSoftwareRenderer::present()
+{
+	const f64 start = getPreciseTimeMs();
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+
+	if (!Target)
+	{
+		const bool mipMaps = driver->getTextureCreationFlag(video::ETCF_CREATE_MIP_MAPS);
+		driver->setTextureCreationFlag(video::ETCF_CREATE_MIP_MAPS, false);
+		Target = driver->addTexture(Size, "tiled_software_renderer", video::ECF_A8R8G8B8);
+		driver->setTextureCreationFlag(video::ETCF_CREATE_MIP_MAPS, mipMaps);
+
+		ColorImage = driver->createImageFromData(video::ECF_A8R8G8B8, Size, Color.pointer(), true, false);
+	}
+
+	if (Target && ColorImage)
+	{
+		// the driver may have rounded the size up or keep another format
+		const core::dimension2d<u32>& size = Target->getSize();
+		void* pixels = Target->lock(video::ETLM_WRITE_ONLY);
+		if (pixels)
+		{
+			ColorImage->copyToScaling(pixels, size.Width, size.Height, Target->getColorFormat(), Target->getPitch());
+			Target->unlock();
+		}
+
+		const core::dimension2d<u32>& screen = driver->getScreenSize();
+		driver->draw2DImage(Target, core::rect<s32>(0, 0, screen.Width, screen.Height),
+			core::rect<s32>(0, 0, size.Width, size.Height));
+	}
+
+	const f64 end = getPreciseTimeMs();
+	LastStats.PresentMs = end - start;
+	CFrameProfiler::report("tiled_present", start, end);
+}
+
+
+void CTiledSoftwareRenderer::gather(ISceneNode* node, const ICameraSceneNode* camera)
+{
+	if (!node->isVisible())
+		return;
+
+	const ESCENE_NODE_TYPE type = node->getType();
+	if (type == ESNT_LIGHT)
+	{
+		SLightInfo light;
+		light.Light = ((ILightSceneNode*)node)->getLightData();
+		light.Position = node->getAbsolutePosition();
+		Lights.push_back(light);
+	}
+	else if (type == ESNT_SKY_DOME)
+		addSkyDome(node, camera);
+	else if (!SceneManager->isCulled(node))
+	{
+		const core::matrix4& world = node->getAbsoluteTransformation();
+		switch (type)
+		{
+		case ESNT_MESH:
+		case ESNT_CUBE:
+		case ESNT_SPHERE:
+		case ESNT_OCTREE:
+			{
+				IMeshSceneNode* meshNode = (IMeshSceneNode*)node;
+				IMesh* mesh = meshNode->getMesh();
+				for (u32 b=0; mesh && b<mesh->getMeshBufferCount(); ++b)
+				{
+					const IMeshBuffer* buffer = mesh->getMeshBuffer(b);
+					const bool readOnly = meshNode->isReadOnlyMaterials() || b >= node->getMaterialCount();
+					addItem(node, buffer, readOnly ? buffer->getMaterial() : node->getMaterial(b), world);
+				}
+			}
+			break;
+		case ESNT_ANIMATED_MESH:
+			{
+				// skinned meshes are only animated in render()
+				IAnimatedMeshSceneNode* animatedNode = (IAnimatedMeshSceneNode*)node;
+				IAnimatedMesh* animated = animatedNode->getMesh();
+				if (!animated || animated->getMeshType() == EAMT_SKINNED)
+					break;
+
+				IMesh* mesh = animated->getMesh((s32)animatedNode->getFrameNr());
+				for (u32 b=0; mesh && b<mesh->getMeshBufferCount(); ++b)
+				{
+					const IMeshBuffer* buffer = mesh->getMeshBuffer(b);
+					const bool readOnly = animatedNode->isReadOnlyMaterials() || b >= node->getMaterialCount();
+					addItem(node, buffer, readOnly ? buffer->getMaterial() : node->getMaterial(b), world);
+				}
+			}
+			break;
+		case ESNT_BILLBOARD:
+			addBillboard((IBillboardSceneNode*)node, camera);
+			break;
+		default:
+			break;
+		}
+
+		if (type == ESNT_LOD_MESH)
+		{
+			CLodMeshSceneNode* lodNode = (CLodMeshSceneNode*)node;
+			lodNode->updateLevel();
+			IMesh* mesh = lodNode->getCurrentMesh();
+			for (u32 b=0; b<mesh->getMeshBufferCount(); ++b)
+			{
+				const IMeshBuffer* buffer = mesh->getMeshBuffer(b);
+				addItem(node, buffer, b < node->getMaterialCount() ? node->getMaterial(b) : buffer->getMaterial(), world);
+			}
+		}
+		else if (type == ESNT_CUBE_FIELD)
+		{
+			CCubeFieldSceneNode* cubeField = (CCubeFieldSceneNode*)node;
+			if (cubeField->getInstanceCount())
+				addItem(node, cubeField->getMergedBuffer(), node->getMaterial(0), world);
+		}
+		else if (type == ESNT_PAGED_TERRAIN)
+		{
+			TerrainTiles.set_used(0);
+			((CPagedTerrainSceneNode*)node)->getVisibleTiles(*camera->getViewFrustum(), TerrainTiles);
+			for (u32 i=0; i<TerrainTiles.size(); ++i)
+				addItem(node, TerrainTiles[i], node->getMaterial(0), world);
+		}
+		else if (type == ESNT_WAVE_SURFACE)
+		{
+			CWaveSurfaceSceneNode* water = (CWaveSurfaceSceneNode*)node;
+			for (u32 i=0; i<water->getPatchCount(); ++i)
+				addItem(node, water->getPatchBuffer(i), node->getMaterial(0), world);
+		}
+		else if (type == ESNT_SKINNED_CHARACTER)
+		{
+			CSkinnedCharacterSceneNode* character = (CSkinnedCharacterSceneNode*)node;
+			character->updatePose();
+			for (u32 i=0; i<character->getBufferCount(); ++i)
+			{
+				const IMeshBuffer* buffer = character->getBuffer(i);
+				addItem(node, buffer, buffer->getMaterial(), world);
+			}
+		}
+		else if (type == ESNT_SOA_PARTICLE_SYSTEM)
+		{
+			CSoaParticleSystemSceneNode* particles = (CSoaParticleSystemSceneNode*)node;
+			const u32 count = particles->getParticleCount();
+			if (count)
+			{
+				// the billboards are in world space, in batches like render() draws them
+				particles->buildBillboards(camera);
+				const u32 batch = particles->getBatchSize();
+				for (u32 first=0; first<count; first+=batch)
+				{
+					const u32 n = core::min_(batch, count - first);
+					addItem(node, particles->getBillboardVertices() + first * 4, n * 4, video::EVT_STANDARD,
+						particles->getBatchIndices(), n * 6, false, node->getMaterial(0),
+						core::IdentityMatrix, node->getTransformedBoundingBox());
+				}
+			}
+		}
+	}
+
+	const core::list<ISceneNode*>& children = node->getChildren();
+	for (core::list<ISceneNode*>::ConstIterator it = children.begin(); it != children.end(); ++it)
+		gather(*it, camera);
+}
+
+
+void CTiledSoftwareRenderer::addItem(ISceneNode* node, const IMeshBuffer* buffer,
+	const video::SMaterial& material, const core::matrix4& world)
+{
+	if (!buffer)
+		return;
+
+	core::aabbox3df box(buffer->getBoundingBox());
+	world.transformBoxEx(box);
+	addItem(node, buffer->getVertices(), buffer->getVertexCount(), buffer->getVertexType(),
+		buffer->getIndices(), buffer->getIndexCount(), buffer->getIndexType() == video::EIT_32BIT,
+		material, world, box);
+}
+
+
+void CTiledSoftwareRenderer::addItem(ISceneNode* node, const void* vertices, u32 vertexCount,
+	video::E_VERTEX_TYPE type, const void* indices, u32 indexCount, bool indices32,
+	const video::SMaterial& material, const core::matrix4& world, const core::aabbox3df& worldBox)
+{
+	if (!vertexCount || indexCount < 3)
+		return;
+
+	SItem item;
+	item.Vertices = vertices;
+	item.VertexCount = vertexCount;
+	item.VertexPitch = video::getVertexPitchFromType(type);
+	item.TwoCoords = type == video::EVT_2TCOORDS;
+	item.Indices = indices;
+	item.Indices32 = indices32;
+	item.IndexCount = indexCount;
+	item.World = world;
+	item.Material = &material;
+	item.BackfaceCulling = material.BackfaceCulling;
+	item.FrontfaceCulling = material.FrontfaceCulling;
+	item.Center = worldBox.getCenter();
+	item.Radius = worldBox.getExtent().getLength() * 0.5f;
+	item.FirstBillboard = 0;
+	item.FirstLight = 0;
+	item.LightCount = 0;
+	item.FirstVertex = 0;
+
+	const ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	item.Depth = item.Center.getDistanceFromSQ(camera->getAbsolutePosition());
+
+	SRasterMaterial& raster = item.Raster;
+	raster.Layer[0] = getTexture(material.getTexture(0));
+	raster.Layer[1] = 0;
+	raster.DepthTest = material.ZBuffer != video::ECFN_NEVER;
+	raster.DepthWrite = material.ZWriteEnable;
+	raster.Fog = material.FogEnable;
+	raster.Gouraud = material.GouraudShading;
+	raster.AlphaRef = 0;
+
+	switch (material.MaterialType)
+	{
+	case video::EMT_DETAIL_MAP:
+		raster.Blend = EB_DETAIL;
+		raster.Layer[1] = getTexture(material.getTexture(1));
+		break;
+	case video::EMT_REFLECTION_2_LAYER:
+		raster.Blend = EB_REFLECTION;
+		raster.Layer[1] = getTexture(material.getTexture(1));
+		break;
+	case video::EMT_TRANSPARENT_ADD_COLOR:
+		raster.Blend = EB_ADD;
+		break;
+	case video::EMT_TRANSPARENT_ALPHA_CHANNEL:
+		raster.Blend = EB_ALPHA_CHANNEL;
+		break;
+	case video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF:
+		raster.Blend = EB_ALPHA_CHANNEL;
+		raster.AlphaRef = 127;
+		break;
+	case video::EMT_TRANSPARENT_VERTEX_ALPHA:
+		raster.Blend = EB_VERTEX_ALPHA;
+		break;
+	default:
+		// the normal and parallax maps and the rest are drawn solid
+		raster.Blend = EB_SOLID;
+		break;
+	}
+
+	// a second layer without a texture is left out, like the drivers do
+	if ((raster.Blend == EB_DETAIL || raster.Blend == EB_REFLECTION) && !raster.Layer[1])
+		raster.Blend = EB_SOLID;
+
+	if (node->getType() == ESNT_SKY_DOME)
+		item.Pass = 0;
+	else if (raster.Blend >= EB_ADD)
+	{
+		// transparent materials never write the depth, like in the drivers
+		item.Pass = 2;
+		raster.DepthWrite = false;
+	}
+	else
+		item.Pass = 1;
+
+	Items.push_back(item);
+}
+
+
+void CTiledSoftwareRenderer::addBillboard(IBillboardSceneNode* node, const ICameraSceneNode* camera)
+{
+	// the quad of Irrlicht's billboard scene node
+	const core::vector3df position = node->getAbsolutePosition();
+	core::vector3df view = camera->getTarget() - camera->getAbsolutePosition();
+	view.normalize();
+
+	const core::vector3df& up = camera->getUpVector();
+	core::vector3df horizontal = up.crossProduct(view);
+	if (horizontal.getLength() == 0.f)
+		horizontal.set(up.Y, up.X, up.Z);
+	horizontal.normalize();
+	horizontal *= 0.5f * node->getSize().Width;
+
+	core::vector3df vertical = horizontal.crossProduct(view);
+	vertical.normalize();
+	vertical *= 0.5f * node->getSize().Height;
+
+	video::SColor top, bottom;
+	node->getColor(top, bottom);
+
+	const u32 first = Billboards.size();
+	Billboards.set_used(first + 4);
+	video::S3DVertex* v = Billboards.pointer() + first;
+	v[0] = video::S3DVertex(position + horizontal + vertical, -view, bottom, core::vector2df(1.f, 1.f));
+	v[1] = video::S3DVertex(position + horizontal - vertical, -view, top, core::vector2df(1.f, 0.f));
+	v[2] = video::S3DVertex(position - horizontal - vertical, -view, top, core::vector2df(0.f, 0.f));
+	v[3] = video::S3DVertex(position - horizontal + vertical, -view, bottom, core::vector2df(0.f, 1.f));
+
+	core::aabbox3df box(v[0].Pos);
+	for (u32 i=1; i<4; ++i)
+		box.addInternalPoint(v[i].Pos);
+
+	// the vertices are set once all billboards are built
+	addItem(node, 0, 4, video::EVT_STANDARD, BillboardIndices, 6, false,
+		node->getMaterial(0), core::IdentityMatrix, box);
+	Items.getLast().FirstBillboard = first;
+}
+
+
+void CTiledSoftwareRenderer::addSkyDome(ISceneNode* node, const ICameraSceneNode* camera)
+{
+	if (node != SkyDomeNode)
+	{
+		// Irrlicht's sky dome keeps its mesh to itself, it is built again
+		// from the parameters the node writes out
+		u32 horizontal = 16, vertical = 8;
+		f32 texturePercentage = 0.9f, spherePercentage = 2.f, radius = 1000.f;
+		io::IAttributes* attributes = SceneManager->getFileSystem()->createEmptyAttributes(SceneManager->getVideoDriver());
+		if (attributes)
+		{
+			node->serializeAttributes(attributes);
+			if (attributes->getAttributeAsInt("HorizontalResolution") > 0)
+			{
+				horizontal = (u32)attributes->getAttributeAsInt("HorizontalResolution");
+				vertical = (u32)core::max_(attributes->getAttributeAsInt("VerticalResolution"), 1);
+				texturePercentage = attributes->getAttributeAsFloat("TexturePercentage");
+				spherePercentage = core::clamp(attributes->getAttributeAsFloat("SpherePercentage"), 0.f, 2.f);
+				radius = attributes->getAttributeAsFloat("Radius");
+			}
+			attributes->drop();
+		}
+
+		if (!SkyDome)
+			SkyDome = new SMeshBuffer();
+		SkyDome->Vertices.set_used(0);
+		SkyDome->Indices.set_used(0);
+
+		const f32 azimuthStep = core::PI * 2.f / horizontal;
+		const f32 elevationStep = spherePercentage * core::HALF_PI / vertical;
+		video::S3DVertex vertex;
+		vertex.Color.set(255, 255, 255, 255);
+		for (u32 k=0; k<=horizontal; ++k)
+		{
+			const f32 azimuth = k * azimuthStep;
+			for (u32 j=0; j<=vertical; ++j)
+			{
+				const f32 elevation = core::HALF_PI - j * elevationStep;
+				const f32 cosE = radius * cosf(elevation);
+				vertex.Pos.set(cosE * sinf(azimuth), radius * sinf(elevation), cosE * cosf(azimuth));
+				vertex.TCoords.set((f32)k / horizontal, j * texturePercentage / vertical);
+				vertex.Normal = -vertex.Pos;
+				vertex.Normal.normalize();
+				SkyDome->Vertices.push_back(vertex);
+			}
+		}
+
+		for (u32 k=0; k<horizontal; ++k)
+		{
+			const u16 column = (u16)((vertical + 1) * k);
+			SkyDome->Indices.push_back(column + vertical + 2);
+			SkyDome->Indices.push_back(column + 1);
+			SkyDome->Indices.push_back(column);
+			for (u32 j=1; j<vertical; ++j)
+			{
+				SkyDome->Indices.push_back(column + vertical + 2 + j);
+				SkyDome->Indices.push_back(column + 1 + j);
+				SkyDome->Indices.push_back(column + j);
+				SkyDome->Indices.push_back(column + vertical + 1 + j);
+				SkyDome->Indices.push_back(column + vertical + 2 + j);
+				SkyDome->Indices.push_back(column + j);
+			}
+		}
+		SkyDome->recalculateBoundingBox();
+		SkyDomeNode = node;
+	}
+
+	// centered on the camera, like the node draws itself
+	core::matrix4 world(node->getAbsoluteTransformation());
+	world.setTranslation(camera->getAbsolutePosition());
+	addItem(node, SkyDome, node->getMaterial(0), world);
+}
+
+
+void CTiledSoftwareRenderer::pickLights(SItem& item)
+{
+	item.FirstLight = ItemLights.size();
+	item.LightCount = 0;
+	if (!item.Material->Lighting)
+		return;
+
+	const SLightInfo* picked[MaxLights];
+	f32 scores[MaxLights];
+	u32 count = 0;
+	for (u32 i=0; i<Lights.size(); ++i)
+	{
+		const video::SLight& light = Lights[i].Light;
+		f32 score = light.DiffuseColor.r + light.DiffuseColor.g + light.DiffuseColor.b;
+		if (light.Type != video::ELT_DIRECTIONAL)
+		{
+			const f32 distance = core::max_(Lights[i].Position.getDistanceFrom(item.Center) - item.Radius, 0.f);
+			if (distance > light.Radius)
+				continue;
+
+			const f32 attenuation = light.Attenuation.X + light.Attenuation.Y * distance +
+				light.Attenuation.Z * distance * distance;
+			if (attenuation > 0.f)
+				score /= attenuation;
+		}
+
+		// sorted by score, the weakest falls out when all are taken
+		u32 at = count < MaxLights ? count++ : MaxLights;
+		while (at > 0 && scores[at - 1] < score)
+		{
+			if (at < MaxLights)
+			{
+				picked[at] = picked[at - 1];
+				scores[at] = scores[at - 1];
+			}
+			--at;
+		}
+		if (at < MaxLights)
+		{
+			picked[at] = &Lights[i];
+			scores[at] = score;
+		}
+	}
+
+	for (u32 i=0; i<count; ++i)
+		ItemLights.push_back(*picked[i]);
+	item.LightCount = count;
+}
+
+
+const CTiledSoftwareRenderer::STexture* CTiledSoftwareRenderer::getTexture(video::ITexture* texture)
+{
+	if (!texture)
+		return 0;
+
+	for (u32 i=0; i<Textures.size(); ++i)
+		if (Textures[i]->Source == texture)
+			return Textures[i];
+
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+	STexture* copy = new STexture();
+	copy->Source = texture;
+	texture->grab();
+	Textures.push_back(copy);
+
+	// the null driver keeps no pixels, then the file is read again
+	void* pixels = texture->lock(video::ETLM_READ_ONLY);
+	video::IImage* image = pixels ?
+		driver->createImageFromData(texture->getColorFormat(), texture->getSize(), pixels, true, false) :
+		driver->createImageFromFile(texture->getName().getPath());
+
+	u32 width = 1, height = 1;
+	if (image)
+	{
+		width = core::min_(getPowerOfTwo(image->getDimension().Width), MaxTextureSize);
+		height = core::min_(getPowerOfTwo(image->getDimension().Height), MaxTextureSize);
+	}
+
+	u32 levelCount = 1;
+	while ((width >> (levelCount - 1)) > 1 || (height >> (levelCount - 1)) > 1)
+		++levelCount;
+	copy->Levels.reallocate(levelCount);
+
+	STextureLevel level;
+	level.Width = width;
+	level.Height = height;
+	level.Shift = getShift(width);
+	level.Texels.set_used(width * height);
+	if (image)
+		image->copyToScaling(level.Texels.pointer(), width, height, video::ECF_A8R8G8B8);
+	else
+		level.Texels[0] = 0xFFFFFFFF;
+	copy->Levels.push_back(level);
+
+	if (image)
+		image->drop();
+	if (pixels)
+		texture->unlock();
+
+	// box filtered mip maps down to one texel
+	while (copy->Levels.getLast().Width > 1 || copy->Levels.getLast().Height > 1)
+	{
+		const STextureLevel& source = copy->Levels.getLast();
+		STextureLevel next;
+		next.Width = core::max_(source.Width / 2, 1u);
+		next.Height = core::max_(source.Height / 2, 1u);
+		next.Shift = getShift(next.Width);
+		next.Texels.set_used(next.Width * next.Height);
+
+		const u32 stepX = source.Width > 1 ? 1 : 0;
+		const u32 stepY = source.Height > 1 ? source.Width : 0;
+		for (u32 y=0; y<next.Height; ++y)
+		{
+			for (u32 x=0; x<next.Width; ++x)
+			{
+				const u32* texel = source.Texels.const_pointer() +
+					(y << (stepY ? 1 : 0)) * source.Width + (x << stepX);
+				next.Texels[y * next.Width + x] = averageColor(texel[0], texel[stepX],
+					texel[stepY], texel[stepX + stepY]);
+			}
+		}
+		copy->Levels.push_back(next);
+	}
+
+	return copy;
+}
+
+
+void CTiledSoftwareRenderer::transformJob(void* data, u32 begin, u32 end)
+{
+	CTiledSoftwareRenderer* renderer = (CTiledSoftwareRenderer*)data;
+	for (u32 i=begin; i<end; ++i)
+		renderer->transformVertices(renderer->VertexChunks[i]);
+}
+
+
+void CTiledSoftwareRenderer::setupJob(void* data, u32 begin, u32 end)
+{
+	CTiledSoftwareRenderer* renderer = (CTiledSoftwareRenderer*)data;
+	for (u32 i=begin; i<end; ++i)
+		renderer->setupTriangles(renderer->TriangleChunks[i]);
+}
+
+
+void CTiledSoftwareRenderer::binJob(void* data, u32 begin, u32 end)
+{
+	CTiledSoftwareRenderer* renderer = (CTiledSoftwareRenderer*)data;
+	for (u32 i=begin; i<end; ++i)
+		renderer->binRow(i);
+}
+
+
+void CTiledSoftwareRenderer::rasterJob(void* data, u32 begin, u32 end)
+{
+	CTiledSoftwareRenderer* renderer = (CTiledSoftwareRenderer*)data;
+	for (u32 i=begin; i<end; ++i)
+		renderer->rasterTile(i);
+}
+
+
+void CTiledSoftwareRenderer::transformVertices(const SChunk& chunk)
+{
+	const SItem& item = Items[chunk.Item];
+	const video::SMaterial& material = *item.Material;
+	const bool reflection = item.Raster.Blend == EB_REFLECTION;
+
+	core::matrix4 mvp(ViewProjection);
+	mvp *= item.World;
+	const core::matrix4& textureMatrix = material.getTextureMatrix(0);
+	const bool transformCoords = !textureMatrix.isIdentity();
+
+	// the fixed function light equation without specular light
+	const f32 ambient[3] = {
+		AmbientLight.r * material.AmbientColor.getRed() + material.EmissiveColor.getRed(),
+		AmbientLight.g * material.AmbientColor.getGreen() + material.EmissiveColor.getGreen(),
+		AmbientLight.b * material.AmbientColor.getBlue() + material.EmissiveColor.getBlue() };
+	const bool vertexDiffuse = material.ColorMaterial == video::ECM_DIFFUSE ||
+		material.ColorMaterial == video::ECM_DIFFUSE_AND_AMBIENT;
+	const SLightInfo* lights = ItemLights.const_pointer() + item.FirstLight;
+
+	const u8* source = (const u8*)item.Vertices + chunk.First * item.VertexPitch;
+	SVertex* out = Vertices.pointer() + item.FirstVertex + chunk.First;
+	for (u32 i=0; i<chunk.Count; ++i, source+=item.VertexPitch, ++out)
+	{
+		const video::S3DVertex& vertex = *(const video::S3DVertex*)source;
+		mvp.transformVect(out->Clip, vertex.Pos);
+
+		core::vector2df coords = vertex.TCoords;
+		if (transformCoords)
+			coords.set(textureMatrix[0] * coords.X + textureMatrix[4] * coords.Y + textureMatrix[8],
+				textureMatrix[1] * coords.X + textureMatrix[5] * coords.Y + textureMatrix[9]);
+		out->Attributes[EA_U] = coords.X;
+		out->Attributes[EA_V] = coords.Y;
+
+		const core::vector2df& coords2 = item.TwoCoords ?
+			((const video::S3DVertex2TCoords*)source)->TCoords2 : vertex.TCoords;
+		out->Attributes[EA_U2] = coords2.X;
+		out->Attributes[EA_V2] = coords2.Y;
+
+		video::SColor color = vertex.Color;
+		if (material.Lighting || reflection)
+		{
+			core::vector3df position(vertex.Pos);
+			item.World.transformVect(position);
+			core::vector3df normal(vertex.Normal);
+			item.World.rotateVect(normal);
+			if (material.NormalizeNormals || reflection)
+				normal.normalize();
+
+			if (material.Lighting)
+			{
+				const video::SColor diffuse = vertexDiffuse ? vertex.Color : material.DiffuseColor;
+				f32 light[3] = { ambient[0], ambient[1], ambient[2] };
+				for (u32 l=0; l<item.LightCount; ++l)
+				{
+					const video::SLight& data = lights[l].Light;
+					core::vector3df direction;
+					f32 attenuation = 1.f;
+					if (data.Type == video::ELT_DIRECTIONAL)
+						direction = -data.Direction;
+					else
+					{
+						direction = lights[l].Position - position;
+						const f32 distance = direction.getLength();
+						if (distance > data.Radius || distance == 0.f)
+							continue;
+						direction /= distance;
+						const f32 divisor = data.Attenuation.X + data.Attenuation.Y * distance +
+							data.Attenuation.Z * distance * distance;
+						attenuation = divisor > 0.f ? 1.f / divisor : 1.f;
+					}
+
+					const f32 intensity = normal.dotProduct(direction) * attenuation;
+					if (intensity <= 0.f)
+						continue;
+					light[0] += data.DiffuseColor.r * intensity * diffuse.getRed();
+					light[1] += data.DiffuseColor.g * intensity * diffuse.getGreen();
+					light[2] += data.DiffuseColor.b * intensity * diffuse.getBlue();
+				}
+				color.set(diffuse.getAlpha(), clampColor((s32)light[0]),
+					clampColor((s32)light[1]), clampColor((s32)light[2]));
+			}
+
+			if (reflection)
+			{
+				// sphere map of the reflection in view space
+				core::vector3df eye(position);
+				View.transformVect(eye);
+				eye.normalize();
+				View.rotateVect(normal);
+				normal.normalize();
+				const core::vector3df r = eye - normal * (2.f * normal.dotProduct(eye));
+				const f32 m = 2.f * sqrtf(r.X * r.X + r.Y * r.Y + (1.f - r.Z) * (1.f - r.Z));
+				out->Attributes[EA_U2] = m > 0.f ? r.X / m + 0.5f : 0.5f;
+				out->Attributes[EA_V2] = m > 0.f ? 0.5f - r.Y / m : 0.5f;
+			}
+		}
+
+		out->Attributes[EA_RED] = (f32)color.getRed();
+		out->Attributes[EA_GREEN] = (f32)color.getGreen();
+		out->Attributes[EA_BLUE] = (f32)color.getBlue();
+		out->Attributes[EA_ALPHA] = (f32)color.getAlpha();
+
+		f32 fog = 1.f;
+		if (item.Raster.Fog)
+		{
+			// w is the depth in view space
+			const f32 distance = out->Clip[3];
+			if (FogType == video::EFT_FOG_LINEAR)
+				fog = FogEnd > FogStart ? (FogEnd - distance) / (FogEnd - FogStart) : 1.f;
+			else if (FogType == video::EFT_FOG_EXP)
+				fog = expf(-FogDensity * distance);
+			else
+				fog = expf(-(FogDensity * distance) * (FogDensity * distance));
+			fog = core::clamp(fog, 0.f, 1.f);
+		}
+		out->Attributes[EA_FOG] = fog;
+	}
+}
+
+
+void CTiledSoftwareRenderer::setupTriangles(SChunk& chunk)
+{
+	const SItem& item = Items[chunk.Item];
+	const SVertex* vertices = Vertices.const_pointer() + item.FirstVertex;
+	STriangle* out = Triangles.pointer() + chunk.FirstOutput;
+
+	u32 count = 0;
+	for (u32 t=chunk.First; t<chunk.First+chunk.Count; ++t)
+	{
+		const u32 a = getIndex(item.Indices, item.Indices32, t * 3);
+		const u32 b = getIndex(item.Indices, item.Indices32, t * 3 + 1);
+		const u32 c = getIndex(item.Indices, item.Indices32, t * 3 + 2);
+		if (a >= item.VertexCount || b >= item.VertexCount || c >= item.VertexCount)
+			continue;
+
+		count += setupTriangle(item, chunk.Item, vertices + a, vertices + b, vertices + c, out + count);
+	}
+	chunk.OutputCount = count;
+}
+
+
+u32 CTiledSoftwareRenderer::setupTriangle(const SItem& item, u32 itemIndex, const SVertex* a,
+	const SVertex* b, const SVertex* c, STriangle* out) const
+{
+	// one plane cuts a triangle into at most a quad
+	const SVertex* in[3] = { a, b, c };
+	SVertex clipped[4];
+	const SVertex* polygon[4];
+	u32 count = 0;
+	if (a->Clip[3] >= NearW && b->Clip[3] >= NearW && c->Clip[3] >= NearW)
+	{
+		polygon[0] = a;
+		polygon[1] = b;
+		polygon[2] = c;
+		count = 3;
+	}
+	else
+	{
+		const u32 floats = sizeof(SVertex) / sizeof(f32);
+		for (u32 i=0; i<3; ++i)
+		{
+			const SVertex* from = in[i];
+			const SVertex* to = in[i == 2 ? 0 : i + 1];
+			const bool fromInside = from->Clip[3] >= NearW;
+			const bool toInside = to->Clip[3] >= NearW;
+
+			if (fromInside)
+			{
+				polygon[count] = from;
+				++count;
+			}
+
+			if (fromInside != toInside)
+			{
+				const f32 t = (NearW - from->Clip[3]) / (to->Clip[3] - from->Clip[3]);
+				const f32* f = (const f32*)from;
+				const f32* g = (const f32*)to;
+				f32* result = (f32*)&clipped[count];
+				for (u32 k=0; k<floats; ++k)
+					result[k] = f[k] + (g[k] - f[k]) * t;
+				polygon[count] = &clipped[count];
+				++count;
+			}
+		}
+		if (count < 3)
+			return 0;
+	}
+
+	// completely beside the screen
+	u32 left = 0, right = 0, bottom = 0, top = 0;
+	for (u32 i=0; i<count; ++i)
+	{
+		const f32* clip = polygon[i]->Clip;
+		left += clip[0] < -clip[3];
+		right += clip[0] > clip[3];
+		bottom += clip[1] < -clip[3];
+		top += clip[1] > clip[3];
+	}
+	if (left == count || right == count || bottom == count || top == count)
+		return 0;
+
+	f32 screenX[4], screenY[4], invW[4];
+	for (u32 i=0; i<count; ++i)
+	{
+		invW[i] = 1.f / polygon[i]->Clip[3];
+		screenX[i] = (polygon[i]->Clip[0] * invW[i] * 0.5f + 0.5f) * Size.Width;
+		screenY[i] = (0.5f - polygon[i]->Clip[1] * invW[i] * 0.5f) * Size.Height;
+	}
+
+	u32 written = 0;
+	for (u32 f=1; f+1<count; ++f)
+	{
+		u32 p[3] = { 0, f, f + 1 };
+		f32 area = (screenX[p[1]] - screenX[p[0]]) * (screenY[p[2]] - screenY[p[0]]) -
+			(screenY[p[1]] - screenY[p[0]]) * (screenX[p[2]] - screenX[p[0]]);
+
+		// clockwise on the screen is the front, like in Irrlicht's drivers
+		if (area == 0.f || (area < 0.f && item.BackfaceCulling) || (area > 0.f && item.FrontfaceCulling))
+			continue;
+		if (area < 0.f)
+		{
+			p[1] = f + 1;
+			p[2] = f;
+			area = -area;
+		}
+
+		// the pixels whose centers are within the bounds of the triangle
+		const f32 minX = core::min_(screenX[p[0]], screenX[p[1]], screenX[p[2]]);
+		const f32 maxX = core::max_(screenX[p[0]], screenX[p[1]], screenX[p[2]]);
+		const f32 minY = core::min_(screenY[p[0]], screenY[p[1]], screenY[p[2]]);
+		const f32 maxY = core::max_(screenY[p[0]], screenY[p[1]], screenY[p[2]]);
+		if (maxX < 0.f || maxY < 0.f || minX > (f32)Size.Width || minY > (f32)Size.Height)
+			continue;
+
+		STriangle& triangle = out[written];
+		triangle.MinX = core::max_((s32)ceilf(minX - 0.5f), 0);
+		triangle.MaxX = core::min_((s32)floorf(maxX - 0.5f), (s32)Size.Width - 1);
+		triangle.MinY = core::max_((s32)ceilf(minY - 0.5f), 0);
+		triangle.MaxY = core::min_((s32)floorf(maxY - 0.5f), (s32)Size.Height - 1);
+		if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY)
+			continue;
+
+		// edge i runs from p[i] to the next vertex and is positive inside
+		triangle.TopLeft = 0;
+		for (u32 i=0; i<3; ++i)
+		{
+			const u32 from = p[i];
+			const u32 to = p[i == 2 ? 0 : i + 1];
+			triangle.EdgeA[i] = screenY[from] - screenY[to];
+			triangle.EdgeB[i] = screenX[to] - screenX[from];
+			triangle.EdgeC[i] = -triangle.EdgeA[i] * screenX[from] - triangle.EdgeB[i] * screenY[from];
+			if (triangle.EdgeA[i] > 0.f || (triangle.EdgeA[i] == 0.f && triangle.EdgeB[i] > 0.f))
+				triangle.TopLeft |= 1 << i;
+		}
+
+		// the attributes of every vertex, texture coordinates moved by
+		// whole repeats so they are positive and wrap with a mask
+		f32 values[3][EA_COUNT];
+		for (u32 i=0; i<3; ++i)
+			memcpy(values[i], polygon[p[i]]->Attributes, sizeof(values[i]));
+		for (u32 k=EA_U; k<=EA_V2; ++k)
+		{
+			const f32 offset = floorf(core::min_(values[0][k], values[1][k], values[2][k]));
+			for (u32 i=0; i<3; ++i)
+				values[i][k] -= offset;
+		}
+		if (!item.Raster.Gouraud)
+		{
+			for (u32 k=EA_RED; k<=EA_ALPHA; ++k)
+				values[1][k] = values[2][k] = values[0][k];
+		}
+
+		// the weight of a vertex is the edge across from it
+		const f32 invArea = 1.f / area;
+		const f32 w0 = invW[p[0]], w1 = invW[p[1]], w2 = invW[p[2]];
+		triangle.DepthA = (triangle.EdgeA[1] * w0 + triangle.EdgeA[2] * w1 + triangle.EdgeA[0] * w2) * invArea;
+		triangle.DepthB = (triangle.EdgeB[1] * w0 + triangle.EdgeB[2] * w1 + triangle.EdgeB[0] * w2) * invArea;
+		triangle.DepthC = (triangle.EdgeC[1] * w0 + triangle.EdgeC[2] * w1 + triangle.EdgeC[0] * w2) * invArea;
+		for (u32 k=0; k<EA_COUNT; ++k)
+		{
+			const f32 q0 = values[0][k] * w0, q1 = values[1][k] * w1, q2 = values[2][k] * w2;
+			triangle.PlaneA[k] = (triangle.EdgeA[1] * q0 + triangle.EdgeA[2] * q1 + triangle.EdgeA[0] * q2) * invArea;
+			triangle.PlaneB[k] = (triangle.EdgeB[1] * q0 + triangle.EdgeB[2] * q1 + triangle.EdgeB[0] * q2) * invArea;
+			triangle.PlaneC[k] = (triangle.EdgeC[1] * q0 + triangle.EdgeC[2] * q1 + triangle.EdgeC[0] * q2) * invArea;
+		}
+
+		// one mip level for the whole triangle, from texels per pixel
+		for (u32 l=0; l<2; ++l)
+		{
+			triangle.Level[l] = 0;
+			const STexture* texture = item.Raster.Layer[l];
+			if (!texture)
+				continue;
+
+			const u32 u = l ? EA_U2 : EA_U;
+			const u32 v = u + 1;
+			const STextureLevel& base = texture->Levels[0];
+			const f32 texels = fabsf((values[1][u] - values[0][u]) * (values[2][v] - values[0][v]) -
+				(values[2][u] - values[0][u]) * (values[1][v] - values[0][v])) * base.Width * base.Height;
+			const f32 ratio = texels / area;
+			if (ratio > 1.f)
+				triangle.Level[l] = core::min_((u32)(0.5f * logf(ratio) * 1.442695f), texture->Levels.size() - 1);
+		}
+
+		triangle.Item = itemIndex;
+		++written;
+	}
+
+	return written;
+}
+
+
+void CTiledSoftwareRenderer::binRow(u32 row)
+{
+	const s32 rowY0 = row * TileSize;
+	const s32 rowY1 = rowY0 + TileSize - 1;
+	for (u32 x=0; x<TilesX; ++x)
+		Bins[row * TilesX + x].set_used(0);
+
+	// every row walks all triangles, so the bins keep the drawing order
+	for (u32 c=0; c<TriangleChunks.size(); ++c)
+	{
+		const SChunk& chunk = TriangleChunks[c];
+		for (u32 t=chunk.FirstOutput; t<chunk.FirstOutput+chunk.OutputCount; ++t)
+		{
+			const STriangle& triangle = Triangles[t];
+			if (triangle.MaxY < rowY0 || triangle.MinY > rowY1)
+				continue;
+
+			const u32 last = triangle.MaxX / TileSize;
+			for (u32 x=triangle.MinX / TileSize; x<=last; ++x)
+				Bins[row * TilesX + x].push_back(t);
+		}
+	}
+}
+
+
+void CTiledSoftwareRenderer::rasterTile(u32 tile)
+{
+	const s32 x0 = (tile % TilesX) * TileSize;
+	const s32 y0 = (tile / TilesX) * TileSize;
+	const s32 x1 = core::min_(x0 + (s32)TileSize, (s32)Size.Width) - 1;
+	const s32 y1 = core::min_(y0 + (s32)TileSize, (s32)Size.Height) - 1;
+
+	for (s32 y=y0; y<=y1; ++y)
+	{
+		u32* color = Color.pointer() + y * Size.Width;
+		for (s32 x=x0; x<=x1; ++x)
+			color[x] = 0xFF000000;
+		memset(Depth.pointer() + y * Size.Width + x0, 0, (x1 - x0 + 1) * sizeof(f32));
+	}
+
+	const core::array<u32>& bin = Bins[tile];
+	for (u32 i=0; i<bin.size(); ++i)
+		drawTriangle(Triangles[bin[i]], x0, y0, x1, y1);
+}
+
+
+void CTiledSoftwareRenderer::drawTriangle(const STriangle& triangle, s32 tileX0, s32 tileY0, s32 tileX1, s32 tileY1)
+{
+	const SRasterMaterial& material = Items[triangle.Item].Raster;
+
+	// groups of four start at a multiple of 4, which is still in the tile
+	const s32 x0 = core::max_(triangle.MinX, tileX0) & ~3;
+	const s32 x1 = core::min_(triangle.MaxX, tileX1);
+	const s32 y0 = core::max_(triangle.MinY, tileY0);
+	const s32 y1 = core::min_(triangle.MaxY, tileY1);
+	if (x0 > x1 || y0 > y1)
+		return;
+
+	const s32 width = (s32)Size.Width;
+	f32 depth[4];
+	f32 attributes[EA_COUNT][4];
+
+#ifdef _MARS_TILED_SSE_
+	const __m128 lanes = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+	__m128 edgeA[3], topLeft[3];
+	for (u32 i=0; i<3; ++i)
+	{
+		edgeA[i] = _mm_set1_ps(triangle.EdgeA[i]);
+		topLeft[i] = (triangle.TopLeft & (1 << i)) ? _mm_cmpeq_ps(zero, zero) : zero;
+	}
+	const __m128 depthA = _mm_set1_ps(triangle.DepthA);
+	__m128 planeA[EA_COUNT];
+	for (u32 k=0; k<EA_COUNT; ++k)
+		planeA[k] = _mm_set1_ps(triangle.PlaneA[k]);
+
+	for (s32 y=y0; y<=y1; ++y)
+	{
+		const f32 centerY = y + 0.5f;
+		__m128 row[3];
+		for (u32 i=0; i<3; ++i)
+			row[i] = _mm_set1_ps(triangle.EdgeB[i] * centerY + triangle.EdgeC[i]);
+		const __m128 rowDepth = _mm_set1_ps(triangle.DepthB * centerY + triangle.DepthC);
+		__m128 rowPlane[EA_COUNT];
+		for (u32 k=0; k<EA_COUNT; ++k)
+			rowPlane[k] = _mm_set1_ps(triangle.PlaneB[k] * centerY + triangle.PlaneC[k]);
+		const f32* depthRow = Depth.const_pointer() + y * width;
+
+		for (s32 x=x0; x<=x1; x+=4)
+		{
+			const __m128 centerX = _mm_add_ps(_mm_set1_ps((f32)x), lanes);
+
+			// on an edge only the top and left edges own the pixel, so
+			// neighbouring triangles do not blend it twice
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (u32 i=0; i<3; ++i)
+			{
+				const __m128 e = _mm_add_ps(_mm_mul_ps(edgeA[i], centerX), row[i]);
+				const __m128 onEdge = _mm_and_ps(_mm_cmpeq_ps(e, zero), topLeft[i]);
+				inside = _mm_and_ps(inside, _mm_or_ps(_mm_cmpgt_ps(e, zero), onEdge));
+			}
+			u32 mask = _mm_movemask_ps(inside);
+			if (!mask)
+				continue;
+
+			const __m128 z = _mm_add_ps(_mm_mul_ps(depthA, centerX), rowDepth);
+			if (material.DepthTest)
+				mask &= _mm_movemask_ps(_mm_cmpge_ps(z, _mm_loadu_ps(depthRow + x)));
+			if (x + 4 > width)
+				mask &= (1 << (width - x)) - 1;
+			if (!mask)
+				continue;
+
+			const __m128 w = _mm_div_ps(one, z);
+			_mm_storeu_ps(depth, z);
+			for (u32 k=0; k<EA_COUNT; ++k)
+				_mm_storeu_ps(attributes[k], _mm_mul_ps(_mm_add_ps(_mm_mul_ps(planeA[k], centerX), rowPlane[k]), w));
+
+			shadePixels(triangle, material, mask, depth, attributes, x, y);
+		}
+	}
+#else
+	for (s32 y=y0; y<=y1; ++y)
+	{
+		const f32 centerY = y + 0.5f;
+		const f32* depthRow = Depth.const_pointer() + y * width;
+
+		for (s32 x=x0; x<=x1; x+=4)
+		{
+			u32 mask = 0;
+			for (u32 lane=0; lane<4 && x + (s32)lane < width; ++lane)
+			{
+				const f32 centerX = x + lane + 0.5f;
+				bool inside = true;
+				for (u32 i=0; i<3 && inside; ++i)
+				{
+					const f32 e = triangle.EdgeA[i] * centerX + triangle.EdgeB[i] * centerY + triangle.EdgeC[i];
+					inside = e > 0.f || (e == 0.f && (triangle.TopLeft & (1 << i)));
+				}
+				if (!inside)
+					continue;
+
+				const f32 z = triangle.DepthA * centerX + triangle.DepthB * centerY + triangle.DepthC;
+				if (material.DepthTest && z < depthRow[x + lane])
+					continue;
+
+				const f32 w = 1.f / z;
+				depth[lane] = z;
+				for (u32 k=0; k<EA_COUNT; ++k)
+					attributes[k][lane] = (triangle.PlaneA[k] * centerX + triangle.PlaneB[k] * centerY + triangle.PlaneC[k]) * w;
+				mask |= 1 << lane;
+			}
+
+			if (mask)
+				shadePixels(triangle, material, mask, depth, attributes, x, y);
+		}
+	}
+#endif
+}
+
+
+void CTiledSoftwareRenderer::shadePixels(const STriangle& triangle, const SRasterMaterial& material, u32 mask,
+	const f32* depth, const f32 (*attributes)[4], s32 x, s32 y)
+{
+	const STextureLevel* layer0 = material.Layer[0] ? &material.Layer[0]->Levels[triangle.Level[0]] : 0;
+	const STextureLevel* layer1 = material.Layer[1] ? &material.Layer[1]->Levels[triangle.Level[1]] : 0;
+	const s32 fogRed = FogColor.getRed();
+	const s32 fogGreen = FogColor.getGreen();
+	const s32 fogBlue = FogColor.getBlue();
+
+	u32* color = Color.pointer() + y * Size.Width + x;
+	f32* depthRow = Depth.pointer() + y * Size.Width + x;
+
+	for (u32 lane=0; lane<4; ++lane)
+	{
+		if (!(mask & (1 << lane)))
+			continue;
+
+		// vertex color, scaled to 0..256 so >> 8 divides
+		s32 r = clampColor((s32)attributes[EA_RED][lane]) + 1;
+		s32 g = clampColor((s32)attributes[EA_GREEN][lane]) + 1;
+		s32 b = clampColor((s32)attributes[EA_BLUE][lane]) + 1;
+		s32 a = clampColor((s32)attributes[EA_ALPHA][lane]) + 1;
+
+		if (layer0)
+		{
+			const u32 tx = (u32)(s32)(attributes[EA_U][lane] * layer0->Width) & (layer0->Width - 1);
+			const u32 ty = (u32)(s32)(attributes[EA_V][lane] * layer0->Height) & (layer0->Height - 1);
+			const u32 texel = layer0->Texels[(ty << layer0->Shift) | tx];
+			r = (((texel >> 16) & 255) * r) >> 8;
+			g = (((texel >> 8) & 255) * g) >> 8;
+			b = ((texel & 255) * b) >> 8;
+			a = material.Blend == EB_ALPHA_CHANNEL ? (s32)(texel >> 24) : ((texel >> 24) * a) >> 8;
+		}
+		else
+		{
+			r -= 1;
+			g -= 1;
+			b -= 1;
+			a -= 1;
+		}
+
+		if (layer1)
+		{
+			const u32 tx = (u32)(s32)(attributes[EA_U2][lane] * layer1->Width) & (layer1->Width - 1);
+			const u32 ty = (u32)(s32)(attributes[EA_V2][lane] * layer1->Height) & (layer1->Height - 1);
+			const u32 texel = layer1->Texels[(ty << layer1->Shift) | tx];
+			if (material.Blend == EB_DETAIL)
+			{
+				// added signed, like the detail map of the drivers
+				r = clampColor(r + (s32)((texel >> 16) & 255) - 128);
+				g = clampColor(g + (s32)((texel >> 8) & 255) - 128);
+				b = clampColor(b + (s32)(texel & 255) - 128);
+			}
+			else
+			{
+				r = (r * (((texel >> 16) & 255) + 1)) >> 8;
+				g = (g * (((texel >> 8) & 255) + 1)) >> 8;
+				b = (b * ((texel & 255) + 1)) >> 8;
+			}
+		}
+
+		if (material.Fog)
+		{
+			const s32 f = (s32)(core::clamp(attributes[EA_FOG][lane], 0.f, 1.f) * 256.f);
+			r = fogRed + (((r - fogRed) * f) >> 8);
+			g = fogGreen + (((g - fogGreen) * f) >> 8);
+			b = fogBlue + (((b - fogBlue) * f) >> 8);
+		}
+
+		const u32 destination = color[lane];
+		const s32 dr = (destination >> 16) & 255;
+		const s32 dg = (destination >> 8) & 255;
+		const s32 db = destination & 255;
+		switch (material.Blend)
+		{
+		case EB_ADD:
+			// source plus destination times one minus source
+			r = r + ((dr * (256 - r)) >> 8);
+			g = g + ((dg * (256 - g)) >> 8);
+			b = b + ((db * (256 - b)) >> 8);
+			break;
+		case EB_ALPHA_CHANNEL:
+		case EB_VERTEX_ALPHA:
+			if (a <= (s32)material.AlphaRef)
+				continue;
+			r = dr + (((r - dr) * (a + 1)) >> 8);
+			g = dg + (((g - dg) * (a + 1)) >> 8);
+			b = db + (((b - db) * (a + 1)) >> 8);
+			break;
+		default:
+			break;
+		}
+
+		color[lane] = 0xFF000000 | (clampColor(r) << 16) | (clampColor(g) << 8) | clampColor(b);
+		if (material.DepthWrite)
+			depthRow[lane] = depth[lane];
+	}
+}
+
+} // end namespace scene
+} // end namespace irr
@@ -0,0 +1,346 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_TILED_SOFTWARE_RENDERER_H_INCLUDED__
+#define __C_TILED_SOFTWARE_RENDERER_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+
+class CWorkStealingPool;
+
+namespace scene
+{
+
+//! Work and times of one frame of the tiled software renderer.
+struct STiledRenderStats
+{
+	STiledRenderStats()
+		: Items(0), Triangles(0), SetupTriangles(0), BinnedTriangles(0),
+		GatherMs(0.0), TransformMs(0.0), BinMs(0.0), RasterMs(0.0), PresentMs(0.0)
+	{
+	}
+
+	//! Buffers drawn, every tile of the terrain and batch of particles counts.
+	u32 Items;
+	//! Triangles of the drawn buffers.
+	u32 Triangles;
+	//! Triangles left after clipping, back face culling and dropping those between pixel centers.
+	u32 SetupTriangles;
+	//! Triangles in all bins, a triangle counts once for every tile it touches.
+	u32 BinnedTriangles;
+
+	f64 GatherMs;
+	f64 TransformMs;
+	f64 BinMs;
+	f64 RasterMs;
+	f64 PresentMs;
+};
+
+//! Draws the scene on the CPU, with all cores, without a video driver.
+/** The software drivers of Irrlicht draw every triangle on the calling
+thread, so hosts without a GPU get a few frames per second at best. This
+renderer draws the scene of a scene manager like drawAll() would:
+
+- On the calling thread, it walks the visible nodes which are not culled
+  and collects their mesh buffers with their world matrix and material:
+  mesh, cube, sphere, octree and static animated mesh nodes, the level of
+  detail meshes, billboards, the sky dome and the game's own nodes. The
+  lights each buffer gets are picked here, the nearest ones first.
+- On all threads, the vertices are transformed and lit, the triangles
+  clipped at the near plane, back face culled and set up: the edges and
+  the planes of 1/w and of every attribute over w across the screen.
+- On all threads, one per row of tiles, the triangles are sorted into
+  the tiles of 64x64 pixels they touch, in drawing order.
+- On all threads, every tile clears its part of the buffers and draws
+  its triangles. Coverage, depth and the attributes are computed for four
+  pixels at a time with SSE (plain C++ without it), textures are sampled
+  and blended per covered pixel.
+
+The sky is drawn first, then the solid buffers front to back and the
+transparent ones back to front, like the passes of drawAll(). Lighting is
+per vertex, like the fixed function pipeline, with ambient, emissive and
+diffuse light of point and directional lights; there is no specular light.
+Textures are sampled from a mip chain, the level is picked per triangle.
+The materials of the scene are supported: solid, detail map, reflection 2
+layer, transparent add color, alpha channel and vertex alpha, and fog.
+Normal and parallax maps are drawn solid. There are no stencil shadows.
+
+The textures are copied from the driver, or loaded from their file when
+the driver keeps no pixels, the first time they are used. present() copies
+the color buffer into a texture of the driver and draws it, so the window
+and the GUI still belong to the driver; EDT_BURNINGSVIDEO is enough. */
+class CTiledSoftwareRenderer : public virtual IReferenceCounted
+{
+public:
+
+	//! Creates the buffers for a frame of size.
+	/** \param threadCount Threads drawing, including the caller, 0 for one
+	per hardware thread. */
+	CTiledSoftwareRenderer(ISceneManager* smgr, const core::dimension2d<u32>& size, u32 threadCount=0);
+
+	virtual ~CTiledSoftwareRenderer();
+
+	u32 getThreadCount() const;
+
+	const core::dimension2d<u32>& getSize() const { return Size; }
+
+	//! Animates the scene at timeMs and draws it with its active camera.
+	/** Replaces ISceneManager::drawAll(), which must not be called as well:
+	the nodes would be animated twice. */
+	void drawAll(u32 timeMs);
+
+	//! Draws the color buffer of the last frame onto the screen of the driver.
+	void present();
+
+	//! Pixels of the last frame as A8R8G8B8, row by row without padding.
+	const u32* getColorBuffer() const { return Color.const_pointer(); }
+
+	const STiledRenderStats& getLastStats() const { return LastStats; }
+
+	//! Amount of textures copied for sampling.
+	u32 getTextureCount() const { return Textures.size(); }
+
+	//! Memory of the copied textures, with their mip maps.
+	u32 getTextureBytes() const;
+
+private:
+
+	// not copyable
+	CTiledSoftwareRenderer(const CTiledSoftwareRenderer&);
+	CTiledSoftwareRenderer& operator=(const CTiledSoftwareRenderer&);
+
+	enum E_BLEND
+	{
+		EB_SOLID = 0,
+		EB_DETAIL,
+		EB_REFLECTION,
+		EB_ADD,
+		EB_ALPHA_CHANNEL,
+		EB_VERTEX_ALPHA
+	};
+
+	//! Attributes interpolated over a triangle.
+	enum E_ATTRIBUTE
+	{
+		EA_U = 0,
+		EA_V,
+		EA_U2,
+		EA_V2,
+		EA_RED,
+		EA_GREEN,
+		EA_BLUE,
+		EA_ALPHA,
+		//! 1 without fog, 0 for the fog color only.
+		EA_FOG,
+		EA_COUNT
+	};
+
+	struct STextureLevel
+	{
+		u32 Width;
+		u32 Height;
+		u32 Shift;
+		core::array<u32> Texels;
+	};
+
+	//! A texture of the driver, copied as A8R8G8B8 with a power of two size.
+	struct STexture
+	{
+		const video::ITexture* Source;
+		core::array<STextureLevel> Levels;
+	};
+
+	//! What the pixels of a buffer are drawn with.
+	struct SRasterMaterial
+	{
+		const STexture* Layer[2];
+		E_BLEND Blend;
+		bool DepthTest;
+		bool DepthWrite;
+		bool Fog;
+		bool Gouraud;
+		//! Alpha at or below which pixels of EB_ALPHA_CHANNEL are dropped.
+		u32 AlphaRef;
+	};
+
+	//! A mesh buffer to draw, or the vertices of billboards built by gather().
+	struct SItem
+	{
+		const void* Vertices;
+		u32 VertexCount;
+		u32 VertexPitch;
+		bool TwoCoords;
+		const void* Indices;
+		bool Indices32;
+		u32 IndexCount;
+
+		core::matrix4 World;
+		const video::SMaterial* Material;
+		SRasterMaterial Raster;
+		bool BackfaceCulling;
+		bool FrontfaceCulling;
+
+		//! 0 sky, 1 solid, 2 transparent.
+		u32 Pass;
+		//! Squared distance of the center to the camera.
+		f32 Depth;
+		//! Bounding sphere in world space, for picking the lights.
+		core::vector3df Center;
+		f32 Radius;
+
+		//! First of Billboards when Vertices is 0.
+		u32 FirstBillboard;
+		u32 FirstLight;
+		u32 LightCount;
+		//! First of the transformed vertices.
+		u32 FirstVertex;
+
+		//! Drawing order: by pass, solid front to back, transparent back to front.
+		bool operator<(const SItem& other) const;
+	};
+
+	//! A vertex after transformation and lighting.
+	struct SVertex
+	{
+		f32 Clip[4];
+		f32 Attributes[EA_COUNT];
+	};
+
+	//! A triangle ready to draw, with its edges and planes over the screen.
+	struct STriangle
+	{
+		f32 EdgeA[3];
+		f32 EdgeB[3];
+		f32 EdgeC[3];
+		//! Bit i set if edge i is a top or left edge, which owns the pixels on it.
+		u32 TopLeft;
+
+		//! value = A * x + B * y + C at pixel centers, 1/w and every attribute over w.
+		f32 DepthA, DepthB, DepthC;
+		f32 PlaneA[EA_COUNT];
+		f32 PlaneB[EA_COUNT];
+		f32 PlaneC[EA_COUNT];
+
+		//! Pixels whose centers are within the bounds.
+		s32 MinX, MinY, MaxX, MaxY;
+		u32 Item;
+		//! Mip level of both layers.
+		u32 Level[2];
+	};
+
+	//! Part of the vertices or the triangles of one item.
+	struct SChunk
+	{
+		u32 Item;
+		u32 First;
+		u32 Count;
+		//! Triangle chunks: where the output starts and how many triangles were set up.
+		u32 FirstOutput;
+		u32 OutputCount;
+	};
+
+	struct SLightInfo
+	{
+		video::SLight Light;
+		core::vector3df Position;
+	};
+
+	static void transformJob(void* data, u32 begin, u32 end);
+	static void setupJob(void* data, u32 begin, u32 end);
+	static void binJob(void* data, u32 begin, u32 end);
+	static void rasterJob(void* data, u32 begin, u32 end);
+
+	//! Collects the items and lights of the visible nodes below node.
+	void gather(ISceneNode* node, const ICameraSceneNode* camera);
+
+	//! Adds the buffer of a node, with the material it is drawn with.
+	void addItem(ISceneNode* node, const IMeshBuffer* buffer, const video::SMaterial& material,
+		const core::matrix4& world);
+
+	//! Adds vertices and indices which are not in a mesh buffer, worldBox bounds them.
+	void addItem(ISceneNode* node, const void* vertices, u32 vertexCount, video::E_VERTEX_TYPE type,
+		const void* indices, u32 indexCount, bool indices32,
+		const video::SMaterial& material, const core::matrix4& world, const core::aabbox3df& worldBox);
+
+	void addBillboard(IBillboardSceneNode* node, const ICameraSceneNode* camera);
+
+	void addSkyDome(ISceneNode* node, const ICameraSceneNode* camera);
+
+	//! Picks the lights of items which are lit, the nearest and brightest first.
+	void pickLights(SItem& item);
+
+	//! Returns the copy of texture, makes it the first time. 0 for no texture.
+	const STexture* getTexture(video::ITexture* texture);
+
+	void transformVertices(const SChunk& chunk);
+
+	void setupTriangles(SChunk& chunk);
+
+	//! Clips, culls and sets up one triangle, returns the amount of triangles written.
+	u32 setupTriangle(const SItem& item, u32 itemIndex, const SVertex* a, const SVertex* b,
+		const SVertex* c, STriangle* out) const;
+
+	void binRow(u32 row);
+
+	void rasterTile(u32 tile);
+
+	void drawTriangle(const STriangle& triangle, s32 tileX0, s32 tileY0, s32 tileX1, s32 tileY1);
+
+	//! Shades the covered pixels of a group of four, from their interpolated attributes.
+	void shadePixels(const STriangle& triangle, const SRasterMaterial& material, u32 mask,
+		const f32* depth, const f32 (*attributes)[4], s32 x, s32 y);
+
+	ISceneManager* SceneManager;
+	CWorkStealingPool* Pool;
+
+	core::dimension2d<u32> Size;
+	u32 TilesX;
+	u32 TilesY;
+
+	core::array<u32> Color;
+	//! 1/w of the nearest pixel so far, 0 for nothing drawn.
+	core::array<f32> Depth;
+	//! Indices of the triangles touching every tile, in drawing order.
+	core::array<core::array<u32> > Bins;
+
+	core::array<SItem> Items;
+	core::array<SLightInfo> Lights;
+	core::array<SLightInfo> ItemLights;
+	core::array<video::S3DVertex> Billboards;
+	core::array<IMeshBuffer*> TerrainTiles;
+	//! The mesh of the sky dome, rebuilt when the dome changes.
+	SMeshBuffer* SkyDome;
+	const ISceneNode* SkyDomeNode;
+
+	core::array<SVertex> Vertices;
+	core::array<SChunk> VertexChunks;
+	core::array<SChunk> TriangleChunks;
+	core::array<STriangle> Triangles;
+
+	core::array<STexture*> Textures;
+
+	//! Camera of the frame.
+	core::matrix4 ViewProjection;
+	core::matrix4 View;
+	f32 NearW;
+	video::SColorf AmbientLight;
+	video::SColor FogColor;
+	video::E_FOG_TYPE FogType;
+	f32 FogStart;
+	f32 FogEnd;
+	f32 FogDensity;
+
+	video::ITexture* Target;
+	video::IImage* ColorImage;
+
+	STiledRenderStats LastStats;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
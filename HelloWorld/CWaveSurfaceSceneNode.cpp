@@ -0,0 +1,315 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CWaveSurfaceSceneNode.h"
+#include "CFrameProfiler.h"
+#include "PreciseTimer.h"
+#include <math.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define _MARS_WAVES_SSE_
+#include <xmmintrin.h>
+#endif
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+// tiles per patch side, so a patch has less than 65536 vertices
+const u32 PatchTiles = 128;
+
+// Writes the heights and normals of one row of vertices. The height of a
+// vertex is the wave of its column plus the wave of the row, the normal is
+// (-slope of the column, 1, -slope of the row), normalized.
+void writeWaveRow(video::S3DVertex* v, const f32* wave, const f32* slope, u32 count,
+	f32 rowWave, f32 rowSlope)
+{
+	u32 i = 0;
+
+#ifdef _MARS_WAVES_SSE_
+	const __m128 rowWave4 = _mm_set1_ps(rowWave);
+	const __m128 rowLength4 = _mm_set1_ps(1.f + rowSlope * rowSlope);
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (; i+4<=count; i+=4)
+	{
+		const __m128 s = _mm_loadu_ps(slope + i);
+		const __m128 y = _mm_add_ps(_mm_loadu_ps(wave + i), rowWave4);
+		const __m128 ny = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(s, s), rowLength4)));
+		const __m128 nx = _mm_mul_ps(_mm_sub_ps(zero, s), ny);
+
+		f32 heights[4], normalX[4], normalY[4];
+		_mm_storeu_ps(heights, y);
+		_mm_storeu_ps(normalX, nx);
+		_mm_storeu_ps(normalY, ny);
+
+		for (u32 l=0; l<4; ++l)
+		{
+			v[i+l].Pos.Y = heights[l];
+			v[i+l].Normal.set(normalX[l], normalY[l], -rowSlope * normalY[l]);
+		}
+	}
+#endif
+
+	// the rest, or everything without SSE
+	for (; i<count; ++i)
+	{
+		const f32 ny = 1.f / sqrtf(slope[i] * slope[i] + 1.f + rowSlope * rowSlope);
+		v[i].Pos.Y = wave[i] + rowWave;
+		v[i].Normal.set(-slope[i] * ny, ny, -rowSlope * ny);
+	}
+}
+
+// Slopes of a row of wave heights spaced step apart, from the neighbours.
+void computeSlopes(const core::array<f32>& wave, core::array<f32>& slope, f32 step)
+{
+	const u32 count = wave.size();
+	for (u32 i=0; i<count; ++i)
+	{
+		const u32 prev = i ? i - 1 : i;
+		const u32 next = i + 1 < count ? i + 1 : i;
+		slope[i] = next != prev ? (wave[next] - wave[prev]) / ((next - prev) * step) : 0.f;
+	}
+}
+
+} // end anonymous namespace
+
+
+CWaveSurfaceSceneNode::CWaveSurfaceSceneNode(const core::dimension2df& tileSize,
+	const core::dimension2du& tileCount, const core::dimension2df& textureRepeatCount,
+	f32 waveHeight, f32 waveSpeed, f32 waveLength,
+	ISceneNode* parent, ISceneManager* mgr, s32 id)
+	: ISceneNode(parent, mgr, id), Columns(tileCount.Width + 1), Rows(tileCount.Height + 1),
+	TileSize(tileSize), WaveHeight(waveHeight), WaveSpeed(waveSpeed), UpdateIntervalMs(0),
+	LastWaveTimeMs(0), WavesValid(false), SkipCulledUpdates(true), LastUpdateTimeMs(0.0),
+	UpdateCount(0), SkippedUpdateCount(0)
+{
+	#ifdef _DEBUG
+	setDebugName("CWaveSurfaceSceneNode");
+	#endif
+
+	// same placement and texture coordinates as addHillPlaneMesh()
+	const f32 centerX = tileSize.Width * Columns * 0.5f;
+	const f32 centerZ = tileSize.Height * Rows * 0.5f;
+	const f32 texStepX = tileCount.Width ? textureRepeatCount.Width / tileCount.Width : 0.f;
+	const f32 texStepZ = tileCount.Height ? textureRepeatCount.Height / tileCount.Height : 0.f;
+
+	// the phase tables, in double precision because x / length gets large
+	SinX.set_used(Columns);
+	CosX.set_used(Columns);
+	for (u32 c=0; c<Columns; ++c)
+	{
+		const f64 phase = (c * tileSize.Width - centerX) / (f64)waveLength;
+		SinX[c] = (f32)sin(phase);
+		CosX[c] = (f32)cos(phase);
+	}
+
+	SinZ.set_used(Rows);
+	CosZ.set_used(Rows);
+	for (u32 r=0; r<Rows; ++r)
+	{
+		const f64 phase = (r * tileSize.Height - centerZ) / (f64)waveLength;
+		SinZ[r] = (f32)sin(phase);
+		CosZ[r] = (f32)cos(phase);
+	}
+
+	WaveX.set_used(Columns);
+	SlopeX.set_used(Columns);
+	WaveZ.set_used(Rows);
+	SlopeZ.set_used(Rows);
+
+	for (u32 firstRow=0; firstRow+1<Rows; firstRow+=PatchTiles)
+	{
+		for (u32 firstColumn=0; firstColumn+1<Columns; firstColumn+=PatchTiles)
+		{
+			SPatch patch;
+			patch.FirstColumn = firstColumn;
+			patch.FirstRow = firstRow;
+			patch.Columns = core::min_(PatchTiles + 1, Columns - firstColumn);
+			patch.Rows = core::min_(PatchTiles + 1, Rows - firstRow);
+			patch.Buffer = new SMeshBuffer();
+
+			SMeshBuffer* mb = patch.Buffer;
+			mb->Vertices.set_used(patch.Columns * patch.Rows);
+			for (u32 r=0; r<patch.Rows; ++r)
+			{
+				for (u32 c=0; c<patch.Columns; ++c)
+				{
+					const u32 column = firstColumn + c;
+					const u32 row = firstRow + r;
+					mb->Vertices[r * patch.Columns + c] = video::S3DVertex(
+						column * tileSize.Width - centerX, 0.f, row * tileSize.Height - centerZ,
+						0.f, 1.f, 0.f, video::SColor(255,255,255,255),
+						column * texStepX, 1.f - row * texStepZ);
+				}
+			}
+
+			mb->Indices.reallocate((patch.Columns - 1) * (patch.Rows - 1) * 6);
+			for (u32 r=0; r+1<patch.Rows; ++r)
+			{
+				for (u32 c=0; c+1<patch.Columns; ++c)
+				{
+					// same winding as addHillPlaneMesh()
+					const u16 current = (u16)(r * patch.Columns + c);
+					const u16 next = (u16)(current + patch.Columns);
+					mb->Indices.push_back(current);
+					mb->Indices.push_back(next);
+					mb->Indices.push_back(current + 1);
+					mb->Indices.push_back(next);
+					mb->Indices.push_back(next + 1);
+					mb->Indices.push_back(current + 1);
+				}
+			}
+
+			mb->recalculateBoundingBox();
+			Patches.push_back(patch);
+		}
+	}
+
+	// every wave stays within twice the wave height
+	const f32 maxHeight = 2.f * core::abs_(waveHeight);
+	Box.reset(-centerX, -maxHeight, -centerZ);
+	Box.addInternalPoint((Columns - 1) * tileSize.Width - centerX, maxHeight,
+		(Rows - 1) * tileSize.Height - centerZ);
+
+	for (u32 i=0; i<Patches.size(); ++i)
+	{
+		Patches[i].Buffer->BoundingBox.MinEdge.Y = -maxHeight;
+		Patches[i].Buffer->BoundingBox.MaxEdge.Y = maxHeight;
+	}
+}
+
+
+CWaveSurfaceSceneNode::~CWaveSurfaceSceneNode()
+{
+	for (u32 i=0; i<Patches.size(); ++i)
+		Patches[i].Buffer->drop();
+}
+
+
+void CWaveSurfaceSceneNode::setUpdateRate(u32 updatesPerSecond)
+{
+	UpdateIntervalMs = updatesPerSecond ? 1000 / updatesPerSecond : 0;
+}
+
+
+void CWaveSurfaceSceneNode::updateWaves(u32 timeMs)
+{
+	const f64 start = getPreciseTimeMs();
+
+	// sin(a + t) and cos(a + t) from the tables
+	const f64 time = fmod(timeMs / (f64)WaveSpeed, 2.0 * core::PI64);
+	const f32 st = (f32)sin(time);
+	const f32 ct = (f32)cos(time);
+
+	for (u32 c=0; c<Columns; ++c)
+		WaveX[c] = WaveHeight * (SinX[c] * ct + CosX[c] * st);
+	for (u32 r=0; r<Rows; ++r)
+		WaveZ[r] = WaveHeight * (CosZ[r] * ct - SinZ[r] * st);
+
+	computeSlopes(WaveX, SlopeX, TileSize.Width);
+	computeSlopes(WaveZ, SlopeZ, TileSize.Height);
+
+	for (u32 i=0; i<Patches.size(); ++i)
+	{
+		const SPatch& patch = Patches[i];
+		video::S3DVertex* v = patch.Buffer->Vertices.pointer();
+
+		for (u32 r=0; r<patch.Rows; ++r, v+=patch.Columns)
+		{
+			const u32 row = patch.FirstRow + r;
+			writeWaveRow(v, WaveX.const_pointer() + patch.FirstColumn,
+				SlopeX.const_pointer() + patch.FirstColumn, patch.Columns, WaveZ[row], SlopeZ[row]);
+		}
+
+		patch.Buffer->setDirty(EBT_VERTEX);
+	}
+
+	LastWaveTimeMs = timeMs;
+	WavesValid = true;
+	++UpdateCount;
+	const f64 end = getPreciseTimeMs();
+	LastUpdateTimeMs = end - start;
+	CFrameProfiler::report("lava_waves", start, end);
+}
+
+
+void CWaveSurfaceSceneNode::OnRegisterSceneNode()
+{
+	if (IsVisible)
+		SceneManager->registerNodeForRendering(this);
+
+	ISceneNode::OnRegisterSceneNode();
+}
+
+
+void CWaveSurfaceSceneNode::OnAnimate(u32 timeMs)
+{
+	// first, so the culling test below uses this frame's transformation
+	ISceneNode::OnAnimate(timeMs);
+
+	if (!IsVisible)
+		return;
+
+	const bool due = !WavesValid || timeMs < LastWaveTimeMs ||
+		timeMs - LastWaveTimeMs >= UpdateIntervalMs;
+	if (!due)
+		return;
+
+	// a node out of view keeps its old waves, and is updated as soon as it
+	// is in view again because the update stays due
+	if (SkipCulledUpdates && SceneManager->isCulled(this))
+	{
+		++SkippedUpdateCount;
+		return;
+	}
+
+	updateWaves(timeMs);
+}
+
+
+void CWaveSurfaceSceneNode::render()
+{
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+
+	driver->setTransform(video::ETS_WORLD, AbsoluteTransformation);
+	driver->setMaterial(Material);
+
+	for (u32 i=0; i<Patches.size(); ++i)
+		driver->drawMeshBuffer(Patches[i].Buffer);
+
+	if (DebugDataVisible & EDS_BBOX)
+	{
+		video::SMaterial debugMaterial;
+		debugMaterial.Lighting = false;
+		driver->setMaterial(debugMaterial);
+		driver->draw3DBox(Box, video::SColor(255,255,255,255));
+	}
+}
+
+
+const core::aabbox3d<f32>& CWaveSurfaceSceneNode::getBoundingBox() const
+{
+	return Box;
+}
+
+
+u32 CWaveSurfaceSceneNode::getMaterialCount() const
+{
+	return 1;
+}
+
+
+video::SMaterial& CWaveSurfaceSceneNode::getMaterial(u32 i)
+{
+	return Material;
+}
+
+} // end namespace scene
+} // end namespace irr
@@ -0,0 +1,134 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_WAVE_SURFACE_SCENE_NODE_H_INCLUDED__
+#define __C_WAVE_SURFACE_SCENE_NODE_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Type of the wave surface scene node.
+const ESCENE_NODE_TYPE ESNT_WAVE_SURFACE = (ESCENE_NODE_TYPE)MAKE_IRR_ID('w','v','s','f');
+
+//! Flat grid with the waves of Irrlicht's water surface node, for large grids.
+/** addWaterSurfaceSceneNode() calls sinf and cosf twice per vertex in every
+frame and then recalculates all normals from the triangles. Its waves are
+height = sin(x / length + t) * height + cos(z / length + t) * height, a sum
+of one term per grid column and one per grid row. This node computes the
+terms once per column and row, from a table of the sine and cosine of every
+column and row phase, so only the sum and the normal are left per vertex.
+That pass runs four vertices at a time with SSE. The normals come from the
+height differences of the neighbouring columns and rows, which is what the
+triangles would give.
+
+The grid is the one addHillPlaneMesh() builds without hills, split into
+patches of at most 128 x 128 tiles so every patch fits 16 bit indices.
+
+The waves can be updated at a lower rate than the frames are drawn, and
+are not updated while the node is outside the view of the active camera. */
+class CWaveSurfaceSceneNode : public ISceneNode
+{
+public:
+
+	//! Creates the grid, with the parameters of addHillPlaneMesh() and addWaterSurfaceSceneNode().
+	CWaveSurfaceSceneNode(const core::dimension2df& tileSize, const core::dimension2du& tileCount,
+		const core::dimension2df& textureRepeatCount, f32 waveHeight, f32 waveSpeed, f32 waveLength,
+		ISceneNode* parent, ISceneManager* mgr, s32 id=-1);
+
+	virtual ~CWaveSurfaceSceneNode();
+
+	//! Sets how often the waves are updated per second, 0 for every frame.
+	void setUpdateRate(u32 updatesPerSecond);
+
+	//! Sets if the waves are only updated while the node is in view. On by default.
+	void setSkipCulledUpdates(bool skip) { SkipCulledUpdates = skip; }
+
+	//! Moves the waves to the time timeMs.
+	void updateWaves(u32 timeMs);
+
+	u32 getVertexCount() const { return Columns * Rows; }
+
+	u32 getPatchCount() const { return Patches.size(); }
+
+	//! Buffer of a patch, in the space of the node.
+	IMeshBuffer* getPatchBuffer(u32 i) const { return Patches[i].Buffer; }
+
+	//! Time the last wave update took.
+	f64 getLastUpdateTimeMs() const { return LastUpdateTimeMs; }
+
+	//! Amount of wave updates done, since the start.
+	u32 getUpdateCount() const { return UpdateCount; }
+
+	//! Amount of wave updates skipped because the node was not in view, since the start.
+	u32 getSkippedUpdateCount() const { return SkippedUpdateCount; }
+
+	virtual void OnRegisterSceneNode();
+
+	virtual void OnAnimate(u32 timeMs);
+
+	virtual void render();
+
+	virtual const core::aabbox3d<f32>& getBoundingBox() const;
+
+	virtual u32 getMaterialCount() const;
+
+	virtual video::SMaterial& getMaterial(u32 i);
+
+	virtual ESCENE_NODE_TYPE getType() const { return ESNT_WAVE_SURFACE; }
+
+private:
+
+	//! Part of the grid, the vertices are stored row by row.
+	struct SPatch
+	{
+		SMeshBuffer* Buffer;
+		u32 FirstColumn;
+		u32 FirstRow;
+		u32 Columns;
+		u32 Rows;
+	};
+
+	//! Vertices in X and Z direction.
+	u32 Columns;
+	u32 Rows;
+	core::dimension2df TileSize;
+
+	//! Sine and cosine of x / length of every column and z / length of every row.
+	core::array<f32> SinX;
+	core::array<f32> CosX;
+	core::array<f32> SinZ;
+	core::array<f32> CosZ;
+
+	//! Height and slope of the wave term of every column and row.
+	core::array<f32> WaveX;
+	core::array<f32> SlopeX;
+	core::array<f32> WaveZ;
+	core::array<f32> SlopeZ;
+
+	core::array<SPatch> Patches;
+
+	f32 WaveHeight;
+	f32 WaveSpeed;
+
+	u32 UpdateIntervalMs;
+	u32 LastWaveTimeMs;
+	bool WavesValid;
+	bool SkipCulledUpdates;
+
+	f64 LastUpdateTimeMs;
+	u32 UpdateCount;
+	u32 SkippedUpdateCount;
+
+	video::SMaterial Material;
+	core::aabbox3df Box;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
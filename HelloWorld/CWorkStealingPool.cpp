@@ -0,0 +1,160 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CWorkStealingPool.h"
+#include "CThreadPool.h"
+
+namespace irr
+{
+
+CWorkStealingPool::CWorkStealingPool(u32 threadCount)
+	: Queues(0), RemainingChunks(0), Steals(0), Generation(0), Stopping(false)
+{
+	if (!threadCount)
+		threadCount = CThreadPool::getHardwareThreadCount();
+
+	// queue 0 belongs to the calling thread
+	Queues = new SQueue[threadCount];
+
+	Threads.reserve(threadCount - 1);
+	for (u32 i=1; i<threadCount; ++i)
+		Threads.push_back(std::thread(&CWorkStealingPool::workerLoop, this, i));
+}
+
+
+CWorkStealingPool::~CWorkStealingPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Stopping = true;
+	}
+	RangeStarted.notify_all();
+
+	for (u32 i=0; i<Threads.size(); ++i)
+		Threads[i].join();
+
+	delete [] Queues;
+}
+
+
+void CWorkStealingPool::run(RangeFunction function, void* data, u32 count, u32 grainSize)
+{
+	if (!count)
+		return;
+
+	grainSize = core::max_(grainSize, 1u);
+	const u32 chunkCount = (count + grainSize - 1) / grainSize;
+	const u32 queueCount = getThreadCount();
+
+	Steals = 0;
+
+	if (queueCount == 1 || chunkCount == 1)
+	{
+		function(data, 0, count);
+		return;
+	}
+
+	// every queue gets a contiguous part, neighbouring elements are
+	// usually neighbours in memory as well
+	RemainingChunks = chunkCount;
+	for (u32 q=0; q<queueCount; ++q)
+	{
+		const u32 first = (u32)((u64)chunkCount * q / queueCount);
+		const u32 last = (u32)((u64)chunkCount * (q + 1) / queueCount);
+
+		std::lock_guard<std::mutex> lock(Queues[q].Mutex);
+		for (u32 c=first; c<last; ++c)
+		{
+			SChunk chunk;
+			chunk.Function = function;
+			chunk.Data = data;
+			chunk.Begin = c * grainSize;
+			chunk.End = core::min_(chunk.Begin + grainSize, count);
+			Queues[q].Chunks.push_back(chunk);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		++Generation;
+	}
+	RangeStarted.notify_all();
+
+	work(0);
+
+	std::unique_lock<std::mutex> lock(Mutex);
+	while (RemainingChunks)
+		RangeDone.wait(lock);
+}
+
+
+bool CWorkStealingPool::takeChunk(u32 queue, SChunk& chunk)
+{
+	{
+		SQueue& own = Queues[queue];
+		std::lock_guard<std::mutex> lock(own.Mutex);
+		if (!own.Chunks.empty())
+		{
+			chunk = own.Chunks.back();
+			own.Chunks.pop_back();
+			return true;
+		}
+	}
+
+	// steal the chunk farthest from where the owner is working
+	const u32 queueCount = getThreadCount();
+	for (u32 i=1; i<queueCount; ++i)
+	{
+		SQueue& other = Queues[(queue + i) % queueCount];
+		std::lock_guard<std::mutex> lock(other.Mutex);
+		if (!other.Chunks.empty())
+		{
+			chunk = other.Chunks.front();
+			other.Chunks.pop_front();
+			++Steals;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void CWorkStealingPool::work(u32 queue)
+{
+	SChunk chunk;
+	while (takeChunk(queue, chunk))
+	{
+		chunk.Function(chunk.Data, chunk.Begin, chunk.End);
+
+		if (--RemainingChunks == 0)
+		{
+			// under the mutex, so run() can not miss it between its check and wait
+			std::lock_guard<std::mutex> lock(Mutex);
+			RangeDone.notify_all();
+		}
+	}
+}
+
+
+void CWorkStealingPool::workerLoop(u32 queue)
+{
+	u32 seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			while (Generation == seen && !Stopping)
+				RangeStarted.wait(lock);
+
+			if (Stopping)
+				return;
+			seen = Generation;
+		}
+
+		work(queue);
+	}
+}
+
+} // end namespace irr
@@ -0,0 +1,98 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_WORK_STEALING_POOL_H_INCLUDED__
+#define __C_WORK_STEALING_POOL_H_INCLUDED__
+
+#include <irrlicht.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace irr
+{
+
+//! Threads running the chunks of a range, each from its own queue.
+/** CThreadPool runs independent jobs from one shared queue, which is fine
+for a few big jobs like loading a file. For many small chunks of one loop
+the shared queue becomes the bottleneck. Here every thread gets its own
+queue with a contiguous part of the chunks, takes them from the back and,
+once it runs dry, steals from the front of the other queues. Chunks of
+uneven cost end up spread over all threads without a central queue.
+
+The calling thread works on the range as well, so a pool of 1 thread runs
+everything on the caller. The same rules as for CThreadPool apply: the
+function must not call into the video driver, the scene manager or the GUI
+environment. */
+class CWorkStealingPool
+{
+public:
+
+	typedef void (*RangeFunction)(void* data, u32 begin, u32 end);
+
+	//! Starts the workers.
+	/** \param threadCount Threads working on a range including the caller,
+	0 for one per hardware thread. */
+	explicit CWorkStealingPool(u32 threadCount=0);
+
+	//! Stops the workers.
+	~CWorkStealingPool();
+
+	//! Runs function over [0,count) in chunks of grainSize and returns when all are done.
+	void run(RangeFunction function, void* data, u32 count, u32 grainSize);
+
+	//! Threads working on a range, including the caller.
+	u32 getThreadCount() const { return (u32)Threads.size() + 1; }
+
+	//! Chunks taken from another thread's queue in the last run().
+	u32 getLastStealCount() const { return Steals; }
+
+private:
+
+	// not copyable
+	CWorkStealingPool(const CWorkStealingPool&);
+	CWorkStealingPool& operator=(const CWorkStealingPool&);
+
+	struct SChunk
+	{
+		RangeFunction Function;
+		void* Data;
+		u32 Begin;
+		u32 End;
+	};
+
+	struct SQueue
+	{
+		std::mutex Mutex;
+		std::deque<SChunk> Chunks;
+	};
+
+	//! Takes a chunk from the own queue or steals one.
+	bool takeChunk(u32 queue, SChunk& chunk);
+
+	//! Runs chunks until there are none left to take.
+	void work(u32 queue);
+
+	void workerLoop(u32 queue);
+
+	std::vector<std::thread> Threads;
+	SQueue* Queues;
+
+	std::mutex Mutex;
+	//! Signalled when a range is started or the pool stops.
+	std::condition_variable RangeStarted;
+	//! Signalled when the last chunk of a range is done.
+	std::condition_variable RangeDone;
+	std::atomic<u32> RemainingChunks;
+	std::atomic<u32> Steals;
+	u32 Generation;
+	bool Stopping;
+};
+
+} // end namespace irr
+
+#endif
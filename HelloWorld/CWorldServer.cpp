@@ -0,0 +1,74 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "CWorldServer.h"
+#include "CMarsWorld.h"
+#include "CWorkStealingPool.h"
+#include "PreciseTimer.h"
+
+namespace irr
+{
+namespace scene
+{
+
+CWorldServer::CWorldServer(u32 threadCount)
+	: Pool(0), TimeMs(0), LastTickTimeMs(0)
+{
+	#ifdef _DEBUG
+	setDebugName("CWorldServer");
+	#endif
+
+	setThreadCount(threadCount);
+}
+
+
+CWorldServer::~CWorldServer()
+{
+	delete Pool;
+
+	for (u32 i=0; i<Worlds.size(); ++i)
+		Worlds[i]->drop();
+}
+
+
+void CWorldServer::setThreadCount(u32 threadCount)
+{
+	delete Pool;
+	Pool = new CWorkStealingPool(threadCount);
+}
+
+
+u32 CWorldServer::getThreadCount() const
+{
+	return Pool->getThreadCount();
+}
+
+
+void CWorldServer::addWorld(CMarsWorld* world)
+{
+	world->grab();
+	Worlds.push_back(world);
+}
+
+
+void CWorldServer::tickWorlds(void* data, u32 begin, u32 end)
+{
+	CWorldServer* server = (CWorldServer*)data;
+
+	for (u32 i=begin; i<end; ++i)
+		server->Worlds[i]->tick(server->TimeMs);
+}
+
+
+void CWorldServer::tick(u32 timeMs)
+{
+	TimeMs = timeMs;
+
+	const f64 start = getPreciseTimeMs();
+	Pool->run(tickWorlds, this, Worlds.size(), 1);
+	LastTickTimeMs = getPreciseTimeMs() - start;
+}
+
+} // end namespace scene
+} // end namespace irr
@@ -0,0 +1,65 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#ifndef __C_WORLD_SERVER_H_INCLUDED__
+#define __C_WORLD_SERVER_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+class CWorkStealingPool;
+
+namespace scene
+{
+
+class CMarsWorld;
+
+//! Ticks many independent worlds in parallel.
+/** Every world has its own scene manager and only reads the assets it
+shares with the others, see CMarsWorld.h, so tick() runs one task per world
+on a work stealing pool. A world is always ticked by one thread as a whole,
+worlds of uneven cost are spread over the threads by stealing. */
+class CWorldServer : public virtual IReferenceCounted
+{
+public:
+
+	//! \param threadCount Threads including the caller, 0 for one per hardware thread.
+	CWorldServer(u32 threadCount=0);
+
+	//! Drops the worlds.
+	virtual ~CWorldServer();
+
+	//! Changes the amount of threads.
+	void setThreadCount(u32 threadCount);
+
+	u32 getThreadCount() const;
+
+	//! Adds a world, it is grabbed.
+	void addWorld(CMarsWorld* world);
+
+	u32 getWorldCount() const { return Worlds.size(); }
+
+	CMarsWorld* getWorld(u32 index) const { return Worlds[index]; }
+
+	//! Ticks every world once at timeMs and returns when all are done.
+	void tick(u32 timeMs);
+
+	//! Time the last tick() took for all worlds.
+	f64 getLastTickTimeMs() const { return LastTickTimeMs; }
+
+private:
+
+	static void tickWorlds(void* data, u32 begin, u32 end);
+
+	CWorkStealingPool* Pool;
+	core::array<CMarsWorld*> Worlds;
+	u32 TimeMs;
+	f64 LastTickTimeMs;
+};
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
@@ -0,0 +1,162 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+
+Layout of the cooked mesh files (.cmesh) written by CCookedMeshWriter and
+read by CCookedMeshLoader. All values are little endian and every record
+starts at a multiple of 4 bytes, so the loader can copy the vertex and index
+arrays straight out of the mapped file.
+
+	SCookedMeshHeader
+	BufferCount times:
+		SCookedBuffer
+		MATERIAL_MAX_TEXTURES texture names
+		VertexCount vertices of VertexType
+		IndexCount indices of IndexType, padded to 4 bytes
+	JointCount times (skinned meshes only):
+		joint name
+		SCookedJoint
+		AttachedMeshCount u32
+		PositionKeyCount SCookedKey
+		ScaleKeyCount SCookedKey
+		RotationKeyCount SCookedRotationKey
+		WeightCount SCookedWeight
+
+A name is an u32 length followed by that many characters, padded to 4
+bytes. Joints are stored parents first, Parent is the index of the parent
+joint or -1.
+*/
+#ifndef __COOKED_MESH_FORMAT_H_INCLUDED__
+#define __COOKED_MESH_FORMAT_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+const u32 COOKED_MESH_MAGIC = MAKE_IRR_ID('C','M','S','H');
+
+//! Increase whenever the layout changes, old files are then rejected.
+const u32 COOKED_MESH_VERSION = 1;
+
+//! Extension of cooked mesh files.
+const c8* const COOKED_MESH_EXTENSION = ".cmesh";
+
+enum E_COOKED_MESH_FLAG
+{
+	//! The file has joints and is loaded as skinned mesh.
+	ECMF_SKINNED = 1
+};
+
+enum E_COOKED_MATERIAL_FLAG
+{
+	ECMAT_WIREFRAME = 1,
+	ECMAT_POINTCLOUD = 2,
+	ECMAT_GOURAUD_SHADING = 4,
+	ECMAT_LIGHTING = 8,
+	ECMAT_ZWRITE_ENABLE = 16,
+	ECMAT_BACK_FACE_CULLING = 32,
+	ECMAT_FRONT_FACE_CULLING = 64,
+	ECMAT_FOG_ENABLE = 128,
+	ECMAT_NORMALIZE_NORMALS = 256,
+	ECMAT_USE_MIP_MAPS = 512
+};
+
+struct SCookedMeshHeader
+{
+	u32 Magic;
+	u32 Version;
+	u32 Flags;
+	u32 BufferCount;
+	u32 JointCount;
+	f32 AnimationSpeed;
+	f32 BoxMin[3];
+	f32 BoxMax[3];
+};
+
+struct SCookedMaterial
+{
+	u32 MaterialType;
+	u32 AmbientColor;
+	u32 DiffuseColor;
+	u32 EmissiveColor;
+	u32 SpecularColor;
+	f32 Shininess;
+	f32 MaterialTypeParam;
+	f32 MaterialTypeParam2;
+	f32 Thickness;
+	u32 ZBuffer;
+	u32 AntiAliasing;
+	u32 ColorMask;
+	//! E_COOKED_MATERIAL_FLAG bits.
+	u32 Flags;
+};
+
+struct SCookedBuffer
+{
+	u32 VertexType;
+	u32 IndexType;
+	u32 VertexCount;
+	u32 IndexCount;
+	f32 BoxMin[3];
+	f32 BoxMax[3];
+	//! Only used by skinned meshes.
+	f32 Transformation[16];
+	SCookedMaterial Material;
+};
+
+struct SCookedJoint
+{
+	s32 Parent;
+	f32 LocalMatrix[16];
+	f32 GlobalInversedMatrix[16];
+	u32 AttachedMeshCount;
+	u32 PositionKeyCount;
+	u32 ScaleKeyCount;
+	u32 RotationKeyCount;
+	u32 WeightCount;
+};
+
+//! Position or scale key.
+struct SCookedKey
+{
+	f32 Frame;
+	f32 Value[3];
+};
+
+struct SCookedRotationKey
+{
+	f32 Frame;
+	//! X, Y, Z, W of the quaternion.
+	f32 Value[4];
+};
+
+struct SCookedWeight
+{
+	u32 Buffer;
+	u32 Vertex;
+	f32 Strength;
+};
+
+//! Returns the name of the cooked file for a source mesh.
+/** The file is next to the source, with a lower case name, so that sources
+which are loaded with different case, like UFO.obj and ufo.obj, share one
+cooked file and one mesh cache entry. */
+inline io::path getCookedMeshName(io::IFileSystem* fileSystem, const io::path& source)
+{
+	io::path name = fileSystem->getFileBasename(source, false);
+	name.make_lower();
+	name += COOKED_MESH_EXTENSION;
+
+	const io::path dir = fileSystem->getFileDir(source);
+	if (dir.size() && dir != ".")
+		name = dir + "/" + name;
+	return name;
+}
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
@@ -0,0 +1,93 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+
+Layout of the cooked texture files (.ctex) written by the texture cooker and
+read by CAssetLoader. All values are little endian.
+
+	SCookedTextureHeader
+	LevelCount mip levels, largest first, each one
+		max(Width >> level, 1) * max(Height >> level, 1) pixels of A8R8G8B8
+
+The size is already a power of two and the mip chain, if any, goes down to
+1x1, which is the layout IVideoDriver::addTexture() expects for its
+mipmapData, so the levels after the first are handed to the driver as they
+are and neither decoding nor mipmap generation happens at load time.
+*/
+#ifndef __COOKED_TEXTURE_FORMAT_H_INCLUDED__
+#define __COOKED_TEXTURE_FORMAT_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace video
+{
+
+const u32 COOKED_TEXTURE_MAGIC = MAKE_IRR_ID('C','T','E','X');
+
+//! Increase whenever the layout changes, old files are then ignored.
+const u32 COOKED_TEXTURE_VERSION = 1;
+
+//! Appended to the name of the source image.
+const c8* const COOKED_TEXTURE_EXTENSION = ".ctex";
+
+struct SCookedTextureHeader
+{
+	u32 Magic;
+	u32 Version;
+	u32 Width;
+	u32 Height;
+	//! Always ECF_A8R8G8B8 in version 1.
+	u32 ColorFormat;
+	//! 1 for textures without mipmaps.
+	u32 LevelCount;
+	//! Size of the source image before it was scaled to a power of two.
+	u32 OriginalWidth;
+	u32 OriginalHeight;
+};
+
+//! Returns the size of one mip level in bytes.
+inline u32 getCookedTextureLevelSize(const SCookedTextureHeader& header, u32 level)
+{
+	const u32 width = core::max_(header.Width >> level, 1u);
+	const u32 height = core::max_(header.Height >> level, 1u);
+	return width * height * 4;
+}
+
+//! Returns the size of all levels in bytes.
+inline u32 getCookedTextureDataSize(const SCookedTextureHeader& header)
+{
+	u32 size = 0;
+	for (u32 level=0; level<header.LevelCount; ++level)
+		size += getCookedTextureLevelSize(header, level);
+	return size;
+}
+
+//! Returns true if header can be loaded from a file of fileSize bytes.
+inline bool isCookedTextureValid(const SCookedTextureHeader& header, u32 fileSize)
+{
+	if (header.Magic != COOKED_TEXTURE_MAGIC || header.Version != COOKED_TEXTURE_VERSION ||
+		header.ColorFormat != ECF_A8R8G8B8 || !header.Width || !header.Height ||
+		header.Width > 16384 || header.Height > 16384 || !header.LevelCount || header.LevelCount > 15)
+		return false;
+
+	// a mip chain has to go down to 1x1, see above
+	const u32 fullChain = core::max_(header.Width, header.Height);
+	if (header.LevelCount > 1 && (fullChain >> (header.LevelCount - 1)) != 1)
+		return false;
+
+	return fileSize >= sizeof(header) &&
+		fileSize - sizeof(header) >= getCookedTextureDataSize(header);
+}
+
+//! Returns the name of the cooked file for a source image.
+inline io::path getCookedTextureName(const io::path& source)
+{
+	return source + COOKED_TEXTURE_EXTENSION;
+}
+
+} // end namespace video
+} // end namespace irr
+
+#endif
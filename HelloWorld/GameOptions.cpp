@@ -0,0 +1,201 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "GameOptions.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace irr
+{
+
+namespace
+{
+
+bool parseDriverType(const char* name, video::E_DRIVER_TYPE& out)
+{
+	if (!strcmp(name, "d3d9"))
+		out = video::EDT_DIRECT3D9;
+	else if (!strcmp(name, "opengl"))
+		out = video::EDT_OPENGL;
+	else if (!strcmp(name, "burnings"))
+		out = video::EDT_BURNINGSVIDEO;
+	else if (!strcmp(name, "software"))
+		out = video::EDT_SOFTWARE;
+	else if (!strcmp(name, "null"))
+		out = video::EDT_NULL;
+	else
+		return false;
+	return true;
+}
+
+} // end anonymous namespace
+
+
+bool parseGameOptions(int argc, char* argv[], SGameOptions& options)
+{
+	bool driverGiven = false;
+
+	for (int i=1; i<argc; ++i)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = i+1 < argc;
+
+		if (!strcmp(arg, "-driver") && hasValue)
+		{
+			if (!parseDriverType(argv[++i], options.DriverType))
+			{
+				printf("Unknown driver '%s'\n", argv[i]);
+				return false;
+			}
+			driverGiven = true;
+		}
+		else if (!strcmp(arg, "-window") && hasValue)
+		{
+			u32 width = 0, height = 0;
+			if (sscanf(argv[++i], "%ux%u", &width, &height) != 2 || !width || !height)
+			{
+				printf("Invalid window size '%s', expected <width>x<height>\n", argv[i]);
+				return false;
+			}
+			options.WindowSize.set(width, height);
+			options.Fullscreen = false;
+		}
+		else if (!strcmp(arg, "-bench"))
+		{
+			options.Benchmark = true;
+			// optional frame count
+			if (hasValue && argv[i+1][0] != '-')
+				options.BenchmarkFrames = (u32)atoi(argv[++i]);
+		}
+		else if (!strcmp(arg, "-bench-out") && hasValue)
+		{
+			options.BenchmarkOutput = argv[++i];
+		}
+		else if (!strcmp(arg, "-microbench") && hasValue)
+		{
+			options.MicroBenchmark = argv[++i];
+		}
+		else if (!strcmp(arg, "-cook"))
+		{
+			options.Cook = true;
+		}
+		else if (!strcmp(arg, "-load-threads") && hasValue)
+		{
+			options.LoadThreads = (u32)atoi(argv[++i]);
+		}
+		else if (!strcmp(arg, "-shadow-budget") && hasValue)
+		{
+			options.ShadowBudget = (u32)atoi(argv[++i]);
+		}
+		else if (!strcmp(arg, "-shadow-lights") && hasValue)
+		{
+			options.ShadowLights = (u32)atoi(argv[++i]);
+		}
+		else if (!strcmp(arg, "-tick-rate") && hasValue)
+		{
+			options.TickRate = (f32)atof(argv[++i]);
+		}
+		else if (!strcmp(arg, "-max-fps") && hasValue)
+		{
+			options.MaxFps = (f32)atof(argv[++i]);
+		}
+		else if (!strcmp(arg, "-max-catchup") && hasValue)
+		{
+			options.MaxCatchUpTicks = (u32)atoi(argv[++i]);
+		}
+		else if (!strcmp(arg, "-free-run"))
+		{
+			options.FreeRun = true;
+		}
+		else if (!strcmp(arg, "-animation-threads") && hasValue)
+		{
+			options.AnimationThreads = (u32)atoi(argv[++i]);
+		}
+		else if (!strcmp(arg, "-profile"))
+		{
+			options.Profile = true;
+		}
+		else if (!strcmp(arg, "-trace") && hasValue)
+		{
+			options.TraceOutput = argv[++i];
+		}
+		else if (!strcmp(arg, "-no-occlusion"))
+		{
+			options.Occlusion = false;
+		}
+		else if (!strcmp(arg, "-no-lod"))
+		{
+			options.MeshLOD = false;
+		}
+		else if (!strcmp(arg, "-no-impostors"))
+		{
+			options.Impostors = false;
+		}
+		else if (!strcmp(arg, "-no-render-queue"))
+		{
+			options.RenderQueue = false;
+		}
+		else if (!strcmp(arg, "-no-atlas"))
+		{
+			options.TextureAtlas = false;
+		}
+		else if (!strcmp(arg, "-worlds") && hasValue)
+		{
+			options.WorldCount = (u32)atoi(argv[++i]);
+		}
+		else if (!strcmp(arg, "-tiled"))
+		{
+			options.TiledRenderer = true;
+			// optional thread count
+			if (hasValue && argv[i+1][0] != '-')
+				options.TiledThreads = (u32)atoi(argv[++i]);
+		}
+		else
+		{
+			printf("Unknown argument '%s'\n", arg);
+			return false;
+		}
+	}
+
+	// the benchmark steps the device timer by itself, once per frame
+	if (options.Benchmark && (options.TickRate > 0.f || options.FreeRun))
+	{
+		printf("-tick-rate and -free-run can not be used with -bench\n");
+		return false;
+	}
+
+	// free running needs ticks to run
+	if (options.FreeRun && options.TickRate <= 0.f)
+		options.TickRate = 60.f;
+
+	if (options.TiledRenderer)
+	{
+		// the culler, the impostors and the queue work inside drawAll(),
+		// which the tiled renderer replaces
+		options.Occlusion = false;
+		options.Impostors = false;
+		options.RenderQueue = false;
+
+		// the driver only shows the frames, the software one is enough
+		if (!driverGiven && !options.Benchmark)
+			options.DriverType = video::EDT_BURNINGSVIDEO;
+	}
+
+	if (options.Benchmark || options.MicroBenchmark.size() || options.Cook)
+	{
+		// benchmarks and cooking run on build machines without a GPU,
+		// windowed and without vsync so the frame times are not clamped.
+		if (!driverGiven)
+			options.DriverType = video::EDT_NULL;
+		options.Fullscreen = false;
+		options.Vsync = false;
+		if (!options.BenchmarkFrames)
+			options.BenchmarkFrames = 1;
+	}
+
+	return true;
+}
+
+} // end namespace irr
@@ -0,0 +1,145 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+
+Command line options of the game. Without any arguments the game starts
+exactly like before: Direct3D9, 1366x768, fullscreen, FPS camera.
+*/
+#ifndef __GAME_OPTIONS_H_INCLUDED__
+#define __GAME_OPTIONS_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+
+//! All settings which can be changed from the command line.
+struct SGameOptions
+{
+	SGameOptions()
+		: DriverType(video::EDT_DIRECT3D9), WindowSize(1366, 768),
+		Fullscreen(true), Vsync(true), Benchmark(false),
+		BenchmarkFrames(2000), BenchmarkFrameTimeMs(1000.f / 60.f),
+		BenchmarkOutput("benchmark.json"), MicroBenchmark(""), Cook(false), LoadThreads(0),
+		ShadowBudget(64), ShadowLights(2), TickRate(0.f), MaxFps(0.f),
+		MaxCatchUpTicks(5), FreeRun(false), AnimationThreads(0),
+		Profile(false), TraceOutput(""), Occlusion(true), MeshLOD(true), Impostors(true),
+		RenderQueue(true), TextureAtlas(true), WorldCount(16),
+		TiledRenderer(false), TiledThreads(0)
+	{
+	}
+
+	//! Driver used to render the scene.
+	video::E_DRIVER_TYPE DriverType;
+
+	//! Size of the window or screen.
+	core::dimension2d<u32> WindowSize;
+
+	bool Fullscreen;
+	bool Vsync;
+
+	//! Run the scripted camera flythrough instead of the FPS camera.
+	bool Benchmark;
+
+	//! Amount of frames rendered in benchmark mode.
+	u32 BenchmarkFrames;
+
+	//! Virtual time which passes for the animators per benchmark frame.
+	f32 BenchmarkFrameTimeMs;
+
+	//! File the benchmark report is written to.
+	io::path BenchmarkOutput;
+
+	//! Name of the micro benchmark to run instead of the game, empty for none.
+	core::stringc MicroBenchmark;
+
+	//! Cook the meshes of the game into .cmesh files and exit, see MeshCooker.h.
+	bool Cook;
+
+	//! Worker threads loading the assets, 0 for one per hardware thread.
+	u32 LoadThreads;
+
+	//! Most shadow casters which get shadow volumes in a frame, 0 for all.
+	u32 ShadowBudget;
+
+	//! Most lights which cast shadows in a frame, see CNearestLightManager.h.
+	u32 ShadowLights;
+
+	//! Simulation ticks per second, 0 to animate once per frame like before.
+	f32 TickRate;
+
+	//! Most frames per second drawn with a tick rate, 0 for no limit.
+	f32 MaxFps;
+
+	//! Most ticks one frame catches up, see CSimulationClock.h.
+	u32 MaxCatchUpTicks;
+
+	//! Run one tick per frame instead of following real time, for headless runs.
+	bool FreeRun;
+
+	//! Threads running the animators before drawAll(), 0 to leave them to drawAll().
+	u32 AnimationThreads;
+
+	//! Show the time of every phase of the frame instead of the title, see CFrameProfiler.h.
+	bool Profile;
+
+	//! File the phases are written to as a trace on exit, empty for none.
+	io::path TraceOutput;
+
+	//! Hide what the mother ship, the gates and the terrain cover, see COcclusionCuller.h.
+	bool Occlusion;
+
+	//! Draw the gates, the mother ship and the ufos with levels of detail, see CLodMeshSceneNode.h.
+	bool MeshLOD;
+
+	//! Draw the far away ships and gates as impostors, see CImpostorManager.h.
+	bool Impostors;
+
+	//! Draw the solid mesh buffers sorted by their state, see CRenderQueue.h.
+	bool RenderQueue;
+
+	//! Draw the ships from one atlas of their textures, see CTextureAtlas.h.
+	bool TextureAtlas;
+
+	//! Worlds simulated by the worlds micro benchmark, see CMarsWorld.h.
+	u32 WorldCount;
+
+	//! Draw the scene on the CPU with all cores, see CTiledSoftwareRenderer.h.
+	bool TiledRenderer;
+
+	//! Threads of the tiled renderer, 0 for one per hardware thread.
+	u32 TiledThreads;
+};
+
+//! Parses the command line into options.
+/** Supported arguments:
+-driver d3d9|opengl|burnings|software|null
+-window <width>x<height>
+-bench [frames]
+-bench-out <file>
+-microbench all|selectors|collision|shadows|particles|water|tangents|loading|terrain|lights|animators|skinning|occlusion|impostors|worlds
+-cook
+-load-threads <count>
+-shadow-budget <casters>
+-shadow-lights <lights>
+-tick-rate <hz>
+-max-fps <fps>
+-max-catchup <ticks>
+-free-run
+-animation-threads <count>
+-profile
+-trace <file>
+-no-occlusion
+-no-lod
+-no-impostors
+-no-render-queue
+-no-atlas
+-worlds <count>
+-tiled [threads]
+Unknown arguments, and -tick-rate or -free-run together with -bench, are
+reported and make this function return false. */
+bool parseGameOptions(int argc, char* argv[], SGameOptions& options);
+
+} // end namespace irr
+
+#endif
@@ -50,6 +50,34 @@ After we have set up the IDE, the compiler will know where to find the Irrlicht
 Engine header files so we can include it now in our code.
 */
 #include <irrlicht.h>
+#include "GameOptions.h"
+#include "MicroBenchmarks.h"
+#include "MeshCooker.h"
+#include "TextureCooker.h"
+#include "CAnimationPhase.h"
+#include "CAssetLoader.h"
+#include "CBenchmarkRecorder.h"
+#include "CBroadphaseTriangleSelector.h"
+#include "CBvhTriangleSelector.h"
+#include "CCubeFieldSceneNode.h"
+#include "CFlythroughPath.h"
+#include "CFrameProfiler.h"
+#include "CImpostorManager.h"
+#include "CLodMeshSceneNode.h"
+#include "CNearestLightManager.h"
+#include "COcclusionCuller.h"
+#include "CPagedTerrainSceneNode.h"
+#include "CProfileProbes.h"
+#include "CRenderQueue.h"
+#include "CShadowVolumeManager.h"
+#include "CSimulationClock.h"
+#include "CSkinnedCharacterSceneNode.h"
+#include "CSoaParticleSystemSceneNode.h"
+#include "CSoaSkin.h"
+#include "CTextureAtlas.h"
+#include "CTiledSoftwareRenderer.h"
+#include "CWaveSurfaceSceneNode.h"
+#include "PreciseTimer.h"
 
 /*
 In the Irrlicht Engine, everything can be found in the namespace 'irr'. So if
@@ -90,11 +118,446 @@ losing platform independence then.
 #endif
 
 
+/*
+Irrlicht does not count draw calls, so the benchmark estimates them from the
+scene graph after drawAll(): every visible node which was not culled costs
+one call per mesh buffer, all other renderable nodes one call.
+*/
+u32 estimateDrawCalls(ISceneManager* smgr, const array<ISceneNode*>& nodes,
+	const COcclusionCuller* occlusion, const CImpostorManager* impostors)
+{
+	u32 calls = 0;
+	for (u32 i=0; i<nodes.size(); ++i)
+	{
+		ISceneNode* node = nodes[i];
+		if (!node->isTrulyVisible() || smgr->isCulled(node))
+			continue;
+
+		// the profile probe and the occlusion culler draw nothing
+		if (node->getType() == ESNT_PROFILE_PROBE || node->getType() == ESNT_OCCLUSION_CULLER)
+			continue;
+
+		// visible again after drawAll(), but not drawn
+		if (occlusion && occlusion->wasOccluded(node))
+			continue;
+		if (impostors && impostors->wasImpostor(node))
+			continue;
+
+		// all impostors in one call
+		if (node->getType() == ESNT_IMPOSTOR_MANAGER)
+		{
+			calls += ((CImpostorManager*)node)->getLastImpostorCount() ? 1 : 0;
+			continue;
+		}
+
+		// its nodes are visible again and counted themselves
+		if (node->getType() == ESNT_RENDER_QUEUE)
+			continue;
+
+		// one buffer per material
+		if (node->getType() == ESNT_SKINNED_CHARACTER)
+		{
+			calls += node->getMaterialCount();
+			continue;
+		}
+
+		// the buffers of the current level, some may have no triangles left
+		if (node->getType() == ESNT_LOD_MESH)
+		{
+			IMesh* mesh = ((CLodMeshSceneNode*)node)->getCurrentMesh();
+			for (u32 b=0; b<mesh->getMeshBufferCount(); ++b)
+				calls += mesh->getMeshBuffer(b)->getIndexCount() ? 1 : 0;
+			continue;
+		}
+
+		switch (node->getType())
+		{
+		case ESNT_SCENE_MANAGER:
+		case ESNT_CAMERA:
+		case ESNT_CAMERA_FPS:
+		case ESNT_CAMERA_MAYA:
+		case ESNT_LIGHT:
+		case ESNT_EMPTY:
+		case ESNT_DUMMY_TRANSFORMATION:
+			break;
+		case ESNT_MESH:
+		case ESNT_CUBE:
+		case ESNT_SPHERE:
+		case ESNT_OCTREE:
+			{
+				IMesh* mesh = ((IMeshSceneNode*)node)->getMesh();
+				calls += mesh ? mesh->getMeshBufferCount() : 0;
+			}
+			break;
+		case ESNT_ANIMATED_MESH:
+			{
+				IAnimatedMesh* mesh = ((IAnimatedMeshSceneNode*)node)->getMesh();
+				calls += mesh ? mesh->getMesh(0)->getMeshBufferCount() : 0;
+			}
+			break;
+		default:
+			++calls;
+			break;
+		}
+	}
+
+	return calls;
+}
+
+
+/*
+Counts the triangles the level of detail nodes drew in the last frame, and
+the triangles they would have drawn with their full meshes.
+*/
+void countLodTriangles(ISceneManager* smgr, const array<ISceneNode*>& nodes,
+	const COcclusionCuller* occlusion, const CImpostorManager* impostors, u32& drawn, u32& full)
+{
+	drawn = 0;
+	full = 0;
+	for (u32 i=0; i<nodes.size(); ++i)
+	{
+		ISceneNode* node = nodes[i];
+		if (node->getType() != ESNT_LOD_MESH || !node->isTrulyVisible() || smgr->isCulled(node))
+			continue;
+		if (occlusion && occlusion->wasOccluded(node))
+			continue;
+		if (impostors && impostors->wasImpostor(node))
+			continue;
+
+		const CLodMeshSceneNode* lod = (const CLodMeshSceneNode*)node;
+		drawn += lod->getLevelTriangleCount(lod->getCurrentLevel());
+		full += lod->getLevelTriangleCount(0);
+	}
+}
+
+
+/*
+Logs the triangles of every level of detail of a mesh.
+*/
+void logMeshLevels(ILogger* logger, const c8* name, const CLodMeshSceneNode* node)
+{
+	stringc levels("Mesh levels of detail ");
+	levels += name;
+	levels += ":";
+	for (u32 l=0; l<node->getLevelCount(); ++l)
+	{
+		levels += " ";
+		levels += node->getLevelTriangleCount(l);
+	}
+	levels += " triangles";
+	logger->log(levels.c_str(), ELL_INFORMATION);
+}
+
+
+/*
+Progress callback of the asset loader. It draws a bar at the bottom of the
+screen, the scene does not exist yet while the assets are loaded.
+*/
+void drawLoadingProgress(u32 loaded, u32 total, const io::path& name, void* userData)
+{
+	IrrlichtDevice* device = (IrrlichtDevice*)userData;
+	IVideoDriver* driver = device->getVideoDriver();
+
+	// keeps the window responsive
+	if (!device->run())
+		return;
+
+	const dimension2d<u32> screen = driver->getScreenSize();
+	const s32 width = (s32)screen.Width - 40;
+	const s32 top = (s32)screen.Height - 40;
+
+	driver->beginScene(true, true, SColor(255,0,0,0));
+	driver->draw2DRectangleOutline(rect<s32>(20, top, 20 + width, top + 20), SColor(255,200,120,60));
+	driver->draw2DRectangle(SColor(255,200,120,60),
+		rect<s32>(22, top + 2, 22 + (width - 4) * (s32)loaded / (s32)total, top + 18));
+	driver->endScene();
+}
+
+
+/*
+Draws one frame, the same in all loops of the game. Every step is a phase
+of the frame profiler; drawAll() is split up further by the profile probe,
+the shadow volumes and the light manager, see CProfileProbes.h. With the
+tiled renderer, it draws the scene instead of drawAll().
+*/
+void drawFrame(IrrlichtDevice* device, CAnimationPhase* animation, CTiledSoftwareRenderer* tiled, u32 timeMs)
+{
+	IVideoDriver* driver = device->getVideoDriver();
+
+	{
+		MARS_PROFILE_SCOPE("begin_scene");
+		driver->beginScene(true, true, SColor(0,0,0,0));
+	}
+
+	if (animation)
+	{
+		MARS_PROFILE_SCOPE("animation_phase");
+		animation->animate(timeMs);
+	}
+
+	{
+		MARS_PROFILE_SCOPE("scene_draw");
+		if (tiled)
+		{
+			tiled->drawAll(timeMs);
+			tiled->present();
+		}
+		else
+			device->getSceneManager()->drawAll();
+	}
+
+	{
+		MARS_PROFILE_SCOPE("gui_draw");
+		device->getGUIEnvironment()->drawAll();
+	}
+
+	MARS_PROFILE_SCOPE("present");
+	driver->endScene();
+}
+
+
+/*
+The benchmark replaces the interactive loop at the end of main(). Instead of
+the FPS camera reacting to the keyboard, the camera is moved along a fixed
+recorded path, one step per frame, and the device timer is stopped and
+advanced by a fixed amount per frame. That way every run renders exactly the
+same frames, no matter how fast the machine is, and the frame times of two
+builds can be compared. The report is written as JSON.
+*/
+int runBenchmark(IrrlichtDevice* device, ICameraSceneNode* camera, const CAssetLoader& assets,
+	const CShadowVolumeManager* shadows, const CNearestLightManager* lights,
+	const COcclusionCuller* occlusion, const CImpostorManager* impostors,
+	const CRenderQueue* renderQueue, const CTextureAtlas* atlas, CAnimationPhase* animation,
+	CTiledSoftwareRenderer* tiled, f64 startupMs, const SGameOptions& options)
+{
+	IVideoDriver* driver = device->getVideoDriver();
+	ISceneManager* smgr = device->getSceneManager();
+	ITimer* timer = device->getTimer();
+
+	// The camera follows the path, not the keyboard and mouse
+	camera->setInputReceiverEnabled(false);
+	const CFlythroughPath path = CFlythroughPath::createMarsColonyPath();
+
+	CBenchmarkRecorder recorder;
+	const u32 trianglesSeries = recorder.addSeries("triangles");
+	const u32 sceneNodesSeries = recorder.addSeries("scene_nodes");
+	const u32 drawCallsSeries = recorder.addSeries("draw_calls_est");
+	const u32 shadowSeries = recorder.addSeries("shadow_ms");
+	const u32 shadowCastersSeries = recorder.addSeries("shadow_casters");
+	const u32 lightSeries = recorder.addSeries("light_select_ms");
+	const u32 lightScoredSeries = recorder.addSeries("lights_scored");
+	const u32 animationSeries = recorder.addSeries("animation_ms");
+	const u32 occlusionSeries = recorder.addSeries("occlusion_ms");
+	const u32 occludedSeries = recorder.addSeries("occluded_nodes");
+	const u32 lodTrianglesSeries = recorder.addSeries("lod_triangles");
+	const u32 lodFullTrianglesSeries = recorder.addSeries("lod_full_triangles");
+	const u32 impostorSeries = recorder.addSeries("impostors");
+	const u32 impostorRefreshSeries = recorder.addSeries("impostor_refreshes");
+	const u32 impostorTimeSeries = recorder.addSeries("impostor_refresh_ms");
+	const u32 queueTimeSeries = recorder.addSeries("render_queue_ms");
+	const u32 queueDrawCallsSeries = recorder.addSeries("queue_draw_calls");
+	const u32 materialSwitchesSeries = recorder.addSeries("material_switches");
+	const u32 shaderSwitchesSeries = recorder.addSeries("shader_switches");
+	const u32 textureBindsSeries = recorder.addSeries("texture_binds");
+	const u32 unsortedMaterialSwitchesSeries = recorder.addSeries("unsorted_material_switches");
+	const u32 unsortedShaderSwitchesSeries = recorder.addSeries("unsorted_shader_switches");
+	const u32 unsortedTextureBindsSeries = recorder.addSeries("unsorted_texture_binds");
+	const u32 tiledTransformSeries = recorder.addSeries("tiled_transform_ms");
+	const u32 tiledBinSeries = recorder.addSeries("tiled_bin_ms");
+	const u32 tiledRasterSeries = recorder.addSeries("tiled_raster_ms");
+	const u32 tiledPresentSeries = recorder.addSeries("tiled_present_ms");
+	const u32 tiledTrianglesSeries = recorder.addSeries("tiled_triangles");
+	const u32 tiledBinnedSeries = recorder.addSeries("tiled_binned_triangles");
+
+	timer->stop();
+	const u32 startTime = timer->getTime();
+	const u32 frames = options.BenchmarkFrames;
+	array<ISceneNode*> sceneNodes;
+	CFrameProfiler* profiler = CFrameProfiler::getActive();
+
+	for (u32 frame=0; frame<frames && device->run(); ++frame)
+	{
+		const f64 frameStart = getPreciseTimeMs();
+		if (profiler)
+			profiler->beginFrame();
+
+		timer->setTime(startTime + (u32)(frame * options.BenchmarkFrameTimeMs));
+		path.apply(camera, frames > 1 ? (f32)frame / (frames - 1) : 0.f);
+
+		drawFrame(device, animation, tiled, timer->getTime());
+
+		const f64 frameEnd = getPreciseTimeMs();
+		if (profiler)
+			profiler->endFrame();
+
+		sceneNodes.set_used(0);
+		smgr->getSceneNodesFromType(ESNT_ANY, sceneNodes);
+
+		recorder.beginFrame();
+		recorder.setValue(CBenchmarkRecorder::FRAME_TIME, frameEnd - frameStart);
+		recorder.setValue(trianglesSeries, driver->getPrimitiveCountDrawn());
+		recorder.setValue(sceneNodesSeries, sceneNodes.size());
+		recorder.setValue(drawCallsSeries, estimateDrawCalls(smgr, sceneNodes, occlusion, impostors));
+		u32 lodTriangles, lodFullTriangles;
+		countLodTriangles(smgr, sceneNodes, occlusion, impostors, lodTriangles, lodFullTriangles);
+		recorder.setValue(lodTrianglesSeries, lodTriangles);
+		recorder.setValue(lodFullTrianglesSeries, lodFullTriangles);
+		recorder.setValue(shadowSeries, shadows->getLastFrameTimeMs());
+		recorder.setValue(shadowCastersSeries, shadows->getLastCasterCount());
+		recorder.setValue(lightSeries, lights->getLastSelectionTimeMs());
+		recorder.setValue(lightScoredSeries, lights->getLastScoredLightCount());
+		if (animation)
+			recorder.setValue(animationSeries, animation->getLastAnimateTimeMs() + animation->getLastCommitTimeMs());
+		if (occlusion)
+		{
+			recorder.setValue(occlusionSeries, occlusion->getLastCullTimeMs());
+			recorder.setValue(occludedSeries, occlusion->getLastOccludedCount());
+		}
+		if (impostors)
+		{
+			recorder.setValue(impostorSeries, impostors->getLastImpostorCount());
+			recorder.setValue(impostorRefreshSeries, impostors->getLastRefreshCount());
+			recorder.setValue(impostorTimeSeries, impostors->getLastRefreshTimeMs());
+		}
+		if (renderQueue)
+		{
+			const SRenderQueueStats& sorted = renderQueue->getLastStats();
+			const SRenderQueueStats& unsorted = renderQueue->getLastUnsortedStats();
+			recorder.setValue(queueTimeSeries, renderQueue->getLastDrawTimeMs());
+			recorder.setValue(queueDrawCallsSeries, sorted.DrawCalls);
+			recorder.setValue(materialSwitchesSeries, sorted.MaterialSwitches);
+			recorder.setValue(shaderSwitchesSeries, sorted.ShaderSwitches);
+			recorder.setValue(textureBindsSeries, sorted.TextureBinds);
+			recorder.setValue(unsortedMaterialSwitchesSeries, unsorted.MaterialSwitches);
+			recorder.setValue(unsortedShaderSwitchesSeries, unsorted.ShaderSwitches);
+			recorder.setValue(unsortedTextureBindsSeries, unsorted.TextureBinds);
+		}
+		if (tiled)
+		{
+			// the driver draws one quad, the triangles are the renderer's
+			const STiledRenderStats& stats = tiled->getLastStats();
+			recorder.setValue(trianglesSeries, stats.SetupTriangles);
+			recorder.setValue(tiledTransformSeries, stats.TransformMs);
+			recorder.setValue(tiledBinSeries, stats.BinMs);
+			recorder.setValue(tiledRasterSeries, stats.RasterMs);
+			recorder.setValue(tiledPresentSeries, stats.PresentMs);
+			recorder.setValue(tiledTrianglesSeries, stats.Triangles);
+			recorder.setValue(tiledBinnedSeries, stats.BinnedTriangles);
+		}
+
+		if (frame == 0)
+			recorder.setInfo("time_to_first_frame_ms", startupMs + frameEnd - frameStart);
+	}
+
+	timer->start();
+
+	recorder.setInfo("driver", stringc(driver->getName()));
+	recorder.setInfo("width", driver->getScreenSize().Width);
+	recorder.setInfo("height", driver->getScreenSize().Height);
+	recorder.setInfo("frame_step_ms", options.BenchmarkFrameTimeMs);
+	recorder.setInfo("startup_ms", startupMs);
+	recorder.setInfo("load_ms", assets.getLoadTimeMs());
+	recorder.setInfo("load_worker_ms", assets.getWorkerTimeMs());
+	recorder.setInfo("load_threads", assets.getThreadCount());
+	recorder.setInfo("load_assets", assets.getAssetCount());
+	recorder.setInfo("texture_bytes", assets.getTextureBytes());
+	recorder.setInfo("shadow_budget", shadows->getBudget());
+	recorder.setInfo("shadow_volume_hits", shadows->getVolumeHitCount());
+	recorder.setInfo("shadow_silhouette_hits", shadows->getSilhouetteHitCount());
+	recorder.setInfo("shadow_rebuilds", shadows->getRebuildCount());
+	recorder.setInfo("lights", lights->getLightCount());
+	recorder.setInfo("global_lights", lights->getGlobalLightCount());
+	recorder.setInfo("lights_per_node", lights->getMaxLightsPerNode());
+	recorder.setInfo("shadow_lights", lights->getMaxShadowLights());
+	recorder.setInfo("animation_threads", animation ? animation->getThreadCount() : 0);
+	recorder.setInfo("animation_nodes", animation ? animation->getNodeCount() : 0);
+	recorder.setInfo("occluders", occlusion ? occlusion->getOccluderCount() : 0);
+	recorder.setInfo("occludees", occlusion ? occlusion->getOccludeeCount() : 0);
+	recorder.setInfo("impostor_nodes", impostors ? impostors->getNodeCount() : 0);
+	recorder.setInfo("impostor_snapshots", impostors ? impostors->getRefreshCount() : 0);
+	recorder.setInfo("render_queue_nodes", renderQueue ? renderQueue->getNodeCount() : 0);
+	recorder.setInfo("atlas_textures", atlas ? atlas->getImageCount() : 0);
+	recorder.setInfo("atlas_occupancy", atlas ? atlas->getOccupancy() : 0.f);
+	recorder.setInfo("atlas_buffers", atlas ? atlas->getRemappedBufferCount() : 0);
+	recorder.setInfo("atlas_skipped_buffers", atlas ? atlas->getSkippedBufferCount() : 0);
+	recorder.setInfo("tiled_threads", tiled ? tiled->getThreadCount() : 0);
+	recorder.setInfo("tiled_textures", tiled ? tiled->getTextureCount() : 0);
+	recorder.setInfo("tiled_texture_bytes", tiled ? tiled->getTextureBytes() : 0);
+
+	if (!recorder.writeReport(device->getFileSystem(), options.BenchmarkOutput))
+	{
+		device->getLogger()->log("Could not write benchmark report", options.BenchmarkOutput.c_str(), ELL_ERROR);
+		return 1;
+	}
+
+	device->getLogger()->log("Benchmark report written to", options.BenchmarkOutput.c_str(), ELL_INFORMATION);
+	return 0;
+}
+
+
+/*
+Writes the trace asked for with -trace and turns the profiler off. This
+has to happen before the device is dropped, the overlay is part of its GUI.
+*/
+void finishProfiling(IrrlichtDevice* device, const SGameOptions& options)
+{
+	CFrameProfiler* profiler = CFrameProfiler::getActive();
+	if (!profiler)
+		return;
+
+	if (options.TraceOutput.size())
+	{
+		if (profiler->getDroppedEventCount())
+			device->getLogger()->log("The trace was full, the last phases are missing", ELL_WARNING);
+
+		if (profiler->writeTrace(device->getFileSystem(), options.TraceOutput))
+			device->getLogger()->log("Trace written to", options.TraceOutput.c_str(), ELL_INFORMATION);
+		else
+			device->getLogger()->log("Could not write trace", options.TraceOutput.c_str(), ELL_ERROR);
+	}
+
+	CFrameProfiler::setActive(0);
+}
+
+
+/*
+Releases the clock, the tiled renderer and the animation phase, writes the
+trace and drops the device. Every way out of main() after the profiler was
+set up goes through here, so none of them leaks on an error.
+*/
+int shutdownGame(IrrlichtDevice* device, CSimulationClock* clock, CAnimationPhase* animation,
+	CTiledSoftwareRenderer* tiled, const SGameOptions& options, int result)
+{
+	if (clock)
+	{
+		clock->setAnimationPhase(0);
+		clock->drop();
+	}
+	if (tiled)
+		tiled->drop();
+	if (animation)
+		animation->drop();
+	finishProfiling(device, options);
+	device->drop();
+	return result;
+}
+
+
 /*
 This is the main method. We can now use main() on every platform.
+Without arguments the game starts like it always did. Run it with
+-bench [frames] to get the scripted flythrough benchmark instead, see
+GameOptions.h for all arguments.
 */
-int main()
+int main(int argc, char* argv[])
 {
+	// the benchmark reports how long loading the scene took
+	const f64 startupStart = getPreciseTimeMs();
+
+	SGameOptions options;
+	if (!parseGameOptions(argc, argv, options))
+		return 1;
+
 	/*
 	The most important function of the engine is the createDevice()
 	function. The IrrlichtDevice is created by it, which is the root
@@ -131,12 +594,45 @@ int main()
 
 	// ******** Touraj: IF this did not work with video::EDT_DIRECT3D9, change it to video::EDT_OPENGL *******
 	IrrlichtDevice *device =
-		createDevice( video::EDT_DIRECT3D9, dimension2d<u32>(1366, 768), 32,
-			true, true, true, 0); // 1366, 768
+		createDevice( options.DriverType, options.WindowSize, 32,
+			options.Fullscreen, true, options.Vsync, 0); // 1366, 768
 
 	if (!device)
 		return 1;
 
+	// micro benchmarks load their own assets and do not need the scene
+	if (options.MicroBenchmark.size())
+	{
+		const int result = runMicroBenchmark(device, options);
+		device->drop();
+		return result;
+	}
+
+	// cooking only converts the meshes, see MeshCooker.h
+	if (options.Cook)
+	{
+		const int result = cookGameTextures(device) | cookGameAtlas(device) | cookGameMeshes(device);
+		device->drop();
+		return result;
+	}
+
+	// meshes are loaded from their cooked .cmesh files when there are any
+	scene::CCookedMeshLoader* cookedMeshLoader = addCookedMeshLoader(device);
+
+	/*
+	With -profile or -trace the phases of every frame are timed, see
+	CFrameProfiler.h. The profiler starts before the assets are loaded, so
+	the trace also shows how long every file took to read and decode.
+	*/
+	if (options.Profile || options.TraceOutput.size())
+	{
+		CFrameProfiler* profiler = new CFrameProfiler();
+		if (options.TraceOutput.size())
+			profiler->setTraceCapacity(1 << 20);
+		CFrameProfiler::setActive(profiler);
+		profiler->drop(); // active until finishProfiling()
+	}
+
 	/*
 	Set the caption of the window to some nice text. Note that there is an
 	'L' in front of the string. The Irrlicht Engine uses wide character
@@ -155,6 +651,26 @@ int main()
 	ISceneManager* smgr = device->getSceneManager();
 	IGUIEnvironment* guienv = device->getGUIEnvironment();
 
+	/*
+	With a tick rate the animators, the collision response and the
+	particles advance in fixed steps instead of once per drawn frame, see
+	CSimulationClock.h. The moving objects get an interpolation animator,
+	after their other animators, so they still move smoothly when more
+	frames are drawn than ticks run.
+	*/
+	CSimulationClock* clock = 0;
+	if (options.TickRate > 0.f)
+	{
+		clock = new CSimulationClock(device, options.TickRate);
+		clock->setMaxTicksPerFrame(options.MaxCatchUpTicks);
+		clock->setFrameLimit(options.MaxFps);
+		clock->setFreeRunning(options.FreeRun);
+	}
+
+	// set up with the scene below, declared here for shutdownGame()
+	CAnimationPhase* animation = 0;
+	CTiledSoftwareRenderer* tiled = 0;
+
 	driver->setFog(SColor(100,30,30,30),E_FOG_TYPE::EFT_FOG_EXP, 50,4000,0.0009f, false,false);
 
 
@@ -164,8 +680,91 @@ int main()
 	(260,22) as lower right corner.
 	*/
 	// guienv->addButton(rect<s32>(10,10,360,122),0,-1,L"exit",L"quit");
-	guienv->addStaticText(L"Game By Touraj Ebrahimi",
-		rect<s32>(10,10,260,22), true,0,0,0,true);
+	if (options.Profile)
+	{
+		// the times of the phases take the place of the label
+		IGUIStaticText* overlay = guienv->addStaticText(L"",
+			rect<s32>(10,10,330,260), true,true,0,-1,true);
+		CFrameProfiler::getActive()->setOverlay(overlay);
+	}
+	else
+		guienv->addStaticText(L"Game By Touraj Ebrahimi",
+			rect<s32>(10,10,260,22), true,0,0,0,true);
+
+	// times the animators during drawAll(), it has to be the first node
+	scene::addProfileProbe(smgr);
+
+	/*
+	The mother ship, the gates and the terrain hide much of the scene from
+	most places. The occlusion culler draws their largest triangles into a
+	small depth buffer every frame and hides the nodes behind them, see
+	COcclusionCuller.h. It is added before the nodes it hides, the
+	occluders are added with their nodes below.
+	*/
+	COcclusionCuller* occlusion = 0;
+	if (options.Occlusion)
+	{
+		occlusion = new COcclusionCuller(smgr->getRootSceneNode(), smgr);
+		occlusion->drop(); // the root node keeps it
+	}
+
+	/*
+	Far away, the ufos, the gates and the mother ship cover a few dozen
+	pixels. The impostor manager draws them as quads with a snapshot of the
+	node instead, without shadow volumes, see CImpostorManager.h. Like the
+	occlusion culler, it is added before its nodes.
+	*/
+	CImpostorManager* impostors = 0;
+	if (options.Impostors)
+	{
+		impostors = new CImpostorManager(smgr->getRootSceneNode(), smgr);
+		impostors->drop(); // the root node keeps it
+	}
+
+	/*
+	The render queue draws the solid buffers of the mesh nodes sorted by
+	material and texture instead of node by node, see CRenderQueue.h. It
+	comes after the culler and the impostors, which hide nodes it must not
+	draw, and before the nodes. They are added once the scene is built.
+	*/
+	CRenderQueue* renderQueue = 0;
+	if (options.RenderQueue)
+	{
+		renderQueue = new CRenderQueue(smgr->getRootSceneNode(), smgr);
+		renderQueue->drop(); // the root node keeps it
+	}
+
+	/*
+	All textures and meshes of the scene are listed here first and loaded
+	together by the asset loader. It decodes the images on one worker thread
+	per core and only reads and uploads them on this thread, while drawing a
+	progress bar. Cooked textures and meshes are not even decoded. The code
+	below then finds everything in the texture and mesh caches of the
+	engine. Assets missing here still work, they are just loaded the slow
+	way when they are first used.
+	*/
+	//////// Asset Loading [Begin]
+	CAssetLoader assets(device, cookedMeshLoader);
+
+	// the textures and whether they have mipmaps are listed in
+	// TextureCooker.cpp. They go first, the meshes use some of them.
+	addGameTextures(assets);
+	if (options.TextureAtlas && device->getFileSystem()->existFile(GAME_ATLAS_IMAGE))
+		assets.addTexture(GAME_ATLAS_IMAGE);
+
+	assets.addMesh("Objects/Zuleyka.x");
+	assets.addMesh("MayaObjects/SciFIGateArray2.obj");
+	assets.addMesh("MayaObjects/MotherShip.obj");
+	assets.addMesh("MayaObjects/UFO.obj");
+	assets.addMesh("MayaObjects/ufo.obj");
+	assets.addMesh("MayaObjects/RockPack.obj");
+
+	{
+		MARS_PROFILE_SCOPE("asset_load");
+		assets.load(options.LoadThreads, drawLoadingProgress, device);
+	}
+	assets.logTimings(device->getLogger());
+	//////// Asset Loading [End]
 
 	/*
 	To show something interesting, we load a Quake 2 model and display it.
@@ -180,14 +779,28 @@ int main()
 	called sydney was modelled by Brian Collins.
 	*/
 	//IAnimatedMesh* mesh = smgr->getMesh("../../media/sydney.md2"); // Zuleyka.x
-	IAnimatedMesh* mesh = smgr->getMesh("Objects/Zuleyka.x");
+	IAnimatedMesh* mesh = getGameMesh(smgr, "Objects/Zuleyka.x");
 	if (!mesh)
+		return shutdownGame(device, clock, animation, tiled, options, 1);
+	//mesh->setAnimationSpeed(12);
+
+	/*
+	The colony is going to be full of these characters, so she is not drawn
+	with addAnimatedMeshSceneNode(): every such node skins the shared mesh
+	again. The skin keeps the weights in arrays made for skinning, and bakes
+	the poses of the frame loop once, so characters at the same pose only
+	copy it. See CSoaSkin.h. The skin has to be created before anything
+	animates the mesh.
+	*/
+	scene::CSkinnedCharacterSceneNode* node = 0;
+	if (mesh->getMeshType() == EAMT_SKINNED)
 	{
-		device->drop();
-		return 1;
+		scene::CSoaSkin* skin = new scene::CSoaSkin((ISkinnedMesh*)mesh);
+		skin->setPoseCache(2);
+		node = new scene::CSkinnedCharacterSceneNode(skin, smgr->getRootSceneNode(), smgr);
+		node->drop(); // the root node keeps it
+		skin->drop(); // the node keeps it
 	}
-	//mesh->setAnimationSpeed(12);
-	IAnimatedMeshSceneNode* node = smgr->addAnimatedMeshSceneNode( mesh );
 
 	/*
 	To let the mesh look a little bit nicer, we change its material. We
@@ -221,6 +834,20 @@ int main()
 
 	}
 
+	/*
+	The scene has lights with huge radii all over the map. Instead of
+	letting the driver shade every node with the first lights it gets, the
+	light manager turns on only the most influential lights for each node
+	and lets only the strongest lights at the camera cast shadows, see
+	CNearestLightManager.h.
+	*/
+	CNearestLightManager* lights = new CNearestLightManager(smgr);
+	lights->setMaxShadowLights(options.ShadowLights);
+	smgr->setLightManager(lights);
+	if (renderQueue)
+		renderQueue->setLightManager(lights);
+	lights->drop(); // the scene manager keeps it
+
 	ILightSceneNode *light1 = smgr->addLightSceneNode();
 	SLight &lightData1 = light1->getLightData();
 	lightData1.Type = ELT_POINT;
@@ -259,19 +886,27 @@ int main()
     animl = smgr->createFlyCircleAnimator (core::vector3df(0,150,0),250.0f);
     light2->addAnimator(animl);
     animl->drop();
+	if (clock)
+		clock->addInterpolation(light2);
 
 
 	///////
 
 	/////////////////////////////////////////////////// Water Begin
 
-	mesh = smgr->addHillPlaneMesh( "WaterSurface",
+	/*
+	The lava lake has the waves of addWaterSurfaceSceneNode() on the grid of
+	addHillPlaneMesh(), but they are computed by CWaveSurfaceSceneNode. It
+	updates them 30 times per second and not at all while the lake is out
+	of view.
+	*/
+	CWaveSurfaceSceneNode* waterNode = new CWaveSurfaceSceneNode(
         core::dimension2d<f32>(20,20),
-        core::dimension2d<u32>(60,60), 0, 0,
-        core::dimension2d<f32>(0,0),
-        core::dimension2d<f32>(10,10));
-	ISceneNode *waterNode = 0;
-    waterNode = smgr->addWaterSurfaceSceneNode(mesh->getMesh(0), 4.0f, 600.0f, 0.01f);
+        core::dimension2d<u32>(60,60),
+        core::dimension2d<f32>(10,10),
+        4.0f, 600.0f, 0.01f, smgr->getRootSceneNode(), smgr);
+	waterNode->setUpdateRate(30);
+	waterNode->drop(); // the root node keeps it
     waterNode->setPosition(core::vector3df(11000,200,5000));
 	waterNode->setScale(core::vector3df(7,7,7));
 	//waterNode->setRotation(core::vector3df(0,0,180));
@@ -342,19 +977,26 @@ int main()
 
 ///// terrian node/////
 
-	// add terrain scene node
-    scene::ITerrainSceneNode* terrain = smgr->addTerrainSceneNode(
-        "Objects/hm.png",
-        0,                  // parent node
-        -1,                 // node id
-        core::vector3df(-1400.f, -600.f, -1800.f),     // position
-        core::vector3df(0.f, 0.f, 0.f),     // rotation
-        core::vector3df(80.f, 16.4f,80.f),  // scale
-        video::SColor ( 255, 255, 255, 255 ),   // vertexColor
-        5,                  // maxLOD
-        scene::ETPS_17,             // patchSize
-        4                   // smoothFactor
-        );
+	/*
+	The terrain is paged: the height map is cut into tiles which are built
+	on a background thread around the camera and dropped again behind it,
+	so the map can be much larger than what fits in memory at once. Each
+	tile picks its level of detail from its own height error, not from a
+	fixed distance per patch.
+	*/
+	scene::CPagedTerrainSceneNode* terrain = new scene::CPagedTerrainSceneNode(
+		"Objects/hm.png",
+		smgr->getRootSceneNode(),	// parent node
+		smgr,
+		-1,					// node id
+		core::vector3df(-1400.f, -600.f, -1800.f),	// position
+		core::vector3df(0.f, 0.f, 0.f),		// rotation
+		core::vector3df(80.f, 16.4f,80.f),	// scale
+		video::SColor ( 255, 255, 255, 255 ),	// vertexColor
+		5,					// maxLOD
+		64,					// tileSize
+		4					// smoothFactor
+		);
 
     terrain->setMaterialFlag(video::EMF_LIGHTING, true);
 	terrain->setMaterialFlag(EMF_GOURAUD_SHADING,true);
@@ -372,6 +1014,15 @@ int main()
 
     terrain->scaleTexture(1.0f, 40.0f);
 
+	// the terrain hides what is behind the hills
+	if (occlusion)
+	{
+		IMesh* terrainOccluder = terrain->createOccluderMesh(8);
+		occlusion->addOccluder(terrain, terrainOccluder);
+		if (terrainOccluder)
+			terrainOccluder->drop();
+	}
+
 
 	/////////// terrian node end /////
 
@@ -404,25 +1055,32 @@ int main()
 	ICameraSceneNode *camnode = smgr->addCameraSceneNodeFPS(0, 50, 1, -1, keyMap, 10, false,50,false,true);
 	camnode->setFarValue(42000.0f);
 	camnode->setPosition(vector3df(200,270,-80));
+	// build the tiles around the start position before the first frame
+	terrain->preload(camnode->getPosition());
 	//camnode->
 	device->getCursorControl()->setVisible(false);
 	
+	/*
+	Everything the camera can bump into is collected in one world selector.
+	Earlier every object attached its own collision response animator to
+	the camera, so each frame the camera was resolved ~200 times, once per
+	cube, gate, ship and the terrain. Now the selectors are only added to
+	worldSelector here and below, and at the end of the scene setup a single
+	collision response animator resolves the camera once against all of
+	them. worldSelector skips every object whose bounding box is not near
+	the camera, so only a handful of selectors are asked for triangles.
+	*/
+	CBroadphaseTriangleSelector* worldSelector = new CBroadphaseTriangleSelector();
+
 		////////////////////// Terrian Collision Detection
 
 	// create triangle selector for the terrain 
-    scene::ITriangleSelector* selector
-        = smgr->createTerrainTriangleSelector(terrain, 0);
+	// it only sees the resident tiles, which always cover the camera
+    scene::ITriangleSelector* selector = terrain->createTriangleSelector();
     terrain->setTriangleSelector(selector);
-
-    // create collision response animator and attach it to the camera
-    scene::ISceneNodeAnimator* anim = smgr->createCollisionResponseAnimator(
-        selector, camnode, core::vector3df(60,100,60),
-        core::vector3df(0,-9.8f,0), // gravity
-        core::vector3df(0,50,0));
-	
+    worldSelector->addTriangleSelector(selector);
     selector->drop();
-    camnode->addAnimator(anim);
-    anim->drop();
+	terrain->drop(); // the root node keeps it
 
 
 	////////////////////// Terrian Collision Detection End
@@ -449,6 +1107,8 @@ int main()
        sphereNode->addAnimator(anim);
        anim->drop();
         anim = 0;
+		if (clock)
+			clock->addInterpolation(sphereNode);
     }
 
 					  // add Real time shadow Casting To Sphere
@@ -458,18 +1118,56 @@ int main()
 	}
 	///////////// Add Sphere [End]
 
+	/*
+	The gates, the mother ship and the ufos are drawn with levels of detail,
+	see CLodMeshSceneNode.h: a ufo circling far away needs a few hundred
+	triangles, not thousands. Collision uses level 1. Shadow volumes use
+	level 2, a volume only needs the outline of its caster.
+	*/
+	const u32 lodLevels = options.MeshLOD ? GAME_MESH_LOD_COUNT : 1;
+	const u32 collisionLevel = 1;
+	const u32 shadowLevel = 2;
+
+	/*
+	The mother ship and the ufos each have their own texture. Their mesh
+	buffers are moved onto one atlas of both, see CTextureAtlas.h, so the
+	render queue draws all of them without binding another texture.
+	*/
+	CTextureAtlas atlas(driver, device->getFileSystem());
+	CTextureAtlas* shipAtlas = options.TextureAtlas && loadGameAtlas(device, atlas) ? &atlas : 0;
+
 	////////////////// Add sciFiGateArray [Begin]
+
+	/*
+	The gate mesh has tens of thousands of triangles. Instead of four flat
+	triangle lists which are scanned completely for every collision query,
+	one bounding volume hierarchy is built for the mesh and shared by the
+	selectors of all four gates, see CBvhTriangleSelector.h.
+	*/
+	array<IMesh*> sciFiGateArrayLevels;
+	const bool sciFiGateArrayLoaded =
+		getGameMeshLevels(smgr, "MayaObjects/SciFIGateArray2.obj", sciFiGateArrayLevels, lodLevels, shipAtlas);
+	CBvhTree* sciFiGateArrayTree = sciFiGateArrayLoaded ?
+		new CBvhTree(sciFiGateArrayLevels[core::min_(collisionLevel, sciFiGateArrayLevels.size() - 1)]) : 0;
+
 	for (s32 i=0;i<4;++i)
 	{
-	IAnimatedMesh *sciFiGateArray = smgr->getMesh("MayaObjects/SciFIGateArray2.obj");
-	IAnimatedMeshSceneNode* sciFiGateArrayNode = smgr->addAnimatedMeshSceneNode( sciFiGateArray );
+	CLodMeshSceneNode* sciFiGateArrayNode = sciFiGateArrayLoaded ?
+		new CLodMeshSceneNode(sciFiGateArrayLevels, smgr->getRootSceneNode(), smgr) : 0;
 		if (sciFiGateArrayNode)
 		{
+				sciFiGateArrayNode->drop(); // the root node keeps it
+				if (i == 0)
+					logMeshLevels(device->getLogger(), "MayaObjects/SciFIGateArray2.obj", sciFiGateArrayNode);
 				//sciFiGateArrayNode->setMaterialTexture( 0, driver->getTexture("Objects/lunar.jpg") );
 				sciFiGateArrayNode->setMaterialFlag(EMF_LIGHTING, false);
 				sciFiGateArrayNode->getMaterial(0).GouraudShading = true;
 				sciFiGateArrayNode->setScale(vector3df(20,20,20)); // Scale of the sciFiGateArray
 				sciFiGateArrayNode->setPosition(vector3df(9800+i*2500,550,-2000));
+				if (occlusion)
+					occlusion->addOccluder(sciFiGateArrayNode, sciFiGateArrayNode->getLevelMesh(0), 256);
+				if (impostors)
+					impostors->addNode(sciFiGateArrayNode);
 
 					// Light For Gate Array [Begin]
 				ILightSceneNode *lightGate = smgr->addLightSceneNode();
@@ -494,76 +1192,64 @@ int main()
 				////////////////////////////////////////////// SCIGATEWAYARRAY Collision Detection [Begin]
 
 
-			scene::ITriangleSelector *sciFiGateArraySelector = smgr->createTriangleSelector(sciFiGateArrayNode);
+			scene::ITriangleSelector *sciFiGateArraySelector = createBvhTriangleSelector(sciFiGateArrayTree, sciFiGateArrayNode);
 			sciFiGateArrayNode->setTriangleSelector(sciFiGateArraySelector);
-
-			// create collision response animator and attach it to the camera
-			scene::ISceneNodeAnimator* anim = smgr->createCollisionResponseAnimator(
-				sciFiGateArraySelector, camnode, core::vector3df(60,100,60),
-				core::vector3df(0,0,0), // gravity
-				core::vector3df(0,50,0),0.0005f);
-	
+			worldSelector->addTriangleSelector(sciFiGateArraySelector);
 			sciFiGateArraySelector->drop();
-			camnode->addAnimator(anim);
-			anim->drop();
 
 		////////////////////////////////////////// SCIGATEWAYARRAY Collision Detection [End]
 		}
 
 
 	}
+
+	if (sciFiGateArrayTree)
+		sciFiGateArrayTree->drop();
 	///////////////// Add sciFiGateArray [End]
 
 	//////////////////////////// Add MotherShip [Begin]
-		IAnimatedMesh* motherShip = smgr->getMesh("MayaObjects/MotherShip.obj");
-	if (!motherShip)
-	{
-		device->drop();
-		return 1;
-	}
+	array<IMesh*> motherShipLevels;
+	if (!getGameMeshLevels(smgr, "MayaObjects/MotherShip.obj", motherShipLevels, lodLevels, shipAtlas))
+		return shutdownGame(device, clock, animation, tiled, options, 1);
 	//mesh->setAnimationSpeed(12);
-	IAnimatedMeshSceneNode* motherShipNode = smgr->addAnimatedMeshSceneNode( motherShip );
-	if (motherShipNode)
-	{
-		//motherShipNode->setMaterialTexture( 1, driver->getTexture("Objects/lunar.jpg") ); // MayaObjects/ShipMatMain.jpg
-		motherShipNode->setMaterialFlag(EMF_LIGHTING, false);
-		motherShipNode->setMaterialFlag(EMF_BACK_FACE_CULLING, true);
+	CLodMeshSceneNode* motherShipNode = new CLodMeshSceneNode(motherShipLevels, smgr->getRootSceneNode(), smgr);
+	motherShipNode->drop(); // the root node keeps it
+	logMeshLevels(device->getLogger(), "MayaObjects/MotherShip.obj", motherShipNode);
+	//motherShipNode->setMaterialTexture( 1, driver->getTexture("Objects/lunar.jpg") ); // MayaObjects/ShipMatMain.jpg
+	motherShipNode->setMaterialFlag(EMF_LIGHTING, false);
+	motherShipNode->setMaterialFlag(EMF_BACK_FACE_CULLING, true);
 
-		//motherShipNode->setMaterialTexture(0, driver->getTexture("../../../media/lava.jpg"));
-		//motherShipNode->setMaterialTexture(1, driver->getTexture("Objects/sky_fyros_night_fair.png"));
-		//motherShipNode->setMaterialType(video::EMT_REFLECTION_2_LAYER);
+	//motherShipNode->setMaterialTexture(0, driver->getTexture("../../../media/lava.jpg"));
+	//motherShipNode->setMaterialTexture(1, driver->getTexture("Objects/sky_fyros_night_fair.png"));
+	//motherShipNode->setMaterialType(video::EMT_REFLECTION_2_LAYER);
 
-		//motherShipNode->getMaterial(0).Shininess = 20;
-		//motherShipNode->getMaterial(0).EmissiveColor = SColor(0.1,100,10,10);
-		//motherShipNode->getMaterial(0).GouraudShading = true;
-		//motherShipNode->getMaterial(0).SpecularColor = SColor(0.5f,250,0,0);
+	//motherShipNode->getMaterial(0).Shininess = 20;
+	//motherShipNode->getMaterial(0).EmissiveColor = SColor(0.1,100,10,10);
+	//motherShipNode->getMaterial(0).GouraudShading = true;
+	//motherShipNode->getMaterial(0).SpecularColor = SColor(0.5f,250,0,0);
 
-		motherShipNode->setScale(vector3df(40,40,40)); // Scale of the Sphere
-		motherShipNode->setPosition(vector3df(0,-1000,-15500));
-		motherShipNode->setRotation(core::vector3df(0,-45,0));
+	motherShipNode->setScale(vector3df(40,40,40)); // Scale of the Sphere
+	motherShipNode->setPosition(vector3df(0,-1000,-15500));
+	motherShipNode->setRotation(core::vector3df(0,-45,0));
+	if (occlusion)
+		occlusion->addOccluder(motherShipNode, motherShipNode->getLevelMesh(0), 512);
+	if (impostors)
+		impostors->addNode(motherShipNode);
 
-		//motherShipNode->getMaterial(1).getTextureMatrix(0).setTextureScale(8,8);
+	//motherShipNode->getMaterial(1).getTextureMatrix(0).setTextureScale(8,8);
 
-		////////////////////////////////////////////// MotherShip Collision Detection [Begin]
+	////////////////////////////////////////////// MotherShip Collision Detection [Begin]
 
 
-    scene::ITriangleSelector *motherShipSelector = smgr->createTriangleSelector(motherShipNode);
+    scene::ITriangleSelector *motherShipSelector = createBvhTriangleSelector(motherShipNode->getLevelMesh(collisionLevel), motherShipNode);
     motherShipNode->setTriangleSelector(motherShipSelector);
-
-    // create collision response animator and attach it to the camera
-    scene::ISceneNodeAnimator* anim = smgr->createCollisionResponseAnimator(
-        motherShipSelector, camnode, core::vector3df(60,100,60),
-        core::vector3df(0,0,0), // gravity
-        core::vector3df(0,50,0));
-	
+    worldSelector->addTriangleSelector(motherShipSelector);
     motherShipSelector->drop();
-    camnode->addAnimator(anim);
-    anim->drop();
 
 ////////////////////////////////////////// MotherShip Collision Detection [End]
 
-		// Rotate Mother Ship
-				//scene::ISceneNodeAnimator* anim =
+	// Rotate Mother Ship
+			//scene::ISceneNodeAnimator* anim =
     //    smgr->createRotationAnimator(core::vector3df(0, 0.1f, 0));
 
     //if(anim)
@@ -572,56 +1258,70 @@ int main()
     //   anim->drop();
     //    anim = 0;
     //}
-	}
 	//////////////////////////// Add MotherShip [End]
 
+	/*
+	The ufos and the cubes of the tower cast their shadows through one
+	shadow volume manager instead of one shadow volume node each. It keeps
+	the volumes of casters which did not move relative to a light and only
+	draws the nearest casters within the budget, see CShadowVolumeManager.h.
+	*/
+	CShadowVolumeManager* shadows = new CShadowVolumeManager(smgr->getRootSceneNode(), smgr);
+	shadows->setBudget(options.ShadowBudget);
+	shadows->drop(); // the root node keeps it
+
 	//////////////////////////// Add UFO [Begin]
-	IAnimatedMesh* ufo = smgr->getMesh("MayaObjects/UFO.obj");
-	if (!ufo)
-	{
-		device->drop();
-		return 1;
-	}
+	array<IMesh*> ufoLevels;
+	if (!getGameMeshLevels(smgr, "MayaObjects/UFO.obj", ufoLevels, lodLevels, shipAtlas))
+		return shutdownGame(device, clock, animation, tiled, options, 1);
 	//mesh->setAnimationSpeed(12);
-	IAnimatedMeshSceneNode* ufoNode = smgr->addAnimatedMeshSceneNode( ufo );
-	if (ufo)
-	{
-		//motherShipNode->setMaterialTexture( 1, driver->getTexture("Objects/lunar.jpg") ); // MayaObjects/ShipMatMain.jpg
-		ufoNode->setMaterialFlag(EMF_LIGHTING, false);
-		ufoNode->setMaterialFlag(EMF_BACK_FACE_CULLING, false); // Double Sided Materials
-		ufoNode->setMaterialFlag(EMF_NORMALIZE_NORMALS, true);
-		//ufoNode->getMaterial(0).Shininess = 20;
-		//ufoNode->getMaterial(0).EmissiveColor = SColor(0.1,100,10,10);
-		//ufoNode->getMaterial(0).GouraudShading = true;
-		//ufoNode->getMaterial(0).SpecularColor = SColor(0.5f,250,0,0);
-		ufoNode->setScale(vector3df(10,10,10)); // Scale of the Sphere
-		ufoNode->setPosition(vector3df(740,-2000,-1400)); //EMF_NORMALIZE_NORMALS
+	CLodMeshSceneNode* ufoNode = new CLodMeshSceneNode(ufoLevels, smgr->getRootSceneNode(), smgr);
+	ufoNode->drop(); // the root node keeps it
+	logMeshLevels(device->getLogger(), "MayaObjects/UFO.obj", ufoNode);
+	//motherShipNode->setMaterialTexture( 1, driver->getTexture("Objects/lunar.jpg") ); // MayaObjects/ShipMatMain.jpg
+	ufoNode->setMaterialFlag(EMF_LIGHTING, false);
+	ufoNode->setMaterialFlag(EMF_BACK_FACE_CULLING, false); // Double Sided Materials
+	ufoNode->setMaterialFlag(EMF_NORMALIZE_NORMALS, true);
+	//ufoNode->getMaterial(0).Shininess = 20;
+	//ufoNode->getMaterial(0).EmissiveColor = SColor(0.1,100,10,10);
+	//ufoNode->getMaterial(0).GouraudShading = true;
+	//ufoNode->getMaterial(0).SpecularColor = SColor(0.5f,250,0,0);
+	ufoNode->setScale(vector3df(10,10,10)); // Scale of the Sphere
+	ufoNode->setPosition(vector3df(740,-2000,-1400)); //EMF_NORMALIZE_NORMALS
 		
-		//ufoNode->setRotation(core::vector3df(0,30,0));
-		//motherShipNode->getMaterial(1).getTextureMatrix(0).setTextureScale(8,8);
+	//ufoNode->setRotation(core::vector3df(0,30,0));
+	//motherShipNode->getMaterial(1).getTextureMatrix(0).setTextureScale(8,8);
 
-		scene::ISceneNodeAnimator* anim =
+	scene::ISceneNodeAnimator* anim =
         smgr->createFlyCircleAnimator(vector3df(-740,4500,-4400),20000,0.001);
-		if(anim)
-		{
-		   ufoNode->addAnimator(anim);
-		   anim->drop();
-			anim = 0;
-		}
+	if(anim)
+	{
+	   ufoNode->addAnimator(anim);
+	   anim->drop();
+		anim = 0;
+		if (clock)
+			clock->addInterpolation(ufoNode);
+	}
 
-			// add Real time shadow Casting To Ufo
-			ufoNode->addShadowVolumeSceneNode();
-			ufoNode->setMaterialFlag(video::EMF_NORMALIZE_NORMALS, true);
+		// add Real time shadow Casting To Ufo
+		shadows->addCaster(ufoNode, ufoNode->getLevelMesh(shadowLevel));
+		if (impostors)
+			impostors->addNode(ufoNode);
+		ufoNode->setMaterialFlag(video::EMF_NORMALIZE_NORMALS, true);
 
-	}
 	//////////////////////////// Add UFO [End]
 
 	///////////////////////// create a particle system [Begin]
 
-    scene::IParticleSystemSceneNode* ps =
-        smgr->addParticleSystemSceneNode(false);
+	/*
+	About 30000 particles are alive at once, more than Irrlicht's particle
+	system can draw, so the lava fire uses CSoaParticleSystemSceneNode.
+	It takes the same emitter and fade out parameters.
+	*/
+    CSoaParticleSystemSceneNode* ps =
+        new CSoaParticleSystemSceneNode(smgr->getRootSceneNode(), smgr);
 
-    scene::IParticleEmitter* em = ps->createBoxEmitter(
+    ps->setBoxEmitter(
         core::aabbox3d<f32>(-70,0,-70,70,450,470), // emitter size
         core::vector3df(0.0f,0.06f,0.0f),   // initial direction
         1800,2000,                             // emit rate
@@ -631,13 +1331,7 @@ int main()
         core::dimension2df(100.f,100.f),         // min size
         core::dimension2df(400.f,400.f));        // max size
 
-    ps->setEmitter(em); // this grabs the emitter
-    em->drop(); // so we can drop it here without deleting it
-
-    scene::IParticleAffector* paf = ps->createFadeOutParticleAffector(); //// createGravityAffector();
-
-    ps->addAffector(paf); // same goes for the affector
-    paf->drop();
+    ps->setFadeOut(); //// createGravityAffector();
 	vector3df wpos = waterNode->getPosition(); //Pos Neeed Some Tweeking
 	wpos.Y-=400;
 	wpos.X+=700;
@@ -648,127 +1342,125 @@ int main()
     ps->setMaterialFlag(video::EMF_ZWRITE_ENABLE, false);//Touraj: Default was False, I made it true to impose prespective illusion on Particles
     ps->setMaterialTexture(0, driver->getTexture("../../../media/fireball.bmp"));
     ps->setMaterialType(video::EMT_TRANSPARENT_ADD_COLOR);
+    ps->drop(); // the root node keeps it
 	///////////////////////// create a particle system [End]
 
 	//////////////////////////// Add ufo2 [Begin]
-	IAnimatedMesh* ufo2 = smgr->getMesh("MayaObjects/ufo.obj");
-	if (!ufo2)
-	{
-		device->drop();
-		return 1;
-	}
+	array<IMesh*> ufo2Levels;
+	if (!getGameMeshLevels(smgr, "MayaObjects/ufo.obj", ufo2Levels, lodLevels, shipAtlas))
+		return shutdownGame(device, clock, animation, tiled, options, 1);
 	//mesh->setAnimationSpeed(12);
-	IAnimatedMeshSceneNode* ufo2Node = smgr->addAnimatedMeshSceneNode( ufo2 );
-	if (ufo2)
-	{
-		//motherShipNode->setMaterialTexture( 1, driver->getTexture("Objects/lunar.jpg") ); // MayaObjects/ShipMatMain.jpg
-		ufo2Node->setMaterialFlag(EMF_LIGHTING, false);
-		ufo2Node->setMaterialFlag(EMF_BACK_FACE_CULLING, false);
+	CLodMeshSceneNode* ufo2Node = new CLodMeshSceneNode(ufo2Levels, smgr->getRootSceneNode(), smgr);
+	ufo2Node->drop(); // the root node keeps it
+	//motherShipNode->setMaterialTexture( 1, driver->getTexture("Objects/lunar.jpg") ); // MayaObjects/ShipMatMain.jpg
+	ufo2Node->setMaterialFlag(EMF_LIGHTING, false);
+	ufo2Node->setMaterialFlag(EMF_BACK_FACE_CULLING, false);
 		
-		//ufo2Node->getMaterial(0).Shininess = 20;
-		//ufo2Node->getMaterial(0).EmissiveColor = SColor(0.1,100,10,10);
-		//ufo2Node->getMaterial(0).GouraudShading = true;
-		//ufo2Node->getMaterial(0).SpecularColor = SColor(0.5f,250,0,0);
-		ufo2Node->setScale(vector3df(20,20,20)); // Scale of the UFO2
-		ufo2Node->setPosition(vector3df(740,-2000,-1400));
-		//ufo2Node->setRotation(core::vector3df(0,30,0));
-		//motherShipNode->getMaterial(1).getTextureMatrix(0).setTextureScale(8,8);
-
-		scene::ISceneNodeAnimator* anim =
+	//ufo2Node->getMaterial(0).Shininess = 20;
+	//ufo2Node->getMaterial(0).EmissiveColor = SColor(0.1,100,10,10);
+	//ufo2Node->getMaterial(0).GouraudShading = true;
+	//ufo2Node->getMaterial(0).SpecularColor = SColor(0.5f,250,0,0);
+	ufo2Node->setScale(vector3df(20,20,20)); // Scale of the UFO2
+	ufo2Node->setPosition(vector3df(740,-2000,-1400));
+	//ufo2Node->setRotation(core::vector3df(0,30,0));
+	//motherShipNode->getMaterial(1).getTextureMatrix(0).setTextureScale(8,8);
+
+	anim =
         smgr->createFlyCircleAnimator(vector3df(740,6500,-2400),40000,0.0005);
-		if(anim)
-		{
-		   ufo2Node->addAnimator(anim);
-		   anim->drop();
-			anim = 0;
-		}
-
-					// add Real time shadow Casting To Ufo
-			ufo2Node->addShadowVolumeSceneNode();
-			ufo2Node->setMaterialFlag(video::EMF_NORMALIZE_NORMALS, true);
+	if(anim)
+	{
+	   ufo2Node->addAnimator(anim);
+	   anim->drop();
+		anim = 0;
+		if (clock)
+			clock->addInterpolation(ufo2Node);
 	}
+
+				// add Real time shadow Casting To Ufo
+		shadows->addCaster(ufo2Node, ufo2Node->getLevelMesh(shadowLevel));
+		if (impostors)
+			impostors->addNode(ufo2Node);
+		ufo2Node->setMaterialFlag(video::EMF_NORMALIZE_NORMALS, true);
 	//////////////////////////// Add ufo2 [End]
 
 	//////////////////////////// Add ufo3 [Begin]
-	IAnimatedMesh* ufo3 = smgr->getMesh("MayaObjects/ufo.obj");
-	if (!ufo3)
-	{
-		device->drop();
-		return 1;
-	}
+	array<IMesh*> ufo3Levels;
+	if (!getGameMeshLevels(smgr, "MayaObjects/ufo.obj", ufo3Levels, lodLevels, shipAtlas))
+		return shutdownGame(device, clock, animation, tiled, options, 1);
 	//mesh->setAnimationSpeed(12);
-	IAnimatedMeshSceneNode* ufo3Node = smgr->addAnimatedMeshSceneNode( ufo3 );
-	if (ufo3)
-	{
-		// ufo3Node->setMaterialTexture( 0, driver->getTexture("Objects/lunar.jpg") ); // MayaObjects/ShipMatMain.jpg
-		ufo3Node->setMaterialFlag(EMF_LIGHTING, true);
-		ufo3Node->setMaterialFlag(EMF_BACK_FACE_CULLING, false);
-		//ufo3Node->setMaterialType(EMT_REFLECTION_2_LAYER);
-
-		//ufo3Node->setMaterialTexture(0, driver->getTexture("../../../media/lava.jpg"));
-		//ufo3Node->setMaterialTexture(1, driver->getTexture("Objects/lunar.jpg"));
-		//ufo3Node->setMaterialType(video::EMT_REFLECTION_2_LAYER);
+	CLodMeshSceneNode* ufo3Node = new CLodMeshSceneNode(ufo3Levels, smgr->getRootSceneNode(), smgr);
+	ufo3Node->drop(); // the root node keeps it
+	// ufo3Node->setMaterialTexture( 0, driver->getTexture("Objects/lunar.jpg") ); // MayaObjects/ShipMatMain.jpg
+	ufo3Node->setMaterialFlag(EMF_LIGHTING, true);
+	ufo3Node->setMaterialFlag(EMF_BACK_FACE_CULLING, false);
+	//ufo3Node->setMaterialType(EMT_REFLECTION_2_LAYER);
+
+	//ufo3Node->setMaterialTexture(0, driver->getTexture("../../../media/lava.jpg"));
+	//ufo3Node->setMaterialTexture(1, driver->getTexture("Objects/lunar.jpg"));
+	//ufo3Node->setMaterialType(video::EMT_REFLECTION_2_LAYER);
 		
-		//ufo3Node->getMaterial(0).Shininess = 20;
-		//ufo3Node->getMaterial(0).EmissiveColor = SColor(0.1,100,10,10);
-		//ufo3Node->getMaterial(0).GouraudShading = true;
-		//ufo3Node->getMaterial(0).SpecularColor = SColor(0.5f,250,0,0);
-		ufo3Node->setScale(vector3df(20,20,20)); // Scale of the ufo3
-		ufo3Node->setPosition(vector3df(740,2000,-2400));
-		ufo3Node->setRotation(core::vector3df(-30,0,0));
-		//motherShipNode->getMaterial(1).getTextureMatrix(0).setTextureScale(8,8);
-
-		scene::ISceneNodeAnimator* anim =
-			smgr->createRotationAnimator(vector3df(0,0.1,0));
-		if(anim)
-		{
-		   ufo3Node->addAnimator(anim);
-		   anim->drop();
-			anim = 0;
-		}
+	//ufo3Node->getMaterial(0).Shininess = 20;
+	//ufo3Node->getMaterial(0).EmissiveColor = SColor(0.1,100,10,10);
+	//ufo3Node->getMaterial(0).GouraudShading = true;
+	//ufo3Node->getMaterial(0).SpecularColor = SColor(0.5f,250,0,0);
+	ufo3Node->setScale(vector3df(20,20,20)); // Scale of the ufo3
+	ufo3Node->setPosition(vector3df(740,2000,-2400));
+	ufo3Node->setRotation(core::vector3df(-30,0,0));
+	//motherShipNode->getMaterial(1).getTextureMatrix(0).setTextureScale(8,8);
+
+	anim =
+		smgr->createRotationAnimator(vector3df(0,0.1,0));
+	if(anim)
+	{
+	   ufo3Node->addAnimator(anim);
+	   anim->drop();
+		anim = 0;
+		if (clock)
+			clock->addInterpolation(ufo3Node);
+	}
 
-		// Light For UFO3
-		ILightSceneNode *light4 = smgr->addLightSceneNode();
-	SLight &lightData4 = light4->getLightData();
-	lightData4.Type = ELT_POINT;
-	lightData4.Radius = 4000.0f;
-	lightData4.DiffuseColor = SColorf(150,150,5,0.1);
-	lightData4.CastShadows = true;
-	vector3df ufo3NodePos =  ufo3Node->getPosition();
-	ufo3NodePos.Y += 800;
-	//ufo3NodePos.Z += 1200;
-	light4->setPosition(ufo3NodePos);
+	// Light For UFO3
+	ILightSceneNode *light4 = smgr->addLightSceneNode();
+SLight &lightData4 = light4->getLightData();
+lightData4.Type = ELT_POINT;
+lightData4.Radius = 4000.0f;
+lightData4.DiffuseColor = SColorf(150,150,5,0.1);
+lightData4.CastShadows = true;
+vector3df ufo3NodePos =  ufo3Node->getPosition();
+ufo3NodePos.Y += 800;
+//ufo3NodePos.Z += 1200;
+light4->setPosition(ufo3NodePos);
 
-	/////////////////////// attach billboard to light
+/////////////////////// attach billboard to light
 
     IBillboardSceneNode *bill2 = smgr->addBillboardSceneNode(light4, core::dimension2d<f32>(150, 150));
     bill2->setMaterialFlag(video::EMF_LIGHTING, false);
     bill2->setMaterialType(video::EMT_TRANSPARENT_ADD_COLOR);
     bill2->setMaterialTexture(0, driver->getTexture("../../../media/particlewhite.bmp"));
 
-	scene::ISceneNodeAnimator* anim2 =
+scene::ISceneNodeAnimator* anim2 =
         smgr->createFlyCircleAnimator(ufo3NodePos,1000,0.0005);
-		if(anim2)
-		{
-		   light4->addAnimator(anim2);
-		   anim2->drop();
-			anim2 = 0;
-		}
+	if(anim2)
+	{
+	   light4->addAnimator(anim2);
+	   anim2->drop();
+		anim2 = 0;
+		if (clock)
+			clock->addInterpolation(light4);
+	}
 
 
-					// add Real time shadow Casting To Ufo
-			ufo3Node->addShadowVolumeSceneNode();
-			ufo3Node->setMaterialFlag(video::EMF_NORMALIZE_NORMALS, true);
-	}
+				// add Real time shadow Casting To Ufo
+		shadows->addCaster(ufo3Node, ufo3Node->getLevelMesh(shadowLevel));
+		if (impostors)
+			impostors->addNode(ufo3Node);
+		ufo3Node->setMaterialFlag(video::EMF_NORMALIZE_NORMALS, true);
 	//////////////////////////// Add ufo3 [End]
 
 		//////////////////////////// Add Rocks [Begin]
-	IAnimatedMesh* rock = smgr->getMesh("MayaObjects/RockPack.obj");
+	IAnimatedMesh* rock = getGameMesh(smgr, "MayaObjects/RockPack.obj");
 	if (!rock)
-	{
-		device->drop();
-		return 1;
-	}
+		return shutdownGame(device, clock, animation, tiled, options, 1);
 	//mesh->setAnimationSpeed(12);
 	IAnimatedMeshSceneNode* rockNode = smgr->addAnimatedMeshSceneNode( rock );
 	if (rock)
@@ -808,133 +1500,212 @@ int main()
 
 
 	smgr->setShadowColor(video::SColor(150,0,0,0)); // Light of real time shadows
+
+	//////////////////////////// Add Cube Tower [Begin]
+
+	/*
+	The tower is made of 12 levels with 16 cubes each. Every cube used to be
+	its own cube scene node with a rotation animator, a shadow volume and a
+	bounding box selector, which made hundreds of draw calls for the tower
+	alone. Now all cubes are instances of one CCubeFieldSceneNode, which
+	rotates them in one pass and draws them with one call. The cubes of odd
+	levels turn with 0.3, the ones of even levels with 1.2, like before.
+	*/
+	video::ITexture* normalMap = driver->getTexture("Objects/normal.tga"); //normal.tga
+
+	IMesh* cubeMesh = smgr->getGeometryCreator()->createCubeMesh(vector3df(10,10,10));
+	if (normalMap)
+	{
+		// the parallax material needs tangents in the vertices
+		driver->setTextureCreationFlag(video::ETCF_ALWAYS_32_BIT, true);
+		IMesh* tangentMesh = smgr->getMeshManipulator()->createMeshWithTangents(cubeMesh);
+		cubeMesh->drop();
+		cubeMesh = tangentMesh;
+	}
+
+	CCubeFieldSceneNode* cubeField = new CCubeFieldSceneNode(cubeMesh,
+		vector3df(12,12,12), smgr->getRootSceneNode(), smgr); // Scale of the Cubes
+	cubeMesh->drop();
+
+	cubeField->setMaterialTexture( 0, driver->getTexture("Objects/texture1.tga") );
+	cubeField->getMaterial(0).Shininess = 20;
+	cubeField->getMaterial(0).EmissiveColor = SColor(0.1,0,200,0);
+	cubeField->getMaterial(0).GouraudShading = false;
+	cubeField->getMaterial(0).SpecularColor = SColor(1,250,0,0);
+
+	if (normalMap)
+	{
+		cubeField->setMaterialTexture(1, normalMap);
+
+		// Stones don't glitter..
+		cubeField->getMaterial(0).SpecularColor.set(0,0,0,0);
+		cubeField->getMaterial(0).Shininess = 0.f;
+
+		cubeField->setMaterialType(video::EMT_PARALLAX_MAP_SOLID);
+		// adjust height for parallax effect
+		cubeField->getMaterial(0).MaterialTypeParam = 1.f / 64.f;
+	}
+
 	int leveupCounter = 1;
-	int boxOffset = 0;
 	s32 modVal = 4;
 	s32 modBoost = 1;
 	while(leveupCounter <=12)
 	{
-		s32 boxLevelOffset=0;
 		vector3df basePos = vector3df(0,-400,0);
 		basePos.Y+=leveupCounter*130;
-		for (s32 i=1;i<=16;++i)
-		{
-		IMeshSceneNode *cubeNode = smgr->addCubeSceneNode();
-		cubeNode->setMaterialTexture( 0, driver->getTexture("Objects/texture1.tga") );
-		// cubeNode->setMaterialFlag(EMF_LIGHTING, true);
-		cubeNode->getMaterial(0).Shininess = 20;
-		cubeNode->getMaterial(0).EmissiveColor = SColor(0.1,0,200,0);
-		cubeNode->getMaterial(0).GouraudShading = false;
-		cubeNode->getMaterial(0).SpecularColor = SColor(1,250,0,0);
-		cubeNode->setScale(vector3df(12,12,12)); // Scale of the Cubes
-
-		if(i%modVal==0)
-		{
-			if (modBoost >4 )modBoost=1;
-			basePos.X+=130*(modBoost++);
-			basePos.Z-=130;
-		cubeNode->setPosition(basePos);
-		basePos.Z+=130;
-		basePos.X-=130*(modBoost--);
 
-		}
-		else
-		{
-			
-		cubeNode->setPosition(basePos);
-		basePos.Z+=130;
-		}
-		
+		float yaxisSpeed = 0.3f;
+		if (leveupCounter%2==0) yaxisSpeed*=4;
 
-				  // add Real time shadow Casting To boxes
-    cubeNode->addShadowVolumeSceneNode();
-    cubeNode->setMaterialFlag(video::EMF_NORMALIZE_NORMALS, true);
-	
-	
-			//////////////////// Apply Normal Map Begin
-
-			 video::ITexture* normalMap =
-            driver->getTexture("Objects/normal.tga"); //normal.tga
-			  
-        if (normalMap)
+		for (s32 i=1;i<=16;++i)
 		{
-			 driver->setTextureCreationFlag(video::ETCF_ALWAYS_32_BIT, true);
-
-         //   driver->makeNormalMapTexture(normalMap, 20.0f); //Touraj:  This is for GrayScale Maps
-
-		scene::IMesh* tangentMesh = tangentMesh = smgr->getMeshManipulator()->createMeshWithTangents(cubeNode->getMesh());
-		cubeNode = smgr->addMeshSceneNode(tangentMesh);
-
-        cubeNode->setMaterialTexture(1, normalMap);
-
-        // Stones don't glitter..
-        cubeNode->getMaterial(0).SpecularColor.set(0,0,0,0);
-        cubeNode->getMaterial(0).Shininess = 0.f;
-
-        //cubeNode->setMaterialFlag(video::EMF_FOG_ENABLE, true);
-        cubeNode->setMaterialType(video::EMT_PARALLAX_MAP_SOLID);
-        // adjust height for parallax effect
-        cubeNode->getMaterial(0).MaterialTypeParam = 1.f / 64.f;
-		tangentMesh->drop();
-		}
+			if(i%modVal==0)
+			{
+				if (modBoost >4 )modBoost=1;
+				basePos.X+=130*(modBoost++);
+				basePos.Z-=130;
+				cubeField->addInstance(basePos, yaxisSpeed);
+				basePos.Z+=130;
+				basePos.X-=130*(modBoost--);
+			}
+			else
+			{
+				cubeField->addInstance(basePos, yaxisSpeed);
+				basePos.Z+=130;
+			}
+		} // End For
+		leveupCounter++;
+	}
 
-        // drop mesh because we created it with a create.. call.
-        
+	// add Real time shadow Casting To boxes, every cube is a caster of its own
+	shadows->addCubeField(cubeField);
 
+	////////////////////////////////////////////// Box Collision Detection
 
-		/////////////////// Apply Normal Map End
+	scene::ITriangleSelector* cubeFieldSelector = cubeField->createTriangleSelector();
+	cubeField->setTriangleSelector(cubeFieldSelector);
+	worldSelector->addTriangleSelector(cubeFieldSelector, cubeField);
+	cubeFieldSelector->drop();
 
+	////////////////////////////////////////// Box Collision Detection End
 
-	////////////////////////////////////////////// Box Collision Detection
+	cubeField->drop();
 
+	//////////////////////////// Add Cube Tower [End]
 
-    scene::ITriangleSelector* selector
-        = smgr->createTriangleSelectorFromBoundingBox(cubeNode);
-    cubeNode->setTriangleSelector(selector);
+	//////////////////////////////
 
-    // create collision response animator and attach it to the camera
-    scene::ISceneNodeAnimator* anim = smgr->createCollisionResponseAnimator(
-        selector, camnode, core::vector3df(60,100,60),
-        core::vector3df(0,0,0), // gravity
-        core::vector3df(0,50,0));
-	
-    selector->drop();
-    camnode->addAnimator(anim);
-    anim->drop();
+	////////////////////// Camera Collision Detection [Begin]
 
+	/*
+	Now that all objects are in worldSelector, the camera gets its one and
+	only collision response animator. Gravity comes from here, the other
+	objects used to have a gravity of 0 anyway.
+	*/
+	anim = smgr->createCollisionResponseAnimator(
+		worldSelector, camnode, core::vector3df(60,100,60),
+		core::vector3df(0,-9.8f,0), // gravity
+		core::vector3df(0,50,0));
 
-	////////////////////////////////////////// Box Collision Detection End
+	worldSelector->drop();
+	scene::addProfiledAnimator(camnode, anim, "camera_collision");
+	anim->drop();
 
+	////////////////////// Camera Collision Detection [End]
 
-	//		scene::ISceneNodeAnimator* animCube =
-	//smgr->createFlyCircleAnimator(core::vector3df(10+boxOffset,10+boxOffset,30), 20.0f+boxOffset);
-	float yaxisSpeed = 0.3f;
+	// every node which can be hidden by itself may be occluded
+	if (occlusion)
+	{
+		stringc occlusionStats("Occlusion culling: occluders ");
+		occlusionStats += occlusion->getOccluderCount();
+		occlusionStats += ", occludees ";
+		occlusionStats += occlusion->addOccludees(smgr->getRootSceneNode());
+		device->getLogger()->log(occlusionStats.c_str(), ELL_INFORMATION);
+	}
 
-	//if (i%2==0) yaxisSpeed*=2;
-	if (leveupCounter%2==0) yaxisSpeed*=4;
+	// every mesh node with solid materials is drawn by the queue
+	if (renderQueue)
+	{
+		stringc queueStats("Render queue: nodes ");
+		queueStats += renderQueue->addNodes(smgr->getRootSceneNode());
+		device->getLogger()->log(queueStats.c_str(), ELL_INFORMATION);
+	}
 
-			scene::ISceneNodeAnimator* animCube =
-				smgr->createRotationAnimator(vector3df(0,yaxisSpeed,0));
+	/////////////////////
 
-        if (animCube)
-        {
-            cubeNode->addAnimator(animCube);
-            animCube->drop();
-        }
+	const f64 startupMs = getPreciseTimeMs() - startupStart;
+	CFrameProfiler::report("startup", startupStart, startupStart + startupMs);
+	stringc startupStats("Scene loaded in ");
+	startupStats += (u32)startupMs;
+	startupStats += " ms";
+	device->getLogger()->log(startupStats.c_str(), ELL_INFORMATION);
 
-		} // End For
-		leveupCounter++;
-		boxOffset +=60;
-		
-	
+	/*
+	With animation threads, the animators which only move their own node
+	are taken off the nodes and run on several threads before drawAll(),
+	see CAnimationPhase.h. The camera keeps its animators.
+	*/
+	if (options.AnimationThreads)
+	{
+		animation = new CAnimationPhase(options.AnimationThreads);
+		animation->adoptAnimators(smgr->getRootSceneNode());
+		if (clock)
+			clock->setAnimationPhase(animation);
 	}
 
-	//////////////////////////////
+	/*
+	Without a GPU, the scene is drawn by the tiled renderer on all cores
+	instead of drawAll(), and the driver only shows the frames, see
+	CTiledSoftwareRenderer.h.
+	*/
+	if (options.TiledRenderer)
+		tiled = new CTiledSoftwareRenderer(smgr, driver->getScreenSize(), options.TiledThreads);
 
+	if (options.Benchmark)
+	{
+		const int result = runBenchmark(device, camnode, assets, shadows, lights, occlusion, impostors, renderQueue, shipAtlas, animation, tiled, startupMs, options);
+		return shutdownGame(device, clock, animation, tiled, options, result);
+	}
 
+	CFrameProfiler* profiler = CFrameProfiler::getActive();
 
+	if (clock)
+	{
+		/*
+		The fixed step loop: first the ticks which are due since the last
+		frame, then the frame, drawn between the last two ticks. Slow
+		frames only change how many ticks run, not how far each one goes.
+		*/
+		while(device->run())
+		{
+			if (!device->isWindowActive() && !options.FreeRun)
+			{
+				// no catching up on the time the window was in the background
+				device->yield();
+				clock->resync();
+				continue;
+			}
+
+			if (profiler)
+				profiler->beginFrame();
+
+			{
+				MARS_PROFILE_SCOPE("clock_ticks");
+				clock->advance();
+			}
+
+			clock->beginFrame();
+			drawFrame(device, animation, tiled, clock->getTime());
+			clock->endFrame();
+
+			if (profiler)
+				profiler->endFrame();
+
+			clock->limitFrame();
+		}
 
-	/////////////////////
+		return shutdownGame(device, clock, animation, tiled, options, 0);
+	}
 
 	/*
 	Ok, now we have set up the scene, lets draw everything: We run the
@@ -955,12 +1726,13 @@ int main()
         {
 
 
-		driver->beginScene(true, true, SColor(0,0,0,0));
+		if (profiler)
+			profiler->beginFrame();
 
-		smgr->drawAll();
-		guienv->drawAll();
+		drawFrame(device, animation, tiled, device->getTimer()->getTime());
 
-		driver->endScene();
+		if (profiler)
+			profiler->endFrame();
 		 }
 		 else device->yield();
 	}
@@ -973,9 +1745,7 @@ int main()
 	See the documentation at irr::IReferenceCounted::drop() for more
 	information.
 	*/
-	device->drop();
-
-	return 0;
+	return shutdownGame(device, clock, animation, tiled, options, 0);
 }
 
 /*
@@ -0,0 +1,232 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "MeshCooker.h"
+#include "CCookedMeshLoader.h"
+#include "CCookedMeshWriter.h"
+#include "CFrameProfiler.h"
+#include "CTextureAtlas.h"
+#include "MeshSimplifier.h"
+
+namespace irr
+{
+
+namespace
+{
+
+// Every mesh main() loads with getGameMesh(). ufo.obj is loaded with two
+// spellings, both use the cooked file of UFO.obj.
+const c8* const GameMeshes[] =
+{
+	"Objects/Zuleyka.x",
+	"MayaObjects/SciFIGateArray2.obj",
+	"MayaObjects/MotherShip.obj",
+	"MayaObjects/UFO.obj",
+	"MayaObjects/RockPack.obj"
+};
+
+// The meshes which get levels of detail, drawn far away and in the sky.
+const c8* const LodMeshes[] =
+{
+	"MayaObjects/SciFIGateArray2.obj",
+	"MayaObjects/MotherShip.obj",
+	"MayaObjects/UFO.obj"
+};
+
+// Share of the triangles of one level kept by the next.
+const f32 LodRatio = 0.25f;
+
+bool hasLevelsOfDetail(const io::path& source)
+{
+	io::path name = source;
+	name.make_lower();
+
+	const u32 count = sizeof(LodMeshes) / sizeof(LodMeshes[0]);
+	for (u32 i=0; i<count; ++i)
+	{
+		io::path lodName = LodMeshes[i];
+		lodName.make_lower();
+		if (name == lodName)
+			return true;
+	}
+	return false;
+}
+
+// Cooked file of a level, also the mesh cache name of a level simplified
+// at load time, so ufo.obj and UFO.obj share their levels too.
+io::path getCookedLevelName(io::IFileSystem* fileSystem, const io::path& source, u32 level)
+{
+	io::path name = fileSystem->getFileBasename(source, false);
+	name.make_lower();
+	name += "_lod";
+	name += core::stringc(level);
+	name += scene::COOKED_MESH_EXTENSION;
+
+	const io::path dir = fileSystem->getFileDir(source);
+	if (dir.size() && dir != ".")
+		name = dir + "/" + name;
+	return name;
+}
+
+scene::IMesh* createLevel(scene::IMesh* previous)
+{
+	MARS_PROFILE_SCOPE("simplify");
+	return scene::createSimplifiedMesh(previous, LodRatio);
+}
+
+} // end anonymous namespace
+
+
+scene::CCookedMeshLoader* addCookedMeshLoader(IrrlichtDevice* device)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	scene::CCookedMeshLoader* loader = new scene::CCookedMeshLoader(smgr,
+		device->getVideoDriver(), device->getLogger());
+	smgr->addExternalMeshLoader(loader);
+	loader->drop();
+	return loader;
+}
+
+
+int cookGameMeshes(IrrlichtDevice* device)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	io::IFileSystem* fileSystem = device->getFileSystem();
+	ILogger* logger = device->getLogger();
+
+	scene::CMeshDerivationCache* meshes = new scene::CMeshDerivationCache(smgr->getMeshManipulator());
+	scene::CCookedMeshWriter* writer = new scene::CCookedMeshWriter(meshes, fileSystem);
+
+	int result = 0;
+	const u32 count = sizeof(GameMeshes) / sizeof(GameMeshes[0]);
+	for (u32 i=0; i<count; ++i)
+	{
+		const io::path source = GameMeshes[i];
+		const io::path cooked = scene::getCookedMeshName(fileSystem, source);
+
+		// always cook from the source, never from an older cooked file
+		scene::IAnimatedMesh* mesh = smgr->getMesh(source);
+		if (!mesh)
+		{
+			logger->log("Could not load mesh to cook", source.c_str(), ELL_ERROR);
+			result = 1;
+			continue;
+		}
+
+		io::IWriteFile* file = fileSystem->createAndWriteFile(cooked);
+		const bool written = file && writer->writeAnimatedMesh(file, mesh);
+		if (file)
+			file->drop();
+
+		if (written)
+			logger->log("Cooked mesh", cooked.c_str(), ELL_INFORMATION);
+		else
+		{
+			logger->log("Could not write cooked mesh", cooked.c_str(), ELL_ERROR);
+			result = 1;
+		}
+
+		// every level from the one before, starting at the source
+		scene::IMesh* level = hasLevelsOfDetail(source) ? mesh->getMesh(0) : 0;
+		if (level)
+			level->grab();
+		for (u32 l=1; level && l<GAME_MESH_LOD_COUNT; ++l)
+		{
+			scene::IMesh* next = createLevel(level);
+			level->drop();
+			level = next;
+
+			const io::path levelName = getCookedLevelName(fileSystem, source, l);
+			file = fileSystem->createAndWriteFile(levelName);
+			const bool levelWritten = file && writer->writeMesh(file, level);
+			if (file)
+				file->drop();
+
+			if (levelWritten)
+				logger->log("Cooked mesh", levelName.c_str(), ELL_INFORMATION);
+			else
+			{
+				logger->log("Could not write cooked mesh", levelName.c_str(), ELL_ERROR);
+				result = 1;
+			}
+		}
+		if (level)
+			level->drop();
+
+		smgr->getMeshCache()->removeMesh(mesh);
+	}
+
+	core::stringc weldStats("Welded meshes: ");
+	weldStats += meshes->getMissCount();
+	weldStats += ", reused ";
+	weldStats += meshes->getHitCount();
+	logger->log(weldStats.c_str(), ELL_INFORMATION);
+
+	writer->drop();
+	meshes->drop();
+	return result;
+}
+
+
+scene::IAnimatedMesh* getGameMesh(scene::ISceneManager* smgr, const io::path& source)
+{
+	MARS_PROFILE_DETAIL_SCOPE("getMesh", source.c_str());
+
+	const io::path cooked = scene::getCookedMeshName(smgr->getFileSystem(), source);
+	if (smgr->getFileSystem()->existFile(cooked))
+	{
+		scene::IAnimatedMesh* mesh = smgr->getMesh(cooked);
+		if (mesh)
+			return mesh;
+	}
+
+	return smgr->getMesh(source);
+}
+
+
+bool getGameMeshLevels(scene::ISceneManager* smgr, const io::path& source,
+	core::array<scene::IMesh*>& levels, u32 levelCount, CTextureAtlas* atlas)
+{
+	levels.clear();
+
+	scene::IAnimatedMesh* mesh = getGameMesh(smgr, source);
+	if (!mesh || !mesh->getMesh(0))
+		return false;
+	levels.push_back(mesh->getMesh(0));
+	if (atlas)
+		atlas->remapMesh(levels[0]);
+
+	if (!hasLevelsOfDetail(source))
+		return true;
+
+	io::IFileSystem* fileSystem = smgr->getFileSystem();
+	scene::IMeshCache* meshCache = smgr->getMeshCache();
+	for (u32 l=1; l<levelCount; ++l)
+	{
+		const io::path levelName = getCookedLevelName(fileSystem, source, l);
+
+		scene::IAnimatedMesh* level = meshCache->getMeshByName(levelName);
+		if (!level && fileSystem->existFile(levelName))
+			level = smgr->getMesh(levelName);
+
+		if (!level)
+		{
+			scene::IMesh* simplified = createLevel(levels.getLast());
+			scene::SAnimatedMesh* animated = new scene::SAnimatedMesh(simplified);
+			simplified->drop();
+			meshCache->addMesh(levelName, animated);
+			animated->drop();
+			level = animated;
+		}
+
+		// cooked levels still have the coordinates of the source
+		levels.push_back(level->getMesh(0));
+		if (atlas)
+			atlas->remapMesh(levels.getLast());
+	}
+
+	return true;
+}
+
+} // end namespace irr
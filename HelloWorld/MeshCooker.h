@@ -0,0 +1,61 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+
+Cooking converts the meshes of the game into the binary .cmesh format once,
+so the game does not parse .obj and .x files on every start. Run the game
+with -cook to write the cooked files next to their sources. The game loads
+a cooked file when there is one and falls back to the source otherwise, so
+cooking is optional. Cook again after changing a source mesh, the cooked
+file is not checked for being older than its source.
+
+The gates, the mother ship and the ufos also get coarser levels of detail,
+each with a quarter of the triangles of the level before, made by
+createSimplifiedMesh(). Cooking writes them as <name>_lod1.cmesh and so on;
+without these files, the game simplifies the meshes when it loads them.
+*/
+#ifndef __MESH_COOKER_H_INCLUDED__
+#define __MESH_COOKER_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+
+class CTextureAtlas;
+
+namespace scene
+{
+	class CCookedMeshLoader;
+} // end namespace scene
+
+//! Adds the loader for cooked meshes to the scene manager of device.
+/** \return The loader, owned by the scene manager. */
+scene::CCookedMeshLoader* addCookedMeshLoader(IrrlichtDevice* device);
+
+//! Cooks all meshes the game loads.
+/** \return Exit code for main(), 0 if every mesh was cooked. */
+int cookGameMeshes(IrrlichtDevice* device);
+
+//! Loads a mesh of the game, from its cooked file if there is one.
+/** Use this instead of ISceneManager::getMesh() for every mesh listed in
+MeshCooker.cpp. */
+scene::IAnimatedMesh* getGameMesh(scene::ISceneManager* smgr, const io::path& source);
+
+//! Levels of detail of the meshes which have them, the full mesh included.
+const u32 GAME_MESH_LOD_COUNT = 4;
+
+//! Loads a mesh of the game with its levels of detail, for a CLodMeshSceneNode.
+/** Level 0 is the first frame of getGameMesh(), the others are cooked or
+simplified on the first call and kept in the mesh cache, which owns all the
+meshes. Meshes without levels of detail get level 0 only.
+\param atlas If not 0, the buffers of all levels using one of its textures
+are moved onto it, see CTextureAtlas.h.
+\return False if the mesh could not be loaded. */
+bool getGameMeshLevels(scene::ISceneManager* smgr, const io::path& source,
+	core::array<scene::IMesh*>& levels, u32 levelCount=GAME_MESH_LOD_COUNT,
+	CTextureAtlas* atlas=0);
+
+} // end namespace irr
+
+#endif
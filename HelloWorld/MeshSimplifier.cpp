@@ -0,0 +1,522 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <string.h>
+
+namespace irr
+{
+namespace scene
+{
+
+namespace
+{
+
+const u32 None = 0xFFFFFFFF;
+
+// planes along open borders weigh this much more than the surface
+const f64 BorderWeight = 10.0;
+
+//! Sum of squared distances to planes, the upper half of a symmetric 4x4 matrix.
+struct SQuadric
+{
+	// aa ab ac ad bb bc bd cc cd dd
+	f64 M[10];
+
+	void clear()
+	{
+		for (u32 i=0; i<10; ++i)
+			M[i] = 0.0;
+	}
+
+	void addPlane(f64 a, f64 b, f64 c, f64 d, f64 weight)
+	{
+		M[0] += weight * a * a; M[1] += weight * a * b; M[2] += weight * a * c; M[3] += weight * a * d;
+		M[4] += weight * b * b; M[5] += weight * b * c; M[6] += weight * b * d;
+		M[7] += weight * c * c; M[8] += weight * c * d;
+		M[9] += weight * d * d;
+	}
+
+	void add(const SQuadric& other)
+	{
+		for (u32 i=0; i<10; ++i)
+			M[i] += other.M[i];
+	}
+
+	f64 evaluate(const core::vector3df& p) const
+	{
+		const f64 x = p.X, y = p.Y, z = p.Z;
+		return M[0]*x*x + 2.0*M[1]*x*y + 2.0*M[2]*x*z + 2.0*M[3]*x
+			+ M[4]*y*y + 2.0*M[5]*y*z + 2.0*M[6]*y
+			+ M[7]*z*z + 2.0*M[8]*z
+			+ M[9];
+	}
+};
+
+struct SWeldVertex
+{
+	core::vector3df Position;
+	u32 Index;
+
+	bool operator<(const SWeldVertex& other) const
+	{
+		if (Position.X != other.Position.X)
+			return Position.X < other.Position.X;
+		if (Position.Y != other.Position.Y)
+			return Position.Y < other.Position.Y;
+		return Position.Z < other.Position.Z;
+	}
+};
+
+//! Moving the position From onto the position To.
+struct SCollapse
+{
+	f64 Cost;
+	u32 From;
+	u32 To;
+	//! Versions of both positions the cost was computed with.
+	u32 FromVersion;
+	u32 ToVersion;
+
+	// std::push_heap keeps the largest on top, so the cheapest is the largest
+	bool operator<(const SCollapse& other) const { return Cost > other.Cost; }
+};
+
+
+//! Simplifies the triangles of one mesh buffer.
+class CBufferSimplifier
+{
+public:
+
+	CBufferSimplifier(const IMeshBuffer* buffer);
+
+	void simplify(u32 targetTriangles);
+
+	//! Copies the vertices still used and the remaining triangles.
+	IMeshBuffer* createBuffer() const;
+
+private:
+
+	bool contains(u32 triangle, u32 position) const;
+
+	//! Queues the collapses of position with all its neighbours, both ways.
+	void queueNeighbours(u32 position);
+
+	void queue(u32 from, u32 to);
+
+	bool collapse(u32 from, u32 to);
+
+	const IMeshBuffer* Source;
+
+	//! Welded position of every vertex.
+	core::array<u32> VertexPosition;
+	//! Vertex a vertex moved onto, for the collapse being done.
+	core::array<u32> Partner;
+
+	core::array<core::vector3df> Positions;
+	core::array<SQuadric> Quadrics;
+	core::array<u32> Versions;
+	core::array<bool> Alive;
+	core::array<bool> Border;
+	core::array<bool> Locked;
+	//! Triangles using each position, dead ones included.
+	core::array<core::array<u32> > PositionTriangles;
+
+	//! 3 vertices per triangle.
+	core::array<u32> Corners;
+	core::array<bool> TriangleAlive;
+	u32 TriangleCount;
+
+	core::array<SCollapse> Heap;
+};
+
+
+CBufferSimplifier::CBufferSimplifier(const IMeshBuffer* buffer)
+	: Source(buffer), TriangleCount(0)
+{
+	const u32 vertexCount = buffer->getVertexCount();
+
+	// positions shared by several vertices, like both sides of a seam
+	core::array<SWeldVertex> weld;
+	weld.set_used(vertexCount);
+	for (u32 i=0; i<vertexCount; ++i)
+	{
+		weld[i].Position = buffer->getPosition(i);
+		weld[i].Index = i;
+	}
+	weld.sort();
+
+	VertexPosition.set_used(vertexCount);
+	for (u32 i=0; i<vertexCount; ++i)
+	{
+		if (!i || weld[i].Position != weld[i-1].Position)
+			Positions.push_back(weld[i].Position);
+		VertexPosition[weld[i].Index] = Positions.size() - 1;
+	}
+
+	Partner.set_used(vertexCount);
+	for (u32 i=0; i<vertexCount; ++i)
+		Partner[i] = None;
+
+	const u32 positionCount = Positions.size();
+	Quadrics.set_used(positionCount);
+	Versions.set_used(positionCount);
+	Alive.set_used(positionCount);
+	Border.set_used(positionCount);
+	Locked.set_used(positionCount);
+	PositionTriangles.reallocate(positionCount);
+	for (u32 p=0; p<positionCount; ++p)
+	{
+		Quadrics[p].clear();
+		Versions[p] = 0;
+		Alive[p] = true;
+		Border[p] = false;
+		Locked[p] = false;
+		PositionTriangles.push_back(core::array<u32>());
+	}
+
+	// triangles, with the plane of each added to its corners
+	const u32 indexCount = buffer->getIndexCount() / 3 * 3;
+	const bool indices32 = buffer->getIndexType() == video::EIT_32BIT;
+	Corners.set_used(indexCount);
+	for (u32 i=0; i<indexCount; ++i)
+		Corners[i] = indices32 ? ((const u32*)buffer->getIndices())[i] : buffer->getIndices()[i];
+
+	// edges between positions, the smaller position in the high bits
+	core::array<u64> edges;
+	TriangleAlive.set_used(indexCount / 3);
+	for (u32 t=0; t<indexCount / 3; ++t)
+	{
+		const u32 p0 = VertexPosition[Corners[t*3]];
+		const u32 p1 = VertexPosition[Corners[t*3+1]];
+		const u32 p2 = VertexPosition[Corners[t*3+2]];
+		TriangleAlive[t] = p0 != p1 && p1 != p2 && p2 != p0;
+		if (!TriangleAlive[t])
+			continue;
+
+		++TriangleCount;
+		PositionTriangles[p0].push_back(t);
+		PositionTriangles[p1].push_back(t);
+		PositionTriangles[p2].push_back(t);
+
+		core::vector3df normal = (Positions[p1] - Positions[p0]).crossProduct(Positions[p2] - Positions[p0]);
+		const f64 area = normal.getLength() * 0.5;
+		if (area > 0.0)
+		{
+			normal.normalize();
+			const f64 d = -normal.dotProduct(Positions[p0]);
+			Quadrics[p0].addPlane(normal.X, normal.Y, normal.Z, d, area);
+			Quadrics[p1].addPlane(normal.X, normal.Y, normal.Z, d, area);
+			Quadrics[p2].addPlane(normal.X, normal.Y, normal.Z, d, area);
+		}
+
+		const u32 p[3] = { p0, p1, p2 };
+		for (u32 k=0; k<3; ++k)
+		{
+			const u32 a = p[k];
+			const u32 b = p[k == 2 ? 0 : k + 1];
+			edges.push_back(((u64)core::min_(a, b) << 32) | core::max_(a, b));
+		}
+	}
+	edges.sort();
+
+	for (u32 i=0; i<edges.size(); )
+	{
+		u32 count = 1;
+		while (i + count < edges.size() && edges[i + count] == edges[i])
+			++count;
+
+		const u32 a = (u32)(edges[i] >> 32);
+		const u32 b = (u32)(edges[i] & 0xFFFFFFFF);
+		if (count > 2)
+		{
+			// more than two triangles on an edge, nothing to collapse safely
+			Locked[a] = true;
+			Locked[b] = true;
+		}
+		else if (count == 1)
+		{
+			Border[a] = true;
+			Border[b] = true;
+
+			// a plane through the border, upright on its triangle, keeps it in place
+			for (u32 j=0; j<PositionTriangles[a].size(); ++j)
+			{
+				const u32 t = PositionTriangles[a][j];
+				if (!contains(t, b))
+					continue;
+
+				const core::vector3df& pa = Positions[a];
+				const core::vector3df& pb = Positions[b];
+				const core::vector3df n = (Positions[VertexPosition[Corners[t*3+1]]] - Positions[VertexPosition[Corners[t*3]]]).crossProduct(
+					Positions[VertexPosition[Corners[t*3+2]]] - Positions[VertexPosition[Corners[t*3]]]);
+				core::vector3df plane = (pb - pa).crossProduct(n);
+				if (plane.getLengthSQ() <= 0.f)
+					break;
+
+				plane.normalize();
+				const f64 d = -plane.dotProduct(pa);
+				const f64 weight = BorderWeight * (pb - pa).getLengthSQ();
+				Quadrics[a].addPlane(plane.X, plane.Y, plane.Z, d, weight);
+				Quadrics[b].addPlane(plane.X, plane.Y, plane.Z, d, weight);
+				break;
+			}
+		}
+
+		queue(a, b);
+		queue(b, a);
+		i += count;
+	}
+}
+
+
+bool CBufferSimplifier::contains(u32 triangle, u32 position) const
+{
+	return VertexPosition[Corners[triangle*3]] == position ||
+		VertexPosition[Corners[triangle*3+1]] == position ||
+		VertexPosition[Corners[triangle*3+2]] == position;
+}
+
+
+void CBufferSimplifier::queue(u32 from, u32 to)
+{
+	// the border only moves along itself
+	if (Locked[from] || (Border[from] && !Border[to]))
+		return;
+
+	SQuadric quadric = Quadrics[from];
+	quadric.add(Quadrics[to]);
+
+	SCollapse collapse;
+	collapse.Cost = quadric.evaluate(Positions[to]);
+	collapse.From = from;
+	collapse.To = to;
+	collapse.FromVersion = Versions[from];
+	collapse.ToVersion = Versions[to];
+	Heap.push_back(collapse);
+	std::push_heap(Heap.pointer(), Heap.pointer() + Heap.size());
+}
+
+
+void CBufferSimplifier::queueNeighbours(u32 position)
+{
+	const core::array<u32>& triangles = PositionTriangles[position];
+	for (u32 i=0; i<triangles.size(); ++i)
+	{
+		const u32 t = triangles[i];
+		for (u32 k=0; k<3; ++k)
+		{
+			const u32 other = VertexPosition[Corners[t*3+k]];
+			if (other == position)
+				continue;
+
+			queue(other, position);
+			queue(position, other);
+		}
+	}
+}
+
+
+bool CBufferSimplifier::collapse(u32 from, u32 to)
+{
+	core::array<u32>& triangles = PositionTriangles[from];
+
+	// every vertex at from moves onto the one vertex at to it shares an
+	// edge with; none or two of them would tear a seam
+	core::array<u32> moved;
+	bool ok = false;
+	for (u32 i=0; i<triangles.size(); ++i)
+	{
+		const u32 t = triangles[i];
+		if (!TriangleAlive[t])
+			continue;
+
+		u32 vertex = None;
+		u32 partner = None;
+		for (u32 k=0; k<3; ++k)
+		{
+			const u32 v = Corners[t*3+k];
+			if (VertexPosition[v] == from)
+				vertex = v;
+			else if (VertexPosition[v] == to)
+				partner = v;
+		}
+
+		if (partner == None)
+			continue;
+
+		ok = true;
+		if (Partner[vertex] == None)
+		{
+			Partner[vertex] = partner;
+			moved.push_back(vertex);
+		}
+		else if (Partner[vertex] != partner)
+			ok = false;
+
+		if (!ok)
+			break;
+	}
+
+	// the other triangles must keep their vertices and their side
+	for (u32 i=0; i<triangles.size() && ok; ++i)
+	{
+		const u32 t = triangles[i];
+		if (!TriangleAlive[t] || contains(t, to))
+			continue;
+
+		core::vector3df before[3];
+		core::vector3df after[3];
+		for (u32 k=0; k<3; ++k)
+		{
+			const u32 v = Corners[t*3+k];
+			before[k] = Positions[VertexPosition[v]];
+			after[k] = before[k];
+			if (VertexPosition[v] == from)
+			{
+				ok = Partner[v] != None;
+				after[k] = Positions[to];
+			}
+		}
+
+		const core::vector3df normalBefore = (before[1] - before[0]).crossProduct(before[2] - before[0]);
+		const core::vector3df normalAfter = (after[1] - after[0]).crossProduct(after[2] - after[0]);
+		// a sliver without a side can not turn over
+		if (normalBefore.getLengthSQ() > 0.f && normalBefore.dotProduct(normalAfter) <= 0.f)
+			ok = false;
+	}
+
+	if (ok)
+	{
+		core::array<u32>& target = PositionTriangles[to];
+		for (u32 i=0; i<triangles.size(); ++i)
+		{
+			const u32 t = triangles[i];
+			if (!TriangleAlive[t])
+				continue;
+
+			if (contains(t, to))
+			{
+				TriangleAlive[t] = false;
+				--TriangleCount;
+				continue;
+			}
+
+			for (u32 k=0; k<3; ++k)
+				if (VertexPosition[Corners[t*3+k]] == from)
+					Corners[t*3+k] = Partner[Corners[t*3+k]];
+			target.push_back(t);
+		}
+
+		// drop the dead triangles of to while at it
+		u32 kept = 0;
+		for (u32 i=0; i<target.size(); ++i)
+			if (TriangleAlive[target[i]])
+				target[kept++] = target[i];
+		target.set_used(kept);
+
+		Quadrics[to].add(Quadrics[from]);
+		Alive[from] = false;
+		triangles.clear();
+		++Versions[to];
+	}
+
+	for (u32 i=0; i<moved.size(); ++i)
+		Partner[moved[i]] = None;
+
+	return ok;
+}
+
+
+void CBufferSimplifier::simplify(u32 targetTriangles)
+{
+	while (TriangleCount > targetTriangles && Heap.size())
+	{
+		std::pop_heap(Heap.pointer(), Heap.pointer() + Heap.size());
+		const SCollapse next = Heap.getLast();
+		Heap.erase(Heap.size() - 1);
+
+		// queued before one of the positions changed
+		if (!Alive[next.From] || !Alive[next.To] ||
+			Versions[next.From] != next.FromVersion || Versions[next.To] != next.ToVersion)
+			continue;
+
+		if (collapse(next.From, next.To))
+			queueNeighbours(next.To);
+	}
+}
+
+
+IMeshBuffer* CBufferSimplifier::createBuffer() const
+{
+	const u32 vertexCount = Source->getVertexCount();
+	core::array<u32> remap;
+	remap.set_used(vertexCount);
+	for (u32 i=0; i<vertexCount; ++i)
+		remap[i] = None;
+
+	u32 used = 0;
+	for (u32 t=0; t<TriangleAlive.size(); ++t)
+	{
+		if (!TriangleAlive[t])
+			continue;
+		for (u32 k=0; k<3; ++k)
+			if (remap[Corners[t*3+k]] == None)
+				remap[Corners[t*3+k]] = used++;
+	}
+
+	const video::E_VERTEX_TYPE vertexType = Source->getVertexType();
+	const video::E_INDEX_TYPE indexType = used > 65535 ? video::EIT_32BIT : video::EIT_16BIT;
+	CDynamicMeshBuffer* buffer = new CDynamicMeshBuffer(vertexType, indexType);
+	buffer->Material = Source->getMaterial();
+
+	// the vertices keep their order, in their own type
+	const u32 pitch = video::getVertexPitchFromType(vertexType);
+	buffer->getVertexBuffer().set_used(used);
+	u8* vertices = (u8*)buffer->getVertexBuffer().pointer();
+	const u8* sourceVertices = (const u8*)Source->getVertices();
+	for (u32 i=0; i<vertexCount; ++i)
+		if (remap[i] != None)
+			memcpy(vertices + remap[i] * pitch, sourceVertices + i * pitch, pitch);
+
+	IIndexBuffer& indices = buffer->getIndexBuffer();
+	indices.set_used(TriangleCount * 3);
+	u32 index = 0;
+	for (u32 t=0; t<TriangleAlive.size(); ++t)
+	{
+		if (!TriangleAlive[t])
+			continue;
+		for (u32 k=0; k<3; ++k, ++index)
+			indices.setValue(index, remap[Corners[t*3+k]]);
+	}
+
+	buffer->recalculateBoundingBox();
+	buffer->setHardwareMappingHint(EHM_STATIC);
+	return buffer;
+}
+
+} // end anonymous namespace
+
+
+IMesh* createSimplifiedMesh(IMesh* mesh, f32 ratio)
+{
+	SMesh* result = new SMesh();
+	for (u32 b=0; b<mesh->getMeshBufferCount(); ++b)
+	{
+		const IMeshBuffer* source = mesh->getMeshBuffer(b);
+		CBufferSimplifier simplifier(source);
+		simplifier.simplify((u32)(source->getIndexCount() / 3 * core::clamp(ratio, 0.f, 1.f)));
+
+		IMeshBuffer* buffer = simplifier.createBuffer();
+		result->addMeshBuffer(buffer);
+		buffer->drop();
+	}
+
+	result->recalculateBoundingBox();
+	return result;
+}
+
+} // end namespace scene
+} // end namespace irr
@@ -0,0 +1,37 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+
+Simplifies meshes for their levels of detail, by collapsing the edges which
+change the surface least, measured with quadric error metrics (Garland and
+Heckbert). Every vertex keeps the sum of the squared distances to the planes
+of its original triangles; moving it onto a neighbour costs the distance of
+the neighbour to those planes.
+
+A vertex always moves onto a neighbour and is never placed anywhere new, so
+the simplified mesh uses a subset of the original vertices with their normals
+and texture coordinates untouched, whatever the vertex type. Where a texture
+or normal seam splits a position into several vertices, the seam is only
+collapsed along itself, and open borders only along the border, so neither
+tears. Collapses which would turn a triangle over are skipped.
+*/
+#ifndef __MESH_SIMPLIFIER_H_INCLUDED__
+#define __MESH_SIMPLIFIER_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+namespace scene
+{
+
+//! Creates a copy of mesh with about ratio of the triangles of each mesh buffer.
+/** The result has the same mesh buffers with the same materials, a buffer
+may end up empty. Simplification stops early when no collapse is allowed,
+so small or hard edged buffers can keep more triangles. */
+IMesh* createSimplifiedMesh(IMesh* mesh, f32 ratio);
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
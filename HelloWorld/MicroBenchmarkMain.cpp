@@ -0,0 +1,34 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+
+Entry point of the micro benchmark program for Linux build machines, built
+by CMakeLists.txt instead of the Visual Studio project. It takes the same
+arguments as the game but only runs micro benchmarks, all of them on the
+null driver unless -microbench and -driver say otherwise. Run it from this
+directory, the benchmarks load the real assets by their relative paths.
+*/
+#include <irrlicht.h>
+#include "GameOptions.h"
+#include "MicroBenchmarks.h"
+
+using namespace irr;
+
+int main(int argc, char* argv[])
+{
+	SGameOptions options;
+	options.MicroBenchmark = "all";
+	if (!parseGameOptions(argc, argv, options))
+		return 1;
+
+	IrrlichtDevice* device =
+		createDevice(options.DriverType, options.WindowSize, 32,
+			options.Fullscreen, true, options.Vsync, 0);
+
+	if (!device)
+		return 1;
+
+	const int result = runMicroBenchmark(device, options);
+	device->drop();
+	return result;
+}
@@ -0,0 +1,1773 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "MicroBenchmarks.h"
+#include "CAnimationPhase.h"
+#include "CBenchmarkRecorder.h"
+#include "CBroadphaseTriangleSelector.h"
+#include "CBvhTree.h"
+#include "CBvhTriangleSelector.h"
+#include "CCubeFieldSceneNode.h"
+#include "CImpostorManager.h"
+#include "CMarsWorld.h"
+#include "CMeshDerivationCache.h"
+#include "CNearestLightManager.h"
+#include "COcclusionCuller.h"
+#include "CPagedTerrainSceneNode.h"
+#include "CShadowVolumeManager.h"
+#include "CSkinnedCharacterSceneNode.h"
+#include "CSoaParticleSystemSceneNode.h"
+#include "CSoaSkin.h"
+#include "CThreadPool.h"
+#include "CWaveSurfaceSceneNode.h"
+#include "CWorldServer.h"
+#include "MeshCooker.h"
+#include "PreciseTimer.h"
+#include "ProcessMemory.h"
+
+namespace irr
+{
+
+namespace
+{
+
+// Small deterministic random generator, so every run issues the same queries.
+class CQueryRandom
+{
+public:
+	CQueryRandom() : Seed(0x2545F491) {}
+
+	//! Returns a value in [0,1].
+	f32 frand()
+	{
+		Seed = Seed * 1664525u + 1013904223u;
+		return (Seed >> 8) * (1.f / 16777215.f);
+	}
+
+	core::vector3df point(const core::aabbox3df& box)
+	{
+		return core::vector3df(
+			core::lerp(box.MinEdge.X, box.MaxEdge.X, frand()),
+			core::lerp(box.MinEdge.Y, box.MaxEdge.Y, frand()),
+			core::lerp(box.MinEdge.Z, box.MaxEdge.Z, frand()));
+	}
+
+private:
+	u32 Seed;
+};
+
+
+// Prints the statistics of recorder and writes its report.
+int finishBenchmark(IrrlichtDevice* device, const CBenchmarkRecorder& recorder, const SGameOptions& options)
+{
+	recorder.printSummary(options.MicroBenchmark.c_str());
+
+	if (!recorder.writeReport(device->getFileSystem(), options.BenchmarkOutput))
+	{
+		device->getLogger()->log("Could not write benchmark report", options.BenchmarkOutput.c_str(), ELL_ERROR);
+		return 1;
+	}
+
+	device->getLogger()->log("Benchmark report written to", options.BenchmarkOutput.c_str(), ELL_INFORMATION);
+	return 0;
+}
+
+
+// batches of queries per recorded sample, and queries per batch
+const u32 SelectorSamples = 200;
+const u32 SelectorQueriesPerSample = 50;
+
+// size of the collision ellipsoid of the camera, see main()
+const core::vector3df QueryBoxExtent(120.f, 200.f, 120.f);
+
+// series recorded per mesh, in this order
+enum ESelectorSeries
+{
+	StockBox = 0,
+	BvhBox,
+	StockLine,
+	BvhLine,
+	BvhRay,
+	SelectorSeriesCount
+};
+
+const c8* const SelectorSeriesNames[SelectorSeriesCount] =
+{
+	"_stock_box_us", "_bvh_box_us", "_stock_line_us", "_bvh_line_us", "_bvh_ray_us"
+};
+
+
+void benchmarkSelectors(IrrlichtDevice* device, CBenchmarkRecorder& recorder,
+		u32 firstSeries, const c8* name, const io::path& filename, const core::vector3df& scale)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	ILogger* logger = device->getLogger();
+
+	scene::IAnimatedMesh* mesh = smgr->getMesh(filename);
+	if (!mesh)
+	{
+		logger->log("Could not load benchmark mesh", filename.c_str(), ELL_ERROR);
+		return;
+	}
+
+	scene::IAnimatedMeshSceneNode* node = smgr->addAnimatedMeshSceneNode(mesh);
+	node->setScale(scale);
+	node->updateAbsolutePosition();
+
+	scene::ITriangleSelector* stock = smgr->createTriangleSelector(node);
+
+	const f64 buildStart = getPreciseTimeMs();
+	scene::ITriangleSelector* bvh = scene::createBvhTriangleSelector(node);
+	const f64 buildEnd = getPreciseTimeMs();
+
+	const core::stringc prefix(name);
+	recorder.setInfo((prefix + "_triangles").c_str(), stock->getTriangleCount());
+	recorder.setInfo((prefix + "_bvh_nodes").c_str(),
+		((scene::CBvhTriangleSelector*)bvh)->getTree()->getNodeCount());
+	recorder.setInfo((prefix + "_bvh_build_ms").c_str(), buildEnd - buildStart);
+
+	// queries are spread over a box a bit bigger than the node, so some
+	// miss it completely just like in the game
+	core::aabbox3df area(node->getTransformedBoundingBox());
+	const core::vector3df margin = area.getExtent() * 0.1f;
+	area.MinEdge -= margin;
+	area.MaxEdge += margin;
+
+	core::array<core::triangle3df> triangles;
+	triangles.set_used(stock->getTriangleCount());
+
+	CQueryRandom random;
+	u32 mismatches = 0;
+
+	for (u32 sample=0; sample<SelectorSamples; ++sample)
+	{
+		core::aabbox3df boxes[SelectorQueriesPerSample];
+		core::line3df lines[SelectorQueriesPerSample];
+		for (u32 q=0; q<SelectorQueriesPerSample; ++q)
+		{
+			const core::vector3df center = random.point(area);
+			boxes[q] = core::aabbox3df(center - QueryBoxExtent * 0.5f, center + QueryBoxExtent * 0.5f);
+			lines[q] = core::line3df(random.point(area), random.point(area));
+		}
+
+		s32 stockCount[SelectorQueriesPerSample];
+		s32 bvhCount[SelectorQueriesPerSample];
+
+		recorder.beginFrame();
+
+		f64 start = getPreciseTimeMs();
+		for (u32 q=0; q<SelectorQueriesPerSample; ++q)
+			stock->getTriangles(triangles.pointer(), triangles.size(), stockCount[q], boxes[q]);
+		recorder.setValue(firstSeries + StockBox,
+			(getPreciseTimeMs() - start) * 1000. / SelectorQueriesPerSample);
+
+		start = getPreciseTimeMs();
+		for (u32 q=0; q<SelectorQueriesPerSample; ++q)
+			bvh->getTriangles(triangles.pointer(), triangles.size(), bvhCount[q], boxes[q]);
+		recorder.setValue(firstSeries + BvhBox,
+			(getPreciseTimeMs() - start) * 1000. / SelectorQueriesPerSample);
+
+		for (u32 q=0; q<SelectorQueriesPerSample; ++q)
+			if (stockCount[q] != bvhCount[q])
+				++mismatches;
+
+		start = getPreciseTimeMs();
+		for (u32 q=0; q<SelectorQueriesPerSample; ++q)
+			stock->getTriangles(triangles.pointer(), triangles.size(), stockCount[q], lines[q]);
+		recorder.setValue(firstSeries + StockLine,
+			(getPreciseTimeMs() - start) * 1000. / SelectorQueriesPerSample);
+
+		start = getPreciseTimeMs();
+		for (u32 q=0; q<SelectorQueriesPerSample; ++q)
+			bvh->getTriangles(triangles.pointer(), triangles.size(), bvhCount[q], lines[q]);
+		recorder.setValue(firstSeries + BvhLine,
+			(getPreciseTimeMs() - start) * 1000. / SelectorQueriesPerSample);
+
+		// the nearest hit is what picking and the collision manager want
+		start = getPreciseTimeMs();
+		for (u32 q=0; q<SelectorQueriesPerSample; ++q)
+		{
+			core::vector3df point;
+			core::triangle3df triangle;
+			((scene::CBvhTriangleSelector*)bvh)->getCollisionPoint(lines[q], point, triangle);
+		}
+		recorder.setValue(firstSeries + BvhRay,
+			(getPreciseTimeMs() - start) * 1000. / SelectorQueriesPerSample);
+	}
+
+	recorder.setInfo((prefix + "_box_mismatches").c_str(), mismatches);
+	if (mismatches)
+		logger->log("BVH and stock selector returned different box results for", name, ELL_WARNING);
+
+	stock->drop();
+	bvh->drop();
+	node->remove();
+}
+
+
+int runSelectorBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	CBenchmarkRecorder recorder;
+
+	const c8* const meshes[] = { "gate", "mothership" };
+	u32 firstSeries[2];
+	for (u32 m=0; m<2; ++m)
+	{
+		firstSeries[m] = recorder.getSeriesCount();
+		for (u32 s=0; s<SelectorSeriesCount; ++s)
+			recorder.addSeries((core::stringc(meshes[m]) + SelectorSeriesNames[s]).c_str());
+	}
+
+	// same meshes and scales as in the game
+	benchmarkSelectors(device, recorder, firstSeries[0], meshes[0],
+		"MayaObjects/SciFIGateArray2.obj", core::vector3df(20,20,20));
+	benchmarkSelectors(device, recorder, firstSeries[1], meshes[1],
+		"MayaObjects/MotherShip.obj", core::vector3df(40,40,40));
+
+	recorder.setInfo("benchmark", core::stringc("selectors"));
+	recorder.setInfo("queries_per_sample", SelectorQueriesPerSample);
+
+	return finishBenchmark(device, recorder, options);
+}
+
+
+// frames recorded per particle count
+const u32 ParticleSamples = 200;
+
+// particles alive at once; the lava fire of the game has about 30000
+const u32 ParticleCountCount = 3;
+const u32 ParticleCounts[ParticleCountCount] = { 30000, 100000, 1000000 };
+const c8* const ParticleLabels[ParticleCountCount] = { "soa_30k", "soa_100k", "soa_1m" };
+
+// series recorded per particle count, in this order
+enum EParticleSeries
+{
+	Update = 0,
+	UpdateThreaded,
+	Build,
+	BuildThreaded,
+	ParticleSeriesCount
+};
+
+const c8* const ParticleSeriesNames[ParticleSeriesCount] =
+{
+	"_update_ms", "_update_mt_ms", "_build_ms", "_build_mt_ms"
+};
+
+// average life of the lava fire particles, see main()
+const u32 ParticleLifeMin = 15800;
+const u32 ParticleLifeMax = 17000;
+
+
+//! Creates a lava fire like the one of the game, emitting so that about count particles are alive.
+scene::CSoaParticleSystemSceneNode* createBenchmarkParticles(scene::ISceneManager* smgr, u32 count)
+{
+	// not in the scene, the benchmark animates and renders it itself
+	scene::CSoaParticleSystemSceneNode* node = new scene::CSoaParticleSystemSceneNode(0, smgr);
+	node->setScale(core::vector3df(30,30,30));
+
+	const u32 rate = (u32)((u64)count * 2000 / (ParticleLifeMin + ParticleLifeMax));
+	node->setBoxEmitter(core::aabbox3df(-70,0,-70,70,450,470), core::vector3df(0.0f,0.06f,0.0f),
+		rate, rate, video::SColor(0,255,255,255), video::SColor(0,100,255,100),
+		ParticleLifeMin, ParticleLifeMax, 0,
+		core::dimension2df(100.f,100.f), core::dimension2df(400.f,400.f));
+	node->setFadeOut();
+
+	// run a whole life time, so the amount of particles is the steady one
+	for (u32 time=0; time<=ParticleLifeMax+100; time+=100)
+		node->OnAnimate(time);
+
+	return node;
+}
+
+
+//! Counts the billboards of node which wind counter-clockwise on the screen, those culled as back faces.
+u32 countBackFacingBillboards(const scene::CSoaParticleSystemSceneNode* node, const scene::ICameraSceneNode* camera)
+{
+	core::matrix4 viewProjection(camera->getProjectionMatrix());
+	viewProjection *= camera->getViewMatrix();
+
+	const video::S3DVertex* vertices = node->getBillboardVertices();
+	const u16* indices = node->getBatchIndices();
+	u32 count = 0;
+	for (u32 i=0; i<node->getParticleCount(); ++i)
+	{
+		f32 x[3], y[3];
+		bool visible = true;
+		for (u32 k=0; k<3 && visible; ++k)
+		{
+			f32 clip[4];
+			viewProjection.transformVect(clip, vertices[i * 4 + indices[k]].Pos);
+			visible = clip[3] > 0.f;
+			if (visible)
+			{
+				x[k] = clip[0] / clip[3];
+				y[k] = -clip[1] / clip[3];
+			}
+		}
+
+		// clockwise with y down is the front face
+		if (visible && (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]) < 0.f)
+			++count;
+	}
+	return count;
+}
+
+
+int runParticleBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	video::IVideoDriver* driver = device->getVideoDriver();
+	ITimer* timer = device->getTimer();
+	CBenchmarkRecorder recorder;
+
+	u32 firstSeries[ParticleCountCount];
+	for (u32 c=0; c<ParticleCountCount; ++c)
+	{
+		firstSeries[c] = recorder.getSeriesCount();
+		for (u32 s=0; s<ParticleSeriesCount; ++s)
+			recorder.addSeries((core::stringc(ParticleLabels[c]) + ParticleSeriesNames[s]).c_str());
+	}
+	const u32 stockSeries = recorder.addSeries("stock_frame_ms");
+
+	// a camera looking at the fire, the billboards are built facing it
+	scene::ICameraSceneNode* camera = smgr->addCameraSceneNode(0, core::vector3df(0,2000,-8000), core::vector3df(0,2000,0));
+	driver->beginScene(true, true, video::SColor(0,0,0,0));
+	smgr->drawAll();
+	driver->endScene();
+
+	CThreadPool pool(options.LoadThreads);
+	scene::CSoaParticleSystemSceneNode* nodes[ParticleCountCount];
+	for (u32 c=0; c<ParticleCountCount; ++c)
+		nodes[c] = createBenchmarkParticles(smgr, ParticleCounts[c]);
+
+	// Irrlicht's own particle system with the emitter of the game. It
+	// stops at 16250 particles and animates by the device timer.
+	scene::IParticleSystemSceneNode* stock = smgr->addParticleSystemSceneNode(false);
+	stock->setScale(core::vector3df(30,30,30));
+	scene::IParticleEmitter* emitter = stock->createBoxEmitter(
+		core::aabbox3df(-70,0,-70,70,450,470), core::vector3df(0.0f,0.06f,0.0f), 1800, 2000,
+		video::SColor(0,255,255,255), video::SColor(0,100,255,100), ParticleLifeMin, ParticleLifeMax, 0,
+		core::dimension2df(100.f,100.f), core::dimension2df(400.f,400.f));
+	stock->setEmitter(emitter);
+	emitter->drop();
+	scene::IParticleAffector* affector = stock->createFadeOutParticleAffector();
+	stock->addAffector(affector);
+	affector->drop();
+
+	timer->stop();
+	const u32 startTime = timer->getTime();
+	for (u32 time=0; time<=ParticleLifeMax+100; time+=100)
+	{
+		timer->setTime(startTime + time);
+		driver->beginScene(true, true, video::SColor(0,0,0,0));
+		smgr->drawAll();
+		driver->endScene();
+	}
+
+	const u32 firstFrame = ParticleLifeMax + 200;
+	for (u32 sample=0; sample<ParticleSamples; ++sample)
+	{
+		// two frames per sample, one on this thread and one on the pool
+		const u32 time = firstFrame + (u32)(sample * 2 * options.BenchmarkFrameTimeMs);
+		const u32 threadedTime = firstFrame + (u32)((sample * 2 + 1) * options.BenchmarkFrameTimeMs);
+
+		recorder.beginFrame();
+		driver->beginScene(true, true, video::SColor(0,0,0,0));
+
+		for (u32 c=0; c<ParticleCountCount; ++c)
+		{
+			scene::CSoaParticleSystemSceneNode* node = nodes[c];
+
+			node->setThreadPool(0);
+			node->OnAnimate(time);
+			node->render();
+			recorder.setValue(firstSeries[c] + Update, node->getLastUpdateTimeMs());
+			recorder.setValue(firstSeries[c] + Build, node->getLastBuildTimeMs());
+
+			node->setThreadPool(&pool);
+			node->OnAnimate(threadedTime);
+			node->render();
+			recorder.setValue(firstSeries[c] + UpdateThreaded, node->getLastUpdateTimeMs());
+			recorder.setValue(firstSeries[c] + BuildThreaded, node->getLastBuildTimeMs());
+		}
+
+		timer->setTime(startTime + time);
+		const f64 start = getPreciseTimeMs();
+		smgr->drawAll();
+		recorder.setValue(stockSeries, getPreciseTimeMs() - start);
+
+		driver->endScene();
+
+		if (sample == 0)
+			for (u32 c=0; c<ParticleCountCount; ++c)
+				recorder.setInfo((core::stringc(ParticleLabels[c]) + "_particles").c_str(), nodes[c]->getParticleCount());
+	}
+
+	timer->start();
+
+	// the billboards of the last frame must all face the camera, or the
+	// drivers cull them with the default material
+	for (u32 c=0; c<ParticleCountCount; ++c)
+	{
+		const u32 backFacing = countBackFacingBillboards(nodes[c], camera);
+		recorder.setInfo((core::stringc(ParticleLabels[c]) + "_back_facing").c_str(), backFacing);
+		if (backFacing)
+			device->getLogger()->log("Particle billboards facing away from the camera in", ParticleLabels[c], ELL_WARNING);
+	}
+
+	for (u32 c=0; c<ParticleCountCount; ++c)
+	{
+		nodes[c]->setThreadPool(0);
+		nodes[c]->drop();
+	}
+
+	recorder.setInfo("benchmark", core::stringc("particles"));
+	recorder.setInfo("threads", pool.getThreadCount() + 1);
+
+	return finishBenchmark(device, recorder, options);
+}
+
+
+// frames recorded per grid size
+const u32 WaterSamples = 200;
+
+// tiles per side; the lava lake of the game has 60
+const u32 WaterSizeCount = 3;
+const u32 WaterSizes[WaterSizeCount] = { 60, 256, 1024 };
+const c8* const WaterLabels[WaterSizeCount] = { "waves_60", "waves_256", "waves_1024" };
+
+
+int runWaterBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	CBenchmarkRecorder recorder;
+
+	u32 series[WaterSizeCount];
+	for (u32 s=0; s<WaterSizeCount; ++s)
+		series[s] = recorder.addSeries((core::stringc(WaterLabels[s]) + "_update_ms").c_str());
+	const u32 stockSeries = recorder.addSeries("stock_60_update_ms");
+
+	// the parameters of the lava lake, only the amount of tiles changes
+	scene::CWaveSurfaceSceneNode* nodes[WaterSizeCount];
+	for (u32 s=0; s<WaterSizeCount; ++s)
+	{
+		nodes[s] = new scene::CWaveSurfaceSceneNode(core::dimension2df(20,20),
+			core::dimension2du(WaterSizes[s], WaterSizes[s]), core::dimension2df(10,10),
+			4.0f, 600.0f, 0.01f, 0, smgr);
+		recorder.setInfo((core::stringc(WaterLabels[s]) + "_vertices").c_str(), nodes[s]->getVertexCount());
+	}
+
+	// Irrlicht's water surface, only at 60 tiles: the hill plane has 16 bit
+	// indices and can not be built with more than 65535 vertices
+	scene::IAnimatedMesh* plane = smgr->addHillPlaneMesh("BenchmarkWaterSurface",
+		core::dimension2df(20,20), core::dimension2du(60,60), 0, 0,
+		core::dimension2df(0,0), core::dimension2df(10,10));
+	scene::ISceneNode* stock = smgr->addWaterSurfaceSceneNode(plane->getMesh(0), 4.0f, 600.0f, 0.01f);
+
+	for (u32 sample=0; sample<WaterSamples; ++sample)
+	{
+		const u32 time = (u32)(sample * options.BenchmarkFrameTimeMs);
+		recorder.beginFrame();
+
+		for (u32 s=0; s<WaterSizeCount; ++s)
+		{
+			nodes[s]->updateWaves(time);
+			recorder.setValue(series[s], nodes[s]->getLastUpdateTimeMs());
+		}
+
+		const f64 start = getPreciseTimeMs();
+		stock->OnAnimate(time);
+		recorder.setValue(stockSeries, getPreciseTimeMs() - start);
+	}
+
+	for (u32 s=0; s<WaterSizeCount; ++s)
+		nodes[s]->drop();
+
+	recorder.setInfo("benchmark", core::stringc("water"));
+
+	return finishBenchmark(device, recorder, options);
+}
+
+
+// samples per side of the generated height map, 8192 quads of 80 units
+const u32 TerrainSize = 8193;
+const c8* const TerrainFileName = "terrain_bench.r16";
+
+// frames recorded while flying over the map
+const u32 TerrainSamples = 2000;
+
+
+//! Writes a rolling 16 bit height map, unless it exists from an earlier run.
+bool writeBenchmarkTerrain(io::IFileSystem* fileSystem)
+{
+	io::IReadFile* existing = fileSystem->createAndOpenFile(TerrainFileName);
+	if (existing)
+	{
+		const bool complete = existing->getSize() == (long)(TerrainSize * TerrainSize * sizeof(u16));
+		existing->drop();
+		if (complete)
+			return true;
+	}
+
+	io::IWriteFile* file = fileSystem->createAndWriteFile(TerrainFileName);
+	if (!file)
+		return false;
+
+	core::array<u16> row;
+	row.set_used(TerrainSize);
+	bool ok = true;
+	for (u32 z=0; z<TerrainSize && ok; ++z)
+	{
+		for (u32 x=0; x<TerrainSize; ++x)
+		{
+			const f32 h = 0.5f
+				+ 0.25f * sinf(x * 0.0021f) * cosf(z * 0.0017f)
+				+ 0.15f * sinf(x * 0.013f + z * 0.007f)
+				+ 0.05f * cosf(x * 0.061f - z * 0.047f);
+			row[x] = (u16)core::clamp(h * 65535.f, 0.f, 65535.f);
+		}
+		ok = file->write(row.const_pointer(), TerrainSize * sizeof(u16)) == (s32)(TerrainSize * sizeof(u16));
+	}
+
+	file->drop();
+	return ok;
+}
+
+
+int runTerrainBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	video::IVideoDriver* driver = device->getVideoDriver();
+	ITimer* timer = device->getTimer();
+
+	if (!writeBenchmarkTerrain(device->getFileSystem()))
+	{
+		device->getLogger()->log("Could not write benchmark terrain", TerrainFileName, ELL_ERROR);
+		return 1;
+	}
+
+	// the scale and view distance of the game, on a map 32 times as wide
+	scene::CPagedTerrainSceneNode* terrain = new scene::CPagedTerrainSceneNode(TerrainFileName,
+		smgr->getRootSceneNode(), smgr, -1, core::vector3df(0,0,0), core::vector3df(0,0,0),
+		core::vector3df(80.f, 16.4f, 80.f));
+	if (!terrain->isValid())
+	{
+		terrain->remove();
+		terrain->drop();
+		device->getLogger()->log("Could not open benchmark terrain", TerrainFileName, ELL_ERROR);
+		return 1;
+	}
+
+	scene::ICameraSceneNode* camera = smgr->addCameraSceneNode();
+	camera->setFarValue(42000.0f);
+
+	// diagonally across the map, far enough per frame to cross a tile
+	// border every few frames
+	const f32 extent = (TerrainSize - 1) * 80.f;
+	const core::vector3df start(extent * 0.05f, 4000.f, extent * 0.05f);
+	const core::vector3df step(extent * 0.9f / TerrainSamples, 0.f, extent * 0.9f / TerrainSamples);
+
+	camera->setPosition(start);
+	camera->setTarget(start + step * 100.f - core::vector3df(0, 1500.f, 0));
+	camera->updateAbsolutePosition();
+
+	const f64 preloadStart = getPreciseTimeMs();
+	terrain->preload(start);
+
+	CBenchmarkRecorder recorder;
+	const u32 frameSeries = recorder.addSeries("frame_ms");
+	const u32 streamSeries = recorder.addSeries("stream_ms");
+	const u32 residentSeries = recorder.addSeries("resident_tiles");
+	const u32 bytesSeries = recorder.addSeries("resident_bytes");
+	const u32 pendingSeries = recorder.addSeries("pending_tiles");
+	const u32 drawnSeries = recorder.addSeries("drawn_tiles");
+
+	recorder.setInfo("preload_ms", getPreciseTimeMs() - preloadStart);
+
+	timer->stop();
+	const u32 startTime = timer->getTime();
+
+	for (u32 sample=0; sample<TerrainSamples; ++sample)
+	{
+		const core::vector3df position = start + step * (f32)sample;
+		camera->setPosition(position);
+		camera->setTarget(position + step * 100.f - core::vector3df(0, 1500.f, 0));
+		timer->setTime(startTime + (u32)(sample * options.BenchmarkFrameTimeMs));
+
+		recorder.beginFrame();
+		driver->beginScene(true, true, video::SColor(255,0,0,0));
+
+		const f64 frameStart = getPreciseTimeMs();
+		smgr->drawAll();
+		recorder.setValue(frameSeries, getPreciseTimeMs() - frameStart);
+
+		driver->endScene();
+
+		recorder.setValue(streamSeries, terrain->getLastStreamTimeMs());
+		recorder.setValue(residentSeries, terrain->getResidentTileCount());
+		recorder.setValue(bytesSeries, terrain->getResidentBytes());
+		recorder.setValue(pendingSeries, terrain->getPendingTileCount());
+		recorder.setValue(drawnSeries, terrain->getLastDrawnTileCount());
+	}
+
+	timer->start();
+
+	recorder.setInfo("benchmark", core::stringc("terrain"));
+	recorder.setInfo("tiles", terrain->getTileCount());
+	recorder.setInfo("streamed_tiles", terrain->getStreamedTileCount());
+
+	camera->remove();
+	terrain->remove();
+	terrain->drop();
+
+	return finishBenchmark(device, recorder, options);
+}
+
+
+// frames recorded per light count
+const u32 LightSamples = 200;
+
+// lit nodes spread over the area, about as many as the game has
+const u32 LightNodeCount = 300;
+
+const u32 LightCountCount = 4;
+const u32 LightCounts[LightCountCount] = { 8, 64, 512, 4096 };
+const c8* const LightLabels[LightCountCount] = { "lights_8", "lights_64", "lights_512", "lights_4096" };
+
+
+int runLightBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	CBenchmarkRecorder recorder;
+	CQueryRandom random;
+
+	u32 series[LightCountCount];
+	u32 scoredSeries[LightCountCount];
+	for (u32 c=0; c<LightCountCount; ++c)
+	{
+		series[c] = recorder.addSeries((core::stringc(LightLabels[c]) + "_select_ms").c_str());
+		scoredSeries[c] = recorder.addSeries((core::stringc(LightLabels[c]) + "_scored").c_str());
+	}
+
+	// the extent of the colony
+	const core::aabbox3df area(-10000.f, -600.f, -10000.f, 10000.f, 3000.f, 10000.f);
+
+	core::array<scene::ISceneNode*> nodes;
+	for (u32 i=0; i<LightNodeCount; ++i)
+	{
+		scene::ISceneNode* node = smgr->addCubeSceneNode(100.f, 0, -1, random.point(area));
+		node->updateAbsolutePosition();
+		nodes.push_back(node);
+	}
+
+	scene::ICameraSceneNode* camera = smgr->addCameraSceneNode(0, core::vector3df(0, 1000.f, 0));
+	camera->updateAbsolutePosition();
+
+	// base lights with a small radius, and one sun every node sees; every
+	// count uses the first lights of the same list
+	core::array<scene::ISceneNode*> lights;
+	scene::ILightSceneNode* sun = smgr->addLightSceneNode();
+	sun->setLightType(video::ELT_DIRECTIONAL);
+	lights.push_back(sun);
+
+	while (lights.size() < LightCounts[LightCountCount-1])
+	{
+		scene::ILightSceneNode* light = smgr->addLightSceneNode(0, random.point(area),
+			video::SColorf(1.f, 0.8f, 0.6f), 300.f + 900.f * random.frand());
+		light->updateAbsolutePosition();
+		lights.push_back(light);
+	}
+
+	core::array<scene::ISceneNode*> lightLists[LightCountCount];
+	for (u32 c=0; c<LightCountCount; ++c)
+		for (u32 i=0; i<LightCounts[c]; ++i)
+			lightLists[c].push_back(lights[i]);
+
+	scene::CNearestLightManager* manager = new scene::CNearestLightManager(smgr);
+
+	for (u32 sample=0; sample<LightSamples; ++sample)
+	{
+		recorder.beginFrame();
+
+		for (u32 c=0; c<LightCountCount; ++c)
+		{
+			// the calls drawAll() makes, without the drawing
+			manager->OnPreRender(lightLists[c]);
+			manager->OnRenderPassPreRender(scene::ESNRP_SOLID);
+			for (u32 i=0; i<nodes.size(); ++i)
+			{
+				manager->OnNodePreRender(nodes[i]);
+				manager->OnNodePostRender(nodes[i]);
+			}
+			manager->OnRenderPassPostRender(scene::ESNRP_SOLID);
+			manager->OnPostRender();
+
+			recorder.setValue(series[c], manager->getLastSelectionTimeMs());
+			recorder.setValue(scoredSeries[c], manager->getLastScoredLightCount());
+
+			if (sample == 0)
+				recorder.setInfo((core::stringc(LightLabels[c]) + "_global").c_str(), manager->getGlobalLightCount());
+		}
+	}
+
+	manager->drop();
+
+	for (u32 i=0; i<lights.size(); ++i)
+		lights[i]->remove();
+	for (u32 i=0; i<nodes.size(); ++i)
+		nodes[i]->remove();
+	camera->remove();
+
+	recorder.setInfo("benchmark", core::stringc("lights"));
+	recorder.setInfo("nodes", LightNodeCount);
+
+	return finishBenchmark(device, recorder, options);
+}
+
+
+// frames recorded, groups of nodes and nodes per group
+const u32 AnimatorSamples = 200;
+const u32 AnimatorGroups = 64;
+const u32 AnimatorNodesPerGroup = 256;
+
+const u32 AnimatorThreadCountCount = 3;
+const u32 AnimatorThreadCounts[AnimatorThreadCountCount] = { 1, 4, 16 };
+
+
+//! Adds groups of nodes circling their group, which flies a circle itself.
+scene::ISceneNode* addAnimatedNodes(scene::ISceneManager* smgr, CQueryRandom& random)
+{
+	scene::ISceneNode* root = smgr->addEmptySceneNode();
+	const core::aabbox3df area(-10000.f, 0.f, -10000.f, 10000.f, 4000.f, 10000.f);
+
+	for (u32 g=0; g<AnimatorGroups; ++g)
+	{
+		scene::ISceneNode* group = smgr->addEmptySceneNode(root);
+		scene::ISceneNodeAnimator* anim = smgr->createFlyCircleAnimator(random.point(area), 2000.f, 0.0005f);
+		group->addAnimator(anim);
+		anim->drop();
+
+		for (u32 n=0; n<AnimatorNodesPerGroup; ++n)
+		{
+			scene::ISceneNode* node = smgr->addEmptySceneNode(group);
+			anim = smgr->createFlyCircleAnimator(core::vector3df(0,0,0), 50.f + 500.f * random.frand(), 0.001f + 0.002f * random.frand());
+			node->addAnimator(anim);
+			anim->drop();
+			anim = smgr->createRotationAnimator(core::vector3df(0, 0.1f + random.frand(), 0));
+			node->addAnimator(anim);
+			anim->drop();
+		}
+	}
+
+	return root;
+}
+
+
+int runAnimatorBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	CBenchmarkRecorder recorder;
+	CQueryRandom random;
+
+	// the same nodes once for drawAll()'s way, OnAnimate(), and once per
+	// thread count for the animation phase
+	scene::ISceneNode* stock = addAnimatedNodes(smgr, random);
+	const u32 stockSeries = recorder.addSeries("stock_ms");
+
+	scene::ISceneNode* roots[AnimatorThreadCountCount];
+	scene::CAnimationPhase* phases[AnimatorThreadCountCount];
+	u32 series[AnimatorThreadCountCount];
+	for (u32 t=0; t<AnimatorThreadCountCount; ++t)
+	{
+		random = CQueryRandom();
+		roots[t] = addAnimatedNodes(smgr, random);
+		phases[t] = new scene::CAnimationPhase(AnimatorThreadCounts[t]);
+		phases[t]->adoptAnimators(roots[t]);
+		series[t] = recorder.addSeries((core::stringc("threads_") + core::stringc(AnimatorThreadCounts[t]) + "_ms").c_str());
+	}
+
+	f64 stockTotal = 0;
+	f64 totals[AnimatorThreadCountCount] = { 0 };
+
+	for (u32 sample=0; sample<AnimatorSamples; ++sample)
+	{
+		const u32 time = (u32)(sample * options.BenchmarkFrameTimeMs);
+		recorder.beginFrame();
+
+		const f64 start = getPreciseTimeMs();
+		stock->OnAnimate(time);
+		const f64 stockMs = getPreciseTimeMs() - start;
+		recorder.setValue(stockSeries, stockMs);
+		stockTotal += stockMs;
+
+		for (u32 t=0; t<AnimatorThreadCountCount; ++t)
+		{
+			phases[t]->animate(time);
+			const f64 ms = phases[t]->getLastAnimateTimeMs() + phases[t]->getLastCommitTimeMs();
+			recorder.setValue(series[t], ms);
+			totals[t] += ms;
+		}
+	}
+
+	recorder.setInfo("benchmark", core::stringc("animators"));
+	recorder.setInfo("nodes", phases[0]->getNodeCount());
+	recorder.setInfo("hardware_threads", CThreadPool::getHardwareThreadCount());
+	for (u32 t=0; t<AnimatorThreadCountCount; ++t)
+	{
+		const core::stringc name = core::stringc("speedup_") + core::stringc(AnimatorThreadCounts[t]);
+		recorder.setInfo((name + "_vs_stock").c_str(), totals[t] > 0 ? stockTotal / totals[t] : 0.0);
+		recorder.setInfo((name + "_vs_1").c_str(), totals[t] > 0 ? totals[0] / totals[t] : 0.0);
+	}
+
+	stock->remove();
+	for (u32 t=0; t<AnimatorThreadCountCount; ++t)
+	{
+		phases[t]->drop();
+		roots[t]->remove();
+	}
+
+	return finishBenchmark(device, recorder, options);
+}
+
+
+// frames recorded, and characters per run
+const u32 SkinningSamples = 200;
+const u32 SkinningCountCount = 3;
+const u32 SkinningCounts[SkinningCountCount] = { 1, 100, 1000 };
+
+// cached poses per frame of the animation
+const u32 SkinningPosesPerFrame = 2;
+
+
+int runSkinningBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	video::IVideoDriver* driver = device->getVideoDriver();
+	CBenchmarkRecorder recorder;
+	CQueryRandom random;
+
+	scene::IAnimatedMesh* mesh = smgr->getMesh("Objects/Zuleyka.x");
+	if (!mesh || mesh->getMeshType() != scene::EAMT_SKINNED)
+	{
+		device->getLogger()->log("Could not load skinned benchmark mesh", "Objects/Zuleyka.x", ELL_ERROR);
+		return 1;
+	}
+
+	// before any stock node animates the mesh, see CSoaSkin.h
+	scene::CSoaSkin* skin = new scene::CSoaSkin((scene::ISkinnedMesh*)mesh);
+	skin->setPoseCache(SkinningPosesPerFrame);
+
+	// every count has its own characters, with the frame loop and speed of
+	// the game and random start frames: a character drawn twice at the
+	// same frame skips the skinning
+	core::array<scene::IAnimatedMeshSceneNode*> stock[SkinningCountCount];
+	core::array<scene::CSkinnedCharacterSceneNode*> characters[SkinningCountCount];
+	u32 stockSeries[SkinningCountCount];
+	u32 soaSeries[SkinningCountCount];
+	u32 cachedSeries[SkinningCountCount];
+	for (u32 c=0; c<SkinningCountCount; ++c)
+	{
+		for (u32 i=0; i<SkinningCounts[c]; ++i)
+		{
+			const f32 start = 79.f * random.frand();
+
+			scene::IAnimatedMeshSceneNode* node = smgr->addAnimatedMeshSceneNode(mesh);
+			node->setAnimationSpeed(14);
+			node->setFrameLoop(0, 79);
+			node->setCurrentFrame(start);
+			stock[c].push_back(node);
+
+			scene::CSkinnedCharacterSceneNode* character =
+				new scene::CSkinnedCharacterSceneNode(skin, smgr->getRootSceneNode(), smgr);
+			character->setAnimationSpeed(14);
+			character->setFrameLoop(0, 79);
+			character->setCurrentFrame(start);
+			characters[c].push_back(character);
+			character->drop(); // the root node keeps it
+		}
+
+		const core::stringc count(SkinningCounts[c]);
+		stockSeries[c] = recorder.addSeries((core::stringc("stock_") + count + "_ms").c_str());
+		soaSeries[c] = recorder.addSeries((core::stringc("soa_") + count + "_ms").c_str());
+		cachedSeries[c] = recorder.addSeries((core::stringc("cached_") + count + "_ms").c_str());
+	}
+
+	// the cached runs measure copying, baking every pose once is a load time cost
+	const f64 bakeStart = getPreciseTimeMs();
+	for (u32 i=0; i<(skin->getFrameCount() - 1) * SkinningPosesPerFrame + 1; ++i)
+		skin->getPose(i);
+	recorder.setInfo("pose_bake_ms", getPreciseTimeMs() - bakeStart);
+
+	f64 stockTotals[SkinningCountCount] = { 0 };
+	f64 soaTotals[SkinningCountCount] = { 0 };
+	f64 cachedTotals[SkinningCountCount] = { 0 };
+
+	for (u32 sample=0; sample<SkinningSamples; ++sample)
+	{
+		// one frame for every variant, so each of them has to skin
+		const u32 time = (u32)(sample * 3 * options.BenchmarkFrameTimeMs);
+		const u32 soaTime = (u32)((sample * 3 + 1) * options.BenchmarkFrameTimeMs);
+		const u32 cachedTime = (u32)((sample * 3 + 2) * options.BenchmarkFrameTimeMs);
+
+		recorder.beginFrame();
+		driver->beginScene(true, true, video::SColor(0,0,0,0));
+
+		for (u32 c=0; c<SkinningCountCount; ++c)
+		{
+			// the calls drawAll() makes for a node in view
+			f64 start = getPreciseTimeMs();
+			for (u32 i=0; i<stock[c].size(); ++i)
+			{
+				stock[c][i]->OnAnimate(time);
+				stock[c][i]->render();
+			}
+			f64 ms = getPreciseTimeMs() - start;
+			recorder.setValue(stockSeries[c], ms);
+			stockTotals[c] += ms;
+
+			start = getPreciseTimeMs();
+			for (u32 i=0; i<characters[c].size(); ++i)
+			{
+				characters[c][i]->setUsePoseCache(false);
+				characters[c][i]->OnAnimate(soaTime);
+				characters[c][i]->render();
+			}
+			ms = getPreciseTimeMs() - start;
+			recorder.setValue(soaSeries[c], ms);
+			soaTotals[c] += ms;
+
+			start = getPreciseTimeMs();
+			for (u32 i=0; i<characters[c].size(); ++i)
+			{
+				characters[c][i]->setUsePoseCache(true);
+				characters[c][i]->OnAnimate(cachedTime);
+				characters[c][i]->render();
+			}
+			ms = getPreciseTimeMs() - start;
+			recorder.setValue(cachedSeries[c], ms);
+			cachedTotals[c] += ms;
+		}
+
+		driver->endScene();
+	}
+
+	recorder.setInfo("benchmark", core::stringc("skinning"));
+	recorder.setInfo("vertices", skin->getVertexCount());
+	recorder.setInfo("joints", skin->getJointCount());
+	recorder.setInfo("cached_poses", skin->getCachedPoseCount());
+	recorder.setInfo("pose_cache_bytes", skin->getPoseCacheBytes());
+	for (u32 c=0; c<SkinningCountCount; ++c)
+	{
+		const core::stringc count(SkinningCounts[c]);
+		recorder.setInfo((core::stringc("speedup_soa_") + count).c_str(), soaTotals[c] > 0 ? stockTotals[c] / soaTotals[c] : 0.0);
+		recorder.setInfo((core::stringc("speedup_cached_") + count).c_str(), cachedTotals[c] > 0 ? stockTotals[c] / cachedTotals[c] : 0.0);
+	}
+
+	for (u32 c=0; c<SkinningCountCount; ++c)
+	{
+		for (u32 i=0; i<stock[c].size(); ++i)
+			stock[c][i]->remove();
+		for (u32 i=0; i<characters[c].size(); ++i)
+			characters[c][i]->remove();
+	}
+	skin->drop();
+
+	return finishBenchmark(device, recorder, options);
+}
+
+
+// frames recorded, cubes behind and around the wall
+const u32 OcclusionSamples = 200;
+const u32 OcclusionCubeCount = 1000;
+
+// depth buffer sizes, the first run without the culler
+const u32 OcclusionRunCount = 4;
+const core::dimension2d<u32> OcclusionSizes[OcclusionRunCount] = {
+	core::dimension2d<u32>(0, 0), core::dimension2d<u32>(128, 64),
+	core::dimension2d<u32>(256, 128), core::dimension2d<u32>(512, 256) };
+const c8* const OcclusionLabels[OcclusionRunCount] = { "off", "buffer_128", "buffer_256", "buffer_512" };
+
+
+int runOcclusionBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	video::IVideoDriver* driver = device->getVideoDriver();
+	CBenchmarkRecorder recorder;
+	CQueryRandom random;
+
+	// first, like in the game, so it is registered before the cubes
+	scene::COcclusionCuller* culler = new scene::COcclusionCuller(smgr->getRootSceneNode(), smgr);
+
+	// a wall the size of the mother ship, and cubes on both sides of it
+	scene::IMeshSceneNode* wall = smgr->addCubeSceneNode(1.f, 0, -1, core::vector3df(0, 1000.f, 0),
+		core::vector3df(0, 0, 0), core::vector3df(6000.f, 2000.f, 100.f));
+	wall->updateAbsolutePosition();
+	culler->addOccluder(wall, wall->getMesh());
+
+	const core::aabbox3df area(-6000.f, 0.f, -2000.f, 6000.f, 2500.f, 8000.f);
+	core::array<scene::ISceneNode*> cubes;
+	for (u32 i=0; i<OcclusionCubeCount; ++i)
+	{
+		scene::ISceneNode* cube = smgr->addCubeSceneNode(100.f, 0, -1, random.point(area));
+		cube->updateAbsolutePosition();
+		cubes.push_back(cube);
+	}
+	recorder.setInfo("occludees", culler->addOccludees(smgr->getRootSceneNode()));
+
+	scene::ICameraSceneNode* camera = smgr->addCameraSceneNode();
+	camera->setFarValue(42000.0f);
+
+	u32 drawSeries[OcclusionRunCount];
+	u32 cullSeries[OcclusionRunCount];
+	u32 occludedSeries[OcclusionRunCount];
+	u32 trianglesSeries[OcclusionRunCount];
+	for (u32 r=0; r<OcclusionRunCount; ++r)
+	{
+		const core::stringc label(OcclusionLabels[r]);
+		drawSeries[r] = recorder.addSeries((label + "_draw_ms").c_str());
+		cullSeries[r] = recorder.addSeries((label + "_cull_ms").c_str());
+		occludedSeries[r] = recorder.addSeries((label + "_occluded").c_str());
+		trianglesSeries[r] = recorder.addSeries((label + "_triangles").c_str());
+	}
+
+	for (u32 sample=0; sample<OcclusionSamples; ++sample)
+	{
+		// along the wall in front of it, from one end to the other
+		const f32 t = (f32)sample / (OcclusionSamples - 1);
+		const core::vector3df position(core::lerp(-8000.f, 8000.f, t), 800.f, -3000.f);
+		camera->setPosition(position);
+		camera->setTarget(position + core::vector3df(-0.3f * position.X, 0, 4000.f));
+		camera->updateAbsolutePosition();
+
+		recorder.beginFrame();
+
+		for (u32 r=0; r<OcclusionRunCount; ++r)
+		{
+			culler->setVisible(r != 0);
+			if (r != 0)
+				culler->setResolution(OcclusionSizes[r].Width, OcclusionSizes[r].Height);
+
+			driver->beginScene(true, true, video::SColor(255,0,0,0));
+			const f64 start = getPreciseTimeMs();
+			smgr->drawAll();
+			recorder.setValue(drawSeries[r], getPreciseTimeMs() - start);
+			driver->endScene();
+
+			recorder.setValue(cullSeries[r], r ? culler->getLastCullTimeMs() : 0.0);
+			recorder.setValue(occludedSeries[r], r ? culler->getLastOccludedCount() : 0);
+			recorder.setValue(trianglesSeries[r], driver->getPrimitiveCountDrawn());
+		}
+	}
+
+	recorder.setInfo("benchmark", core::stringc("occlusion"));
+	recorder.setInfo("cubes", OcclusionCubeCount);
+	recorder.setInfo("occluder_triangles", culler->getLastTriangleCount());
+
+	culler->remove();
+	culler->drop();
+	for (u32 i=0; i<cubes.size(); ++i)
+		cubes[i]->remove();
+	wall->remove();
+	camera->remove();
+
+	return finishBenchmark(device, recorder, options);
+}
+
+
+// frames recorded, ships around the camera
+const u32 ImpostorSamples = 200;
+const u32 ImpostorShipCount = 64;
+
+// the first run draws every ship as its mesh
+const u32 ImpostorRunCount = 2;
+const c8* const ImpostorLabels[ImpostorRunCount] = { "off", "on" };
+
+/*
+Ships with a few thousand triangles each, most of them far away, seen
+from a camera turning around in their middle. Run it with -driver burnings
+or software to measure the impostors without a graphics card.
+*/
+int runImpostorBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	video::IVideoDriver* driver = device->getVideoDriver();
+	CBenchmarkRecorder recorder;
+	CQueryRandom random;
+
+	// first, like in the game, so it is registered before the ships
+	scene::CImpostorManager* impostors = new scene::CImpostorManager(smgr->getRootSceneNode(), smgr);
+
+	const core::aabbox3df area(-30000.f, -2000.f, -30000.f, 30000.f, 6000.f, 30000.f);
+	core::array<scene::ISceneNode*> ships;
+	for (u32 i=0; i<ImpostorShipCount; ++i)
+	{
+		scene::ISceneNode* ship = smgr->addSphereSceneNode(200.f, 48, 0, -1, random.point(area),
+			core::vector3df(0, 0, 0), core::vector3df(2.f, 0.5f, 2.f));
+		ship->setMaterialFlag(video::EMF_LIGHTING, false);
+		ship->updateAbsolutePosition();
+		ships.push_back(ship);
+		impostors->addNode(ship);
+	}
+
+	scene::ICameraSceneNode* camera = smgr->addCameraSceneNode();
+	camera->setFarValue(90000.0f);
+
+	u32 drawSeries[ImpostorRunCount];
+	u32 trianglesSeries[ImpostorRunCount];
+	u32 impostorSeries[ImpostorRunCount];
+	u32 refreshSeries[ImpostorRunCount];
+	for (u32 r=0; r<ImpostorRunCount; ++r)
+	{
+		const core::stringc label(ImpostorLabels[r]);
+		drawSeries[r] = recorder.addSeries((label + "_draw_ms").c_str());
+		trianglesSeries[r] = recorder.addSeries((label + "_triangles").c_str());
+		impostorSeries[r] = recorder.addSeries((label + "_impostors").c_str());
+		refreshSeries[r] = recorder.addSeries((label + "_refreshes").c_str());
+	}
+
+	for (u32 sample=0; sample<ImpostorSamples; ++sample)
+	{
+		// once around, on a small circle
+		const f32 angle = (f32)sample / ImpostorSamples * 2.f * core::PI;
+		const core::vector3df position(2000.f * cosf(angle), 1000.f, 2000.f * sinf(angle));
+		camera->setPosition(position);
+		camera->setTarget(position + core::vector3df(cosf(angle), -0.1f, sinf(angle)));
+		camera->updateAbsolutePosition();
+
+		recorder.beginFrame();
+
+		for (u32 r=0; r<ImpostorRunCount; ++r)
+		{
+			impostors->setVisible(r != 0);
+
+			driver->beginScene(true, true, video::SColor(255,0,0,0));
+			const f64 start = getPreciseTimeMs();
+			smgr->drawAll();
+			recorder.setValue(drawSeries[r], getPreciseTimeMs() - start);
+			driver->endScene();
+
+			recorder.setValue(trianglesSeries[r], driver->getPrimitiveCountDrawn());
+			recorder.setValue(impostorSeries[r], r ? impostors->getLastImpostorCount() : 0);
+			recorder.setValue(refreshSeries[r], r ? impostors->getLastRefreshCount() : 0);
+		}
+	}
+
+	recorder.setInfo("benchmark", core::stringc("impostors"));
+	recorder.setInfo("driver", core::stringc(driver->getName()));
+	recorder.setInfo("ships", ImpostorShipCount);
+	recorder.setInfo("impostors_supported", impostors->isSupported() ? 1 : 0);
+	recorder.setInfo("snapshots", impostors->getRefreshCount());
+
+	impostors->remove();
+	impostors->drop();
+	for (u32 i=0; i<ships.size(); ++i)
+		ships[i]->remove();
+	camera->remove();
+
+	return finishBenchmark(device, recorder, options);
+}
+
+// ticks recorded per thread count, and virtual time ticked before measuring
+// memory, so the fire of every world is as large as it gets
+const u32 WorldSamples = 200;
+const u32 WorldWarmUpMs = 20000;
+const u32 WorldThreadCountCount = 7;
+const u32 WorldThreadCounts[WorldThreadCountCount] = { 1, 2, 4, 8, 16, 32, 64 };
+
+
+// Ticks the worlds of server from time on until WorldWarmUpMs later.
+u32 warmUpWorlds(scene::CWorldServer* server, u32 time, f32 frameTimeMs)
+{
+	const u32 ticks = (u32)(WorldWarmUpMs / frameTimeMs);
+	for (u32 i=0; i<ticks; ++i)
+		server->tick(time + (u32)(i * frameTimeMs));
+	return time + (u32)(ticks * frameTimeMs);
+}
+
+
+int runWorldBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	CBenchmarkRecorder recorder;
+	const u32 worldCount = core::max_(options.WorldCount, 2u);
+	const f32 frameTimeMs = options.BenchmarkFrameTimeMs;
+
+	const u64 startMemory = getProcessMemoryBytes();
+	scene::CMarsWorldAssets* assets = new scene::CMarsWorldAssets(device);
+	if (!assets->isValid())
+	{
+		device->getLogger()->log("Could not load the assets of the worlds", ELL_ERROR);
+		assets->drop();
+		return 1;
+	}
+	const u64 assetsMemory = getProcessMemoryBytes();
+
+	// one world first, then the others, each warmed up so the difference
+	// is what one more world costs while it runs
+	scene::CWorldServer* all = new scene::CWorldServer();
+	u32 time = 0;
+	for (u32 i=0; i<worldCount; ++i)
+	{
+		scene::CMarsWorld* world = new scene::CMarsWorld(device, assets, (f32)i / worldCount);
+		all->addWorld(world);
+		world->drop();
+
+		if (i == 0)
+			time = warmUpWorlds(all, time, frameTimeMs);
+	}
+	const u64 firstWorldMemory = getProcessMemoryBytes();
+	time = warmUpWorlds(all, time, frameTimeMs);
+	const u64 allWorldsMemory = getProcessMemoryBytes();
+
+	// the same worlds, ticked by one server per thread count
+	scene::CWorldServer* servers[WorldThreadCountCount];
+	u32 series[WorldThreadCountCount];
+	for (u32 t=0; t<WorldThreadCountCount; ++t)
+	{
+		servers[t] = new scene::CWorldServer(WorldThreadCounts[t]);
+		for (u32 i=0; i<worldCount; ++i)
+			servers[t]->addWorld(all->getWorld(i));
+		series[t] = recorder.addSeries((core::stringc("threads_") + core::stringc(WorldThreadCounts[t]) + "_ms").c_str());
+	}
+
+	f64 totals[WorldThreadCountCount] = { 0 };
+	for (u32 sample=0; sample<WorldSamples; ++sample)
+	{
+		recorder.beginFrame();
+
+		for (u32 t=0; t<WorldThreadCountCount; ++t)
+		{
+			servers[t]->tick(time);
+			time += (u32)frameTimeMs;
+
+			const f64 ms = servers[t]->getLastTickTimeMs();
+			recorder.setValue(series[t], ms);
+			totals[t] += ms;
+		}
+	}
+
+	recorder.setInfo("benchmark", core::stringc("worlds"));
+	recorder.setInfo("worlds", worldCount);
+	recorder.setInfo("hardware_threads", CThreadPool::getHardwareThreadCount());
+	recorder.setInfo("shared_bytes", assets->getSharedBytes());
+	recorder.setInfo("memory_assets_bytes", (f64)assetsMemory - (f64)startMemory);
+	recorder.setInfo("memory_first_world_bytes", (f64)firstWorldMemory - (f64)assetsMemory);
+	recorder.setInfo("memory_per_world_bytes", ((f64)allWorldsMemory - (f64)firstWorldMemory) / (worldCount - 1));
+	for (u32 t=0; t<WorldThreadCountCount; ++t)
+	{
+		const core::stringc count(WorldThreadCounts[t]);
+		recorder.setInfo((core::stringc("world_ticks_per_s_") + count).c_str(),
+			totals[t] > 0 ? worldCount * WorldSamples * 1000.0 / totals[t] : 0.0);
+		recorder.setInfo((core::stringc("speedup_") + count + "_vs_1").c_str(),
+			totals[t] > 0 ? totals[0] / totals[t] : 0.0);
+	}
+
+	for (u32 t=0; t<WorldThreadCountCount; ++t)
+		servers[t]->drop();
+	all->drop();
+	assets->drop();
+
+	return finishBenchmark(device, recorder, options);
+}
+
+// Adds the cube tower of the game, 12 levels of 16 cubes, see main().
+scene::CCubeFieldSceneNode* addCubeTower(scene::ISceneManager* smgr)
+{
+	scene::IMesh* cubeMesh = smgr->getGeometryCreator()->createCubeMesh(core::vector3df(10.f, 10.f, 10.f));
+	scene::CCubeFieldSceneNode* tower = new scene::CCubeFieldSceneNode(cubeMesh,
+		core::vector3df(12.f, 12.f, 12.f), smgr->getRootSceneNode(), smgr);
+	cubeMesh->drop();
+	tower->drop(); // the root node keeps it
+
+	for (u32 level=1; level<=12; ++level)
+	{
+		// every fourth cube sticks out of the row
+		core::vector3df position(0.f, -400.f + level * 130.f, 0.f);
+		const f32 speed = level % 2 ? 0.3f : 1.2f;
+		for (u32 i=1; i<=16; ++i)
+		{
+			if (i % 4 == 0)
+			{
+				tower->addInstance(position + core::vector3df(130.f, 0.f, -130.f), speed);
+				position.X -= 130.f;
+			}
+			else
+			{
+				tower->addInstance(position, speed);
+				position.Z += 130.f;
+			}
+		}
+	}
+
+	tower->OnAnimate(0);
+	return tower;
+}
+
+
+// recorded samples, and moves of the camera ellipsoid per sample
+const u32 CollisionSamples = 200;
+const u32 CollisionMovesPerSample = 50;
+
+// ellipsoid and gravity of the camera, and how far the FPS camera walks
+// in a frame at 60 frames per second, see main()
+const core::vector3df CollisionRadius(60.f, 100.f, 60.f);
+const core::vector3df CollisionGravity(0.f, -9.8f, 0.f);
+const f32 CollisionMoveLength = 1000.f / 60.f;
+
+// the tower alone, the gates alone and both in one world
+const u32 CollisionWorldCount = 3;
+const c8* const CollisionLabels[CollisionWorldCount] = { "tower", "gates", "both" };
+
+
+int runCollisionBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	scene::ISceneCollisionManager* collision = smgr->getSceneCollisionManager();
+	CBenchmarkRecorder recorder;
+	CQueryRandom random;
+
+	core::array<scene::IMesh*> gateLevels;
+	if (!getGameMeshLevels(smgr, "MayaObjects/SciFIGateArray2.obj", gateLevels, 2))
+	{
+		device->getLogger()->log("Could not load benchmark mesh", "MayaObjects/SciFIGateArray2.obj", ELL_ERROR);
+		return 1;
+	}
+
+	scene::CBroadphaseTriangleSelector* worlds[CollisionWorldCount];
+	u32 series[CollisionWorldCount];
+	for (u32 w=0; w<CollisionWorldCount; ++w)
+	{
+		worlds[w] = new scene::CBroadphaseTriangleSelector();
+		series[w] = recorder.addSeries((core::stringc(CollisionLabels[w]) + "_us").c_str());
+	}
+	const u32 candidateSeries = recorder.addSeries("both_candidates");
+
+	// the moves start around the tower and around the gates by turns
+	core::aabbox3df areas[2];
+
+	scene::CCubeFieldSceneNode* tower = addCubeTower(smgr);
+	scene::ITriangleSelector* selector = tower->createTriangleSelector();
+	worlds[0]->addTriangleSelector(selector, tower);
+	worlds[2]->addTriangleSelector(selector, tower);
+	selector->drop();
+	areas[0] = tower->getTransformedBoundingBox();
+
+	// collision uses level 1, like in the game
+	scene::CBvhTree* gateTree = new scene::CBvhTree(gateLevels.getLast());
+	core::array<scene::ISceneNode*> gates;
+	for (s32 i=0; i<4; ++i)
+	{
+		scene::IMeshSceneNode* gate = smgr->addMeshSceneNode(gateLevels[0], 0, -1,
+			core::vector3df((f32)(9800 + i * 2500), 550.f, -2000.f),
+			core::vector3df(0.f, 0.f, 0.f), core::vector3df(20.f, 20.f, 20.f));
+		gate->updateAbsolutePosition();
+		gates.push_back(gate);
+
+		selector = scene::createBvhTriangleSelector(gateTree, gate);
+		worlds[1]->addTriangleSelector(selector);
+		worlds[2]->addTriangleSelector(selector);
+		selector->drop();
+
+		if (i == 0)
+			areas[1] = gate->getTransformedBoundingBox();
+		else
+			areas[1].addInternalBox(gate->getTransformedBoundingBox());
+	}
+
+	for (u32 a=0; a<2; ++a)
+	{
+		const core::vector3df margin = areas[a].getExtent() * 0.1f;
+		areas[a].MinEdge -= margin;
+		areas[a].MaxEdge += margin;
+	}
+
+	recorder.setInfo("benchmark", core::stringc("collision"));
+	recorder.setInfo("tower_cubes", tower->getInstanceCount());
+	recorder.setInfo("gate_triangles", gateTree->getTriangleCount());
+	recorder.setInfo("moves_per_sample", CollisionMovesPerSample);
+	gateTree->drop();
+
+	for (u32 sample=0; sample<CollisionSamples; ++sample)
+	{
+		core::vector3df positions[CollisionMovesPerSample];
+		core::vector3df moves[CollisionMovesPerSample];
+		for (u32 m=0; m<CollisionMovesPerSample; ++m)
+		{
+			positions[m] = random.point(areas[m % 2]);
+			const f32 angle = random.frand() * 2.f * core::PI;
+			moves[m].set(cosf(angle) * CollisionMoveLength, 0.f, sinf(angle) * CollisionMoveLength);
+		}
+
+		recorder.beginFrame();
+
+		for (u32 w=0; w<CollisionWorldCount; ++w)
+		{
+			// the tower and the gates only get the moves near them
+			const u32 first = w == 1 ? 1 : 0;
+			const u32 step = w == 2 ? 1 : 2;
+
+			u32 moveCount = 0;
+			u32 candidates = 0;
+			const f64 start = getPreciseTimeMs();
+			for (u32 m=first; m<CollisionMovesPerSample; m+=step)
+			{
+				core::triangle3df triangle;
+				core::vector3df hit;
+				bool falling = false;
+				scene::ISceneNode* node = 0;
+				collision->getCollisionResultPosition(worlds[w], positions[m], CollisionRadius,
+					moves[m], triangle, hit, falling, node, 0.0005f, CollisionGravity);
+				candidates += worlds[w]->getLastCandidateCount();
+				++moveCount;
+			}
+			recorder.setValue(series[w], (getPreciseTimeMs() - start) * 1000. / moveCount);
+
+			if (w == 2)
+				recorder.setValue(candidateSeries, (f64)candidates / moveCount);
+		}
+	}
+
+	for (u32 w=0; w<CollisionWorldCount; ++w)
+		worlds[w]->drop();
+	tower->remove();
+	for (u32 i=0; i<gates.size(); ++i)
+		gates[i]->remove();
+
+	return finishBenchmark(device, recorder, options);
+}
+
+
+// frames recorded, and the circle the moving light flies around the tower
+const u32 ShadowSamples = 200;
+const core::vector3df ShadowLightCenter(0.f, 2500.f, 0.f);
+const f32 ShadowLightOrbit = 3000.f;
+
+// the level of detail the ufos cast their shadows with, see main()
+const u32 ShadowLevel = 2;
+
+// one manager per caster set and light, so each keeps only its own volumes
+const u32 ShadowRunCount = 4;
+const c8* const ShadowLabels[ShadowRunCount] = { "tower_static", "tower_moving", "ufos_static", "ufos_moving" };
+
+
+int runShadowBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	CBenchmarkRecorder recorder;
+
+	core::array<scene::IMesh*> ufoLevels;
+	if (!getGameMeshLevels(smgr, "MayaObjects/UFO.obj", ufoLevels))
+	{
+		device->getLogger()->log("Could not load benchmark mesh", "MayaObjects/UFO.obj", ELL_ERROR);
+		return 1;
+	}
+	scene::IMesh* ufoShadowMesh = ufoLevels[core::min_(ShadowLevel, ufoLevels.size() - 1)];
+
+	scene::CCubeFieldSceneNode* tower = addCubeTower(smgr);
+
+	// the three ufos of the game, parked above the tower
+	core::array<scene::ISceneNode*> ufos;
+	const f32 ufoScales[3] = { 10.f, 20.f, 20.f };
+	for (u32 i=0; i<3; ++i)
+	{
+		scene::ISceneNode* ufo = smgr->addMeshSceneNode(ufoLevels[0], 0, -1,
+			core::vector3df(-1500.f + i * 1500.f, 1800.f, 800.f),
+			core::vector3df(0.f, 0.f, 0.f), core::vector3df(ufoScales[i], ufoScales[i], ufoScales[i]));
+		ufo->updateAbsolutePosition();
+		ufos.push_back(ufo);
+	}
+
+	scene::ICameraSceneNode* camera = smgr->addCameraSceneNode(0,
+		core::vector3df(0.f, 1000.f, -4000.f), core::vector3df(0.f, 500.f, 0.f));
+	camera->setFarValue(42000.0f);
+	camera->updateAbsolutePosition();
+
+	scene::ILightSceneNode* lights[2];
+	lights[0] = smgr->addLightSceneNode(0, ShadowLightCenter, video::SColorf(1.f, 1.f, 1.f), 18000.f);
+	lights[1] = smgr->addLightSceneNode(0, ShadowLightCenter, video::SColorf(1.f, 1.f, 1.f), 18000.f);
+
+	scene::CShadowVolumeManager* managers[ShadowRunCount];
+	u32 series[ShadowRunCount];
+	for (u32 r=0; r<ShadowRunCount; ++r)
+	{
+		managers[r] = new scene::CShadowVolumeManager(smgr->getRootSceneNode(), smgr);
+		managers[r]->setBudget(0);
+		if (r < 2)
+			managers[r]->addCubeField(tower);
+		else
+			for (u32 i=0; i<ufos.size(); ++i)
+				managers[r]->addCaster(ufos[i], ufoShadowMesh);
+		series[r] = recorder.addSeries((core::stringc(ShadowLabels[r]) + "_ms").c_str());
+	}
+
+	for (u32 sample=0; sample<ShadowSamples; ++sample)
+	{
+		// the cubes turn like in the game
+		tower->OnAnimate((u32)(sample * options.BenchmarkFrameTimeMs));
+
+		const f32 angle = (f32)sample / ShadowSamples * 2.f * core::PI;
+		lights[1]->setPosition(ShadowLightCenter +
+			core::vector3df(cosf(angle) * ShadowLightOrbit, 0.f, sinf(angle) * ShadowLightOrbit));
+		lights[1]->updateAbsolutePosition();
+
+		recorder.beginFrame();
+
+		for (u32 r=0; r<ShadowRunCount; ++r)
+		{
+			const bool moving = r % 2 == 1;
+			lights[0]->setVisible(!moving);
+			lights[1]->setVisible(moving);
+
+			managers[r]->render();
+			recorder.setValue(series[r], managers[r]->getLastFrameTimeMs());
+		}
+	}
+
+	recorder.setInfo("benchmark", core::stringc("shadows"));
+	recorder.setInfo("tower_cubes", tower->getInstanceCount());
+	recorder.setInfo("ufos", ufos.size());
+	for (u32 r=0; r<ShadowRunCount; ++r)
+	{
+		const core::stringc label(ShadowLabels[r]);
+		recorder.setInfo((label + "_volume_hits").c_str(), managers[r]->getVolumeHitCount());
+		recorder.setInfo((label + "_silhouette_hits").c_str(), managers[r]->getSilhouetteHitCount());
+		recorder.setInfo((label + "_rebuilds").c_str(), managers[r]->getRebuildCount());
+	}
+
+	for (u32 r=0; r<ShadowRunCount; ++r)
+	{
+		managers[r]->remove();
+		managers[r]->drop();
+	}
+	lights[0]->remove();
+	lights[1]->remove();
+	camera->remove();
+	tower->remove();
+	for (u32 i=0; i<ufos.size(); ++i)
+		ufos[i]->remove();
+
+	return finishBenchmark(device, recorder, options);
+}
+
+
+// runs per mesh, each standing in for one more node using the mesh
+const u32 TangentSamples = 20;
+
+// the meshes the parallax and normal map materials could be used on
+const u32 TangentMeshCount = 5;
+const c8* const TangentLabels[TangentMeshCount] = { "cube", "ufo", "mothership", "gate", "rocks" };
+const c8* const TangentFiles[TangentMeshCount] =
+{
+	0, "MayaObjects/UFO.obj", "MayaObjects/MotherShip.obj",
+	"MayaObjects/SciFIGateArray2.obj", "MayaObjects/RockPack.obj"
+};
+
+
+int runTangentBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	const scene::IMeshManipulator* manipulator = smgr->getMeshManipulator();
+	scene::CMeshDerivationCache* cache = new scene::CMeshDerivationCache(smgr->getMeshManipulator());
+	CBenchmarkRecorder recorder;
+
+	// the cube of the tower, and the full level of every game mesh
+	scene::IMesh* meshes[TangentMeshCount];
+	u32 series[TangentMeshCount];
+	u32 cachedSeries[TangentMeshCount];
+	for (u32 m=0; m<TangentMeshCount; ++m)
+	{
+		if (TangentFiles[m])
+		{
+			scene::IAnimatedMesh* mesh = getGameMesh(smgr, TangentFiles[m]);
+			meshes[m] = mesh ? mesh->getMesh(0) : 0;
+			if (!meshes[m])
+				device->getLogger()->log("Could not load benchmark mesh", TangentFiles[m], ELL_ERROR);
+			else
+				meshes[m]->grab();
+		}
+		else
+			meshes[m] = smgr->getGeometryCreator()->createCubeMesh(core::vector3df(10.f, 10.f, 10.f));
+
+		series[m] = recorder.addSeries((core::stringc(TangentLabels[m]) + "_ms").c_str());
+		cachedSeries[m] = recorder.addSeries((core::stringc(TangentLabels[m]) + "_cached_ms").c_str());
+	}
+
+	for (u32 sample=0; sample<TangentSamples; ++sample)
+	{
+		recorder.beginFrame();
+
+		for (u32 m=0; m<TangentMeshCount; ++m)
+		{
+			if (!meshes[m])
+				continue;
+
+			f64 start = getPreciseTimeMs();
+			scene::IMesh* tangents = manipulator->createMeshWithTangents(meshes[m]);
+			recorder.setValue(series[m], getPreciseTimeMs() - start);
+			if (tangents)
+				tangents->drop();
+
+			// only the first sample builds the mesh, the others share it
+			start = getPreciseTimeMs();
+			cache->getMeshWithTangents(meshes[m]);
+			recorder.setValue(cachedSeries[m], getPreciseTimeMs() - start);
+		}
+	}
+
+	recorder.setInfo("benchmark", core::stringc("tangents"));
+	recorder.setInfo("mesh_cache_hits", cache->getHitCount());
+	recorder.setInfo("mesh_cache_misses", cache->getMissCount());
+	recorder.setInfo("mesh_cache_bytes_saved", cache->getBytesSaved());
+	recorder.setInfo("mesh_cache_bytes", cache->getBytesCached());
+	cache->drop();
+	for (u32 m=0; m<TangentMeshCount; ++m)
+	{
+		u32 vertices = 0;
+		for (u32 b=0; meshes[m] && b<meshes[m]->getMeshBufferCount(); ++b)
+			vertices += meshes[m]->getMeshBuffer(b)->getVertexCount();
+		recorder.setInfo((core::stringc(TangentLabels[m]) + "_vertices").c_str(), vertices);
+
+		if (meshes[m])
+			meshes[m]->drop();
+	}
+
+	return finishBenchmark(device, recorder, options);
+}
+
+
+// loads per file after the first one, which also loads the textures
+const u32 LoadSamples = 10;
+const u32 LoadDirectoryCount = 2;
+const c8* const LoadDirectories[LoadDirectoryCount] = { "MayaObjects", "Objects" };
+
+
+int runLoadBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	scene::ISceneManager* smgr = device->getSceneManager();
+	scene::IMeshCache* meshCache = smgr->getMeshCache();
+	io::IFileSystem* fileSystem = device->getFileSystem();
+	CBenchmarkRecorder recorder;
+
+	// every .obj and .x file, in a fixed order
+	core::array<io::path> files;
+	const io::path workingDirectory = fileSystem->getWorkingDirectory();
+	for (u32 d=0; d<LoadDirectoryCount; ++d)
+	{
+		if (!fileSystem->changeWorkingDirectoryTo(LoadDirectories[d]))
+			continue;
+
+		io::IFileList* list = fileSystem->createFileList();
+		for (u32 i=0; i<list->getFileCount(); ++i)
+		{
+			if (!list->isDirectory(i) && core::hasFileExtension(list->getFileName(i), "obj", "x"))
+				files.push_back(io::path(LoadDirectories[d]) + "/" + list->getFileName(i));
+		}
+		list->drop();
+		fileSystem->changeWorkingDirectoryTo(workingDirectory);
+	}
+	files.sort();
+
+	if (files.empty())
+	{
+		device->getLogger()->log("No meshes to load found", ELL_ERROR);
+		return 1;
+	}
+
+	core::array<u32> series;
+	for (u32 f=0; f<files.size(); ++f)
+	{
+		series.push_back(recorder.addSeries((core::stringc(files[f]) + "_ms").c_str()));
+
+		// loaded by an earlier benchmark
+		scene::IAnimatedMesh* cached = meshCache->getMeshByName(files[f]);
+		if (cached)
+			meshCache->removeMesh(cached);
+
+		const f64 start = getPreciseTimeMs();
+		scene::IAnimatedMesh* mesh = smgr->getMesh(files[f]);
+		recorder.setInfo((core::stringc(files[f]) + "_first_ms").c_str(), getPreciseTimeMs() - start);
+		if (mesh)
+			meshCache->removeMesh(mesh);
+		else
+			device->getLogger()->log("Could not load benchmark mesh", files[f].c_str(), ELL_ERROR);
+	}
+
+	for (u32 sample=0; sample<LoadSamples; ++sample)
+	{
+		recorder.beginFrame();
+
+		for (u32 f=0; f<files.size(); ++f)
+		{
+			const f64 start = getPreciseTimeMs();
+			scene::IAnimatedMesh* mesh = smgr->getMesh(files[f]);
+			recorder.setValue(series[f], getPreciseTimeMs() - start);
+			if (mesh)
+				meshCache->removeMesh(mesh);
+		}
+	}
+
+	recorder.setInfo("benchmark", core::stringc("loading"));
+	recorder.setInfo("files", files.size());
+
+	return finishBenchmark(device, recorder, options);
+}
+
+
+struct SMicroBenchmark
+{
+	const c8* Name;
+	int (*Run)(IrrlichtDevice* device, const SGameOptions& options);
+};
+
+// in the order -microbench all runs them
+const SMicroBenchmark MicroBenchmarkList[] =
+{
+	{ "selectors", runSelectorBenchmark },
+	{ "collision", runCollisionBenchmark },
+	{ "shadows", runShadowBenchmark },
+	{ "particles", runParticleBenchmark },
+	{ "water", runWaterBenchmark },
+	{ "tangents", runTangentBenchmark },
+	{ "loading", runLoadBenchmark },
+	{ "terrain", runTerrainBenchmark },
+	{ "lights", runLightBenchmark },
+	{ "animators", runAnimatorBenchmark },
+	{ "skinning", runSkinningBenchmark },
+	{ "occlusion", runOcclusionBenchmark },
+	{ "impostors", runImpostorBenchmark },
+	{ "worlds", runWorldBenchmark }
+};
+const u32 MicroBenchmarkCount = sizeof(MicroBenchmarkList) / sizeof(MicroBenchmarkList[0]);
+
+} // end anonymous namespace
+
+
+int runMicroBenchmark(IrrlichtDevice* device, const SGameOptions& options)
+{
+	if (options.MicroBenchmark == "all")
+	{
+		// every report next to the one asked for, named after its benchmark
+		io::path base;
+		core::cutFilenameExtension(base, options.BenchmarkOutput);
+
+		int result = 0;
+		for (u32 i=0; i<MicroBenchmarkCount; ++i)
+		{
+			SGameOptions single(options);
+			single.MicroBenchmark = MicroBenchmarkList[i].Name;
+			single.BenchmarkOutput = base + "_" + MicroBenchmarkList[i].Name + ".json";
+			result |= MicroBenchmarkList[i].Run(device, single);
+		}
+		return result;
+	}
+
+	for (u32 i=0; i<MicroBenchmarkCount; ++i)
+		if (options.MicroBenchmark == MicroBenchmarkList[i].Name)
+			return MicroBenchmarkList[i].Run(device, options);
+
+	device->getLogger()->log("Unknown micro benchmark", options.MicroBenchmark.c_str(), ELL_ERROR);
+	return 1;
+}
+
+} // end namespace irr
@@ -0,0 +1,24 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+
+Micro benchmarks of single engine subsystems, run with -microbench <name>.
+They load only what they measure and write their report in the same JSON
+format as the flythrough benchmark.
+*/
+#ifndef __MICRO_BENCHMARKS_H_INCLUDED__
+#define __MICRO_BENCHMARKS_H_INCLUDED__
+
+#include <irrlicht.h>
+#include "GameOptions.h"
+
+namespace irr
+{
+
+//! Runs the micro benchmark options.MicroBenchmark.
+/** \return Exit code for main(), 0 on success. */
+int runMicroBenchmark(IrrlichtDevice* device, const SGameOptions& options);
+
+} // end namespace irr
+
+#endif
@@ -0,0 +1,49 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+
+Memory the process uses, to tell what an object costs by measuring before
+and after creating many of them. Irrlicht has no way to ask for it.
+*/
+#ifndef __PROCESS_MEMORY_H_INCLUDED__
+#define __PROCESS_MEMORY_H_INCLUDED__
+
+#include <irrlicht.h>
+
+#ifdef _IRR_WINDOWS_
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
+namespace irr
+{
+
+//! Returns the memory of the process in bytes, 0 if it is not known.
+/** On Windows the private bytes, on Linux the resident set. */
+inline u64 getProcessMemoryBytes()
+{
+#ifdef _IRR_WINDOWS_
+	PROCESS_MEMORY_COUNTERS_EX counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters)))
+		return 0;
+	return (u64)counters.PrivateUsage;
+#else
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (!file)
+		return 0;
+	unsigned long size = 0;
+	unsigned long resident = 0;
+	const int read = fscanf(file, "%lu %lu", &size, &resident);
+	fclose(file);
+	return read == 2 ? (u64)resident * (u64)sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+} // end namespace irr
+
+#endif
@@ -0,0 +1,276 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+*/
+#include "TextureCooker.h"
+#include "CAssetLoader.h"
+#include "CTextureAtlas.h"
+#include "CookedTextureFormat.h"
+
+namespace irr
+{
+
+namespace
+{
+
+struct SGameTexture
+{
+	const c8* Name;
+	bool MipMaps;
+};
+
+// Every texture main() loads with driver->getTexture(), including the ones
+// the .obj materials refer to.
+const SGameTexture GameTextures[] =
+{
+	{ "Objects/Zuleyka_Skin.PNG", true },
+	{ "Objects/terrmain.jpg", true },
+	{ "Objects/terrdetail.jpg", true },
+	// the sky dome is created without mipmaps
+	{ "Objects/scifidome3.jpg", false },
+	{ "Objects/lunar.jpg", true },
+	{ "Objects/texture1.tga", true },
+	{ "MayaObjects/rockmat.jpg", true },
+	{ "MayaObjects/UfoPaint.png", true },
+	{ "MayaObjects/ShipPaint.png", true },
+	{ "../../../media/particlewhite.bmp", true },
+	{ "../../../media/fireball.bmp", true },
+	{ "../../../media/lava.jpg", true },
+	{ "../../../media/water.jpg", true }
+};
+
+// The textures packed into the atlas of the ships. ShipMatMain*.jpg,
+// rockmat2.jpg and MatUV.png are not used by any mesh, and the rocks repeat
+// rockmat.jpg across their faces, which an atlas cell can not do.
+const c8* const AtlasTextures[] =
+{
+	"MayaObjects/ShipPaint.png",
+	"MayaObjects/UfoPaint.png"
+};
+
+void getAtlasTextures(core::array<io::path>& names)
+{
+	const u32 count = sizeof(AtlasTextures) / sizeof(AtlasTextures[0]);
+	for (u32 i=0; i<count; ++i)
+		names.push_back(AtlasTextures[i]);
+}
+
+// True if the layout of atlas holds the listed textures and no others.
+bool hasAtlasTextures(const CTextureAtlas& atlas)
+{
+	const u32 count = sizeof(AtlasTextures) / sizeof(AtlasTextures[0]);
+	if (atlas.getImageCount() != count)
+		return false;
+	for (u32 i=0; i<count; ++i)
+		if (!atlas.containsImage(AtlasTextures[i]))
+			return false;
+	return true;
+}
+
+void logAtlas(ILogger* logger, const CTextureAtlas& atlas)
+{
+	core::stringc text("Texture atlas ");
+	text += GAME_ATLAS_IMAGE;
+	text += ": ";
+	text += atlas.getImageCount();
+	text += " textures in ";
+	text += atlas.getSize().Width;
+	text += "x";
+	text += atlas.getSize().Height;
+	text += ", ";
+	text += (u32)(atlas.getOccupancy() * 100.f + 0.5f);
+	text += "% occupied";
+	logger->log(text.c_str(), ELL_INFORMATION);
+}
+
+u32 getPowerOfTwo(u32 size)
+{
+	u32 result = 1;
+	while (result < size)
+		result <<= 1;
+	return result;
+}
+
+// Averages 2x2 blocks of source into target. A side which is already 1
+// pixel long stays 1, so non square chains reach 1x1.
+void buildMipLevel(const u32* source, u32 sourceWidth, u32 sourceHeight, u32* target)
+{
+	const u32 width = core::max_(sourceWidth >> 1, 1u);
+	const u32 height = core::max_(sourceHeight >> 1, 1u);
+
+	for (u32 y=0; y<height; ++y)
+	{
+		const u32* row0 = source + core::min_(y * 2, sourceHeight - 1) * sourceWidth;
+		const u32* row1 = source + core::min_(y * 2 + 1, sourceHeight - 1) * sourceWidth;
+
+		for (u32 x=0; x<width; ++x)
+		{
+			const u32 x0 = core::min_(x * 2, sourceWidth - 1);
+			const u32 x1 = core::min_(x * 2 + 1, sourceWidth - 1);
+			const u32 a = row0[x0], b = row0[x1], c = row1[x0], d = row1[x1];
+
+			u32 pixel = 0;
+			for (u32 shift=0; shift<32; shift+=8)
+			{
+				const u32 sum = ((a >> shift) & 0xff) + ((b >> shift) & 0xff) +
+					((c >> shift) & 0xff) + ((d >> shift) & 0xff);
+				pixel |= ((sum + 2) >> 2) << shift;
+			}
+			*target++ = pixel;
+		}
+	}
+}
+
+} // end anonymous namespace
+
+
+bool cookTexture(IrrlichtDevice* device, const io::path& source, bool mipMaps)
+{
+	video::IVideoDriver* driver = device->getVideoDriver();
+	io::IFileSystem* fileSystem = device->getFileSystem();
+	ILogger* logger = device->getLogger();
+
+	video::IImage* image = driver->createImageFromFile(source);
+	if (!image)
+	{
+		logger->log("Could not load texture to cook", source.c_str(), ELL_ERROR);
+		return false;
+	}
+
+	video::SCookedTextureHeader header;
+	header.Magic = video::COOKED_TEXTURE_MAGIC;
+	header.Version = video::COOKED_TEXTURE_VERSION;
+	header.OriginalWidth = image->getDimension().Width;
+	header.OriginalHeight = image->getDimension().Height;
+	// the drivers scale textures up to a power of two as well
+	header.Width = getPowerOfTwo(header.OriginalWidth);
+	header.Height = getPowerOfTwo(header.OriginalHeight);
+	header.ColorFormat = video::ECF_A8R8G8B8;
+	header.LevelCount = 1;
+	if (mipMaps)
+		while ((core::max_(header.Width, header.Height) >> (header.LevelCount - 1)) > 1)
+			++header.LevelCount;
+
+	core::array<u32> pixels;
+	pixels.set_used(video::getCookedTextureDataSize(header) / 4);
+	image->copyToScaling(pixels.pointer(), header.Width, header.Height, video::ECF_A8R8G8B8);
+	image->drop();
+
+	u32* level = pixels.pointer();
+	for (u32 i=1; i<header.LevelCount; ++i)
+	{
+		u32* next = level + video::getCookedTextureLevelSize(header, i - 1) / 4;
+		buildMipLevel(level, core::max_(header.Width >> (i - 1), 1u),
+			core::max_(header.Height >> (i - 1), 1u), next);
+		level = next;
+	}
+
+	const io::path cooked = video::getCookedTextureName(source);
+	io::IWriteFile* file = fileSystem->createAndWriteFile(cooked);
+	const u32 dataSize = pixels.size() * 4;
+	const bool written = file &&
+		file->write(&header, sizeof(header)) == (s32)sizeof(header) &&
+		file->write(pixels.pointer(), dataSize) == (s32)dataSize;
+	if (file)
+		file->drop();
+
+	if (written)
+		logger->log("Cooked texture", cooked.c_str(), ELL_INFORMATION);
+	else
+		logger->log("Could not write cooked texture", cooked.c_str(), ELL_ERROR);
+	return written;
+}
+
+
+int cookGameTextures(IrrlichtDevice* device)
+{
+	int result = 0;
+	const u32 count = sizeof(GameTextures) / sizeof(GameTextures[0]);
+	for (u32 i=0; i<count; ++i)
+		if (!cookTexture(device, GameTextures[i].Name, GameTextures[i].MipMaps))
+			result = 1;
+	return result;
+}
+
+
+void addGameTextures(CAssetLoader& assets)
+{
+	const u32 count = sizeof(GameTextures) / sizeof(GameTextures[0]);
+	for (u32 i=0; i<count; ++i)
+		assets.addTexture(GameTextures[i].Name, GameTextures[i].MipMaps);
+}
+
+
+int cookGameAtlas(IrrlichtDevice* device)
+{
+	video::IVideoDriver* driver = device->getVideoDriver();
+	ILogger* logger = device->getLogger();
+
+	core::array<io::path> names;
+	getAtlasTextures(names);
+
+	CTextureAtlas atlas(driver, device->getFileSystem());
+	video::IImage* image = atlas.build(names);
+	if (!image)
+	{
+		logger->log("Could not pack texture atlas", GAME_ATLAS_IMAGE, ELL_ERROR);
+		return 1;
+	}
+	for (u32 i=0; i<names.size(); ++i)
+		if (!atlas.containsImage(names[i]))
+			logger->log("Texture left out of atlas", names[i].c_str(), ELL_WARNING);
+	logAtlas(logger, atlas);
+
+	const bool written = driver->writeImageToFile(image, GAME_ATLAS_IMAGE) &&
+		atlas.writeLayout(GAME_ATLAS_LAYOUT);
+	image->drop();
+	if (!written)
+	{
+		logger->log("Could not write texture atlas", GAME_ATLAS_IMAGE, ELL_ERROR);
+		return 1;
+	}
+
+	logger->log("Cooked texture atlas", GAME_ATLAS_LAYOUT, ELL_INFORMATION);
+	return cookTexture(device, GAME_ATLAS_IMAGE, true) ? 0 : 1;
+}
+
+
+bool loadGameAtlas(IrrlichtDevice* device, CTextureAtlas& atlas)
+{
+	video::IVideoDriver* driver = device->getVideoDriver();
+	io::IFileSystem* fileSystem = device->getFileSystem();
+	ILogger* logger = device->getLogger();
+
+	if (fileSystem->existFile(GAME_ATLAS_IMAGE) && atlas.readLayout(GAME_ATLAS_LAYOUT))
+	{
+		if (hasAtlasTextures(atlas))
+			atlas.setTexture(driver->getTexture(GAME_ATLAS_IMAGE));
+		else
+			logger->log("Texture atlas is out of date, cook again", GAME_ATLAS_LAYOUT, ELL_WARNING);
+	}
+
+	if (!atlas.getTexture())
+	{
+		core::array<io::path> names;
+		getAtlasTextures(names);
+
+		video::IImage* image = atlas.build(names);
+		if (image)
+		{
+			// under the name getTexture() would have given the cooked one
+			atlas.setTexture(driver->addTexture(fileSystem->getAbsolutePath(GAME_ATLAS_IMAGE), image));
+			image->drop();
+		}
+	}
+
+	if (!atlas.getTexture())
+	{
+		logger->log("Could not load texture atlas", GAME_ATLAS_IMAGE, ELL_ERROR);
+		return false;
+	}
+
+	logAtlas(logger, atlas);
+	return true;
+}
+
+} // end namespace irr
@@ -0,0 +1,58 @@
+/*
+Mars Game Simulator
+Developed BY: Touraj Ebrahimi
+
+-cook also converts the textures of the game into .ctex files next to their
+sources: scaled to a power of two, converted to 32 bit and with their mip
+levels already built. The asset loader uploads a cooked texture without
+decoding it or building mipmaps, and uses the source image when there is no
+cooked file. Like meshes, textures have to be cooked again after changing.
+
+The textures of the mother ship and the ufos are also packed into one atlas,
+MayaObjects/ShipAtlas.png, with its layout in ShipAtlas.catl; cooking writes
+both and a cooked file of the atlas image. Without them, the game packs the
+atlas when it starts.
+*/
+#ifndef __TEXTURE_COOKER_H_INCLUDED__
+#define __TEXTURE_COOKER_H_INCLUDED__
+
+#include <irrlicht.h>
+
+namespace irr
+{
+
+class CAssetLoader;
+class CTextureAtlas;
+
+//! Image of the texture atlas of the ships.
+const c8* const GAME_ATLAS_IMAGE = "MayaObjects/ShipAtlas.png";
+
+//! Layout of the texture atlas of the ships.
+const c8* const GAME_ATLAS_LAYOUT = "MayaObjects/ShipAtlas.catl";
+
+//! Cooks one image.
+/** \param mipMaps Build the mip levels, false for textures created
+without ETCF_CREATE_MIP_MAPS like the sky dome.
+\return True if the cooked file was written. */
+bool cookTexture(IrrlichtDevice* device, const io::path& source, bool mipMaps);
+
+//! Cooks all textures the game loads.
+/** \return Exit code for main(), 0 if every texture was cooked. */
+int cookGameTextures(IrrlichtDevice* device);
+
+//! Adds all textures of the game to assets, with the right mipmap setting.
+void addGameTextures(CAssetLoader& assets);
+
+//! Packs the texture atlas of the ships and writes it, see above.
+/** \return Exit code for main(), 0 if the atlas was written. */
+int cookGameAtlas(IrrlichtDevice* device);
+
+//! Loads the cooked texture atlas of the ships into atlas, or packs it.
+/** A cooked layout which does not hold exactly the images listed in
+TextureCooker.cpp is ignored.
+\return False if there is no texture for the atlas. */
+bool loadGameAtlas(IrrlichtDevice* device, CTextureAtlas& atlas);
+
+} // end namespace irr
+
+#endif